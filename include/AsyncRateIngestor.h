@@ -0,0 +1,110 @@
+#ifndef POS_ASYNC_RATE_INGESTOR_H
+#define POS_ASYNC_RATE_INGESTOR_H
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+#include "POSTransaction.h"
+#include "MPSCQueue.h"
+
+namespace pos
+{
+
+// Asynchronous ingestion of rates into manager.
+// Producers validate rate and push it to lock-free queue. Single writer thread
+// drains queue in batches, groups updates by currency and applies batch
+// under one manager lock.
+class AsyncRateIngestor
+{
+private:
+    POSTransactionManager& m_manager;
+    const size_t m_batchSize;
+    MPSCQueue<RateUpdate> m_queue;
+
+    // counted before update is pushed to queue
+    std::atomic<uint64_t> m_pushedCount;
+    std::atomic<bool> m_writerWaiting;
+    uint64_t m_appliedCount = 0;
+    uint64_t m_batchesCount = 0;
+    bool m_stopped = false;
+    mutable std::mutex m_guard;
+    std::condition_variable m_writerCv;
+    std::condition_variable m_flushCv;
+    std::thread m_writer;
+
+private:
+    void push(RateUpdate&& update);
+    void run();
+
+public:
+    AsyncRateIngestor(POSTransactionManager& manager, const size_t batchSize = 4096);
+    // applies all pushed updates
+    ~AsyncRateIngestor();
+
+    AsyncRateIngestor(const AsyncRateIngestor&) = delete;
+    AsyncRateIngestor& operator=(const AsyncRateIngestor&) = delete;
+
+    // rate is validated synchronously and applied later
+    template<class T1, class T2>
+    Result addExchangeRate(
+        T1&& fromCurrency,
+        T2&& toCurrency,
+        const time_t fromDate,
+        const time_t toDate,
+        double rate);
+    template<class T1, class T2>
+    Result addExchangeRate(
+        T1&& fromCurrency,
+        T2&& toCurrency,
+        const time_t fromDate,
+        double rate);
+
+    // wait until all rates pushed before the call are visible in manager
+    void flush();
+
+    uint64_t getAppliedCount() const;
+    uint64_t getBatchesCount() const;
+};
+
+template<class T1, class T2>
+Result AsyncRateIngestor::addExchangeRate(
+    T1&& fromCurrency,
+    T2&& toCurrency,
+    const time_t fromDate,
+    const time_t toDate,
+    double rate)
+{
+    RateUpdate update;
+    Result r = m_manager.makeRateUpdate(
+        update, std::forward<T1>(fromCurrency), std::forward<T2>(toCurrency), fromDate, toDate, rate);
+    if (Result::SUCCESS != r)
+    {
+        return r;
+    }
+    push(std::move(update));
+    return Result::SUCCESS;
+}
+
+template<class T1, class T2>
+Result AsyncRateIngestor::addExchangeRate(
+    T1&& fromCurrency,
+    T2&& toCurrency,
+    const time_t fromDate,
+    double rate)
+{
+    RateUpdate update;
+    Result r = m_manager.makeRateUpdate(
+        update, std::forward<T1>(fromCurrency), std::forward<T2>(toCurrency), fromDate, rate);
+    if (Result::SUCCESS != r)
+    {
+        return r;
+    }
+    push(std::move(update));
+    return Result::SUCCESS;
+}
+
+} // namespace pos
+
+#endif // POS_ASYNC_RATE_INGESTOR_H
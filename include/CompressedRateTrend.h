@@ -0,0 +1,50 @@
+#ifndef POS_COMPRESSED_RATE_TREND_H
+#define POS_COMPRESSED_RATE_TREND_H
+
+#include <cstdint>
+#include <ctime>
+#include <vector>
+
+#include "POSTransaction.h"
+
+namespace pos
+{
+
+// Compact read-mostly representation of rate trend.
+// Points are split into blocks of BLOCK_SIZE points. Inside block dates are
+// delta + varint encoded and rates are XOR encoded against previous rate
+// (repeated rate takes one byte). Block index (first date and offset of each
+// block) is used to find block by date.
+class CompressedRateTrend
+{
+public:
+    static constexpr size_t BLOCK_SIZE = 32;
+
+private:
+    std::vector<time_t> m_blockFirstDates;
+    std::vector<size_t> m_blockOffsets;
+    std::vector<uint8_t> m_data;
+    size_t m_size = 0;
+    time_t m_lastDate = 0;
+    uint64_t m_lastRateBits = 0;
+
+public:
+    CompressedRateTrend() = default;
+    explicit CompressedRateTrend(const POSTransactionManager::RateTrend& rateTrend);
+
+    // dates shall be appended in increasing order
+    Result append(const time_t date, const double rate);
+    // rate that is active at date
+    Result findRate(const time_t date, double& rate) const;
+    POSTransactionManager::RateTrend toRateTrend() const;
+
+    size_t size() const { return m_size; }
+    bool empty() const { return !m_size; }
+    // bytes used by representation
+    size_t getMemoryUsage() const;
+    void shrinkToFit();
+};
+
+} // namespace pos
+
+#endif // POS_COMPRESSED_RATE_TREND_H
@@ -0,0 +1,74 @@
+#ifndef POS_CONVERSION_CLIENT_H
+#define POS_CONVERSION_CLIENT_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "POSTransactionBatch.h"
+#include "ConversionProtocol.h"
+
+namespace pos
+{
+
+// Client of conversion daemon. Not thread safe.
+// send* methods buffer request and return its id. Buffered requests are written
+// together by flush or by the first receive*, so several requests may be in flight.
+// receive* waits for response of request. Responses that come before are kept
+// until they are received. IO_ERROR closes connection. Receive of request that was not
+// sent or was already received returns INVALID_FORMAT without waiting.
+class ConversionClient
+{
+private:
+    int m_fd = -1;
+    uint32_t m_nextRequestId = 1;
+    std::vector<uint8_t> m_output;
+    std::vector<uint8_t> m_input;
+    // requests that are sent and not received
+    std::unordered_set<uint32_t> m_pendingIds;
+    // responses received before they were asked
+    std::unordered_map<uint32_t, std::vector<uint8_t>> m_responses;
+    std::vector<uint8_t> m_response;
+
+private:
+    uint32_t beginRequest(const MessageType type, size_t& offset);
+    // payload of response to request
+    Result receive(const uint32_t requestId, const MessageType type, const uint8_t*& p, const uint8_t*& end);
+
+public:
+    ConversionClient() = default;
+    ~ConversionClient();
+
+    ConversionClient(const ConversionClient&) = delete;
+    ConversionClient& operator=(const ConversionClient&) = delete;
+
+    Result connect(const std::string& socketPath);
+    void close();
+    bool isConnected() const { return m_fd >= 0; }
+
+    uint32_t sendConvert(const POSTransactionBatch& fromBatch, const std::string& toCurrency);
+    uint32_t sendAddExchangeRates(const std::vector<ExchangeRate>& rates);
+    uint32_t sendExport(const std::string& currency);
+    // write buffered requests
+    Result flush();
+
+    // result of request or IO_ERROR / INVALID_FORMAT. total of failed row is NaN
+    Result receiveConvert(const uint32_t requestId, std::vector<double>& totals, std::vector<Result>& results);
+    Result receiveAddExchangeRates(const uint32_t requestId, std::vector<Result>& results);
+    Result receiveExport(const uint32_t requestId, RateTrend& rateTrend);
+
+    // send request and wait for response. toBatch gets rows of fromBatch in toCurrency
+    Result convert(
+        POSTransactionBatch& toBatch,
+        std::vector<Result>& results,
+        const POSTransactionBatch& fromBatch,
+        const std::string& toCurrency);
+    Result addExchangeRates(const std::vector<ExchangeRate>& rates, std::vector<Result>& results);
+    Result getExchangeRates(const std::string& currency, RateTrend& rateTrend);
+};
+
+} // namespace pos
+
+#endif // POS_CONVERSION_CLIENT_H
@@ -0,0 +1,115 @@
+#ifndef POS_CONVERSION_DAEMON_H
+#define POS_CONVERSION_DAEMON_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "POSTransaction.h"
+#include "ConversionProtocol.h"
+
+namespace pos
+{
+
+// Conversion service on Unix domain socket.
+// Event loop thread accepts connections, reads frames with epoll and queues them to
+// worker pool. Workers process requests and append responses to connection output,
+// which is written by event loop. Responses of one connection may come out of order
+// (they are matched by request id). Broken frame closes connection.
+// Connection is not read while its unsent output or number of its unfinished requests
+// is above limit, so client that does not receive responses cannot grow daemon memory.
+class ConversionDaemon
+{
+public:
+    static constexpr size_t READ_BUFFER_SIZE = 64 * 1024;
+    static constexpr size_t MAX_EVENTS = 64;
+    // reading of connection is paused above these limits
+    static constexpr size_t MAX_CONNECTION_OUTPUT = 4 * 1024 * 1024;
+    static constexpr size_t MAX_CONNECTION_TASKS = 256;
+
+private:
+    struct Connection
+    {
+        int m_fd;
+        // incomplete frame. used by event loop only
+        std::vector<uint8_t> m_input;
+        std::mutex m_outputGuard;
+        std::vector<uint8_t> m_output;
+        size_t m_outputPos = 0;
+        // requests that are queued or processed
+        size_t m_tasksCount = 0;
+        // EPOLLIN is requested. changed by event loop only
+        bool m_reading = true;
+        // EPOLLOUT is requested
+        bool m_writing = false;
+        // connection is in flush queue
+        bool m_flushQueued = false;
+        bool m_closed = false;
+    };
+    typedef std::shared_ptr<Connection> ConnectionPtr;
+
+    struct Task
+    {
+        ConnectionPtr m_connection;
+        std::vector<uint8_t> m_frame;
+    };
+
+    POSTransactionManager& m_manager;
+    const size_t m_workersCount;
+    std::string m_socketPath;
+    int m_listenFd = -1;
+    int m_epollFd = -1;
+    int m_eventFd = -1;
+    // used by event loop only
+    std::unordered_map<int, ConnectionPtr> m_connections;
+
+    std::mutex m_guard;
+    std::condition_variable m_tasksCv;
+    std::deque<Task> m_tasks;
+    std::vector<ConnectionPtr> m_flushQueue;
+    bool m_stopped = false;
+
+    std::atomic<uint64_t> m_requestsCount;
+    std::atomic<uint64_t> m_readPausesCount;
+    std::thread m_loop;
+    std::vector<std::thread> m_workers;
+
+private:
+    void runLoop();
+    void runWorker();
+    void accept();
+    void read(const ConnectionPtr& connection);
+    void flush(const ConnectionPtr& connection);
+    void close(const ConnectionPtr& connection);
+    // request EPOLLIN unless connection is over limits and EPOLLOUT while there is output left
+    void updateEventsUnsafe(Connection& connection);
+    void wakeUp();
+    void process(const std::vector<uint8_t>& frame, std::vector<uint8_t>& response);
+    void closeFds();
+
+public:
+    ConversionDaemon(POSTransactionManager& manager, const size_t workersCount = 2);
+    ~ConversionDaemon();
+
+    ConversionDaemon(const ConversionDaemon&) = delete;
+    ConversionDaemon& operator=(const ConversionDaemon&) = delete;
+
+    // listen on socket path. existing socket file is replaced
+    Result start(const std::string& socketPath);
+    // close connections and remove socket file. queued requests are dropped
+    void stop();
+
+    uint64_t getRequestsCount() const { return m_requestsCount.load(); }
+    // times reading of some connection was paused by limits
+    uint64_t getReadPausesCount() const { return m_readPausesCount.load(); }
+};
+
+} // namespace pos
+
+#endif // POS_CONVERSION_DAEMON_H
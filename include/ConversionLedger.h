@@ -0,0 +1,82 @@
+#ifndef POS_CONVERSION_LEDGER_H
+#define POS_CONVERSION_LEDGER_H
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "POSTransaction.h"
+
+namespace pos
+{
+
+struct LedgerEntry
+{
+    POSTransaction m_fromTransaction;
+    std::string m_toCurrency;
+    Result m_result;
+    POSTransaction m_toTransaction;
+};
+
+// Stored conversions with rate dependencies.
+// Conversion depends on rates of its non-base currencies at transaction date. Dependencies
+// are indexed by currency and date, so rate change in [fromDate, toDate) marks exactly
+// conversions whose rates could change. Affected conversions are taken by caller or
+// recomputed by ledger. Conversion that is marked while it is computed keeps its mark.
+class ConversionLedger : public RateChangeListener
+{
+private:
+    struct Entry
+    {
+        LedgerEntry m_entry;
+        // changed when conversion is marked as affected
+        uint64_t m_generation = 0;
+    };
+    typedef std::multimap<time_t, uint64_t> Dependencies;
+
+    POSTransactionManager& m_manager;
+    std::unordered_map<uint64_t, Entry> m_entries;
+    // conversion ids keyed by currency and date
+    std::unordered_map<std::string, Dependencies> m_dependencies;
+    std::set<uint64_t> m_affected;
+    uint64_t m_nextId = 1;
+    mutable std::mutex m_guard;
+
+private:
+    void addDependencyUnsafe(const std::string& currency, const time_t date, const uint64_t id);
+    void removeDependencyUnsafe(const std::string& currency, const time_t date, const uint64_t id);
+    // compute conversion if it is not marked during computation. true if result or total is changed
+    bool compute(const uint64_t id);
+
+public:
+    ConversionLedger(POSTransactionManager& manager);
+    ~ConversionLedger();
+
+    ConversionLedger(const ConversionLedger&) = delete;
+    ConversionLedger& operator=(const ConversionLedger&) = delete;
+
+    // convert and store conversion (failed conversions are stored too)
+    Result convertPOSTransaction(
+        uint64_t& id,
+        POSTransaction& toPosTransaction,
+        const POSTransaction& fromPosTransaction,
+        const std::string& toCurrency);
+    bool get(const uint64_t id, LedgerEntry& entry) const;
+    bool remove(const uint64_t id);
+    size_t size() const;
+
+    // ids of conversions affected by rate changes since the last take or reprice
+    std::vector<uint64_t> takeAffected();
+    // recompute affected conversions. returns ids of conversions with changed result or total
+    std::vector<uint64_t> reprice();
+
+    void onRatesChanged(const std::string& currency, const time_t fromDate, const time_t toDate) override;
+};
+
+} // namespace pos
+
+#endif // POS_CONVERSION_LEDGER_H
@@ -0,0 +1,89 @@
+#ifndef POS_CONVERSION_PROTOCOL_H
+#define POS_CONVERSION_PROTOCOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include "POSTransactionBatch.h"
+
+namespace pos
+{
+
+// Binary protocol of conversion daemon.
+// Frame is 4 byte little endian payload size and payload. Payload starts with 4 byte request id
+// and 1 byte message type. Response has id and type of request, so client may send several
+// requests without waiting (pipelining) and match responses that come in any order.
+// Numbers are varints (dates are zigzag deltas), doubles are 8 byte little endian,
+// strings are varint size and bytes. Every response body starts with result and rows count.
+//
+// CONVERT request: to currency, currency dictionary, rows (total, currency id, date)
+//         response: result, rows (result, total)
+// ADD_RATES request: rates (from currency, to currency, from date, to date flag, to date, rate)
+//           response: result, rows (result)
+// EXPORT request: currency
+//        response: result, points (date, rate)
+enum class MessageType : uint8_t
+{
+    CONVERT = 1,
+    ADD_RATES,
+    EXPORT,
+};
+
+static constexpr size_t FRAME_HEADER_SIZE = 4;
+static constexpr size_t MESSAGE_HEADER_SIZE = 5;
+static constexpr size_t MAX_FRAME_SIZE = 64 << 20;
+
+// rate in any direction. toDateSet is false for [fromDate, +infinity)
+struct ExchangeRate
+{
+    std::string m_fromCurrency;
+    std::string m_toCurrency;
+    time_t m_fromDate;
+    time_t m_toDate;
+    bool m_toDateSet;
+    double m_rate;
+};
+
+// append frame header and message header. returns frame offset for endFrame
+size_t beginFrame(std::vector<uint8_t>& buf, const uint32_t requestId, const MessageType type);
+// set payload size of frame that starts at offset
+void endFrame(std::vector<uint8_t>& buf, const size_t offset);
+// size of frame (with header) that starts at p. 0 if header is not complete yet.
+// returns false if frame is bigger than MAX_FRAME_SIZE or smaller than message header
+bool getFrameSize(const uint8_t* p, const size_t size, size_t& frameSize);
+// read message header of payload. p is moved to message body
+Result readMessageHeader(const uint8_t*& p, const uint8_t* end, uint32_t& requestId, MessageType& type);
+
+void writeConvertRequest(std::vector<uint8_t>& buf, const POSTransactionBatch& batch, const std::string& toCurrency);
+Result readConvertRequest(const uint8_t* p, const uint8_t* end, POSTransactionBatch& batch, std::string& toCurrency);
+void writeConvertResponse(
+    std::vector<uint8_t>& buf,
+    const Result result,
+    const std::vector<double>& totals,
+    const std::vector<Result>& results);
+Result readConvertResponse(
+    const uint8_t* p,
+    const uint8_t* end,
+    Result& result,
+    std::vector<double>& totals,
+    std::vector<Result>& results);
+
+void writeAddRatesRequest(std::vector<uint8_t>& buf, const std::vector<ExchangeRate>& rates);
+Result readAddRatesRequest(const uint8_t* p, const uint8_t* end, std::vector<ExchangeRate>& rates);
+void writeAddRatesResponse(std::vector<uint8_t>& buf, const Result result, const std::vector<Result>& results);
+Result readAddRatesResponse(const uint8_t* p, const uint8_t* end, Result& result, std::vector<Result>& results);
+
+void writeExportRequest(std::vector<uint8_t>& buf, const std::string& currency);
+Result readExportRequest(const uint8_t* p, const uint8_t* end, std::string& currency);
+void writeExportResponse(std::vector<uint8_t>& buf, const Result result, const RateTrend& rateTrend);
+Result readExportResponse(const uint8_t* p, const uint8_t* end, Result& result, RateTrend& rateTrend);
+
+// response without rows (any message type)
+void writeErrorResponse(std::vector<uint8_t>& buf, const Result result);
+
+} // namespace pos
+
+#endif // POS_CONVERSION_PROTOCOL_H
@@ -0,0 +1,98 @@
+#ifndef POS_DAILY_TOTALS_H
+#define POS_DAILY_TOTALS_H
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "POSTransaction.h"
+#include "POSTransactionBatch.h"
+
+namespace pos
+{
+
+struct DailyTotal
+{
+    std::string m_currency;
+    // sum of totals in currency
+    double m_total = 0;
+    // sum of converted totals in base currency
+    double m_baseTotal = 0;
+    size_t m_count = 0;
+    // transactions that have no rate. they are not in base total
+    size_t m_unconvertedCount = 0;
+};
+
+// Per-day totals of transactions in every currency and in base currency.
+// Transactions are added to (day, currency) buckets (UTC days). Bucket keeps native and base
+// sums by transaction date and cached bucket totals, so query takes cached totals of day buckets.
+// Rate change in [fromDate, toDate) marks the interval in buckets of the currency at its days.
+// Dates of marked intervals are converted again (one row per date) by the next query of the day.
+class DailyTotals : public RateChangeListener
+{
+private:
+    struct DateTotal
+    {
+        double m_total = 0;
+        size_t m_count = 0;
+        // NaN if there is no rate
+        double m_baseTotal = 0;
+    };
+    struct Bucket
+    {
+        std::map<time_t, DateTotal> m_dateTotals;
+        DailyTotal m_total;
+        // base totals of dates in [from, to) shall be recomputed
+        time_t m_staleFromDate = 0;
+        time_t m_staleToDate = 0;
+    };
+    typedef std::map<std::string, Bucket> DayBuckets;
+
+    POSTransactionManager& m_manager;
+    std::map<int64_t, DayBuckets> m_days;
+    // days of buckets keyed by non-base currency
+    std::unordered_map<std::string, std::set<int64_t>> m_currencyDays;
+    // reused by recomputation
+    POSTransactionBatch m_fromBatch;
+    POSTransactionBatch m_toBatch;
+    std::vector<Result> m_results;
+    mutable std::mutex m_guard;
+
+private:
+    static int64_t getDay(const time_t date);
+    void addUnsafe(const double total, const std::string& currency, const time_t date);
+    void recomputeUnsafe(DayBuckets& dayBuckets);
+    static void markStale(Bucket& bucket, const time_t fromDate, const time_t toDate);
+    static bool isStale(const Bucket& bucket, const time_t date)
+    {
+        return date >= bucket.m_staleFromDate && date < bucket.m_staleToDate;
+    }
+
+public:
+    static constexpr time_t SECONDS_PER_DAY = 86400;
+
+    DailyTotals(POSTransactionManager& manager);
+    ~DailyTotals();
+
+    DailyTotals(const DailyTotals&) = delete;
+    DailyTotals& operator=(const DailyTotals&) = delete;
+
+    void add(const POSTransaction& transaction);
+    void add(const POSTransactionBatch& batch);
+
+    // totals of day that contains date, ordered by currency
+    std::vector<DailyTotal> getDailyTotals(const time_t date);
+    // drop days before day that contains cutoff. returns number of removed buckets
+    size_t expire(const time_t cutoff);
+    size_t getBucketsCount() const;
+
+    void onRatesChanged(const std::string& currency, const time_t fromDate, const time_t toDate) override;
+};
+
+} // namespace pos
+
+#endif // POS_DAILY_TOTALS_H
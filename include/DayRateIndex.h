@@ -0,0 +1,88 @@
+#ifndef POS_DAY_RATE_INDEX_H
+#define POS_DAY_RATE_INDEX_H
+
+#include <cmath>
+#include <cstdint>
+#include <ctime>
+#include <vector>
+
+#include "RateTrendAllocator.h"
+
+namespace pos
+{
+
+// Direct-indexed table of rates active during whole day.
+// Table holds one rate per day from the day of the first trend point to the day
+// of the last one. Day with rate change after its start holds NaN and lookup falls
+// back to trend. Dates after the last point use its rate.
+class DayRateIndex
+{
+public:
+    typedef pos::RateTrend RateTrend;
+
+    static constexpr time_t SECONDS_PER_DAY = 86400;
+    // trend is indexed if it has at least MIN_POINTS points,
+    // not more than MAX_DAYS_PER_POINT days per point and
+    // not more than 1 / MAX_SPLIT_DAYS_RATIO days with intra-day change
+    static constexpr size_t MIN_POINTS = 32;
+    static constexpr size_t MAX_DAYS_PER_POINT = 8;
+    static constexpr size_t MAX_SPLIT_DAYS_RATIO = 4;
+
+private:
+    int64_t m_firstDay = 0;
+    std::vector<double> m_rates;
+    size_t m_splitDaysCount = 0;
+    time_t m_lastDate = 0;
+    double m_lastRate = -1;
+
+private:
+    static int64_t getDay(const time_t date)
+    {
+        // round down for dates before epoch
+        const int64_t day = date / SECONDS_PER_DAY;
+        return date % SECONDS_PER_DAY < 0 ? day - 1 : day;
+    }
+    // days in [firstDay, lastDay] are not more than MAX_DAYS_PER_POINT per point
+    static bool isSpanWorthwhile(const size_t pointsCount, const int64_t firstDay, const int64_t lastDay);
+    static double getDayRate(const RateTrend& rateTrend, const int64_t day);
+    void setDayRate(const size_t index, const double rate);
+
+public:
+    // index stays empty if days span of trend is too long
+    void build(const RateTrend& rateTrend);
+    // trend was changed in [fromDate, toDate] or its leading points were removed.
+    // index is cleared if days span of trend becomes too long
+    void update(const RateTrend& rateTrend, const time_t fromDate, const time_t toDate);
+    void clear();
+
+    // returns false if date shall be looked up in trend.
+    // rate <= 0 means there is no rate
+    bool findRate(const time_t date, double& rate) const
+    {
+        if (date >= m_lastDate)
+        {
+            rate = m_lastRate;
+            return !m_rates.empty();
+        }
+        const int64_t day = getDay(date);
+        if (day < m_firstDay)
+        {
+            return false;
+        }
+        rate = m_rates[day - m_firstDay];
+        return !std::isnan(rate);
+    }
+
+    static bool isWorthwhile(const size_t pointsCount, const size_t daysCount, const size_t splitDaysCount);
+    bool isWorthwhile(const size_t pointsCount) const;
+
+    size_t getDaysCount() const { return m_rates.size(); }
+    // bytes of day table
+    size_t getMemoryUsage() const { return m_rates.capacity() * sizeof(double); }
+    size_t getSplitDaysCount() const { return m_splitDaysCount; }
+    bool empty() const { return m_rates.empty(); }
+};
+
+} // namespace pos
+
+#endif // POS_DAY_RATE_INDEX_H
@@ -0,0 +1,78 @@
+#ifndef POS_DEFERRED_CONVERSION_H
+#define POS_DEFERRED_CONVERSION_H
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+
+#include "POSTransaction.h"
+
+namespace pos
+{
+
+struct ConversionResult
+{
+    Result m_result;
+    POSTransaction m_transaction;
+};
+
+typedef std::function<void(Result, const POSTransaction&)> ConversionCallback;
+
+// Conversions that wait for missing rates.
+// Conversion that fails because of missing rate is parked in index keyed by missing
+// currency and transaction date. When added rate covers parked conversions, they are
+// completed in batch. Callback is called once: either immediately or from the thread
+// that adds rate (after manager locks are released). Such callback delays return of the
+// writer that added rate, but not other writers, so it shall be short or hand work off
+// to own thread. Conversions still parked on destruction are completed with the last failure.
+class DeferredConverter : public RateChangeListener
+{
+private:
+    struct PendingConversion
+    {
+        POSTransaction m_fromTransaction;
+        std::string m_toCurrency;
+        ConversionCallback m_callback;
+        Result m_result;
+    };
+    typedef std::shared_ptr<PendingConversion> PendingConversionPtr;
+    typedef std::multimap<time_t, PendingConversionPtr> PendingConversions;
+
+    POSTransactionManager& m_manager;
+    // parked conversions keyed by missing currency and date
+    std::unordered_map<std::string, PendingConversions> m_pendingConversions;
+    size_t m_pendingCount = 0;
+    mutable std::mutex m_guard;
+
+private:
+    // returns missing currency in case of missing rate
+    Result tryConvert(PendingConversion& conversion, POSTransaction& toTransaction, std::string& currency) const;
+    // complete conversion or park it. returns PENDING if conversion is parked
+    Result process(const PendingConversionPtr& conversion);
+    bool unpark(const std::string& currency, const PendingConversionPtr& conversion);
+
+public:
+    DeferredConverter(POSTransactionManager& manager);
+    ~DeferredConverter();
+
+    DeferredConverter(const DeferredConverter&) = delete;
+    DeferredConverter& operator=(const DeferredConverter&) = delete;
+
+    // returns SUCCESS or error if completed immediately and PENDING if conversion is parked
+    Result convertPOSTransaction(
+        const POSTransaction& fromPosTransaction,
+        const std::string& toCurrency,
+        ConversionCallback callback);
+    std::future<ConversionResult> convertPOSTransaction(
+        const POSTransaction& fromPosTransaction,
+        const std::string& toCurrency);
+
+    size_t getPendingCount() const;
+
+    void onRatesChanged(const std::string& currency, const time_t fromDate, const time_t toDate) override;
+};
+
+} // namespace pos
+
+#endif // POS_DEFERRED_CONVERSION_H
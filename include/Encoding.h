@@ -0,0 +1,147 @@
+#ifndef POS_ENCODING_H
+#define POS_ENCODING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace pos
+{
+
+// LEB128 variable length encoding of unsigned integers
+inline void writeVarint(std::vector<uint8_t>& buf, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        buf.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    buf.push_back(static_cast<uint8_t>(value));
+}
+
+// decode trusted data (written by writeVarint)
+inline const uint8_t* readVarint(const uint8_t* p, uint64_t& value)
+{
+    uint64_t res = 0;
+    uint32_t shift = 0;
+    while (*p & 0x80)
+    {
+        res |= static_cast<uint64_t>(*p & 0x7f) << shift;
+        shift += 7;
+        ++ p;
+    }
+    value = res | (static_cast<uint64_t>(*p) << shift);
+    return p + 1;
+}
+
+// decode untrusted data. returns false if buffer ends or value is too long
+inline bool readVarint(const uint8_t*& p, const uint8_t* end, uint64_t& value)
+{
+    uint64_t res = 0;
+    for (uint32_t shift = 0; p != end && shift < 64; shift += 7)
+    {
+        const uint8_t byte = *p++;
+        res |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+        {
+            value = res;
+            return true;
+        }
+    }
+    return false;
+}
+
+inline uint64_t zigzagEncode(const int64_t value)
+{
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t zigzagDecode(const uint64_t value)
+{
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+inline uint64_t doubleToBits(const double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+inline double bitsToDouble(const uint64_t bits)
+{
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// 8 byte little endian value
+inline void writeFixed64(std::vector<uint8_t>& buf, const uint64_t value)
+{
+    for (size_t i = 0; i < sizeof(value); ++i)
+    {
+        buf.push_back(static_cast<uint8_t>(value >> (i * 8)));
+    }
+}
+
+// returns false if buffer ends
+inline bool readFixed64(const uint8_t*& p, const uint8_t* end, uint64_t& value)
+{
+    if (end - p < static_cast<ptrdiff_t>(sizeof(value)))
+    {
+        return false;
+    }
+    uint64_t res = 0;
+    for (size_t i = 0; i < sizeof(value); ++i)
+    {
+        res |= static_cast<uint64_t>(p[i]) << (i * 8);
+    }
+    p += sizeof(value);
+    value = res;
+    return true;
+}
+
+// XOR encoding of double against previous value.
+// header byte: 0 - same value, otherwise (significant bytes count << 3) | trailing zero bytes count
+inline void writeXorDouble(std::vector<uint8_t>& buf, const uint64_t bits, const uint64_t prevBits)
+{
+    const uint64_t x = bits ^ prevBits;
+    if (!x)
+    {
+        buf.push_back(0);
+        return;
+    }
+    const uint32_t leading = __builtin_clzll(x) / 8;
+    const uint32_t trailing = __builtin_ctzll(x) / 8;
+    const uint32_t count = 8 - leading - trailing;
+    buf.push_back(static_cast<uint8_t>((count << 3) | trailing));
+    uint64_t significant = x >> (trailing * 8);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        buf.push_back(static_cast<uint8_t>(significant));
+        significant >>= 8;
+    }
+}
+
+inline const uint8_t* readXorDouble(const uint8_t* p, uint64_t& bits)
+{
+    const uint8_t header = *p++;
+    if (!header)
+    {
+        return p;
+    }
+    const uint32_t count = header >> 3;
+    const uint32_t trailing = header & 0x7;
+    uint64_t significant = 0;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        significant |= static_cast<uint64_t>(p[i]) << (i * 8);
+    }
+    bits ^= significant << (trailing * 8);
+    return p + count;
+}
+
+} // namespace pos
+
+#endif // POS_ENCODING_H
@@ -0,0 +1,99 @@
+#ifndef POS_GRAPH_TRANSACTION_H
+#define POS_GRAPH_TRANSACTION_H
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "POSTransaction.h"
+
+namespace pos
+{
+
+// Manager with rates between any currency pairs.
+// Currencies are graph nodes and quoted pairs are edges. Rates of pair are stored once, in
+// the store of currency that quoted the pair first. Table of next hops of the shortest paths
+// (by number of hops) between all currencies is updated when new pair appears, so conversion
+// follows stored path without graph search. Conversion uses rates of path hops at transaction date.
+class GraphPOSTransactionManager
+{
+private:
+    static constexpr size_t MAX_HOPS_COUNT = 16;
+
+    struct Hop
+    {
+        const POSTransactionManager* m_manager;
+        const std::string* m_currency;
+        // rate is quoted from the other currency
+        bool m_inverse;
+    };
+
+    std::unordered_map<std::string, uint32_t> m_currencyIds;
+    // deque keeps currencies in place for hops
+    std::deque<std::string> m_currencies;
+    // rate store of currency that quoted pairs first. null if there are no such pairs
+    std::vector<std::unique_ptr<POSTransactionManager>> m_managers;
+    // owner of pair keyed by ids (lower id in high half)
+    std::unordered_map<uint64_t, uint32_t> m_pairOwners;
+    // next hop and number of hops of path keyed by [from][to]. UINT32_MAX if there is no path
+    std::vector<std::vector<uint32_t>> m_nextHops;
+    std::vector<std::vector<uint32_t>> m_hopsCounts;
+    mutable std::mutex m_graphGuard;
+
+private:
+    static uint64_t getPairKey(const uint32_t id1, const uint32_t id2);
+    uint32_t addCurrencyUnsafe(const std::string& currency);
+    // update paths that become shorter through new pair
+    void addPairUnsafe(const uint32_t id1, const uint32_t id2);
+    // store of pair. pair is added if it is missing
+    Result registerPair(
+        POSTransactionManager*& manager,
+        const std::string& fromCurrency,
+        const std::string& toCurrency);
+    // hops of path between currencies. hops keep pointers to currencies of graph
+    Result findHops(
+        Hop* hops,
+        size_t& hopsCount,
+        const std::string& fromCurrency,
+        const std::string& toCurrency) const;
+
+public:
+    GraphPOSTransactionManager() = default;
+
+    GraphPOSTransactionManager(const GraphPOSTransactionManager&) = delete;
+    GraphPOSTransactionManager& operator=(const GraphPOSTransactionManager&) = delete;
+
+    template<class T1, class T2>
+    Result addExchangeRate(
+        T1&& fromCurrency,
+        T2&& toCurrency,
+        const time_t fromDate,
+        const time_t toDate,
+        double rate);
+    template<class T1, class T2>
+    Result addExchangeRate(
+        T1&& fromCurrency,
+        T2&& toCurrency,
+        const time_t fromDate,
+        double rate);
+
+    // NO_CURRENCY if currency has no rates, CURRENCY_NOT_MATCH if currencies are not connected
+    // or path is longer than MAX_HOPS_COUNT hops. path includes both currencies
+    Result getPath(
+        std::vector<std::string>& path,
+        const std::string& fromCurrency,
+        const std::string& toCurrency) const;
+    std::vector<std::string> getCurrencies() const;
+
+    template<class T>
+    Result convertPOSTransaction(
+        POSTransaction& toPosTransaction,
+        const POSTransaction& fromPosTransaction,
+        T&& toCurrency) const;
+};
+} // namespace pos
+
+#include "GraphPOSTransactionImpl.hpp"
+
+#endif // POS_GRAPH_TRANSACTION_H
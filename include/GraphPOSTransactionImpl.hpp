@@ -0,0 +1,244 @@
+#ifndef POS_GRAPH_TRANSACTION_IMPL_HPP
+#define POS_GRAPH_TRANSACTION_IMPL_HPP
+
+#include <algorithm>
+
+namespace pos
+{
+
+inline uint64_t GraphPOSTransactionManager::getPairKey(const uint32_t id1, const uint32_t id2)
+{
+    return static_cast<uint64_t>(std::min(id1, id2)) << 32 | std::max(id1, id2);
+}
+
+inline uint32_t GraphPOSTransactionManager::addCurrencyUnsafe(const std::string& currency)
+{
+    auto res = m_currencyIds.emplace(currency, static_cast<uint32_t>(m_currencies.size()));
+    if (!res.second)
+    {
+        return res.first->second;
+    }
+    const uint32_t id = res.first->second;
+    m_currencies.push_back(currency);
+    m_managers.emplace_back();
+    for (size_t i = 0; i < m_nextHops.size(); ++i)
+    {
+        m_nextHops[i].push_back(UINT32_MAX);
+        m_hopsCounts[i].push_back(UINT32_MAX);
+    }
+    m_nextHops.emplace_back(m_currencies.size(), UINT32_MAX);
+    m_hopsCounts.emplace_back(m_currencies.size(), UINT32_MAX);
+    m_nextHops[id][id] = id;
+    m_hopsCounts[id][id] = 0;
+    return id;
+}
+
+inline void GraphPOSTransactionManager::addPairUnsafe(const uint32_t id1, const uint32_t id2)
+{
+    // path x -> y through new pair is x -> id1 -> id2 -> y or x -> id2 -> id1 -> y.
+    // paths are symmetric, so hops counts to id1 and id2 are taken before update
+    const size_t count = m_currencies.size();
+    const std::vector<uint32_t> hopsCounts1 = m_hopsCounts[id1];
+    const std::vector<uint32_t> hopsCounts2 = m_hopsCounts[id2];
+    std::vector<uint32_t> nextHops1(count);
+    std::vector<uint32_t> nextHops2(count);
+    for (uint32_t x = 0; x < count; ++x)
+    {
+        nextHops1[x] = x == id1 ? id2 : m_nextHops[x][id1];
+        nextHops2[x] = x == id2 ? id1 : m_nextHops[x][id2];
+    }
+
+    for (uint32_t x = 0; x < count; ++x)
+    {
+        for (uint32_t y = 0; y < count; ++y)
+        {
+            uint32_t& hopsCount = m_hopsCounts[x][y];
+            if (UINT32_MAX != hopsCounts1[x] && UINT32_MAX != hopsCounts2[y] &&
+                static_cast<uint64_t>(hopsCounts1[x]) + hopsCounts2[y] + 1 < hopsCount)
+            {
+                hopsCount = hopsCounts1[x] + hopsCounts2[y] + 1;
+                m_nextHops[x][y] = nextHops1[x];
+            }
+            if (UINT32_MAX != hopsCounts2[x] && UINT32_MAX != hopsCounts1[y] &&
+                static_cast<uint64_t>(hopsCounts2[x]) + hopsCounts1[y] + 1 < hopsCount)
+            {
+                hopsCount = hopsCounts2[x] + hopsCounts1[y] + 1;
+                m_nextHops[x][y] = nextHops2[x];
+            }
+        }
+    }
+}
+
+inline Result GraphPOSTransactionManager::registerPair(
+    POSTransactionManager*& manager,
+    const std::string& fromCurrency,
+    const std::string& toCurrency)
+{
+    if (fromCurrency.empty() || toCurrency.empty())
+    {
+        return Result::NO_CURRENCY;
+    }
+    if (fromCurrency == toCurrency)
+    {
+        return Result::SAME_CURRECY;
+    }
+
+    std::unique_lock<std::mutex> l(m_graphGuard);
+    const uint32_t fromId = addCurrencyUnsafe(fromCurrency);
+    const uint32_t toId = addCurrencyUnsafe(toCurrency);
+    auto res = m_pairOwners.emplace(getPairKey(fromId, toId), fromId);
+    const uint32_t ownerId = res.first->second;
+    if (res.second)
+    {
+        if (!m_managers[ownerId])
+        {
+            m_managers[ownerId].reset(new POSTransactionManager(m_currencies[ownerId]));
+        }
+        addPairUnsafe(fromId, toId);
+    }
+    manager = m_managers[ownerId].get();
+    return Result::SUCCESS;
+}
+
+template<class T1, class T2>
+Result GraphPOSTransactionManager::addExchangeRate(
+    T1&& fromCurrency,
+    T2&& toCurrency,
+    const time_t fromDate,
+    const time_t toDate,
+    double rate)
+{
+    if (fromDate >= toDate)
+    {
+        return Result::INVALID_DATE;
+    }
+    POSTransactionManager* manager;
+    Result r = registerPair(manager, fromCurrency, toCurrency);
+    if (Result::SUCCESS != r)
+    {
+        return r;
+    }
+    // pair quoted in opposite direction is inverted by store
+    return manager->addExchangeRate(
+        std::forward<T1>(fromCurrency), std::forward<T2>(toCurrency), fromDate, toDate, rate);
+}
+
+template<class T1, class T2>
+Result GraphPOSTransactionManager::addExchangeRate(
+    T1&& fromCurrency,
+    T2&& toCurrency,
+    const time_t fromDate,
+    double rate)
+{
+    POSTransactionManager* manager;
+    Result r = registerPair(manager, fromCurrency, toCurrency);
+    if (Result::SUCCESS != r)
+    {
+        return r;
+    }
+    return manager->addExchangeRate(
+        std::forward<T1>(fromCurrency), std::forward<T2>(toCurrency), fromDate, rate);
+}
+
+inline Result GraphPOSTransactionManager::findHops(
+    Hop* hops,
+    size_t& hopsCount,
+    const std::string& fromCurrency,
+    const std::string& toCurrency) const
+{
+    std::unique_lock<std::mutex> l(m_graphGuard);
+    auto fromIt = m_currencyIds.find(fromCurrency);
+    auto toIt = m_currencyIds.find(toCurrency);
+    if (m_currencyIds.end() == fromIt || m_currencyIds.end() == toIt)
+    {
+        return Result::NO_CURRENCY;
+    }
+    const uint32_t toId = toIt->second;
+    uint32_t id = fromIt->second;
+    if (m_hopsCounts[id][toId] > MAX_HOPS_COUNT)
+    {
+        return Result::CURRENCY_NOT_MATCH;
+    }
+    hopsCount = 0;
+    while (id != toId)
+    {
+        const uint32_t nextId = m_nextHops[id][toId];
+        const uint32_t ownerId = m_pairOwners.find(getPairKey(id, nextId))->second;
+        Hop& hop = hops[hopsCount++];
+        hop.m_manager = m_managers[ownerId].get();
+        hop.m_currency = &m_currencies[ownerId == id ? nextId : id];
+        hop.m_inverse = ownerId != id;
+        id = nextId;
+    }
+    return Result::SUCCESS;
+}
+
+inline Result GraphPOSTransactionManager::getPath(
+    std::vector<std::string>& path,
+    const std::string& fromCurrency,
+    const std::string& toCurrency) const
+{
+    path.clear();
+    Hop hops[MAX_HOPS_COUNT];
+    size_t hopsCount;
+    Result r = findHops(hops, hopsCount, fromCurrency, toCurrency);
+    if (Result::SUCCESS != r)
+    {
+        return r;
+    }
+    path.push_back(fromCurrency);
+    for (size_t i = 0; i < hopsCount; ++i)
+    {
+        // currency of hop is the other end of pair
+        path.push_back(hops[i].m_inverse ? hops[i].m_manager->getBaseCurrency() : *hops[i].m_currency);
+    }
+    return Result::SUCCESS;
+}
+
+inline std::vector<std::string> GraphPOSTransactionManager::getCurrencies() const
+{
+    std::unique_lock<std::mutex> l(m_graphGuard);
+    return std::vector<std::string>(m_currencies.begin(), m_currencies.end());
+}
+
+template<class T>
+Result GraphPOSTransactionManager::convertPOSTransaction(
+    POSTransaction& toPosTransaction,
+    const POSTransaction& fromPosTransaction,
+    T&& toCurrency) const
+{
+    if (fromPosTransaction.m_currency == toCurrency)
+    {
+        toPosTransaction = fromPosTransaction;
+        return Result::SUCCESS;
+    }
+
+    Hop hops[MAX_HOPS_COUNT];
+    size_t hopsCount;
+    Result r = findHops(hops, hopsCount, fromPosTransaction.m_currency, toCurrency);
+    if (Result::SUCCESS != r)
+    {
+        return r;
+    }
+
+    // stores are never removed, so hops are used without graph lock
+    double total = fromPosTransaction.m_total;
+    for (size_t i = 0; i < hopsCount; ++i)
+    {
+        double rate;
+        r = hops[i].m_manager->getExchangeRate(*hops[i].m_currency, fromPosTransaction.m_date, rate);
+        if (Result::SUCCESS != r)
+        {
+            return r;
+        }
+        total = hops[i].m_inverse ? total / rate : total * rate;
+    }
+
+    toPosTransaction.m_currency = std::forward<T>(toCurrency);
+    toPosTransaction.m_date = fromPosTransaction.m_date;
+    toPosTransaction.m_total = total;
+    return Result::SUCCESS;
+}
+} // namespace pos
+
+#endif // POS_GRAPH_TRANSACTION_IMPL_HPP
@@ -0,0 +1,134 @@
+#ifndef POS_LOCK_TRACE_H
+#define POS_LOCK_TRACE_H
+
+#include <cstdint>
+#include <chrono>
+#include <string>
+#include <mutex>
+#include <vector>
+
+#include "Utils.h"
+
+namespace pos
+{
+
+// places where manager acquires currency trend map guard
+enum class LockSite : uint8_t
+{
+    CONVERT_FROM,
+    CONVERT_TO,
+    ADD,
+    EXPORT,
+    EXPIRE,
+    LOOKUP,
+};
+
+static constexpr size_t LOCK_SITES_COUNT = static_cast<size_t>(LockSite::LOOKUP) + 1;
+
+const char* lockSiteToStr(const LockSite site);
+
+// all times are in nanoseconds since tracer creation
+struct LockTraceEvent
+{
+    LockSite m_site;
+    uint32_t m_threadIndex;
+    int64_t m_requestTime;
+    int64_t m_acquireTime;
+    int64_t m_releaseTime;
+};
+
+struct LockSiteStats
+{
+    uint64_t m_count = 0;
+    int64_t m_totalWait = 0;
+    int64_t m_maxWait = 0;
+    int64_t m_totalHold = 0;
+    int64_t m_maxHold = 0;
+};
+
+class LockTracer
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+private:
+    const Clock::time_point m_start;
+    // bounded ring buffer. oldest events are overwritten
+    std::vector<LockTraceEvent> m_events;
+    uint64_t m_eventsCount = 0;
+    LockSiteStats m_stats[LOCK_SITES_COUNT];
+    mutable std::mutex m_guard;
+
+public:
+    LockTracer(const size_t capacity = 65536);
+
+    int64_t now() const;
+    void record(
+        const LockSite site,
+        const int64_t requestTime,
+        const int64_t acquireTime,
+        const int64_t releaseTime);
+
+    LockSiteStats getStats(const LockSite site) const;
+    // get copy of traced events. the oldest event goes first
+    std::vector<LockTraceEvent> getEvents() const;
+    // number of events overwritten because of ring buffer overflow
+    uint64_t getDroppedCount() const;
+    void reset();
+
+    // dump events in Chrome trace format (chrome://tracing, Perfetto)
+    Result dumpChromeTrace(const std::string& fileName) const;
+};
+
+// unique lock that reports wait and hold time to tracer (if any)
+template<class Mutex>
+class TracedLock
+{
+private:
+    Mutex& m_mutex;
+    LockTracer* m_tracer;
+    LockSite m_site;
+    int64_t m_requestTime = 0;
+    int64_t m_acquireTime = 0;
+
+public:
+    TracedLock(Mutex& mutex, LockTracer* tracer, const LockSite site);
+    ~TracedLock();
+
+    TracedLock(const TracedLock&) = delete;
+    TracedLock& operator=(const TracedLock&) = delete;
+};
+
+template<class Mutex>
+TracedLock<Mutex>::TracedLock(Mutex& mutex, LockTracer* tracer, const LockSite site):
+    m_mutex(mutex),
+    m_tracer(tracer),
+    m_site(site)
+{
+    if (!m_tracer)
+    {
+        m_mutex.lock();
+        return;
+    }
+    m_requestTime = m_tracer->now();
+    m_mutex.lock();
+    m_acquireTime = m_tracer->now();
+}
+
+template<class Mutex>
+TracedLock<Mutex>::~TracedLock()
+{
+    if (!m_tracer)
+    {
+        m_mutex.unlock();
+        return;
+    }
+    int64_t releaseTime = m_tracer->now();
+    m_mutex.unlock();
+    // record outside of traced lock not to increase hold time
+    m_tracer->record(m_site, m_requestTime, m_acquireTime, releaseTime);
+}
+
+} // namespace pos
+
+#endif // POS_LOCK_TRACE_H
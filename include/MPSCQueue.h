@@ -0,0 +1,83 @@
+#ifndef POS_MPSC_QUEUE_H
+#define POS_MPSC_QUEUE_H
+
+#include <atomic>
+#include <utility>
+
+namespace pos
+{
+
+// Unbounded lock-free multiple producers single consumer queue (D. Vyukov).
+// push is wait-free. pop may return false while producer is inside push
+template<class T>
+class MPSCQueue
+{
+private:
+    struct Node
+    {
+        std::atomic<Node*> m_next;
+        T m_value;
+
+        Node(): m_next(nullptr) {}
+        explicit Node(T&& value): m_next(nullptr), m_value(std::move(value)) {}
+    };
+
+    // producers append to head
+    std::atomic<Node*> m_head;
+    // consumer takes from tail. tail is always already consumed (stub) node
+    Node* m_tail;
+
+public:
+    MPSCQueue();
+    ~MPSCQueue();
+
+    MPSCQueue(const MPSCQueue&) = delete;
+    MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+    void push(T&& value);
+    // shall be called by single consumer
+    bool pop(T& value);
+};
+
+template<class T>
+MPSCQueue<T>::MPSCQueue():
+    m_head(new Node()),
+    m_tail(m_head.load(std::memory_order_relaxed))
+{}
+
+template<class T>
+MPSCQueue<T>::~MPSCQueue()
+{
+    while (m_tail)
+    {
+        Node* next = m_tail->m_next.load(std::memory_order_relaxed);
+        delete m_tail;
+        m_tail = next;
+    }
+}
+
+template<class T>
+void MPSCQueue<T>::push(T&& value)
+{
+    Node* node = new Node(std::move(value));
+    Node* prev = m_head.exchange(node, std::memory_order_acq_rel);
+    prev->m_next.store(node, std::memory_order_release);
+}
+
+template<class T>
+bool MPSCQueue<T>::pop(T& value)
+{
+    Node* next = m_tail->m_next.load(std::memory_order_acquire);
+    if (!next)
+    {
+        return false;
+    }
+    value = std::move(next->m_value);
+    delete m_tail;
+    m_tail = next;
+    return true;
+}
+
+} // namespace pos
+
+#endif // POS_MPSC_QUEUE_H
@@ -0,0 +1,53 @@
+#ifndef POS_MEMORY_USAGE_H
+#define POS_MEMORY_USAGE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace pos
+{
+
+// memory of currency rates in bytes
+struct CurrencyMemoryUsage
+{
+    // empty for total
+    std::string m_currency;
+    size_t m_pointsCount = 0;
+    // trend nodes, day index and rate log
+    size_t m_trendBytes = 0;
+    // currency keys (map nodes and string buffers)
+    size_t m_keyBytes = 0;
+    // heap block headers and rounding, free pool slots, unused capacity, hash tables
+    size_t m_overheadBytes = 0;
+
+    size_t getBytes() const { return m_trendBytes + m_keyBytes + m_overheadBytes; }
+};
+
+struct MemoryUsage
+{
+    // ordered by currency
+    std::vector<CurrencyMemoryUsage> m_currencies;
+    // currencies and shared structures of manager
+    CurrencyMemoryUsage m_total;
+};
+
+// size of heap block that serves allocation (estimate of glibc malloc: size header,
+// 16 bytes alignment, 32 bytes minimum)
+inline size_t getHeapBlockSize(const size_t size)
+{
+    const size_t blockSize = (size + sizeof(size_t) + 15) / 16 * 16;
+    return blockSize < 32 ? 32 : blockSize;
+}
+
+// heap buffer of string (0 if string is kept inside object)
+inline size_t getStringBufferSize(const std::string& str)
+{
+    const char* data = str.data();
+    const char* object = reinterpret_cast<const char*>(&str);
+    return data >= object && data < object + sizeof(str) ? 0 : str.capacity() + 1;
+}
+
+} // namespace pos
+
+#endif // POS_MEMORY_USAGE_H
@@ -0,0 +1,90 @@
+#ifndef POS_MONEY_H
+#define POS_MONEY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <limits>
+#include <string>
+
+#include "Utils.h"
+
+namespace pos
+{
+
+// Fixed-point money.
+// Amount is int64 number of minor units (e.g. cents), amounts of both conversion sides use
+// the same unit. Rate is int64 scaled by RATE_SCALE. Conversion is computed with 128-bit
+// intermediates and rounded once (half to even), so result is exact and does not depend
+// on the code path.
+
+// rate 1.0
+constexpr int64_t RATE_SCALE = 1000000000;
+// amount of failed conversion. valid amounts are in [-INT64_MAX, INT64_MAX]
+constexpr int64_t INVALID_AMOUNT = std::numeric_limits<int64_t>::min();
+
+struct MoneyTransaction
+{
+    int64_t m_amount;
+    std::string m_currency;
+    time_t m_date;
+};
+
+// NO_RATE if rate is not positive, AMOUNT_OVERFLOW if scaled rate rounds to 0 or does not fit
+Result toFixedRate(const double rate, int64_t& fixedRate);
+
+// amount * toRate / fromRate rounded half to even. rates shall be positive.
+// INVALID_AMOUNT if amount is invalid or result does not fit
+inline int64_t convertAmount(const int64_t amount, const int64_t fromRate, const int64_t toRate)
+{
+    if (INVALID_AMOUNT == amount || fromRate <= 0 || toRate <= 0)
+    {
+        return INVALID_AMOUNT;
+    }
+    const bool negative = amount < 0;
+    const uint64_t absAmount = negative ? 0 - static_cast<uint64_t>(amount) : static_cast<uint64_t>(amount);
+    const uint64_t divisor = static_cast<uint64_t>(fromRate);
+    uint64_t quotient;
+    uint64_t remainder;
+    uint64_t product;
+    // 64-bit division when product fits
+    if (!__builtin_mul_overflow(absAmount, static_cast<uint64_t>(toRate), &product))
+    {
+        quotient = product / divisor;
+        remainder = product % divisor;
+    }
+    else
+    {
+        const unsigned __int128 wideProduct = static_cast<unsigned __int128>(absAmount) * static_cast<uint64_t>(toRate);
+        const unsigned __int128 wideQuotient = wideProduct / divisor;
+        if (wideQuotient > static_cast<uint64_t>(std::numeric_limits<int64_t>::max()))
+        {
+            return INVALID_AMOUNT;
+        }
+        quotient = static_cast<uint64_t>(wideQuotient);
+        remainder = static_cast<uint64_t>(wideProduct - wideQuotient * divisor);
+    }
+    // remainder < divisor, so half is compared without overflow
+    if (remainder > divisor - remainder || (remainder == divisor - remainder && (quotient & 1)))
+    {
+        ++ quotient;
+    }
+    if (quotient > static_cast<uint64_t>(std::numeric_limits<int64_t>::max()))
+    {
+        return INVALID_AMOUNT;
+    }
+    return negative ? -static_cast<int64_t>(quotient) : static_cast<int64_t>(quotient);
+}
+
+// toAmounts[i] = convertAmount(fromAmounts[i], fromRates[i], toRates[i]).
+// unrolled, result is the same as of scalar conversion. returns number of INVALID_AMOUNT results
+size_t convertAmounts(
+    int64_t* toAmounts,
+    const int64_t* fromAmounts,
+    const int64_t* fromRates,
+    const int64_t* toRates,
+    const size_t count);
+
+} // namespace pos
+
+#endif // POS_MONEY_H
@@ -0,0 +1,67 @@
+#ifndef POS_MULTI_BASE_TRANSACTION_H
+#define POS_MULTI_BASE_TRANSACTION_H
+
+#include <memory>
+#include <vector>
+
+#include "POSTransaction.h"
+
+namespace pos
+{
+
+// Manager with several base currencies sharing one rate store.
+// Each currency is quoted against one of bases and its rates are stored once,
+// in the store of that base. The first base is primary: rates of other bases
+// are quoted against it. Cross rates are derived through bases.
+class MultiBasePOSTransactionManager
+{
+private:
+    std::vector<std::string> m_baseCurrencies;
+    // rate store of each base
+    std::vector<std::unique_ptr<POSTransactionManager>> m_managers;
+    // index of base that currency is quoted against
+    std::unordered_map<std::string, size_t> m_currencyBaseMap;
+    mutable std::mutex m_currencyBaseMapGuard;
+
+private:
+    // base index of base currency or SIZE_MAX
+    size_t findBase(const std::string& currency) const;
+    Result registerCurrency(
+        size_t& baseIndex,
+        const std::string& fromCurrency,
+        const std::string& toCurrency);
+    // base index of any known currency or SIZE_MAX
+    size_t findCurrencyBase(const std::string& currency) const;
+
+public:
+    MultiBasePOSTransactionManager(const std::vector<std::string>& baseCurrencies);
+
+    const std::vector<std::string>& getBaseCurrencies() const { return m_baseCurrencies; }
+
+    // one of currencies shall be base currency. rates between bases shall include primary base
+    template<class T1, class T2>
+    Result addExchangeRate(
+        T1&& fromCurrency,
+        T2&& toCurrency,
+        const time_t fromDate,
+        const time_t toDate,
+        double rate);
+    template<class T1, class T2>
+    Result addExchangeRate(
+        T1&& fromCurrency,
+        T2&& toCurrency,
+        const time_t fromDate,
+        double rate);
+    // get copy of currency trends quoted against base
+    POSTransactionManager::CurrencyTrendMap getExchangeRates(const std::string& baseCurrency) const;
+    template<class T>
+    Result convertPOSTransaction(
+        POSTransaction& toPosTransaction,
+        const POSTransaction& fromPosTransaction,
+        T&& toCurrency) const;
+};
+} // namespace pos
+
+#include "MultiBasePOSTransactionImpl.hpp"
+
+#endif // POS_MULTI_BASE_TRANSACTION_H
@@ -0,0 +1,189 @@
+#ifndef POS_MULTI_BASE_TRANSACTION_IMPL_HPP
+#define POS_MULTI_BASE_TRANSACTION_IMPL_HPP
+
+#include <cstdint>
+#include <algorithm>
+
+namespace pos
+{
+
+inline MultiBasePOSTransactionManager::MultiBasePOSTransactionManager(
+    const std::vector<std::string>& baseCurrencies):
+    m_baseCurrencies(baseCurrencies)
+{
+    if (m_baseCurrencies.empty())
+    {
+        throw std::runtime_error("MultiBasePOSTransactionManager: base currencies cannot be empty");
+    }
+    for (auto it = m_baseCurrencies.begin(); it != m_baseCurrencies.end(); ++it)
+    {
+        if (std::find(std::next(it), m_baseCurrencies.end(), *it) != m_baseCurrencies.end())
+        {
+            throw std::runtime_error("MultiBasePOSTransactionManager: base currencies shall be unique");
+        }
+        // throws on empty currency
+        m_managers.emplace_back(new POSTransactionManager(*it));
+    }
+}
+
+inline size_t MultiBasePOSTransactionManager::findBase(const std::string& currency) const
+{
+    auto it = std::find(m_baseCurrencies.begin(), m_baseCurrencies.end(), currency);
+    return m_baseCurrencies.end() == it ? SIZE_MAX : std::distance(m_baseCurrencies.begin(), it);
+}
+
+inline size_t MultiBasePOSTransactionManager::findCurrencyBase(const std::string& currency) const
+{
+    size_t baseIndex = findBase(currency);
+    if (SIZE_MAX != baseIndex)
+    {
+        return baseIndex;
+    }
+    std::unique_lock<std::mutex> l(m_currencyBaseMapGuard);
+    auto currencyIt = m_currencyBaseMap.find(currency);
+    return m_currencyBaseMap.end() == currencyIt ? SIZE_MAX : currencyIt->second;
+}
+
+inline Result MultiBasePOSTransactionManager::registerCurrency(
+    size_t& baseIndex,
+    const std::string& fromCurrency,
+    const std::string& toCurrency)
+{
+    if (fromCurrency == toCurrency)
+    {
+        return Result::SAME_CURRECY;
+    }
+
+    const size_t fromBase = findBase(fromCurrency);
+    const size_t toBase = findBase(toCurrency);
+    if (SIZE_MAX != fromBase && SIZE_MAX != toBase)
+    {
+        // rate between bases is stored in primary store
+        if (0 != fromBase && 0 != toBase)
+        {
+            return Result::CURRENCY_NOT_MATCH;
+        }
+        baseIndex = 0;
+        return Result::SUCCESS;
+    }
+    if (SIZE_MAX == fromBase && SIZE_MAX == toBase)
+    {
+        return Result::CURRENCY_NOT_MATCH;
+    }
+
+    baseIndex = SIZE_MAX != fromBase ? fromBase : toBase;
+    const std::string& currency = SIZE_MAX != fromBase ? toCurrency : fromCurrency;
+
+    // currency is quoted against one base only
+    std::unique_lock<std::mutex> l(m_currencyBaseMapGuard);
+    auto res = m_currencyBaseMap.emplace(currency, baseIndex);
+    if (res.first->second != baseIndex)
+    {
+        return Result::CURRENCY_NOT_MATCH;
+    }
+    return Result::SUCCESS;
+}
+
+template<class T1, class T2>
+Result MultiBasePOSTransactionManager::addExchangeRate(
+    T1&& fromCurrency,
+    T2&& toCurrency,
+    const time_t fromDate,
+    const time_t toDate,
+    double rate)
+{
+    if (fromDate >= toDate)
+    {
+        return Result::INVALID_DATE;
+    }
+    size_t baseIndex;
+    Result r = registerCurrency(baseIndex, fromCurrency, toCurrency);
+    if (Result::SUCCESS != r)
+    {
+        return r;
+    }
+    return m_managers[baseIndex]->addExchangeRate(
+        std::forward<T1>(fromCurrency), std::forward<T2>(toCurrency), fromDate, toDate, rate);
+}
+
+template<class T1, class T2>
+Result MultiBasePOSTransactionManager::addExchangeRate(
+    T1&& fromCurrency,
+    T2&& toCurrency,
+    const time_t fromDate,
+    double rate)
+{
+    size_t baseIndex;
+    Result r = registerCurrency(baseIndex, fromCurrency, toCurrency);
+    if (Result::SUCCESS != r)
+    {
+        return r;
+    }
+    return m_managers[baseIndex]->addExchangeRate(
+        std::forward<T1>(fromCurrency), std::forward<T2>(toCurrency), fromDate, rate);
+}
+
+inline POSTransactionManager::CurrencyTrendMap MultiBasePOSTransactionManager::getExchangeRates(
+    const std::string& baseCurrency) const
+{
+    const size_t baseIndex = findBase(baseCurrency);
+    if (SIZE_MAX == baseIndex)
+    {
+        return POSTransactionManager::CurrencyTrendMap();
+    }
+    return m_managers[baseIndex]->getExchangeRates();
+}
+
+template<class T>
+Result MultiBasePOSTransactionManager::convertPOSTransaction(
+    POSTransaction& toPosTransaction,
+    const POSTransaction& fromPosTransaction,
+    T&& toCurrency) const
+{
+    if (fromPosTransaction.m_currency == toCurrency)
+    {
+        toPosTransaction = fromPosTransaction;
+        return Result::SUCCESS;
+    }
+
+    const size_t fromBase = findCurrencyBase(fromPosTransaction.m_currency);
+    const size_t toBase = findCurrencyBase(toCurrency);
+    if (SIZE_MAX == fromBase || SIZE_MAX == toBase)
+    {
+        return Result::NO_CURRENCY;
+    }
+    if (fromBase == toBase)
+    {
+        return m_managers[fromBase]->convertPOSTransaction(
+            toPosTransaction, fromPosTransaction, std::forward<T>(toCurrency));
+    }
+
+    // currency -> its base -> base of target currency -> target currency
+    POSTransaction transaction = fromPosTransaction;
+    Result r;
+    if (m_baseCurrencies[fromBase] != transaction.m_currency)
+    {
+        r = m_managers[fromBase]->convertPOSTransaction(
+            transaction, fromPosTransaction, m_baseCurrencies[fromBase]);
+        if (Result::SUCCESS != r)
+        {
+            return r;
+        }
+    }
+    if (m_baseCurrencies[toBase] == toCurrency)
+    {
+        return m_managers[0]->convertPOSTransaction(
+            toPosTransaction, transaction, std::forward<T>(toCurrency));
+    }
+    r = m_managers[0]->convertPOSTransaction(
+        transaction, POSTransaction(transaction), m_baseCurrencies[toBase]);
+    if (Result::SUCCESS != r)
+    {
+        return r;
+    }
+    return m_managers[toBase]->convertPOSTransaction(
+        toPosTransaction, transaction, std::forward<T>(toCurrency));
+}
+} // namespace pos
+
+#endif // POS_MULTI_BASE_TRANSACTION_IMPL_HPP
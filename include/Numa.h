@@ -0,0 +1,20 @@
+#ifndef POS_NUMA_H
+#define POS_NUMA_H
+
+#include <cstddef>
+
+namespace pos
+{
+
+// NUMA topology helpers. Without libnuma (or on single node machine)
+// there is one node and binding does nothing
+
+size_t getNumaNodesCount();
+// node of cpu that current thread runs on
+size_t getCurrentNumaNode();
+// run current thread on cpus of node and prefer memory of node for its allocations
+void bindThreadToNumaNode(const size_t node);
+
+} // namespace pos
+
+#endif // POS_NUMA_H
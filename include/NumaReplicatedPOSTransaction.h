@@ -0,0 +1,135 @@
+#ifndef POS_NUMA_REPLICATED_TRANSACTION_H
+#define POS_NUMA_REPLICATED_TRANSACTION_H
+
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+
+#include "POSTransaction.h"
+
+namespace pos
+{
+
+// Manager that keeps read copy of rates on each NUMA node.
+// Every replica is updated by its own thread that runs on replica node, so trend
+// nodes are allocated in node local memory. Writer waits until all replicas apply
+// update. Readers use replica of node they run on. With one replica updates are
+// applied by writer directly.
+class NumaReplicatedPOSTransactionManager
+{
+private:
+    struct Replica
+    {
+        const size_t m_node;
+        POSTransactionManager m_manager;
+        std::vector<RateUpdate> m_updates;
+        uint64_t m_pushedCount = 0;
+        uint64_t m_appliedCount = 0;
+        bool m_stopped = false;
+        std::mutex m_guard;
+        std::condition_variable m_cv;
+        std::thread m_thread;
+
+        Replica(const std::string& baseCurrency, const size_t node);
+    };
+
+    std::vector<std::unique_ptr<Replica>> m_replicas;
+    // replicas get updates in the same order
+    std::mutex m_writeGuard;
+
+private:
+    void run(Replica& replica);
+    const POSTransactionManager& getLocalManager() const;
+
+public:
+    // replicasCount 0 means one replica per NUMA node. with fewer replicas than nodes
+    // node n reads replica n % replicasCount
+    NumaReplicatedPOSTransactionManager(const std::string& baseCurrency, const size_t replicasCount = 0);
+    ~NumaReplicatedPOSTransactionManager();
+
+    NumaReplicatedPOSTransactionManager(const NumaReplicatedPOSTransactionManager&) = delete;
+    NumaReplicatedPOSTransactionManager& operator=(const NumaReplicatedPOSTransactionManager&) = delete;
+
+    template<class T1, class T2>
+    Result addExchangeRate(
+        T1&& fromCurrency,
+        T2&& toCurrency,
+        const time_t fromDate,
+        const time_t toDate,
+        double rate);
+    template<class T1, class T2>
+    Result addExchangeRate(
+        T1&& fromCurrency,
+        T2&& toCurrency,
+        const time_t fromDate,
+        double rate);
+    // apply normalized updates to all replicas
+    void addExchangeRates(std::vector<RateUpdate>&& updates);
+
+    const std::string& getBaseCurrency() const { return m_replicas.front()->m_manager.getBaseCurrency(); }
+    size_t getReplicasCount() const { return m_replicas.size(); }
+    const POSTransactionManager& getReplica(const size_t index) const { return m_replicas[index]->m_manager; }
+    size_t getReplicaNode(const size_t index) const { return m_replicas[index]->m_node; }
+
+    // reads use replica of current node
+    POSTransactionManager::CurrencyTrendMap getExchangeRates() const;
+    Result getExchangeRate(const std::string& currency, const time_t date, double& rate) const;
+    template<class T>
+    Result convertPOSTransaction(
+        POSTransaction& toPosTransaction,
+        const POSTransaction& fromPosTransaction,
+        T&& toCurrency) const;
+};
+
+template<class T1, class T2>
+Result NumaReplicatedPOSTransactionManager::addExchangeRate(
+    T1&& fromCurrency,
+    T2&& toCurrency,
+    const time_t fromDate,
+    const time_t toDate,
+    double rate)
+{
+    std::vector<RateUpdate> updates(1);
+    Result r = m_replicas.front()->m_manager.makeRateUpdate(
+        updates.front(), std::forward<T1>(fromCurrency), std::forward<T2>(toCurrency), fromDate, toDate, rate);
+    if (Result::SUCCESS != r)
+    {
+        return r;
+    }
+    addExchangeRates(std::move(updates));
+    return Result::SUCCESS;
+}
+
+template<class T1, class T2>
+Result NumaReplicatedPOSTransactionManager::addExchangeRate(
+    T1&& fromCurrency,
+    T2&& toCurrency,
+    const time_t fromDate,
+    double rate)
+{
+    std::vector<RateUpdate> updates(1);
+    Result r = m_replicas.front()->m_manager.makeRateUpdate(
+        updates.front(), std::forward<T1>(fromCurrency), std::forward<T2>(toCurrency), fromDate, rate);
+    if (Result::SUCCESS != r)
+    {
+        return r;
+    }
+    addExchangeRates(std::move(updates));
+    return Result::SUCCESS;
+}
+
+template<class T>
+Result NumaReplicatedPOSTransactionManager::convertPOSTransaction(
+    POSTransaction& toPosTransaction,
+    const POSTransaction& fromPosTransaction,
+    T&& toCurrency) const
+{
+    return getLocalManager().convertPOSTransaction(
+        toPosTransaction, fromPosTransaction, std::forward<T>(toCurrency));
+}
+
+} // namespace pos
+
+#endif // POS_NUMA_REPLICATED_TRANSACTION_H
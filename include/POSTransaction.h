@@ -4,11 +4,22 @@
 #include <stdexcept>
 #include <ctime>
 #include <string>
+#include <atomic>
+#include <limits>
 #include <mutex>
+#include <condition_variable>
+#include <thread>
 #include <map>
+#include <vector>
 #include <unordered_map>
 
 #include "Utils.h"
+#include "LockTrace.h"
+#include "WorkloadRecorder.h"
+#include "DayRateIndex.h"
+#include "MemoryUsage.h"
+#include "Money.h"
+#include "RateTrendAllocator.h"
 
 namespace pos
 {
@@ -20,33 +31,133 @@ struct POSTransaction
     time_t m_date;
 };
 
+// rate update normalized to 'base -> currency' direction
+struct RateUpdate
+{
+    std::string m_currency;
+    time_t m_fromDate;
+    time_t m_toDate;
+    // false for [fromDate, +infinity)
+    bool m_toDateSet;
+    double m_rate;
+};
+
+class POSTransactionBatch;
+
+// listener of manager rate changes. called from the thread that changed rates, after manager
+// locks are released. notifications of different writers may run concurrently
+class RateChangeListener
+{
+public:
+    virtual ~RateChangeListener() = default;
+    // rates of 'base -> currency' were changed in [fromDate, toDate).
+    // toDate is max time_t for open interval
+    virtual void onRatesChanged(const std::string& currency, const time_t fromDate, const time_t toDate) = 0;
+};
+
 class POSTransactionManager
 {
 public:
-    typedef std::map<time_t, double> RateTrend;
+    typedef pos::RateTrend RateTrend;
+    // map nodes use std allocator, trend nodes use per-currency node pool (if enabled)
     typedef std::unordered_map<std::string, RateTrend> CurrencyTrendMap;
 
 protected:
+    struct DayRateIndexState
+    {
+        DayRateIndex m_index;
+        // trend size when index is built next time
+        size_t m_nextBuildSize = 0;
+    };
+    // keyed by trend. trends are never removed from map
+    typedef std::unordered_map<const RateTrend*, DayRateIndexState> DayRateIndexMap;
+    // updates that are not merged into trend yet, in order of arrival
+    typedef std::unordered_map<const RateTrend*, std::vector<RateUpdate>> RateLogMap;
+
     std::string m_baseCurrency;
-    CurrencyTrendMap m_currencyTrendMap;
+    // every currency trend gets own node pool
+    const bool m_useNodePools;
+    // trends and their indexes are changed by readers that merge rate logs
+    mutable CurrencyTrendMap m_currencyTrendMap;
+    // built automatically for trends with daily granularity
+    mutable DayRateIndexMap m_dayRateIndexMap;
+    mutable RateLogMap m_rateLogMap;
+    // reused by merge of rate log
+    mutable std::vector<RateUpdate> m_rateLogParts;
+    mutable std::vector<std::pair<time_t, time_t>> m_rateLogCovered;
+    // 0 if updates are applied at once
+    size_t m_rateLogLimit = 0;
     mutable std::mutex m_currencyTrendMapGuard;
+    std::atomic<LockTracer*> m_lockTracer;
+    std::atomic<WorkloadRecorder*> m_workloadRecorder;
+    std::vector<RateChangeListener*> m_rateChangeListeners;
+    std::atomic<size_t> m_rateChangeListenersCount;
+    // notifications in progress: listener and notifying thread.
+    // listeners are called without lock, removal waits for their calls
+    mutable std::vector<std::pair<RateChangeListener*, std::thread::id>> m_rateChangeCalls;
+    mutable std::mutex m_rateChangeListenersGuard;
+    mutable std::condition_variable m_rateChangeCallsCv;
+
+    // rate of 'base -> currency' active at date
+    Result findRateUnsafe(const std::string& currency, const time_t date, double& rate) const;
+    Result findTrendRateUnsafe(const RateTrend& rateTrend, const time_t date, double& rate) const;
 
 private:
-    Result checkCurrency(const std::string& fromCurrency, const std::string& toCurrency);
+    Result checkCurrency(const std::string& fromCurrency, const std::string& toCurrency) const;
     template<class T1, class T2>
     void getCurrencyAndRate(
         std::string& currency,
         double& rate,
         T1&& fromCurrency,
-        T2&& toCurrency);
+        T2&& toCurrency) const;
     RateTrend& getCurrencyTrendUnsafe(std::string&& currency);
+    RateTrend createRateTrend() const;
+    // trend was changed in [fromDate, toDate]
+    void updateDayRateIndexUnsafe(const RateTrend& rateTrend, const time_t fromDate, const time_t toDate) const;
+    // apply update or append it to rate log
+    void addRateUpdateUnsafe(RateTrend& rateTrend, RateUpdate& update);
+    // apply parts of logged updates that are not overwritten by newer updates
+    void mergeRateLogUnsafe(RateTrend& rateTrend) const;
+    void mergeRateLogsUnsafe() const;
 
-    RateTrend::iterator insertFromUnsafe(RateTrend& rateTrend, const time_t fromDate, const double rate);
-    RateTrend::iterator insertToUnsafe(RateTrend& rateTrend, const time_t toDate, const double rate);
+    static RateTrend::iterator insertFromUnsafe(RateTrend& rateTrend, const time_t fromDate, const double rate);
+    static RateTrend::iterator insertToUnsafe(RateTrend& rateTrend, const time_t toDate, const double rate);
+
+    void notifyRatesChanged(const std::string& currency, const time_t fromDate, const time_t toDate) const;
+
+    // rates of 'base -> currency' of both currencies at date (1 for base currency)
+    Result findConversionRates(
+        double& fromRate,
+        double& toRate,
+        const std::string& fromCurrency,
+        const std::string& toCurrency,
+        const time_t date) const;
+    // rates of batch rows. from rate of failed row is NaN
+    Result findBatchRates(
+        std::vector<double>& fromRates,
+        std::vector<double>& toRates,
+        std::vector<Result>& results,
+        const POSTransactionBatch& fromBatch,
+        const std::string& toCurrency) const;
 
 public:
+    // useNodePools - allocate trend points from per-currency node pools.
+    // pool memory is reclaimed in bulk when trend becomes empty
     template<class T>
-    POSTransactionManager(T&& baseCurrency);
+    POSTransactionManager(T&& baseCurrency, const bool useNodePools = false);
+
+    // trace wait/hold time of currency trend map guard. nullptr disables tracing
+    void setLockTracer(LockTracer* lockTracer);
+    // record API calls. nullptr disables recording
+    void setWorkloadRecorder(WorkloadRecorder* workloadRecorder);
+    // write optimized mode. updates of currency are appended to log and merged into trend when
+    // log reaches limit or by reads of whole trends (export, expiration, batch conversion).
+    // rate lookups check log from the newest update. 0 merges logs and disables mode
+    void setRateLogLimit(const size_t limit);
+    // listener shall be removed before it is destroyed. removal waits for notifications of
+    // listener in progress, except of the one that removes it
+    void addRateChangeListener(RateChangeListener* listener);
+    void removeRateChangeListener(RateChangeListener* listener);
 
     template<class T1, class T2>
     Result addExchangeRate(
@@ -61,13 +172,83 @@ public:
         T2&& toCurrency,
         const time_t fromDate,
         double rate);
+
+    // validate rate and normalize it to 'base -> currency' direction
+    template<class T1, class T2>
+    Result makeRateUpdate(
+        RateUpdate& update,
+        T1&& fromCurrency,
+        T2&& toCurrency,
+        const time_t fromDate,
+        const time_t toDate,
+        double rate) const;
+    template<class T1, class T2>
+    Result makeRateUpdate(
+        RateUpdate& update,
+        T1&& fromCurrency,
+        T2&& toCurrency,
+        const time_t fromDate,
+        double rate) const;
+    // apply normalized updates in order under one lock.
+    // updates of the same currency that go one by one share trend lookup
+    void addExchangeRates(std::vector<RateUpdate>&& updates);
+    // apply normalized update to trend
+    static void applyRateUpdate(RateTrend& rateTrend, const RateUpdate& update);
+
+    const std::string& getBaseCurrency() const { return m_baseCurrency; }
     // get copy of currency trend
     CurrencyTrendMap getExchangeRates() const;
+    // currencies that have rates. currency is never removed
+    std::vector<std::string> getCurrencies() const;
+    // get copy of one currency trend
+    Result getExchangeRates(const std::string& currency, RateTrend& rateTrend) const;
+    // replace currency trend by swap. trend is taken by caller (old trend is returned in it),
+    // so it is built and released without lock. CURRENCY_NOT_MATCH for base currency
+    Result replaceExchangeRates(const std::string& currency, RateTrend& rateTrend);
+    // get copy of points that are needed to find rates before date
+    CurrencyTrendMap getExchangeRatesBefore(const time_t date) const;
+    // rate of 'base -> currency' active at date
+    Result getExchangeRate(const std::string& currency, const time_t date, double& rate) const;
+    // true if lookups of currency rates use day index
+    bool hasDayRateIndex(const std::string& currency) const;
+    // drop rate points before cutoff in every trend. interval that covers cutoff is kept.
+    // listeners are notified of dates that lost their rates. returns number of removed points
+    size_t expireExchangeRates(const time_t cutoff);
+    // memory of rates per currency and in total
+    MemoryUsage getMemoryUsage() const;
+    // rebuild trends densely after churn: merge rate logs, drop points that repeat rate of the
+    // previous point, copy trends into new nodes (new pools) in date order and release buffers.
+    // rates are not changed. returns number of removed points
+    size_t compact();
     template<class T>
     Result convertPOSTransaction(
         POSTransaction& toPosTransaction,
         const POSTransaction& fromPosTransaction,
         T&& toCurrency) const;
+    // convert batch rows to currency. rows are ordered by currency and date, rates are resolved
+    // under one lock per currency. results and totals keep original row order.
+    // results holds result of each row. total of failed row is NaN.
+    // returns SUCCESS or result of the first failed row
+    Result convertPOSTransactionBatch(
+        POSTransactionBatch& toBatch,
+        std::vector<Result>& results,
+        const POSTransactionBatch& fromBatch,
+        const std::string& toCurrency) const;
+    // fixed-point conversion: amount / fromRate * toRate with rates scaled by RATE_SCALE,
+    // rounded half to even. AMOUNT_OVERFLOW if rate or result does not fit
+    template<class T>
+    Result convertPOSTransaction(
+        MoneyTransaction& toTransaction,
+        const MoneyTransaction& fromTransaction,
+        T&& toCurrency) const;
+    // fixed-point conversion of amounts of batch rows (row currencies and dates are taken from
+    // batch, its totals are not used). amount of failed row is INVALID_AMOUNT
+    Result convertPOSTransactionBatch(
+        std::vector<int64_t>& toAmounts,
+        std::vector<Result>& results,
+        const std::vector<int64_t>& fromAmounts,
+        const POSTransactionBatch& fromBatch,
+        const std::string& toCurrency) const;
 };
 } // namespace pos
 
@@ -0,0 +1,66 @@
+#ifndef POS_TRANSACTION_BATCH_H
+#define POS_TRANSACTION_BATCH_H
+
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "POSTransaction.h"
+
+namespace pos
+{
+
+// Column oriented batch of transactions.
+// Totals, currency ids and dates are kept in separate contiguous arrays.
+// Currencies are dictionary encoded: id is index in batch currency list.
+class POSTransactionBatch
+{
+private:
+    std::vector<double> m_totals;
+    std::vector<uint32_t> m_currencyIds;
+    std::vector<time_t> m_dates;
+    std::vector<std::string> m_currencies;
+    std::unordered_map<std::string, uint32_t> m_currencyIdMap;
+
+public:
+    POSTransactionBatch() = default;
+    explicit POSTransactionBatch(const std::vector<POSTransaction>& transactions);
+
+    // id of currency. currency is added to dictionary if it is missing
+    uint32_t addCurrency(const std::string& currency);
+    void add(const double total, const uint32_t currencyId, const time_t date);
+    void add(const double total, const std::string& currency, const time_t date);
+    void add(const POSTransaction& transaction);
+    void reserve(const size_t size);
+    void clear();
+
+    size_t size() const { return m_totals.size(); }
+    bool empty() const { return m_totals.empty(); }
+    POSTransaction get(const size_t index) const;
+    std::vector<POSTransaction> toTransactions() const;
+
+    const std::vector<double>& getTotals() const { return m_totals; }
+    std::vector<double>& getTotals() { return m_totals; }
+    const std::vector<uint32_t>& getCurrencyIds() const { return m_currencyIds; }
+    const std::vector<time_t>& getDates() const { return m_dates; }
+    const std::vector<std::string>& getCurrencies() const { return m_currencies; }
+};
+
+// permutation of batch rows ordered by currency id and then by date (radix sort).
+// big batches are sorted by several threads
+void sortPOSTransactionBatch(const POSTransactionBatch& batch, std::vector<uint32_t>& order);
+
+// toTotals[i] = fromTotals[i] / fromRates[i] * toRates[i].
+// vectorized when SSE2 is available. result is the same as of scalar conversion
+void convertTotals(
+    double* toTotals,
+    const double* fromTotals,
+    const double* fromRates,
+    const double* toRates,
+    const size_t count);
+
+} // namespace pos
+
+#endif // POS_TRANSACTION_BATCH_H
@@ -1,12 +1,19 @@
 #ifndef POS_TRANSACTION_IMPL_HPP
 #define POS_TRANSACTION_IMPL_HPP
 
+#include <algorithm>
+#include <new>
+
 namespace pos
 {
 
 template<class T>
-POSTransactionManager::POSTransactionManager(T&& baseCurrency):
-    m_baseCurrency(std::forward<T>(baseCurrency))
+POSTransactionManager::POSTransactionManager(T&& baseCurrency, const bool useNodePools):
+    m_baseCurrency(std::forward<T>(baseCurrency)),
+    m_useNodePools(useNodePools),
+    m_lockTracer(nullptr),
+    m_workloadRecorder(nullptr),
+    m_rateChangeListenersCount(0)
 {
     if (m_baseCurrency.empty())
     {
@@ -14,16 +21,464 @@ POSTransactionManager::POSTransactionManager(T&& baseCurrency):
     }
 }
 
+inline void POSTransactionManager::setLockTracer(LockTracer* lockTracer)
+{
+    m_lockTracer.store(lockTracer, std::memory_order_release);
+}
+
+inline void POSTransactionManager::setWorkloadRecorder(WorkloadRecorder* workloadRecorder)
+{
+    m_workloadRecorder.store(workloadRecorder, std::memory_order_release);
+}
+
+inline void POSTransactionManager::addRateChangeListener(RateChangeListener* listener)
+{
+    std::unique_lock<std::mutex> l(m_rateChangeListenersGuard);
+    m_rateChangeListeners.push_back(listener);
+    m_rateChangeListenersCount.store(m_rateChangeListeners.size());
+}
+
+inline void POSTransactionManager::removeRateChangeListener(RateChangeListener* listener)
+{
+    std::unique_lock<std::mutex> l(m_rateChangeListenersGuard);
+    m_rateChangeListeners.erase(
+        std::remove(m_rateChangeListeners.begin(), m_rateChangeListeners.end(), listener),
+        m_rateChangeListeners.end());
+    m_rateChangeListenersCount.store(m_rateChangeListeners.size());
+
+    // waits for notifications in progress. listener may be removed from own notification
+    const std::thread::id threadId = std::this_thread::get_id();
+    m_rateChangeCallsCv.wait(l, [this, listener, threadId] ()
+        {
+            return m_rateChangeCalls.end() == std::find_if(m_rateChangeCalls.begin(), m_rateChangeCalls.end(),
+                [listener, threadId] (const std::pair<RateChangeListener*, std::thread::id>& call)
+                { return call.first == listener && call.second != threadId; });
+        });
+}
+
+inline void POSTransactionManager::notifyRatesChanged(
+    const std::string& currency,
+    const time_t fromDate,
+    const time_t toDate) const
+{
+    // listeners are called without lock, so writers do not wait for each other's listeners
+    const std::thread::id threadId = std::this_thread::get_id();
+    std::vector<RateChangeListener*> listeners;
+    {
+        std::unique_lock<std::mutex> l(m_rateChangeListenersGuard);
+        listeners = m_rateChangeListeners;
+    }
+    for (RateChangeListener* listener : listeners)
+    {
+        {
+            // listener may be removed from previous notification
+            std::unique_lock<std::mutex> l(m_rateChangeListenersGuard);
+            auto listenerIt = std::find(m_rateChangeListeners.begin(), m_rateChangeListeners.end(), listener);
+            if (m_rateChangeListeners.end() == listenerIt)
+            {
+                continue;
+            }
+            m_rateChangeCalls.emplace_back(listener, threadId);
+        }
+        listener->onRatesChanged(currency, fromDate, toDate);
+        {
+            std::unique_lock<std::mutex> l(m_rateChangeListenersGuard);
+            auto callIt = std::find(m_rateChangeCalls.begin(), m_rateChangeCalls.end(),
+                std::make_pair(listener, threadId));
+            *callIt = m_rateChangeCalls.back();
+            m_rateChangeCalls.pop_back();
+        }
+        m_rateChangeCallsCv.notify_all();
+    }
+}
+
 // get copy of currency trend
 inline POSTransactionManager::CurrencyTrendMap POSTransactionManager::getExchangeRates() const
 {
-    std::unique_lock<std::mutex> l(m_currencyTrendMapGuard);
+    if (WorkloadRecorder* workloadRecorder = m_workloadRecorder.load(std::memory_order_acquire))
+    {
+        workloadRecorder->recordExport();
+    }
+    TracedLock<std::mutex> l(
+        m_currencyTrendMapGuard, m_lockTracer.load(std::memory_order_acquire), LockSite::EXPORT);
+    mergeRateLogsUnsafe();
     return m_currencyTrendMap;
 }
 
+inline std::vector<std::string> POSTransactionManager::getCurrencies() const
+{
+    std::vector<std::string> currencies;
+    TracedLock<std::mutex> l(
+        m_currencyTrendMapGuard, m_lockTracer.load(std::memory_order_acquire), LockSite::EXPORT);
+    currencies.reserve(m_currencyTrendMap.size());
+    for (const auto& currencyTrend : m_currencyTrendMap)
+    {
+        currencies.push_back(currencyTrend.first);
+    }
+    return currencies;
+}
+
+inline Result POSTransactionManager::getExchangeRates(const std::string& currency, RateTrend& rateTrend) const
+{
+    TracedLock<std::mutex> l(
+        m_currencyTrendMapGuard, m_lockTracer.load(std::memory_order_acquire), LockSite::EXPORT);
+    auto currencyIt = m_currencyTrendMap.find(currency);
+    if (m_currencyTrendMap.end() == currencyIt)
+    {
+        rateTrend.clear();
+        return Result::NO_CURRENCY;
+    }
+    mergeRateLogUnsafe(currencyIt->second);
+    rateTrend = currencyIt->second;
+    return Result::SUCCESS;
+}
+
+inline Result POSTransactionManager::replaceExchangeRates(const std::string& currency, RateTrend& rateTrend)
+{
+    if (WorkloadRecorder* workloadRecorder = m_workloadRecorder.load(std::memory_order_acquire))
+    {
+        workloadRecorder->recordReplaceExchangeRates(currency, rateTrend);
+    }
+
+    if (currency.empty() || m_baseCurrency == currency)
+    {
+        return Result::CURRENCY_NOT_MATCH;
+    }
+    if (m_useNodePools)
+    {
+        // points are moved to pool of new trend
+        RateTrend pooledRateTrend = createRateTrend();
+        pooledRateTrend.insert(rateTrend.begin(), rateTrend.end());
+        rateTrend.swap(pooledRateTrend);
+    }
+
+    {
+        TracedLock<std::mutex> l(
+            m_currencyTrendMapGuard, m_lockTracer.load(std::memory_order_acquire), LockSite::ADD);
+        RateTrend& currencyRateTrend = getCurrencyTrendUnsafe(std::string(currency));
+        m_rateLogMap.erase(&currencyRateTrend);
+        m_dayRateIndexMap.erase(&currencyRateTrend);
+        currencyRateTrend.swap(rateTrend);
+        updateDayRateIndexUnsafe(currencyRateTrend,
+            std::numeric_limits<time_t>::min(), std::numeric_limits<time_t>::max());
+    }
+
+    if (m_rateChangeListenersCount.load())
+    {
+        notifyRatesChanged(currency, std::numeric_limits<time_t>::min(), std::numeric_limits<time_t>::max());
+    }
+    return Result::SUCCESS;
+}
+
+inline POSTransactionManager::CurrencyTrendMap POSTransactionManager::getExchangeRatesBefore(
+    const time_t date) const
+{
+    CurrencyTrendMap currencyTrendMap;
+    TracedLock<std::mutex> l(
+        m_currencyTrendMapGuard, m_lockTracer.load(std::memory_order_acquire), LockSite::EXPORT);
+    mergeRateLogsUnsafe();
+    for (const auto& currencyTrend : m_currencyTrendMap)
+    {
+        const RateTrend& rateTrend = currencyTrend.second;
+        currencyTrendMap.emplace(
+            currencyTrend.first,
+            RateTrend(rateTrend.begin(), rateTrend.lower_bound(date)));
+    }
+    return currencyTrendMap;
+}
+
+inline Result POSTransactionManager::findRateUnsafe(
+    const std::string& currency,
+    const time_t date,
+    double& rate) const
+{
+    auto currencyIt = m_currencyTrendMap.find(currency);
+    if (m_currencyTrendMap.end() == currencyIt)
+    {
+        return Result::NO_CURRENCY;
+    }
+    return findTrendRateUnsafe(currencyIt->second, date, rate);
+}
+
+inline Result POSTransactionManager::findTrendRateUnsafe(
+    const RateTrend& rateTrend,
+    const time_t date,
+    double& rate) const
+{
+    if (!m_rateLogMap.empty())
+    {
+        auto logIt = m_rateLogMap.find(&rateTrend);
+        if (m_rateLogMap.end() != logIt)
+        {
+            // the newest update that covers date wins
+            const std::vector<RateUpdate>& updates = logIt->second;
+            for (auto it = updates.rbegin(); it != updates.rend(); ++it)
+            {
+                if (date >= it->m_fromDate && (!it->m_toDateSet || date < it->m_toDate))
+                {
+                    if (it->m_rate <= 0)
+                    {
+                        return Result::NO_RATE;
+                    }
+                    rate = it->m_rate;
+                    return Result::SUCCESS;
+                }
+            }
+        }
+    }
+    if (!m_dayRateIndexMap.empty())
+    {
+        auto indexIt = m_dayRateIndexMap.find(&rateTrend);
+        double dayRate;
+        if (m_dayRateIndexMap.end() != indexIt && indexIt->second.m_index.findRate(date, dayRate))
+        {
+            if (dayRate <= 0)
+            {
+                return Result::NO_RATE;
+            }
+            rate = dayRate;
+            return Result::SUCCESS;
+        }
+    }
+    auto rateIt = rateTrend.upper_bound(date);
+    if (rateTrend.begin() == rateIt)
+    {
+        return Result::NO_RATE;
+    }
+    rate = std::prev(rateIt)->second;
+    if (rate <= 0)
+    {
+        return Result::NO_RATE;
+    }
+    return Result::SUCCESS;
+}
+
+inline Result POSTransactionManager::getExchangeRate(
+    const std::string& currency,
+    const time_t date,
+    double& rate) const
+{
+    if (WorkloadRecorder* workloadRecorder = m_workloadRecorder.load(std::memory_order_acquire))
+    {
+        workloadRecorder->recordGetExchangeRate(currency, date);
+    }
+
+    if (m_baseCurrency == currency)
+    {
+        rate = 1;
+        return Result::SUCCESS;
+    }
+    TracedLock<std::mutex> l(
+        m_currencyTrendMapGuard, m_lockTracer.load(std::memory_order_acquire), LockSite::LOOKUP);
+    return findRateUnsafe(currency, date, rate);
+}
+
+inline size_t POSTransactionManager::expireExchangeRates(const time_t cutoff)
+{
+    if (WorkloadRecorder* workloadRecorder = m_workloadRecorder.load(std::memory_order_acquire))
+    {
+        workloadRecorder->recordExpire(cutoff);
+    }
+
+    std::vector<std::string> currencies;
+    {
+        TracedLock<std::mutex> l(
+            m_currencyTrendMapGuard, m_lockTracer.load(std::memory_order_acquire), LockSite::EXPIRE);
+        currencies.reserve(m_currencyTrendMap.size());
+        for (const auto& currencyTrend : m_currencyTrendMap)
+        {
+            currencies.push_back(currencyTrend.first);
+        }
+    }
+
+    // lock is taken per currency to keep critical sections short
+    size_t removedCount = 0;
+    for (const auto& currency : currencies)
+    {
+        // rates disappear in [first removed point, first kept point)
+        time_t fromDate;
+        time_t toDate;
+        {
+            TracedLock<std::mutex> l(
+                m_currencyTrendMapGuard, m_lockTracer.load(std::memory_order_acquire), LockSite::EXPIRE);
+            auto currencyIt = m_currencyTrendMap.find(currency);
+            if (m_currencyTrendMap.end() == currencyIt)
+            {
+                continue;
+            }
+            RateTrend& rateTrend = currencyIt->second;
+            mergeRateLogUnsafe(rateTrend);
+            auto keepIt = rateTrend.upper_bound(cutoff);
+            if (rateTrend.begin() == keepIt)
+            {
+                continue;
+            }
+            // keep point that covers cutoff unless it is 'no rate' point
+            if (std::prev(keepIt)->second > 0)
+            {
+                -- keepIt;
+            }
+            if (rateTrend.begin() == keepIt)
+            {
+                continue;
+            }
+            // the last removed point is 'no rate' one if nothing is kept
+            fromDate = rateTrend.begin()->first;
+            toDate = rateTrend.end() != keepIt ? keepIt->first : std::prev(keepIt)->first;
+            removedCount += std::distance(rateTrend.begin(), keepIt);
+            rateTrend.erase(rateTrend.begin(), keepIt);
+            updateDayRateIndexUnsafe(rateTrend, cutoff, cutoff);
+        }
+
+        if (m_rateChangeListenersCount.load() && fromDate < toDate)
+        {
+            notifyRatesChanged(currency, fromDate, toDate);
+        }
+    }
+    return removedCount;
+}
+
+inline MemoryUsage POSTransactionManager::getMemoryUsage() const
+{
+    typedef CurrencyTrendMap::value_type CurrencyTrend;
+    // hash map node: link, value and cached hash of string key
+    const size_t currencyNodeSize = sizeof(void*) + sizeof(CurrencyTrend) + sizeof(size_t);
+    const size_t indexNodeSize = sizeof(void*) + sizeof(DayRateIndexMap::value_type);
+    const size_t logNodeSize = sizeof(void*) + sizeof(RateLogMap::value_type);
+
+    MemoryUsage memoryUsage;
+    CurrencyMemoryUsage& total = memoryUsage.m_total;
+    TracedLock<std::mutex> l(
+        m_currencyTrendMapGuard, m_lockTracer.load(std::memory_order_acquire), LockSite::EXPORT);
+    memoryUsage.m_currencies.reserve(m_currencyTrendMap.size());
+    for (const CurrencyTrend& currencyTrend : m_currencyTrendMap)
+    {
+        memoryUsage.m_currencies.emplace_back();
+        CurrencyMemoryUsage& usage = memoryUsage.m_currencies.back();
+        usage.m_currency = currencyTrend.first;
+        const RateTrend& rateTrend = currencyTrend.second;
+
+        const size_t keyBufferSize = getStringBufferSize(currencyTrend.first);
+        usage.m_keyBytes = currencyNodeSize - sizeof(RateTrend) + keyBufferSize;
+        usage.m_trendBytes = sizeof(RateTrend);
+        usage.m_overheadBytes = getHeapBlockSize(currencyNodeSize) - currencyNodeSize +
+            (keyBufferSize ? getHeapBlockSize(keyBufferSize) - keyBufferSize : 0);
+
+        usage.m_pointsCount = rateTrend.size();
+        usage.m_trendBytes += rateTrend.size() * RATE_TREND_NODE_SIZE;
+        if (const NodePool* pool = rateTrend.get_allocator().m_pool.get())
+        {
+            // free slots and slot padding are overhead
+            usage.m_overheadBytes += pool->getMemoryUsage() - rateTrend.size() * RATE_TREND_NODE_SIZE +
+                pool->getChunksCount() * sizeof(size_t);
+        }
+        else
+        {
+            usage.m_overheadBytes +=
+                rateTrend.size() * (getHeapBlockSize(RATE_TREND_NODE_SIZE) - RATE_TREND_NODE_SIZE);
+        }
+
+        auto indexIt = m_dayRateIndexMap.find(&rateTrend);
+        if (m_dayRateIndexMap.end() != indexIt)
+        {
+            const size_t indexSize = indexIt->second.m_index.getMemoryUsage();
+            usage.m_trendBytes += indexNodeSize + indexSize;
+            usage.m_overheadBytes += getHeapBlockSize(indexNodeSize) - indexNodeSize +
+                (indexSize ? getHeapBlockSize(indexSize) - indexSize : 0);
+        }
+        auto logIt = m_rateLogMap.find(&rateTrend);
+        if (m_rateLogMap.end() != logIt)
+        {
+            const std::vector<RateUpdate>& updates = logIt->second;
+            const size_t logSize = updates.capacity() * sizeof(RateUpdate);
+            usage.m_trendBytes += logNodeSize + updates.size() * sizeof(RateUpdate);
+            usage.m_overheadBytes += getHeapBlockSize(logNodeSize) - logNodeSize +
+                (logSize ? getHeapBlockSize(logSize) - updates.size() * sizeof(RateUpdate) : 0);
+            for (const RateUpdate& update : updates)
+            {
+                usage.m_trendBytes += getStringBufferSize(update.m_currency);
+            }
+        }
+
+        total.m_pointsCount += usage.m_pointsCount;
+        total.m_trendBytes += usage.m_trendBytes;
+        total.m_keyBytes += usage.m_keyBytes;
+        total.m_overheadBytes += usage.m_overheadBytes;
+    }
+
+    // hash tables and reused buffers of manager
+    total.m_overheadBytes +=
+        (m_currencyTrendMap.bucket_count() + m_dayRateIndexMap.bucket_count() + m_rateLogMap.bucket_count()) *
+            sizeof(void*) +
+        m_rateLogParts.capacity() * sizeof(RateUpdate) +
+        m_rateLogCovered.capacity() * sizeof(std::pair<time_t, time_t>);
+
+    std::sort(memoryUsage.m_currencies.begin(), memoryUsage.m_currencies.end(),
+        [](const CurrencyMemoryUsage& l, const CurrencyMemoryUsage& r) { return l.m_currency < r.m_currency; });
+    return memoryUsage;
+}
+
+inline size_t POSTransactionManager::compact()
+{
+    std::vector<std::string> currencies;
+    {
+        TracedLock<std::mutex> l(
+            m_currencyTrendMapGuard, m_lockTracer.load(std::memory_order_acquire), LockSite::EXPIRE);
+        currencies.reserve(m_currencyTrendMap.size());
+        for (const auto& currencyTrend : m_currencyTrendMap)
+        {
+            currencies.push_back(currencyTrend.first);
+        }
+    }
+
+    // lock is taken per currency to keep critical sections short
+    size_t removedCount = 0;
+    for (const auto& currency : currencies)
+    {
+        RateTrend rateTrend;
+        {
+            TracedLock<std::mutex> l(
+                m_currencyTrendMapGuard, m_lockTracer.load(std::memory_order_acquire), LockSite::EXPIRE);
+            auto currencyIt = m_currencyTrendMap.find(currency);
+            if (m_currencyTrendMap.end() == currencyIt)
+            {
+                continue;
+            }
+            RateTrend& currencyRateTrend = currencyIt->second;
+            mergeRateLogUnsafe(currencyRateTrend);
+            m_rateLogMap.erase(&currencyRateTrend);
+
+            // leading gap and repeated rates do not change lookups
+            rateTrend = createRateTrend();
+            for (const auto& point : currencyRateTrend)
+            {
+                const bool gap = point.second <= 0;
+                if (rateTrend.empty() ? gap :
+                    (gap ? rateTrend.rbegin()->second <= 0 : rateTrend.rbegin()->second == point.second))
+                {
+                    ++ removedCount;
+                    continue;
+                }
+                rateTrend.emplace_hint(rateTrend.end(), point);
+            }
+            currencyRateTrend.swap(rateTrend);
+            m_dayRateIndexMap.erase(&currencyRateTrend);
+            updateDayRateIndexUnsafe(currencyRateTrend,
+                std::numeric_limits<time_t>::min(), std::numeric_limits<time_t>::max());
+        }
+        // old nodes are released without lock
+    }
+
+    TracedLock<std::mutex> l(
+        m_currencyTrendMapGuard, m_lockTracer.load(std::memory_order_acquire), LockSite::EXPIRE);
+    std::vector<RateUpdate>().swap(m_rateLogParts);
+    std::vector<std::pair<time_t, time_t>>().swap(m_rateLogCovered);
+    return removedCount;
+}
+
 inline Result POSTransactionManager::checkCurrency(
     const std::string& fromCurrency,
-    const std::string& toCurrency)
+    const std::string& toCurrency) const
 {
     if (m_baseCurrency != fromCurrency && m_baseCurrency != toCurrency)
     {
@@ -42,7 +497,7 @@ void POSTransactionManager::getCurrencyAndRate(
     std::string& currency,
     double& rate,
     T1&& fromCurrency,
-    T2&& toCurrency)
+    T2&& toCurrency) const
 {
     if (m_baseCurrency == toCurrency)
     {
@@ -55,7 +510,7 @@ void POSTransactionManager::getCurrencyAndRate(
     }
 }
 
-POSTransactionManager::RateTrend::iterator POSTransactionManager::insertFromUnsafe(
+inline POSTransactionManager::RateTrend::iterator POSTransactionManager::insertFromUnsafe(
     RateTrend& rateTrend,
     const time_t fromDate,
     const double rate)
@@ -83,7 +538,7 @@ POSTransactionManager::RateTrend::iterator POSTransactionManager::insertFromUnsa
     return fromIt;
 }
 
-POSTransactionManager::RateTrend::iterator POSTransactionManager::insertToUnsafe(
+inline POSTransactionManager::RateTrend::iterator POSTransactionManager::insertToUnsafe(
     RateTrend& rateTrend,
     const time_t toDate,
     const double rate)
@@ -116,26 +571,240 @@ POSTransactionManager::RateTrend::iterator POSTransactionManager::insertToUnsafe
     return toIt;
 }
 
-POSTransactionManager::RateTrend& POSTransactionManager::getCurrencyTrendUnsafe(
+inline POSTransactionManager::RateTrend& POSTransactionManager::getCurrencyTrendUnsafe(
     std::string&& currency)
 {
     auto currencyIt = m_currencyTrendMap.find(currency);
     if (m_currencyTrendMap.end() == currencyIt)
     {
-        auto res = m_currencyTrendMap.emplace(std::move(currency), RateTrend());
+        auto res = m_currencyTrendMap.emplace(std::move(currency), createRateTrend());
         currencyIt = res.first;
     }
 
     return currencyIt->second;
 }
 
+inline POSTransactionManager::RateTrend POSTransactionManager::createRateTrend() const
+{
+    if (!m_useNodePools)
+    {
+        return RateTrend();
+    }
+    return RateTrend(RateTrend::allocator_type(std::make_shared<NodePool>()));
+}
+
+inline void POSTransactionManager::updateDayRateIndexUnsafe(
+    const RateTrend& rateTrend,
+    const time_t fromDate,
+    const time_t toDate) const
+{
+    auto indexIt = m_dayRateIndexMap.find(&rateTrend);
+    if (m_dayRateIndexMap.end() == indexIt)
+    {
+        if (rateTrend.size() < DayRateIndex::MIN_POINTS)
+        {
+            return;
+        }
+        indexIt = m_dayRateIndexMap.emplace(&rateTrend, DayRateIndexState()).first;
+    }
+
+    DayRateIndexState& state = indexIt->second;
+    try
+    {
+        if (!state.m_index.empty())
+        {
+            state.m_index.update(rateTrend, fromDate, toDate);
+        }
+        else if (rateTrend.size() >= state.m_nextBuildSize)
+        {
+            state.m_index.build(rateTrend);
+        }
+        else
+        {
+            return;
+        }
+    }
+    catch (const std::bad_alloc&)
+    {
+        // trend is already changed. lookups fall back to trend
+        state.m_index.clear();
+    }
+
+    if (state.m_index.empty() || !state.m_index.isWorthwhile(rateTrend.size()))
+    {
+        // try again when trend grows twice
+        state.m_index.clear();
+        state.m_nextBuildSize = rateTrend.size() * 2;
+    }
+}
+
+inline bool POSTransactionManager::hasDayRateIndex(const std::string& currency) const
+{
+    TracedLock<std::mutex> l(
+        m_currencyTrendMapGuard, m_lockTracer.load(std::memory_order_acquire), LockSite::LOOKUP);
+    auto currencyIt = m_currencyTrendMap.find(currency);
+    if (m_currencyTrendMap.end() == currencyIt)
+    {
+        return false;
+    }
+    mergeRateLogUnsafe(currencyIt->second);
+    auto indexIt = m_dayRateIndexMap.find(&currencyIt->second);
+    return m_dayRateIndexMap.end() != indexIt && !indexIt->second.m_index.empty();
+}
+
+inline void POSTransactionManager::applyRateUpdate(RateTrend& rateTrend, const RateUpdate& update)
+{
+    if (!update.m_toDateSet)
+    {
+        // empty trend. just insert
+        if (rateTrend.empty())
+        {
+            rateTrend.emplace(update.m_fromDate, update.m_rate);
+            return;
+        }
+
+        auto fromIt = insertFromUnsafe(rateTrend, update.m_fromDate, update.m_rate);
+
+        // erase everything in (fromDate; end)
+        rateTrend.erase(std::next(fromIt), rateTrend.end());
+        return;
+    }
+
+    // empty trend. just insert
+    if (rateTrend.empty())
+    {
+        rateTrend.emplace(update.m_fromDate, update.m_rate);
+        rateTrend.emplace(update.m_toDate, -1);
+        return;
+    }
+
+    auto toIt = insertToUnsafe(rateTrend, update.m_toDate, update.m_rate);
+    auto fromIt = insertFromUnsafe(rateTrend, update.m_fromDate, update.m_rate);
+
+    // erase everything in (fromDate; toDate)
+    rateTrend.erase(std::next(fromIt), toIt);
+}
+
+inline void POSTransactionManager::addRateUpdateUnsafe(RateTrend& rateTrend, RateUpdate& update)
+{
+    if (!m_rateLogLimit)
+    {
+        applyRateUpdate(rateTrend, update);
+        updateDayRateIndexUnsafe(rateTrend, update.m_fromDate,
+            update.m_toDateSet ? update.m_toDate : std::numeric_limits<time_t>::max());
+        return;
+    }
+    std::vector<RateUpdate>& updates = m_rateLogMap[&rateTrend];
+    // currency is known from trend
+    updates.push_back(update);
+    updates.back().m_currency.clear();
+    if (updates.size() >= m_rateLogLimit)
+    {
+        mergeRateLogUnsafe(rateTrend);
+    }
+}
+
+inline void POSTransactionManager::mergeRateLogUnsafe(RateTrend& rateTrend) const
+{
+    auto logIt = m_rateLogMap.find(&rateTrend);
+    if (m_rateLogMap.end() == logIt)
+    {
+        return;
+    }
+    const std::vector<RateUpdate>& updates = logIt->second;
+    const time_t maxDate = std::numeric_limits<time_t>::max();
+
+    // walk from the newest update. parts of update that are covered by newer ones are dropped
+    std::vector<RateUpdate>& parts = m_rateLogParts;
+    // disjoint sorted covered intervals [from, to)
+    std::vector<std::pair<time_t, time_t>>& covered = m_rateLogCovered;
+    parts.clear();
+    covered.clear();
+    time_t changedFromDate = maxDate;
+    time_t changedToDate = std::numeric_limits<time_t>::min();
+    for (auto it = updates.rbegin(); it != updates.rend(); ++it)
+    {
+        const time_t fromDate = it->m_fromDate;
+        const time_t toDate = it->m_toDateSet ? it->m_toDate : maxDate;
+        changedFromDate = std::min(changedFromDate, fromDate);
+        changedToDate = std::max(changedToDate, toDate);
+
+        auto coveredIt = std::upper_bound(covered.begin(), covered.end(), fromDate,
+            [](const time_t date, const std::pair<time_t, time_t>& interval) { return date < interval.first; });
+        if (covered.begin() != coveredIt && std::prev(coveredIt)->second >= fromDate)
+        {
+            -- coveredIt;
+        }
+        const auto firstCoveredIt = coveredIt;
+        time_t date = fromDate;
+        std::pair<time_t, time_t> joined(fromDate, toDate);
+        for (; covered.end() != coveredIt && coveredIt->first <= toDate; ++coveredIt)
+        {
+            if (coveredIt->first > date)
+            {
+                parts.push_back({ std::string(), date, coveredIt->first, true, it->m_rate });
+            }
+            date = std::max(date, coveredIt->second);
+            joined.first = std::min(joined.first, coveredIt->first);
+            joined.second = std::max(joined.second, coveredIt->second);
+        }
+        if (date < toDate)
+        {
+            parts.push_back({ std::string(), date, toDate, it->m_toDateSet, it->m_rate });
+        }
+        // join intervals that touch update
+        if (firstCoveredIt == coveredIt)
+        {
+            covered.insert(firstCoveredIt, joined);
+        }
+        else
+        {
+            *firstCoveredIt = joined;
+            covered.erase(std::next(firstCoveredIt), coveredIt);
+        }
+    }
+
+    // parts are disjoint, so they are applied in date order and trend is walked forward
+    std::sort(parts.begin(), parts.end(), [](const RateUpdate& update1, const RateUpdate& update2)
+    {
+        return update1.m_fromDate < update2.m_fromDate;
+    });
+    for (const auto& part : parts)
+    {
+        applyRateUpdate(rateTrend, part);
+    }
+    m_rateLogMap.erase(logIt);
+    updateDayRateIndexUnsafe(rateTrend, changedFromDate, changedToDate);
+}
+
+inline void POSTransactionManager::mergeRateLogsUnsafe() const
+{
+    while (!m_rateLogMap.empty())
+    {
+        // trends are never removed from map
+        mergeRateLogUnsafe(const_cast<RateTrend&>(*m_rateLogMap.begin()->first));
+    }
+}
+
+inline void POSTransactionManager::setRateLogLimit(const size_t limit)
+{
+    TracedLock<std::mutex> l(
+        m_currencyTrendMapGuard, m_lockTracer.load(std::memory_order_acquire), LockSite::ADD);
+    m_rateLogLimit = limit;
+    if (!limit)
+    {
+        mergeRateLogsUnsafe();
+    }
+}
+
 template<class T1, class T2>
-Result POSTransactionManager::addExchangeRate(
+Result POSTransactionManager::makeRateUpdate(
+    RateUpdate& update,
     T1&& fromCurrency,
     T2&& toCurrency,
     const time_t fromDate,
     const time_t toDate,
-    double rate)
+    double rate) const
 {
     Result r = checkCurrency(fromCurrency, toCurrency);
     if (Result::SUCCESS != r)
@@ -148,26 +817,74 @@ Result POSTransactionManager::addExchangeRate(
         return Result::INVALID_DATE;
     }
 
-    std::string currency;
-    getCurrencyAndRate(currency, rate, fromCurrency, toCurrency);
+    getCurrencyAndRate(update.m_currency, rate, std::forward<T1>(fromCurrency), std::forward<T2>(toCurrency));
+    update.m_fromDate = fromDate;
+    update.m_toDate = toDate;
+    update.m_toDateSet = true;
+    update.m_rate = rate;
+    return Result::SUCCESS;
+}
 
-    std::unique_lock<std::mutex> l(m_currencyTrendMapGuard);
-    RateTrend& rateTrend = getCurrencyTrendUnsafe(std::move(currency));
+template<class T1, class T2>
+Result POSTransactionManager::makeRateUpdate(
+    RateUpdate& update,
+    T1&& fromCurrency,
+    T2&& toCurrency,
+    const time_t fromDate,
+    double rate) const
+{
+    Result r = checkCurrency(fromCurrency, toCurrency);
+    if (Result::SUCCESS != r)
+    {
+        return r;
+    }
 
-    // empty trend. just insert
-    if (rateTrend.empty())
+    getCurrencyAndRate(update.m_currency, rate, std::forward<T1>(fromCurrency), std::forward<T2>(toCurrency));
+    update.m_fromDate = fromDate;
+    update.m_toDate = 0;
+    update.m_toDateSet = false;
+    update.m_rate = rate;
+    return Result::SUCCESS;
+}
+
+inline void POSTransactionManager::addExchangeRates(std::vector<RateUpdate>&& updates)
+{
+    if (WorkloadRecorder* workloadRecorder = m_workloadRecorder.load(std::memory_order_acquire))
     {
-        rateTrend.emplace(fromDate, rate);
-        rateTrend.emplace(toDate, -1);
-        return Result::SUCCESS;
+        workloadRecorder->recordAddExchangeRates(updates);
     }
 
-    auto toIt = insertToUnsafe(rateTrend, toDate, rate);
-    auto fromIt = insertFromUnsafe(rateTrend, fromDate, rate);
+    const bool notify = m_rateChangeListenersCount.load() != 0;
+    {
+        TracedLock<std::mutex> l(
+            m_currencyTrendMapGuard, m_lockTracer.load(std::memory_order_acquire), LockSite::ADD);
+        RateTrend* rateTrend = nullptr;
+        const std::string* currency = nullptr;
+        for (auto& update : updates)
+        {
+            if (!currency || *currency != update.m_currency)
+            {
+                auto currencyIt = m_currencyTrendMap.find(update.m_currency);
+                if (m_currencyTrendMap.end() == currencyIt)
+                {
+                    currencyIt = m_currencyTrendMap.emplace(
+                        notify ? update.m_currency : std::move(update.m_currency), createRateTrend()).first;
+                }
+                currency = &currencyIt->first;
+                rateTrend = &currencyIt->second;
+            }
+            addRateUpdateUnsafe(*rateTrend, update);
+        }
+    }
 
-    // erase everything in (fromDate; toDate)
-    rateTrend.erase(std::next(fromIt), toIt);
-    return Result::SUCCESS;
+    if (notify)
+    {
+        for (const auto& update : updates)
+        {
+            notifyRatesChanged(update.m_currency, update.m_fromDate,
+                update.m_toDateSet ? update.m_toDate : std::numeric_limits<time_t>::max());
+        }
+    }
 }
 
 template<class T1, class T2>
@@ -175,31 +892,112 @@ Result POSTransactionManager::addExchangeRate(
     T1&& fromCurrency,
     T2&& toCurrency,
     const time_t fromDate,
+    const time_t toDate,
     double rate)
 {
-    Result r = checkCurrency(fromCurrency, toCurrency);
+    if (WorkloadRecorder* workloadRecorder = m_workloadRecorder.load(std::memory_order_acquire))
+    {
+        workloadRecorder->recordAddExchangeRate(fromCurrency, toCurrency, fromDate, toDate, rate);
+    }
+
+    RateUpdate update;
+    Result r = makeRateUpdate(
+        update, std::forward<T1>(fromCurrency), std::forward<T2>(toCurrency), fromDate, toDate, rate);
     if (Result::SUCCESS != r)
     {
         return r;
     }
 
     std::string currency;
-    getCurrencyAndRate(currency, rate, fromCurrency, toCurrency);
+    if (m_rateChangeListenersCount.load())
+    {
+        currency = update.m_currency;
+    }
+    {
+        TracedLock<std::mutex> l(
+            m_currencyTrendMapGuard, m_lockTracer.load(std::memory_order_acquire), LockSite::ADD);
+        RateTrend& rateTrend = getCurrencyTrendUnsafe(std::move(update.m_currency));
+        addRateUpdateUnsafe(rateTrend, update);
+    }
 
-    std::unique_lock<std::mutex> l(m_currencyTrendMapGuard);
-    RateTrend& rateTrend = getCurrencyTrendUnsafe(std::move(currency));
+    if (!currency.empty())
+    {
+        notifyRatesChanged(currency, update.m_fromDate,
+            update.m_toDateSet ? update.m_toDate : std::numeric_limits<time_t>::max());
+    }
+    return Result::SUCCESS;
+}
 
-    // empty trend. just insert
-    if (rateTrend.empty())
+template<class T1, class T2>
+Result POSTransactionManager::addExchangeRate(
+    T1&& fromCurrency,
+    T2&& toCurrency,
+    const time_t fromDate,
+    double rate)
+{
+    if (WorkloadRecorder* workloadRecorder = m_workloadRecorder.load(std::memory_order_acquire))
     {
-        rateTrend.emplace(fromDate, rate);
-        return Result::SUCCESS;
+        workloadRecorder->recordAddExchangeRate(fromCurrency, toCurrency, fromDate, rate);
+    }
+
+    RateUpdate update;
+    Result r = makeRateUpdate(
+        update, std::forward<T1>(fromCurrency), std::forward<T2>(toCurrency), fromDate, rate);
+    if (Result::SUCCESS != r)
+    {
+        return r;
+    }
+
+    std::string currency;
+    if (m_rateChangeListenersCount.load())
+    {
+        currency = update.m_currency;
+    }
+    {
+        TracedLock<std::mutex> l(
+            m_currencyTrendMapGuard, m_lockTracer.load(std::memory_order_acquire), LockSite::ADD);
+        RateTrend& rateTrend = getCurrencyTrendUnsafe(std::move(update.m_currency));
+        addRateUpdateUnsafe(rateTrend, update);
     }
 
-    auto fromIt = insertFromUnsafe(rateTrend, fromDate, rate);
+    if (!currency.empty())
+    {
+        notifyRatesChanged(currency, update.m_fromDate,
+            update.m_toDateSet ? update.m_toDate : std::numeric_limits<time_t>::max());
+    }
+    return Result::SUCCESS;
+}
+
+inline Result POSTransactionManager::findConversionRates(
+    double& fromRate,
+    double& toRate,
+    const std::string& fromCurrency,
+    const std::string& toCurrency,
+    const time_t date) const
+{
+    fromRate = 1;
+    if (m_baseCurrency != fromCurrency)
+    {
+        TracedLock<std::mutex> l(
+            m_currencyTrendMapGuard, m_lockTracer.load(std::memory_order_acquire), LockSite::CONVERT_FROM);
+        Result r = findRateUnsafe(fromCurrency, date, fromRate);
+        if (Result::SUCCESS != r)
+        {
+            return r;
+        }
+    }
 
-    // erase everything in (fromDate; end)
-    rateTrend.erase(std::next(fromIt), rateTrend.end());
+    toRate = 1;
+    if (m_baseCurrency != toCurrency)
+    {
+        TracedLock<std::mutex> l(
+            m_currencyTrendMapGuard, m_lockTracer.load(std::memory_order_acquire), LockSite::CONVERT_TO);
+        Result r = findRateUnsafe(toCurrency, date, toRate);
+        if (Result::SUCCESS != r)
+        {
+            return r;
+        }
+    }
     return Result::SUCCESS;
 }
 
@@ -209,67 +1007,71 @@ Result POSTransactionManager::convertPOSTransaction(
     const POSTransaction& fromPosTransaction,
     T&& toCurrency) const
 {
+    if (WorkloadRecorder* workloadRecorder = m_workloadRecorder.load(std::memory_order_acquire))
+    {
+        workloadRecorder->recordConvert(
+            fromPosTransaction.m_total, fromPosTransaction.m_currency, fromPosTransaction.m_date, toCurrency);
+    }
+
     if (fromPosTransaction.m_currency == toCurrency)
     {
         toPosTransaction = fromPosTransaction;
         return Result::SUCCESS;
     }
 
-    double fromRate = -1;
-    if (m_baseCurrency == fromPosTransaction.m_currency)
-    {
-        fromRate = 1;
-    }
-    else
+    double fromRate;
+    double toRate;
+    Result r = findConversionRates(
+        fromRate, toRate, fromPosTransaction.m_currency, toCurrency, fromPosTransaction.m_date);
+    if (Result::SUCCESS != r)
     {
-        std::unique_lock<std::mutex> l(m_currencyTrendMapGuard);
-        auto currencyIt = m_currencyTrendMap.find(fromPosTransaction.m_currency);
-        if (m_currencyTrendMap.end() == currencyIt)
-        {
-            return Result::NO_CURRENCY;
-        }
-        const RateTrend& rateTrend = currencyIt->second;
-        auto rateIt = rateTrend.upper_bound(fromPosTransaction.m_date);
-        if (rateTrend.begin() == rateIt)
-        {
-            return Result::NO_RATE;
-        }
-        fromRate = std::prev(rateIt)->second;
+        return r;
     }
-    if (fromRate <= 0)
+
+    toPosTransaction.m_currency = std::forward<T>(toCurrency);
+    toPosTransaction.m_date = fromPosTransaction.m_date;
+    toPosTransaction.m_total = fromPosTransaction.m_total / fromRate * toRate;
+    return Result::SUCCESS;
+}
+
+template<class T>
+Result POSTransactionManager::convertPOSTransaction(
+    MoneyTransaction& toTransaction,
+    const MoneyTransaction& fromTransaction,
+    T&& toCurrency) const
+{
+    if (WorkloadRecorder* workloadRecorder = m_workloadRecorder.load(std::memory_order_acquire))
     {
-        return Result::NO_RATE;
+        workloadRecorder->recordConvertMoney(
+            fromTransaction.m_amount, fromTransaction.m_currency, fromTransaction.m_date, toCurrency);
     }
 
-    double toRate = -1;
-    if (m_baseCurrency == toCurrency)
+    if (fromTransaction.m_currency == toCurrency)
     {
-        toRate = 1;
+        toTransaction = fromTransaction;
+        return Result::SUCCESS;
     }
-    else
+
+    double fromRate;
+    double toRate;
+    Result r = findConversionRates(fromRate, toRate, fromTransaction.m_currency, toCurrency, fromTransaction.m_date);
+    int64_t fixedFromRate;
+    int64_t fixedToRate;
+    r = Result::SUCCESS == r ? toFixedRate(fromRate, fixedFromRate) : r;
+    r = Result::SUCCESS == r ? toFixedRate(toRate, fixedToRate) : r;
+    if (Result::SUCCESS != r)
     {
-        std::unique_lock<std::mutex> l(m_currencyTrendMapGuard);
-        auto currencyIt = m_currencyTrendMap.find(toCurrency);
-        if (m_currencyTrendMap.end() == currencyIt)
-        {
-            return Result::NO_CURRENCY;
-        }
-        const RateTrend& rateTrend = currencyIt->second;
-        auto rateIt = rateTrend.upper_bound(fromPosTransaction.m_date);
-        if (rateTrend.begin() == rateIt)
-        {
-            return Result::NO_RATE;
-        }
-        toRate = std::prev(rateIt)->second;
+        return r;
     }
-    if (toRate <= 0)
+    const int64_t amount = convertAmount(fromTransaction.m_amount, fixedFromRate, fixedToRate);
+    if (INVALID_AMOUNT == amount)
     {
-        return Result::NO_RATE;
+        return Result::AMOUNT_OVERFLOW;
     }
 
-    toPosTransaction.m_currency = std::forward<T>(toCurrency);
-    toPosTransaction.m_date = fromPosTransaction.m_date;
-    toPosTransaction.m_total = fromPosTransaction.m_total / fromRate * toRate;
+    toTransaction.m_currency = std::forward<T>(toCurrency);
+    toTransaction.m_date = fromTransaction.m_date;
+    toTransaction.m_amount = amount;
     return Result::SUCCESS;
 }
 } // namespace pos
@@ -0,0 +1,25 @@
+#ifndef POS_RADIX_SORT_H
+#define POS_RADIX_SORT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace pos
+{
+
+// keys are sorted by several threads starting from this count
+static constexpr size_t RADIX_SORT_PARALLEL_MIN_SIZE = 1 << 16;
+
+// Stable LSD radix sort (8 bit digits) of keys.
+// order gets permutation of key indexes in increasing key order. keys are not changed.
+// passes over digits that are the same in all keys are skipped.
+// threadsCount 0 means hardware concurrency
+void radixSortPermutation(
+    const std::vector<uint64_t>& keys,
+    std::vector<uint32_t>& order,
+    const size_t threadsCount = 0);
+
+} // namespace pos
+
+#endif // POS_RADIX_SORT_H
@@ -0,0 +1,67 @@
+#ifndef POS_RATE_EXPORTER_H
+#define POS_RATE_EXPORTER_H
+
+#include <cstddef>
+#include <ctime>
+#include <string>
+
+#include "POSTransaction.h"
+
+namespace pos
+{
+
+enum class ExportFormat : uint8_t
+{
+    CSV,
+    JSON,
+};
+
+// enough for any double and any timestamp
+static constexpr size_t FORMAT_BUFFER_SIZE = 32;
+
+// shortest representation that is parsed back to the same value. returns length
+size_t formatDouble(char* buf, const double value);
+// UTC time as 'YYYY-MM-DD HH:MM:SS' (the same as timeToString). returns length
+size_t formatTime(char* buf, const time_t date);
+
+// Streaming export of manager rates ('base -> currency').
+// Trends are copied one by one, so manager lock is held for one trend only and
+// the whole map is never copied. Output is written to file descriptor when buffer
+// is full or to buffer only.
+// CSV: 'currency,date,rate' lines. JSON: {"base":..,"rates":{"EUR":[["date",rate],..],..}}.
+// Rate of the point that starts a gap is empty (CSV) or null (JSON).
+class RateExporter
+{
+public:
+    static constexpr size_t BUFFER_SIZE = 64 * 1024;
+
+private:
+    const ExportFormat m_format;
+    const int m_fd;
+    std::string m_buffer;
+    bool m_failed = false;
+
+private:
+    void flush();
+    void append(const char* data, const size_t size);
+    void appendString(const std::string& str);
+    void appendRate(const time_t date, const double rate);
+
+public:
+    // write to file descriptor. descriptor is not closed
+    RateExporter(const ExportFormat format, const int fd);
+    // write to buffer
+    explicit RateExporter(const ExportFormat format);
+
+    RateExporter(const RateExporter&) = delete;
+    RateExporter& operator=(const RateExporter&) = delete;
+
+    Result exportRates(const POSTransactionManager& manager);
+
+    // output of the last export of buffer exporter
+    const std::string& getBuffer() const { return m_buffer; }
+};
+
+} // namespace pos
+
+#endif // POS_RATE_EXPORTER_H
@@ -0,0 +1,62 @@
+#ifndef POS_RATE_IMPORTER_H
+#define POS_RATE_IMPORTER_H
+
+#include <cstddef>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include "POSTransaction.h"
+
+namespace pos
+{
+
+// parse UTC time 'YYYY-MM-DD HH:MM:SS' (the format of formatTime).
+// returns pointer after time or nullptr
+const char* parseTime(const char* p, const char* end, time_t& date);
+
+// Parallel import of rate history files in CSV export format ('currency,date,rate' lines,
+// header line is optional, empty rate starts a gap, quoted currency may hold line breaks).
+// Files are read and parsed by worker threads. Points of every currency are collected from
+// all files (point of later file or line wins), sorted and built into trend without manager
+// lock, then trend is installed with one swap per currency. Trends of imported currencies
+// are replaced. Nothing is installed if any file fails.
+class RateImporter
+{
+private:
+    struct Point
+    {
+        time_t m_date;
+        double m_rate;
+    };
+    typedef std::unordered_map<std::string, std::vector<Point>> CurrencyPoints;
+
+    const size_t m_threadsCount;
+    std::string m_errorLocation;
+    size_t m_pointsCount = 0;
+    size_t m_currenciesCount = 0;
+
+private:
+    // parse file into points of currencies. location of error is 'file:line'
+    static Result parseFile(
+        const std::string& fileName,
+        const std::string& baseCurrency,
+        CurrencyPoints& currencyPoints,
+        std::string& errorLocation);
+
+public:
+    // 0 - one thread per core
+    explicit RateImporter(const size_t threadsCount = 0);
+
+    Result importRates(POSTransactionManager& manager, const std::vector<std::string>& fileNames);
+
+    // of the last import
+    size_t getPointsCount() const { return m_pointsCount; }
+    size_t getCurrenciesCount() const { return m_currenciesCount; }
+    // 'file:line' of failed import (line is 0 if file cannot be read)
+    const std::string& getErrorLocation() const { return m_errorLocation; }
+};
+
+} // namespace pos
+
+#endif // POS_RATE_IMPORTER_H
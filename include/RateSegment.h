@@ -0,0 +1,62 @@
+#ifndef POS_RATE_SEGMENT_H
+#define POS_RATE_SEGMENT_H
+
+#include <cstdint>
+#include <ctime>
+#include <string>
+
+#include "POSTransaction.h"
+
+namespace pos
+{
+
+// Immutable sorted rate points of one currency in memory-mapped file.
+// Segment resolves rates for dates in [fromDate, toDate)
+class RateSegment
+{
+public:
+    struct Header
+    {
+        char m_magic[8];
+        int64_t m_fromDate;
+        int64_t m_toDate;
+        uint64_t m_count;
+    };
+    struct Point
+    {
+        int64_t m_date;
+        double m_rate;
+    };
+
+private:
+    void* m_data = nullptr;
+    size_t m_size = 0;
+    const Header* m_header = nullptr;
+    const Point* m_points = nullptr;
+
+public:
+    RateSegment() = default;
+    ~RateSegment();
+
+    RateSegment(const RateSegment&) = delete;
+    RateSegment& operator=(const RateSegment&) = delete;
+
+    // file is created and shall not exist. partially written file is removed
+    static Result write(
+        const std::string& fileName,
+        const POSTransactionManager::RateTrend& rateTrend,
+        const time_t fromDate,
+        const time_t toDate);
+    Result open(const std::string& fileName);
+    void close();
+
+    time_t getFromDate() const { return m_header->m_fromDate; }
+    time_t getToDate() const { return m_header->m_toDate; }
+    size_t size() const { return m_header ? m_header->m_count : 0; }
+
+    Result findRate(const time_t date, double& rate) const;
+};
+
+} // namespace pos
+
+#endif // POS_RATE_SEGMENT_H
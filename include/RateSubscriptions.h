@@ -0,0 +1,122 @@
+#ifndef POS_RATE_SUBSCRIPTIONS_H
+#define POS_RATE_SUBSCRIPTIONS_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "POSTransaction.h"
+
+namespace pos
+{
+
+// rates of 'base -> currency' were changed in [fromDate, toDate)
+struct RateChange
+{
+    std::string m_currency;
+    time_t m_fromDate;
+    time_t m_toDate;
+};
+
+// what happens when change does not fit into full queue of currency
+enum class OverflowPolicy
+{
+    // change is merged with the nearest queued interval (nothing is lost, interval is wider)
+    WIDEN,
+    // queue is replaced by the whole time range of currency
+    RESYNC,
+    // change is dropped and counted
+    DROP_NEWEST,
+};
+
+class RateSubscriber
+{
+public:
+    virtual ~RateSubscriber() = default;
+    // changes are ordered by currency and date, intervals of currency do not touch.
+    // called from notification thread
+    virtual void onRateChanges(const std::vector<RateChange>& changes) = 0;
+};
+
+// Change subscriptions with batched notifications.
+// Rate changes of manager are put into queues of subscribers of the currency. Queue keeps sorted
+// disjoint intervals, so repeated and overlapping changes are coalesced while subscriber is busy.
+// Notification thread takes whole queues of ready subscribers in turn and delivers them as one
+// batch. Writers only lock queues for insert, so slow subscriber never blocks addExchangeRate.
+class RateSubscriptions : public RateChangeListener
+{
+public:
+    typedef uint64_t SubscriptionId;
+
+private:
+    // fromDate -> toDate
+    typedef std::map<time_t, time_t> Intervals;
+    struct Subscription
+    {
+        SubscriptionId m_id;
+        RateSubscriber* m_subscriber;
+        std::vector<std::string> m_currencies;
+        size_t m_queueLimit;
+        OverflowPolicy m_policy;
+        std::map<std::string, Intervals> m_queues;
+        // in ready list
+        bool m_ready = false;
+        uint64_t m_droppedCount = 0;
+    };
+
+    POSTransactionManager& m_manager;
+    std::map<SubscriptionId, std::unique_ptr<Subscription>> m_subscriptions;
+    std::unordered_map<std::string, std::vector<Subscription*>> m_currencySubscriptions;
+    std::deque<Subscription*> m_ready;
+    SubscriptionId m_nextId = 1;
+    // 0 if nothing is delivered now
+    SubscriptionId m_deliveringId = 0;
+    uint64_t m_batchesCount = 0;
+    bool m_stopped = false;
+    mutable std::mutex m_guard;
+    std::condition_variable m_notifierCv;
+    std::condition_variable m_deliveredCv;
+    std::thread m_notifier;
+
+private:
+    static void addInterval(Intervals& intervals, time_t fromDate, time_t toDate);
+    void enqueueUnsafe(Subscription& subscription, const std::string& currency, time_t fromDate, time_t toDate);
+    void run();
+
+public:
+    RateSubscriptions(POSTransactionManager& manager);
+    // delivers queued changes
+    ~RateSubscriptions();
+
+    RateSubscriptions(const RateSubscriptions&) = delete;
+    RateSubscriptions& operator=(const RateSubscriptions&) = delete;
+
+    // queueLimit - max number of queued intervals of every currency.
+    // NO_CURRENCY if currencies are empty, CURRENCY_NOT_MATCH for base currency
+    Result subscribe(
+        SubscriptionId& id,
+        RateSubscriber& subscriber,
+        const std::vector<std::string>& currencies,
+        const size_t queueLimit = 1024,
+        const OverflowPolicy policy = OverflowPolicy::WIDEN);
+    // drops queued changes and waits for delivery in progress (unless called from subscriber)
+    void unsubscribe(const SubscriptionId id);
+    // wait until queues are empty and delivered. returns at once if called from subscriber
+    void flush();
+
+    uint64_t getBatchesCount() const;
+    uint64_t getDroppedCount(const SubscriptionId id) const;
+
+    void onRatesChanged(const std::string& currency, const time_t fromDate, const time_t toDate) override;
+};
+
+} // namespace pos
+
+#endif // POS_RATE_SUBSCRIPTIONS_H
@@ -0,0 +1,130 @@
+#ifndef POS_RATE_TREND_ALLOCATOR_H
+#define POS_RATE_TREND_ALLOCATOR_H
+
+#include <cstddef>
+#include <ctime>
+#include <functional>
+#include <map>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace pos
+{
+
+// Free list allocator of fixed size nodes.
+// Nodes are cut from chunks that grow twice up to MAX_CHUNK_NODES nodes. All chunks are
+// released at once when the last node is freed or pool is destroyed. Not thread safe.
+class NodePool
+{
+public:
+    static constexpr size_t MIN_CHUNK_NODES = 16;
+    static constexpr size_t MAX_CHUNK_NODES = 4096;
+
+private:
+    // size of the first allocation. other sizes are not served
+    size_t m_nodeSize = 0;
+    size_t m_slotSize = 0;
+    std::vector<void*> m_chunks;
+    size_t m_chunkNodes = MIN_CHUNK_NODES;
+    char* m_chunkPos = nullptr;
+    char* m_chunkEnd = nullptr;
+    void* m_freeList = nullptr;
+    size_t m_nodesCount = 0;
+    size_t m_memoryUsage = 0;
+
+private:
+    void release();
+
+public:
+    NodePool() = default;
+    ~NodePool();
+
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+
+    bool accepts(const size_t size) const { return !m_nodeSize || m_nodeSize == size; }
+    // size shall be accepted
+    void* allocate(const size_t size);
+    void deallocate(void* node);
+
+    size_t getNodesCount() const { return m_nodesCount; }
+    // slot of node in chunk. 0 before the first allocation
+    size_t getSlotSize() const { return m_slotSize; }
+    size_t getChunksCount() const { return m_chunks.size(); }
+    // bytes allocated for chunks
+    size_t getMemoryUsage() const { return m_memoryUsage; }
+};
+
+// Allocator of rate trend nodes.
+// Allocator with pool takes single nodes from pool, otherwise (and for arrays) operator new is used.
+// Copy of container gets allocator without pool, so copies given out of manager lock
+// never touch the pool.
+template<class T>
+class RateTrendAllocator
+{
+public:
+    typedef T value_type;
+    typedef std::false_type propagate_on_container_copy_assignment;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    std::shared_ptr<NodePool> m_pool;
+
+public:
+    RateTrendAllocator() = default;
+    explicit RateTrendAllocator(std::shared_ptr<NodePool> pool):
+        m_pool(std::move(pool))
+    {}
+    template<class U>
+    RateTrendAllocator(const RateTrendAllocator<U>& other):
+        m_pool(other.m_pool)
+    {}
+
+    T* allocate(const size_t n)
+    {
+        if (m_pool && 1 == n && m_pool->accepts(sizeof(T)))
+        {
+            return static_cast<T*>(m_pool->allocate(sizeof(T)));
+        }
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, const size_t n)
+    {
+        if (m_pool && 1 == n && m_pool->accepts(sizeof(T)))
+        {
+            m_pool->deallocate(p);
+            return;
+        }
+        ::operator delete(p);
+    }
+
+    RateTrendAllocator select_on_container_copy_construction() const
+    {
+        return RateTrendAllocator();
+    }
+};
+
+template<class T, class U>
+bool operator==(const RateTrendAllocator<T>& l, const RateTrendAllocator<U>& r)
+{
+    return l.m_pool == r.m_pool;
+}
+
+template<class T, class U>
+bool operator!=(const RateTrendAllocator<T>& l, const RateTrendAllocator<U>& r)
+{
+    return l.m_pool != r.m_pool;
+}
+
+// rate points: a point means rate is applied from its date. rate <= 0 starts gap
+typedef std::map<time_t, double, std::less<time_t>, RateTrendAllocator<std::pair<const time_t, double>>> RateTrend;
+// size of trend node: tree node keeps color and three links before value
+constexpr size_t RATE_TREND_NODE_SIZE = 4 * sizeof(void*) + sizeof(RateTrend::value_type);
+
+} // namespace pos
+
+#endif // POS_RATE_TREND_ALLOCATOR_H
@@ -0,0 +1,57 @@
+#ifndef POS_RETENTION_SCHEDULER_H
+#define POS_RETENTION_SCHEDULER_H
+
+#include <ctime>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+#include "POSTransaction.h"
+
+namespace pos
+{
+
+// Background thread that periodically drops rates older than horizon
+class RetentionScheduler
+{
+public:
+    typedef std::function<time_t(void)> Clock;
+
+private:
+    POSTransactionManager& m_manager;
+    const time_t m_horizon;
+    const std::chrono::milliseconds m_period;
+    Clock m_clock;
+
+    uint64_t m_runsCount = 0;
+    uint64_t m_expiredCount = 0;
+    bool m_stopped = false;
+    mutable std::mutex m_guard;
+    std::condition_variable m_cv;
+    std::thread m_thread;
+
+private:
+    void run();
+
+public:
+    // horizon is in seconds. clock returns current time (time(nullptr) by default)
+    RetentionScheduler(
+        POSTransactionManager& manager,
+        const time_t horizon,
+        const std::chrono::milliseconds period,
+        Clock clock = Clock());
+    ~RetentionScheduler();
+
+    RetentionScheduler(const RetentionScheduler&) = delete;
+    RetentionScheduler& operator=(const RetentionScheduler&) = delete;
+
+    void stop();
+    uint64_t getRunsCount() const;
+    uint64_t getExpiredCount() const;
+};
+
+} // namespace pos
+
+#endif // POS_RETENTION_SCHEDULER_H
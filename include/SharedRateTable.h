@@ -0,0 +1,95 @@
+#ifndef POS_SHARED_RATE_TABLE_H
+#define POS_SHARED_RATE_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <string>
+
+#include "POSTransaction.h"
+
+namespace pos
+{
+
+struct SharedRateTableHeader;
+
+// Rate table in POSIX shared memory.
+// One writer process publishes manager rates, reader processes convert straight from
+// shared memory. Segment holds header and two buffers of fixed capacity. Buffer has
+// currencies sorted by name and their points (dates and rates in separate arrays).
+// Writer fills buffer that readers do not use and then switches active buffer. Every buffer
+// has seqlock sequence (odd while buffer is written): reader retries lookup if sequence of
+// buffer was changed during it, so writer never waits for readers.
+class SharedRateTableWriter
+{
+private:
+    uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+    SharedRateTableHeader* m_header = nullptr;
+
+public:
+    SharedRateTableWriter() = default;
+    ~SharedRateTableWriter();
+
+    SharedRateTableWriter(const SharedRateTableWriter&) = delete;
+    SharedRateTableWriter& operator=(const SharedRateTableWriter&) = delete;
+
+    // create segment with name ("/name") and capacity of each buffer in bytes.
+    // existing segment is replaced, attached readers shall reopen table
+    Result open(const std::string& name, const size_t capacity);
+    // unmap segment. segment stays available to readers
+    void close();
+    // remove segment name
+    static Result remove(const std::string& name);
+
+    // publish copy of manager rates. IO_ERROR if rates do not fit into buffer.
+    // publish shall not be called from several threads at once
+    Result publish(const POSTransactionManager& manager);
+    Result publish(const std::string& baseCurrency, const POSTransactionManager::CurrencyTrendMap& currencyTrendMap);
+
+    // bytes needed to publish rates
+    static size_t getPublishSize(
+        const std::string& baseCurrency,
+        const POSTransactionManager::CurrencyTrendMap& currencyTrendMap);
+    // number of publications
+    uint64_t getVersion() const;
+};
+
+class SharedRateTableReader
+{
+private:
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+    const SharedRateTableHeader* m_header = nullptr;
+
+private:
+    // call f with consistent active buffer
+    template<class F>
+    void read(F&& f) const;
+
+public:
+    SharedRateTableReader() = default;
+    ~SharedRateTableReader();
+
+    SharedRateTableReader(const SharedRateTableReader&) = delete;
+    SharedRateTableReader& operator=(const SharedRateTableReader&) = delete;
+
+    // IO_ERROR if segment does not exist, INVALID_FORMAT if it is not rate table
+    Result open(const std::string& name);
+    void close();
+    bool isOpen() const { return m_header != nullptr; }
+
+    std::string getBaseCurrency() const;
+    uint64_t getVersion() const;
+    // rate of 'base -> currency' active at date
+    Result getExchangeRate(const std::string& currency, const time_t date, double& rate) const;
+    // the same as POSTransactionManager::convertPOSTransaction on published rates
+    Result convertPOSTransaction(
+        POSTransaction& toPosTransaction,
+        const POSTransaction& fromPosTransaction,
+        const std::string& toCurrency) const;
+};
+
+} // namespace pos
+
+#endif // POS_SHARED_RATE_TABLE_H
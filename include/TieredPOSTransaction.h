@@ -0,0 +1,83 @@
+#ifndef POS_TIERED_TRANSACTION_H
+#define POS_TIERED_TRANSACTION_H
+
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "POSTransaction.h"
+#include "RateSegment.h"
+
+namespace pos
+{
+
+// Manager with tiered rate storage.
+// Rates since sealed boundary are kept in memory (hot tier). Older rates are sealed
+// into immutable memory-mapped segment files (cold tier). Lookups are routed by date.
+class TieredPOSTransactionManager
+{
+private:
+    typedef std::vector<std::unique_ptr<RateSegment>> RateSegments;
+
+    POSTransactionManager m_hotManager;
+    // segment files are named <prefix><number>.seg. prefix is unique for process and instance
+    const std::string m_filePrefix;
+
+    // dates before boundary are resolved by cold tier
+    std::atomic<time_t> m_sealedUntil;
+    size_t m_segmentsCount = 0;
+    // segments of each currency sorted by date
+    std::unordered_map<std::string, RateSegments> m_currencySegmentsMap;
+    // owned segment files are removed on destruction
+    std::vector<std::string> m_segmentFileNames;
+    mutable std::mutex m_currencySegmentsMapGuard;
+    // serializes rate updates with sealing
+    std::mutex m_sealGuard;
+
+private:
+    static std::string makeFilePrefix(const std::string& directory);
+    Result findColdRate(const std::string& currency, const time_t date, double& rate) const;
+    Result findRate(const std::string& currency, const time_t date, double& rate) const;
+
+public:
+    template<class T>
+    TieredPOSTransactionManager(T&& baseCurrency, const std::string& directory);
+    ~TieredPOSTransactionManager();
+
+    TieredPOSTransactionManager(const TieredPOSTransactionManager&) = delete;
+    TieredPOSTransactionManager& operator=(const TieredPOSTransactionManager&) = delete;
+
+    // rates before sealed boundary cannot be changed
+    template<class T1, class T2>
+    Result addExchangeRate(
+        T1&& fromCurrency,
+        T2&& toCurrency,
+        const time_t fromDate,
+        const time_t toDate,
+        double rate);
+    template<class T1, class T2>
+    Result addExchangeRate(
+        T1&& fromCurrency,
+        T2&& toCurrency,
+        const time_t fromDate,
+        double rate);
+
+    // move rates before boundary to segment files. boundary shall increase.
+    // segments written by failed call are removed
+    Result seal(const time_t boundary);
+    time_t getSealedUntil() const { return m_sealedUntil.load(); }
+    size_t getSegmentsCount() const;
+    // get copy of hot currency trend
+    POSTransactionManager::CurrencyTrendMap getExchangeRates() const;
+
+    template<class T>
+    Result convertPOSTransaction(
+        POSTransaction& toPosTransaction,
+        const POSTransaction& fromPosTransaction,
+        T&& toCurrency) const;
+};
+} // namespace pos
+
+#include "TieredPOSTransactionImpl.hpp"
+
+#endif // POS_TIERED_TRANSACTION_H
@@ -0,0 +1,219 @@
+#ifndef POS_TIERED_TRANSACTION_IMPL_HPP
+#define POS_TIERED_TRANSACTION_IMPL_HPP
+
+#include <algorithm>
+
+#include <unistd.h>
+
+namespace pos
+{
+
+inline std::string TieredPOSTransactionManager::makeFilePrefix(const std::string& directory)
+{
+    // managers of one process and of different processes do not share files
+    static std::atomic<uint64_t> instancesCount(0);
+    return directory + "/rates." + std::to_string(getpid()) + "." +
+        std::to_string(instancesCount.fetch_add(1)) + ".";
+}
+
+template<class T>
+TieredPOSTransactionManager::TieredPOSTransactionManager(T&& baseCurrency, const std::string& directory):
+    m_hotManager(std::forward<T>(baseCurrency)),
+    m_filePrefix(makeFilePrefix(directory)),
+    m_sealedUntil(std::numeric_limits<time_t>::min())
+{}
+
+inline TieredPOSTransactionManager::~TieredPOSTransactionManager()
+{
+    m_currencySegmentsMap.clear();
+    for (const auto& fileName : m_segmentFileNames)
+    {
+        unlink(fileName.c_str());
+    }
+}
+
+template<class T1, class T2>
+Result TieredPOSTransactionManager::addExchangeRate(
+    T1&& fromCurrency,
+    T2&& toCurrency,
+    const time_t fromDate,
+    const time_t toDate,
+    double rate)
+{
+    std::unique_lock<std::mutex> l(m_sealGuard);
+    if (fromDate < m_sealedUntil.load())
+    {
+        return Result::INVALID_DATE;
+    }
+    return m_hotManager.addExchangeRate(
+        std::forward<T1>(fromCurrency), std::forward<T2>(toCurrency), fromDate, toDate, rate);
+}
+
+template<class T1, class T2>
+Result TieredPOSTransactionManager::addExchangeRate(
+    T1&& fromCurrency,
+    T2&& toCurrency,
+    const time_t fromDate,
+    double rate)
+{
+    std::unique_lock<std::mutex> l(m_sealGuard);
+    if (fromDate < m_sealedUntil.load())
+    {
+        return Result::INVALID_DATE;
+    }
+    return m_hotManager.addExchangeRate(
+        std::forward<T1>(fromCurrency), std::forward<T2>(toCurrency), fromDate, rate);
+}
+
+inline Result TieredPOSTransactionManager::seal(const time_t boundary)
+{
+    std::unique_lock<std::mutex> l(m_sealGuard);
+    const time_t sealedUntil = m_sealedUntil.load();
+    if (boundary <= sealedUntil)
+    {
+        return Result::INVALID_DATE;
+    }
+
+    // write and map segments while rates are still in hot tier
+    std::vector<std::pair<std::string, std::unique_ptr<RateSegment>>> segments;
+    std::vector<std::string> fileNames;
+    POSTransactionManager::CurrencyTrendMap currencyTrendMap = m_hotManager.getExchangeRatesBefore(boundary);
+    size_t segmentsCount = m_segmentsCount;
+    for (const auto& currencyTrend : currencyTrendMap)
+    {
+        if (currencyTrend.second.empty())
+        {
+            continue;
+        }
+        std::string fileName = m_filePrefix + std::to_string(segmentsCount++) + ".seg";
+        std::unique_ptr<RateSegment> segment(new RateSegment());
+        Result r = RateSegment::write(fileName, currencyTrend.second, sealedUntil, boundary);
+        if (Result::SUCCESS == r)
+        {
+            fileNames.push_back(fileName);
+            r = segment->open(fileName);
+        }
+        if (Result::SUCCESS != r)
+        {
+            // segments of this call are not used
+            segments.clear();
+            for (const auto& writtenFileName : fileNames)
+            {
+                unlink(writtenFileName.c_str());
+            }
+            return r;
+        }
+        segments.emplace_back(currencyTrend.first, std::move(segment));
+    }
+
+    {
+        std::unique_lock<std::mutex> l(m_currencySegmentsMapGuard);
+        for (auto& segment : segments)
+        {
+            m_currencySegmentsMap[segment.first].push_back(std::move(segment.second));
+        }
+        m_segmentFileNames.insert(m_segmentFileNames.end(), fileNames.begin(), fileNames.end());
+        m_segmentsCount = segmentsCount;
+        m_sealedUntil.store(boundary);
+    }
+
+    // lookups before boundary are routed to cold tier now
+    m_hotManager.expireExchangeRates(boundary);
+    return Result::SUCCESS;
+}
+
+inline size_t TieredPOSTransactionManager::getSegmentsCount() const
+{
+    std::unique_lock<std::mutex> l(m_currencySegmentsMapGuard);
+    return m_segmentsCount;
+}
+
+inline POSTransactionManager::CurrencyTrendMap TieredPOSTransactionManager::getExchangeRates() const
+{
+    return m_hotManager.getExchangeRates();
+}
+
+inline Result TieredPOSTransactionManager::findColdRate(
+    const std::string& currency,
+    const time_t date,
+    double& rate) const
+{
+    std::unique_lock<std::mutex> l(m_currencySegmentsMapGuard);
+    auto currencyIt = m_currencySegmentsMap.find(currency);
+    if (m_currencySegmentsMap.end() == currencyIt)
+    {
+        l.unlock();
+        // currency appeared after sealing
+        return m_hotManager.getExchangeRate(currency, date, rate);
+    }
+    const RateSegments& segments = currencyIt->second;
+    // the first segment that ends after date
+    auto segmentIt = std::upper_bound(segments.begin(), segments.end(), date,
+        [] (const time_t date, const std::unique_ptr<RateSegment>& segment)
+        {
+            return date < segment->getToDate();
+        });
+    if (segments.end() == segmentIt)
+    {
+        return Result::NO_RATE;
+    }
+    return (*segmentIt)->findRate(date, rate);
+}
+
+inline Result TieredPOSTransactionManager::findRate(
+    const std::string& currency,
+    const time_t date,
+    double& rate) const
+{
+    if (m_hotManager.getBaseCurrency() == currency)
+    {
+        rate = 1;
+        return Result::SUCCESS;
+    }
+    const time_t sealedUntil = m_sealedUntil.load();
+    if (date < sealedUntil)
+    {
+        return findColdRate(currency, date, rate);
+    }
+    Result r = m_hotManager.getExchangeRate(currency, date, rate);
+    if (Result::SUCCESS != r && date < m_sealedUntil.load())
+    {
+        // rates were sealed during lookup
+        return findColdRate(currency, date, rate);
+    }
+    return r;
+}
+
+template<class T>
+Result TieredPOSTransactionManager::convertPOSTransaction(
+    POSTransaction& toPosTransaction,
+    const POSTransaction& fromPosTransaction,
+    T&& toCurrency) const
+{
+    if (fromPosTransaction.m_currency == toCurrency)
+    {
+        toPosTransaction = fromPosTransaction;
+        return Result::SUCCESS;
+    }
+
+    double fromRate;
+    Result r = findRate(fromPosTransaction.m_currency, fromPosTransaction.m_date, fromRate);
+    if (Result::SUCCESS != r)
+    {
+        return r;
+    }
+    double toRate;
+    r = findRate(toCurrency, fromPosTransaction.m_date, toRate);
+    if (Result::SUCCESS != r)
+    {
+        return r;
+    }
+
+    toPosTransaction.m_currency = std::forward<T>(toCurrency);
+    toPosTransaction.m_date = fromPosTransaction.m_date;
+    toPosTransaction.m_total = fromPosTransaction.m_total / fromRate * toRate;
+    return Result::SUCCESS;
+}
+} // namespace pos
+
+#endif // POS_TIERED_TRANSACTION_IMPL_HPP
@@ -0,0 +1,109 @@
+#ifndef POS_TRANSACTION_ARCHIVE_H
+#define POS_TRANSACTION_ARCHIVE_H
+
+#include <cstdio>
+#include <cstdint>
+#include <ctime>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "POSTransactionBatch.h"
+
+namespace pos
+{
+
+extern const char ARCHIVE_MAGIC[8];
+
+// Columnar archive of transactions.
+// File starts with magic and consists of blocks of up to BLOCK_ROWS rows. Block header is:
+// rows count, min date, max date (zigzag varints) and payload size (varint).
+// Payload has columns: totals (8 byte little endian doubles), currency dictionary
+// (count and strings) with varint ids, and dates (zigzag varint deltas to previous date).
+// Every block is self-contained, so block can be skipped by its dates without decoding.
+class TransactionArchiveWriter
+{
+public:
+    static constexpr size_t BLOCK_ROWS = 65536;
+
+private:
+    FILE* m_file = nullptr;
+    POSTransactionBatch m_block;
+    std::vector<uint8_t> m_buffer;
+    uint64_t m_rowsCount = 0;
+    uint64_t m_blocksCount = 0;
+    bool m_failed = false;
+
+private:
+    void flushBlock();
+
+public:
+    TransactionArchiveWriter() = default;
+    ~TransactionArchiveWriter();
+
+    TransactionArchiveWriter(const TransactionArchiveWriter&) = delete;
+    TransactionArchiveWriter& operator=(const TransactionArchiveWriter&) = delete;
+
+    Result open(const std::string& fileName);
+    // write the last block and close archive
+    Result close();
+
+    void write(const POSTransaction& transaction);
+    void write(const POSTransactionBatch& batch);
+
+    uint64_t getRowsCount() const { return m_rowsCount; }
+    uint64_t getBlocksCount() const { return m_blocksCount; }
+};
+
+class TransactionArchiveReader
+{
+private:
+    FILE* m_file = nullptr;
+    uint64_t m_fileSize = 0;
+    time_t m_fromDate = std::numeric_limits<time_t>::min();
+    time_t m_toDate = std::numeric_limits<time_t>::max();
+    std::vector<uint8_t> m_buffer;
+    uint64_t m_blocksCount = 0;
+    uint64_t m_skippedBlocksCount = 0;
+
+public:
+    TransactionArchiveReader() = default;
+    ~TransactionArchiveReader();
+
+    TransactionArchiveReader(const TransactionArchiveReader&) = delete;
+    TransactionArchiveReader& operator=(const TransactionArchiveReader&) = delete;
+
+    Result open(const std::string& fileName);
+    void close();
+
+    // read only rows with date in [fromDate, toDate). blocks out of range are skipped
+    void setDateRange(const time_t fromDate, const time_t toDate);
+    // read next block. batch is empty at the end of archive
+    Result read(POSTransactionBatch& batch);
+
+    uint64_t getBlocksCount() const { return m_blocksCount; }
+    uint64_t getSkippedBlocksCount() const { return m_skippedBlocksCount; }
+};
+
+struct ArchiveConversionStats
+{
+    uint64_t m_blocksCount = 0;
+    uint64_t m_skippedBlocksCount = 0;
+    uint64_t m_rowsCount = 0;
+    uint64_t m_failedCount = 0;
+};
+
+// convert archive rows with date in [fromDate, toDate) block by block and write them to
+// archive of the same format. failed rows are written with NaN total
+Result convertTransactionArchive(
+    const POSTransactionManager& manager,
+    const std::string& fromFileName,
+    const std::string& toFileName,
+    const std::string& toCurrency,
+    const time_t fromDate,
+    const time_t toDate,
+    ArchiveConversionStats& stats);
+
+} // namespace pos
+
+#endif // POS_TRANSACTION_ARCHIVE_H
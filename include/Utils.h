@@ -1,6 +1,7 @@
 #ifndef POS_UTILS_H
 #define POS_UTILS_H
 
+#include <cstdint>
 #include <ctime>
 #include <string>
 
@@ -14,6 +15,10 @@ enum class Result : uint16_t
     SAME_CURRECY,
     NO_CURRENCY,
     NO_RATE,
+    IO_ERROR,
+    INVALID_FORMAT,
+    PENDING,
+    AMOUNT_OVERFLOW,
 };
 
 const char* resultToStr(const Result r);
@@ -21,6 +26,9 @@ const char* resultToStr(const Result r);
 time_t timeFromString(const std::string& str);
 std::string timeToString(const time_t t);
 
+// small sequential index of calling thread (starting from 0)
+uint32_t getThreadIndex();
+
 } // namespace pos
 
 #endif // POS_UTILS_H
\ No newline at end of file
@@ -0,0 +1,121 @@
+#ifndef POS_WORKLOAD_RECORDER_H
+#define POS_WORKLOAD_RECORDER_H
+
+#include <cstdio>
+#include <cstdint>
+#include <ctime>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "Utils.h"
+#include "RateTrendAllocator.h"
+
+namespace pos
+{
+
+enum class WorkloadOperation : uint8_t
+{
+    ADD_RATE,
+    ADD_OPEN_RATE,
+    CONVERT,
+    EXPORT,
+    ADD_RATES,
+    EXPIRE,
+    REPLACE_RATES,
+    CONVERT_BATCH,
+    CONVERT_MONEY,
+    CONVERT_MONEY_BATCH,
+    GET_RATE,
+};
+
+static constexpr size_t WORKLOAD_OPERATIONS_COUNT = static_cast<size_t>(WorkloadOperation::GET_RATE) + 1;
+
+const char* workloadOperationToStr(const WorkloadOperation operation);
+
+extern const char WORKLOAD_MAGIC[8];
+
+struct RateUpdate;
+class POSTransactionBatch;
+
+// Binary trace of manager API calls.
+// File starts with magic and base currency. Each record is:
+// operation (1 byte), thread index (varint), time since previous record in ns (varint)
+// and operation arguments. Currency is varint id, new id is followed by currency string.
+// Lists (rate updates, trend points, batch rows) are written as varint count and items.
+class WorkloadRecorder
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+    static constexpr size_t BUFFER_SIZE = 64 * 1024;
+
+private:
+    FILE* m_file = nullptr;
+    Clock::time_point m_start;
+    int64_t m_lastTime = 0;
+    std::unordered_map<std::string, uint64_t> m_currencyIds;
+    std::vector<uint8_t> m_buffer;
+    uint64_t m_recordsCount = 0;
+    bool m_failed = false;
+    std::mutex m_guard;
+
+private:
+    void writeHeaderUnsafe(const WorkloadOperation operation);
+    void writeCurrencyUnsafe(const std::string& currency);
+    void writeDoubleUnsafe(const double value);
+    void writeBatchUnsafe(const POSTransactionBatch& batch, const std::vector<int64_t>* amounts);
+    void flushUnsafe();
+
+public:
+    WorkloadRecorder() = default;
+    ~WorkloadRecorder();
+
+    WorkloadRecorder(const WorkloadRecorder&) = delete;
+    WorkloadRecorder& operator=(const WorkloadRecorder&) = delete;
+
+    Result open(const std::string& fileName, const std::string& baseCurrency);
+    // flush and close trace
+    Result close();
+
+    void recordAddExchangeRate(
+        const std::string& fromCurrency,
+        const std::string& toCurrency,
+        const time_t fromDate,
+        const time_t toDate,
+        const double rate);
+    void recordAddExchangeRate(
+        const std::string& fromCurrency,
+        const std::string& toCurrency,
+        const time_t fromDate,
+        const double rate);
+    void recordConvert(
+        const double total,
+        const std::string& fromCurrency,
+        const time_t date,
+        const std::string& toCurrency);
+    void recordExport();
+    // updates are normalized to 'base -> currency'
+    void recordAddExchangeRates(const std::vector<RateUpdate>& updates);
+    void recordExpire(const time_t cutoff);
+    void recordReplaceExchangeRates(const std::string& currency, const RateTrend& rateTrend);
+    void recordConvertBatch(const POSTransactionBatch& batch, const std::string& toCurrency);
+    void recordConvertMoney(
+        const int64_t amount,
+        const std::string& fromCurrency,
+        const time_t date,
+        const std::string& toCurrency);
+    // totals of batch are not recorded
+    void recordConvertMoneyBatch(
+        const std::vector<int64_t>& amounts,
+        const POSTransactionBatch& batch,
+        const std::string& toCurrency);
+    void recordGetExchangeRate(const std::string& currency, const time_t date);
+
+    uint64_t getRecordsCount();
+};
+
+} // namespace pos
+
+#endif // POS_WORKLOAD_RECORDER_H
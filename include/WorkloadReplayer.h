@@ -0,0 +1,104 @@
+#ifndef POS_WORKLOAD_REPLAYER_H
+#define POS_WORKLOAD_REPLAYER_H
+
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include "POSTransaction.h"
+#include "POSTransactionBatch.h"
+#include "WorkloadRecorder.h"
+
+namespace pos
+{
+
+struct WorkloadRecord
+{
+    WorkloadOperation m_operation;
+    uint32_t m_threadIndex;
+    // ns since the start of recording
+    int64_t m_time;
+    uint32_t m_fromCurrency;
+    uint32_t m_toCurrency;
+    time_t m_fromDate;
+    time_t m_toDate;
+    // rate or transaction total
+    double m_value;
+    // amount of money conversion
+    int64_t m_amount;
+    // index of payload of list operations
+    uint32_t m_payload;
+};
+
+// arguments of list operations
+struct WorkloadPayload
+{
+    // ADD_RATES
+    std::vector<RateUpdate> m_updates;
+    // REPLACE_RATES
+    std::vector<std::pair<time_t, double>> m_points;
+    // CONVERT_BATCH and CONVERT_MONEY_BATCH (totals of money batch are 0)
+    POSTransactionBatch m_batch;
+    std::vector<int64_t> m_amounts;
+};
+
+enum class ReplaySpeed : uint8_t
+{
+    ORIGINAL,
+    FAST,
+};
+
+// latencies are in ns
+struct ReplayLatency
+{
+    uint64_t m_count = 0;
+    int64_t m_p50 = 0;
+    int64_t m_p99 = 0;
+    int64_t m_max = 0;
+};
+
+struct ReplayReport
+{
+    uint64_t m_operationsCount = 0;
+    // operations that did not return success
+    uint64_t m_failedCount = 0;
+    size_t m_threadsCount = 0;
+    int64_t m_duration = 0;
+    // operations per second
+    double m_throughput = 0;
+    ReplayLatency m_latencies[WORKLOAD_OPERATIONS_COUNT];
+};
+
+// Replays trace written by WorkloadRecorder.
+// Each recorded thread is replayed by its own thread.
+class WorkloadReplayer
+{
+private:
+    std::string m_baseCurrency;
+    std::vector<std::string> m_currencies;
+    std::vector<WorkloadRecord> m_records;
+    std::vector<WorkloadPayload> m_payloads;
+
+private:
+    bool readBatch(const uint8_t*& p, const uint8_t* end, WorkloadPayload& payload, const bool money);
+    void replayRecord(
+        POSTransactionManager& manager,
+        const WorkloadRecord& record,
+        Result& res) const;
+
+public:
+    Result load(const std::string& fileName);
+
+    const std::string& getBaseCurrency() const { return m_baseCurrency; }
+    const std::vector<std::string>& getCurrencies() const { return m_currencies; }
+    const std::vector<WorkloadRecord>& getRecords() const { return m_records; }
+    const std::vector<WorkloadPayload>& getPayloads() const { return m_payloads; }
+
+    // manager shall be created with recorded base currency
+    void replay(POSTransactionManager& manager, const ReplaySpeed speed, ReplayReport& report) const;
+};
+
+} // namespace pos
+
+#endif // POS_WORKLOAD_REPLAYER_H
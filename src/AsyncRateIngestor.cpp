@@ -0,0 +1,105 @@
+#include <algorithm>
+
+#include <AsyncRateIngestor.h>
+
+namespace pos
+{
+
+AsyncRateIngestor::AsyncRateIngestor(POSTransactionManager& manager, const size_t batchSize):
+    m_manager(manager),
+    m_batchSize(batchSize ? batchSize : 1),
+    m_pushedCount(0),
+    m_writerWaiting(false)
+{
+    m_writer = std::thread(&AsyncRateIngestor::run, this);
+}
+
+AsyncRateIngestor::~AsyncRateIngestor()
+{
+    {
+        std::unique_lock<std::mutex> l(m_guard);
+        m_stopped = true;
+    }
+    m_writerCv.notify_one();
+    m_writer.join();
+}
+
+void AsyncRateIngestor::push(RateUpdate&& update)
+{
+    m_pushedCount.fetch_add(1);
+    m_queue.push(std::move(update));
+    // writer sets flag before it checks pushed count. so either writer sees update
+    // or we see the flag and wake it up
+    if (m_writerWaiting.load())
+    {
+        std::unique_lock<std::mutex> l(m_guard);
+        m_writerCv.notify_one();
+    }
+}
+
+void AsyncRateIngestor::run()
+{
+    std::vector<RateUpdate> batch;
+    batch.reserve(m_batchSize);
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> l(m_guard);
+            m_writerWaiting.store(true);
+            m_writerCv.wait(l, [this] () { return m_stopped || m_pushedCount.load() != m_appliedCount; });
+            m_writerWaiting.store(false);
+            if (m_stopped && m_pushedCount.load() == m_appliedCount)
+            {
+                break;
+            }
+        }
+
+        RateUpdate update;
+        while (batch.size() < m_batchSize && m_queue.pop(update))
+        {
+            batch.push_back(std::move(update));
+        }
+        if (batch.empty())
+        {
+            // producer is inside push
+            std::this_thread::yield();
+            continue;
+        }
+
+        // updates of the same currency share one trend lookup. order inside currency is kept
+        std::stable_sort(batch.begin(), batch.end(),
+            [] (const RateUpdate& l, const RateUpdate& r) { return l.m_currency < r.m_currency; });
+        const size_t count = batch.size();
+        m_manager.addExchangeRates(std::move(batch));
+        batch.clear();
+        batch.reserve(m_batchSize);
+
+        {
+            std::unique_lock<std::mutex> l(m_guard);
+            m_appliedCount += count;
+            ++ m_batchesCount;
+        }
+        m_flushCv.notify_all();
+    }
+}
+
+void AsyncRateIngestor::flush()
+{
+    const uint64_t pushedCount = m_pushedCount.load();
+    std::unique_lock<std::mutex> l(m_guard);
+    m_flushCv.wait(l, [this, pushedCount] () { return m_appliedCount >= pushedCount; });
+}
+
+uint64_t AsyncRateIngestor::getAppliedCount() const
+{
+    std::unique_lock<std::mutex> l(m_guard);
+    return m_appliedCount;
+}
+
+uint64_t AsyncRateIngestor::getBatchesCount() const
+{
+    std::unique_lock<std::mutex> l(m_guard);
+    return m_batchesCount;
+}
+
+} // namespace pos
@@ -0,0 +1,124 @@
+#include <algorithm>
+
+#include <CompressedRateTrend.h>
+#include <Encoding.h>
+
+namespace pos
+{
+constexpr size_t CompressedRateTrend::BLOCK_SIZE;
+
+CompressedRateTrend::CompressedRateTrend(const POSTransactionManager::RateTrend& rateTrend)
+{
+    m_blockFirstDates.reserve((rateTrend.size() + BLOCK_SIZE - 1) / BLOCK_SIZE);
+    m_blockOffsets.reserve(m_blockFirstDates.capacity());
+    for (const auto& rate : rateTrend)
+    {
+        append(rate.first, rate.second);
+    }
+    shrinkToFit();
+}
+
+Result CompressedRateTrend::append(const time_t date, const double rate)
+{
+    const uint64_t bits = doubleToBits(rate);
+    if (m_size % BLOCK_SIZE == 0)
+    {
+        if (m_size && date <= m_lastDate)
+        {
+            return Result::INVALID_DATE;
+        }
+        // new block starts with date from index and full rate
+        m_blockFirstDates.push_back(date);
+        m_blockOffsets.push_back(m_data.size());
+        writeXorDouble(m_data, bits, 0);
+    }
+    else
+    {
+        if (date <= m_lastDate)
+        {
+            return Result::INVALID_DATE;
+        }
+        // unsigned delta does not overflow for far apart dates
+        writeVarint(m_data, static_cast<uint64_t>(date) - static_cast<uint64_t>(m_lastDate));
+        writeXorDouble(m_data, bits, m_lastRateBits);
+    }
+    m_lastDate = date;
+    m_lastRateBits = bits;
+    ++ m_size;
+    return Result::SUCCESS;
+}
+
+Result CompressedRateTrend::findRate(const time_t date, double& rate) const
+{
+    // block with the last first date <= date
+    auto blockIt = std::upper_bound(m_blockFirstDates.begin(), m_blockFirstDates.end(), date);
+    if (m_blockFirstDates.begin() == blockIt)
+    {
+        return Result::NO_RATE;
+    }
+    const size_t block = std::distance(m_blockFirstDates.begin(), blockIt) - 1;
+    const size_t count = std::min(BLOCK_SIZE, m_size - block * BLOCK_SIZE);
+
+    const uint8_t* p = m_data.data() + m_blockOffsets[block];
+    time_t currentDate = m_blockFirstDates[block];
+    uint64_t bits = 0;
+    p = readXorDouble(p, bits);
+    for (size_t i = 1; i < count; ++i)
+    {
+        uint64_t delta;
+        p = readVarint(p, delta);
+        if (delta > static_cast<uint64_t>(date) - static_cast<uint64_t>(currentDate))
+        {
+            break;
+        }
+        currentDate = static_cast<time_t>(static_cast<uint64_t>(currentDate) + delta);
+        p = readXorDouble(p, bits);
+    }
+
+    rate = bitsToDouble(bits);
+    if (rate <= 0)
+    {
+        return Result::NO_RATE;
+    }
+    return Result::SUCCESS;
+}
+
+POSTransactionManager::RateTrend CompressedRateTrend::toRateTrend() const
+{
+    POSTransactionManager::RateTrend rateTrend;
+    for (size_t block = 0; block < m_blockFirstDates.size(); ++block)
+    {
+        const size_t count = std::min(BLOCK_SIZE, m_size - block * BLOCK_SIZE);
+        const uint8_t* p = m_data.data() + m_blockOffsets[block];
+        time_t date = m_blockFirstDates[block];
+        uint64_t bits = 0;
+        p = readXorDouble(p, bits);
+        rateTrend.emplace_hint(rateTrend.end(), date, bitsToDouble(bits));
+        for (size_t i = 1; i < count; ++i)
+        {
+            uint64_t delta;
+            p = readVarint(p, delta);
+            p = readXorDouble(p, bits);
+            date = static_cast<time_t>(static_cast<uint64_t>(date) + delta);
+            rateTrend.emplace_hint(rateTrend.end(), date, bitsToDouble(bits));
+        }
+    }
+    return rateTrend;
+}
+
+size_t CompressedRateTrend::getMemoryUsage() const
+{
+    return sizeof(*this) +
+        m_blockFirstDates.capacity() * sizeof(time_t) +
+        m_blockOffsets.capacity() * sizeof(size_t) +
+        m_data.capacity();
+}
+
+void CompressedRateTrend::shrinkToFit()
+{
+    m_blockFirstDates.shrink_to_fit();
+    m_blockOffsets.shrink_to_fit();
+    m_data.shrink_to_fit();
+}
+
+} // namespace pos
@@ -0,0 +1,282 @@
+#include <cerrno>
+#include <cstring>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <ConversionClient.h>
+
+namespace pos
+{
+
+ConversionClient::~ConversionClient()
+{
+    close();
+}
+
+Result ConversionClient::connect(const std::string& socketPath)
+{
+    close();
+
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (socketPath.empty() || socketPath.size() >= sizeof(addr.sun_path))
+    {
+        return Result::IO_ERROR;
+    }
+    memcpy(addr.sun_path, socketPath.c_str(), socketPath.size());
+
+    m_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (m_fd < 0)
+    {
+        return Result::IO_ERROR;
+    }
+    if (::connect(m_fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0)
+    {
+        close();
+        return Result::IO_ERROR;
+    }
+    return Result::SUCCESS;
+}
+
+void ConversionClient::close()
+{
+    if (m_fd >= 0)
+    {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+    m_output.clear();
+    m_input.clear();
+    m_responses.clear();
+    m_pendingIds.clear();
+}
+
+uint32_t ConversionClient::beginRequest(const MessageType type, size_t& offset)
+{
+    const uint32_t requestId = m_nextRequestId++;
+    m_pendingIds.insert(requestId);
+    offset = beginFrame(m_output, requestId, type);
+    return requestId;
+}
+
+uint32_t ConversionClient::sendConvert(const POSTransactionBatch& fromBatch, const std::string& toCurrency)
+{
+    size_t offset;
+    const uint32_t requestId = beginRequest(MessageType::CONVERT, offset);
+    writeConvertRequest(m_output, fromBatch, toCurrency);
+    endFrame(m_output, offset);
+    return requestId;
+}
+
+uint32_t ConversionClient::sendAddExchangeRates(const std::vector<ExchangeRate>& rates)
+{
+    size_t offset;
+    const uint32_t requestId = beginRequest(MessageType::ADD_RATES, offset);
+    writeAddRatesRequest(m_output, rates);
+    endFrame(m_output, offset);
+    return requestId;
+}
+
+uint32_t ConversionClient::sendExport(const std::string& currency)
+{
+    size_t offset;
+    const uint32_t requestId = beginRequest(MessageType::EXPORT, offset);
+    writeExportRequest(m_output, currency);
+    endFrame(m_output, offset);
+    return requestId;
+}
+
+Result ConversionClient::flush()
+{
+    if (m_fd < 0)
+    {
+        return Result::IO_ERROR;
+    }
+    size_t pos = 0;
+    while (pos < m_output.size())
+    {
+        const ssize_t res = send(m_fd, m_output.data() + pos, m_output.size() - pos, MSG_NOSIGNAL);
+        if (res < 0 && EINTR == errno)
+        {
+            continue;
+        }
+        if (res <= 0)
+        {
+            close();
+            return Result::IO_ERROR;
+        }
+        pos += res;
+    }
+    m_output.clear();
+    return Result::SUCCESS;
+}
+
+Result ConversionClient::receive(
+    const uint32_t requestId,
+    const MessageType type,
+    const uint8_t*& p,
+    const uint8_t*& end)
+{
+    // response would never come
+    if (!m_pendingIds.erase(requestId))
+    {
+        return m_fd < 0 ? Result::IO_ERROR : Result::INVALID_FORMAT;
+    }
+    auto responseIt = m_responses.find(requestId);
+    if (m_responses.end() != responseIt)
+    {
+        m_response.swap(responseIt->second);
+        m_responses.erase(responseIt);
+    }
+    else
+    {
+        Result res = flush();
+        if (Result::SUCCESS != res)
+        {
+            return res;
+        }
+        bool found = false;
+        size_t pos = 0;
+        while (!found)
+        {
+            size_t frameSize;
+            if (!getFrameSize(m_input.data() + pos, m_input.size() - pos, frameSize))
+            {
+                close();
+                return Result::INVALID_FORMAT;
+            }
+            if (!frameSize)
+            {
+                // read the rest of frame
+                m_input.erase(m_input.begin(), m_input.begin() + pos);
+                pos = 0;
+                const size_t size = m_input.size();
+                m_input.resize(size + 64 * 1024);
+                ssize_t count;
+                do
+                {
+                    count = ::read(m_fd, m_input.data() + size, m_input.size() - size);
+                }
+                while (count < 0 && EINTR == errno);
+                if (count <= 0)
+                {
+                    close();
+                    return Result::IO_ERROR;
+                }
+                m_input.resize(size + count);
+                continue;
+            }
+
+            const uint8_t* payload = m_input.data() + pos + FRAME_HEADER_SIZE;
+            const uint8_t* payloadEnd = m_input.data() + pos + frameSize;
+            const uint8_t* body = payload;
+            uint32_t responseId;
+            MessageType responseType;
+            readMessageHeader(body, payloadEnd, responseId, responseType);
+            if (responseId == requestId)
+            {
+                m_response.assign(payload, payloadEnd);
+                found = true;
+            }
+            else if (m_pendingIds.count(responseId))
+            {
+                m_responses[responseId].assign(payload, payloadEnd);
+            }
+            pos += frameSize;
+        }
+        m_input.erase(m_input.begin(), m_input.begin() + pos);
+    }
+
+    p = m_response.data();
+    end = p + m_response.size();
+    uint32_t responseId;
+    MessageType responseType;
+    readMessageHeader(p, end, responseId, responseType);
+    return responseType == type ? Result::SUCCESS : Result::INVALID_FORMAT;
+}
+
+Result ConversionClient::receiveConvert(
+    const uint32_t requestId,
+    std::vector<double>& totals,
+    std::vector<Result>& results)
+{
+    const uint8_t* p;
+    const uint8_t* end;
+    Result res = receive(requestId, MessageType::CONVERT, p, end);
+    if (Result::SUCCESS != res)
+    {
+        return res;
+    }
+    Result response;
+    res = readConvertResponse(p, end, response, totals, results);
+    return Result::SUCCESS == res ? response : res;
+}
+
+Result ConversionClient::receiveAddExchangeRates(const uint32_t requestId, std::vector<Result>& results)
+{
+    const uint8_t* p;
+    const uint8_t* end;
+    Result res = receive(requestId, MessageType::ADD_RATES, p, end);
+    if (Result::SUCCESS != res)
+    {
+        return res;
+    }
+    Result response;
+    res = readAddRatesResponse(p, end, response, results);
+    return Result::SUCCESS == res ? response : res;
+}
+
+Result ConversionClient::receiveExport(const uint32_t requestId, RateTrend& rateTrend)
+{
+    const uint8_t* p;
+    const uint8_t* end;
+    Result res = receive(requestId, MessageType::EXPORT, p, end);
+    if (Result::SUCCESS != res)
+    {
+        return res;
+    }
+    Result response;
+    res = readExportResponse(p, end, response, rateTrend);
+    return Result::SUCCESS == res ? response : res;
+}
+
+Result ConversionClient::convert(
+    POSTransactionBatch& toBatch,
+    std::vector<Result>& results,
+    const POSTransactionBatch& fromBatch,
+    const std::string& toCurrency)
+{
+    std::vector<double> totals;
+    const Result res = receiveConvert(sendConvert(fromBatch, toCurrency), totals, results);
+    if (Result::IO_ERROR == res || Result::INVALID_FORMAT == res)
+    {
+        return res;
+    }
+    if (totals.size() != fromBatch.size())
+    {
+        return Result::INVALID_FORMAT;
+    }
+    toBatch.clear();
+    toBatch.reserve(totals.size());
+    const uint32_t currencyId = toBatch.addCurrency(toCurrency);
+    for (size_t i = 0; i < totals.size(); ++i)
+    {
+        toBatch.add(totals[i], currencyId, fromBatch.getDates()[i]);
+    }
+    return res;
+}
+
+Result ConversionClient::addExchangeRates(const std::vector<ExchangeRate>& rates, std::vector<Result>& results)
+{
+    return receiveAddExchangeRates(sendAddExchangeRates(rates), results);
+}
+
+Result ConversionClient::getExchangeRates(const std::string& currency, RateTrend& rateTrend)
+{
+    return receiveExport(sendExport(currency), rateTrend);
+}
+
+} // namespace pos
@@ -0,0 +1,515 @@
+#include <cerrno>
+#include <cstring>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <ConversionDaemon.h>
+#include <POSTransactionBatch.h>
+
+namespace pos
+{
+constexpr size_t ConversionDaemon::READ_BUFFER_SIZE;
+constexpr size_t ConversionDaemon::MAX_EVENTS;
+constexpr size_t ConversionDaemon::MAX_CONNECTION_OUTPUT;
+constexpr size_t ConversionDaemon::MAX_CONNECTION_TASKS;
+
+ConversionDaemon::ConversionDaemon(POSTransactionManager& manager, const size_t workersCount):
+    m_manager(manager),
+    m_workersCount(workersCount ? workersCount : 1),
+    m_requestsCount(0),
+    m_readPausesCount(0)
+{}
+
+ConversionDaemon::~ConversionDaemon()
+{
+    stop();
+}
+
+Result ConversionDaemon::start(const std::string& socketPath)
+{
+    stop();
+
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (socketPath.empty() || socketPath.size() >= sizeof(addr.sun_path))
+    {
+        return Result::IO_ERROR;
+    }
+    memcpy(addr.sun_path, socketPath.c_str(), socketPath.size());
+
+    m_listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    m_eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_listenFd < 0 || m_epollFd < 0 || m_eventFd < 0)
+    {
+        closeFds();
+        return Result::IO_ERROR;
+    }
+
+    unlink(socketPath.c_str());
+    if (bind(m_listenFd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0)
+    {
+        closeFds();
+        return Result::IO_ERROR;
+    }
+    m_socketPath = socketPath;
+
+    epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = m_listenFd;
+    bool failed = listen(m_listenFd, SOMAXCONN) != 0 ||
+        epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_listenFd, &event) != 0;
+    event.data.fd = m_eventFd;
+    failed = failed || epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_eventFd, &event) != 0;
+    if (failed)
+    {
+        closeFds();
+        return Result::IO_ERROR;
+    }
+
+    m_stopped = false;
+    m_loop = std::thread(&ConversionDaemon::runLoop, this);
+    for (size_t i = 0; i < m_workersCount; ++i)
+    {
+        m_workers.emplace_back(&ConversionDaemon::runWorker, this);
+    }
+    return Result::SUCCESS;
+}
+
+void ConversionDaemon::stop()
+{
+    {
+        std::unique_lock<std::mutex> l(m_guard);
+        m_stopped = true;
+        m_tasks.clear();
+        m_flushQueue.clear();
+    }
+    m_tasksCv.notify_all();
+    wakeUp();
+
+    if (m_loop.joinable())
+    {
+        m_loop.join();
+    }
+    for (auto& worker : m_workers)
+    {
+        worker.join();
+    }
+    m_workers.clear();
+    closeFds();
+}
+
+void ConversionDaemon::closeFds()
+{
+    for (int* fd : {&m_listenFd, &m_epollFd, &m_eventFd})
+    {
+        if (*fd >= 0)
+        {
+            ::close(*fd);
+            *fd = -1;
+        }
+    }
+    if (!m_socketPath.empty())
+    {
+        unlink(m_socketPath.c_str());
+        m_socketPath.clear();
+    }
+}
+
+void ConversionDaemon::wakeUp()
+{
+    if (m_eventFd < 0)
+    {
+        return;
+    }
+    const uint64_t value = 1;
+    ssize_t res = ::write(m_eventFd, &value, sizeof(value));
+    (void)res;
+}
+
+void ConversionDaemon::runLoop()
+{
+    epoll_event events[MAX_EVENTS];
+    bool stopped = false;
+    while (!stopped)
+    {
+        const int count = epoll_wait(m_epollFd, events, MAX_EVENTS, -1);
+        if (count < 0 && EINTR != errno)
+        {
+            break;
+        }
+        for (int i = 0; i < count; ++i)
+        {
+            const int fd = events[i].data.fd;
+            if (fd == m_listenFd)
+            {
+                accept();
+                continue;
+            }
+            if (fd == m_eventFd)
+            {
+                uint64_t value;
+                ssize_t res = ::read(m_eventFd, &value, sizeof(value));
+                (void)res;
+                std::vector<ConnectionPtr> flushQueue;
+                {
+                    std::unique_lock<std::mutex> l(m_guard);
+                    stopped = m_stopped;
+                    flushQueue.swap(m_flushQueue);
+                }
+                for (const auto& connection : flushQueue)
+                {
+                    flush(connection);
+                }
+                continue;
+            }
+
+            auto connectionIt = m_connections.find(fd);
+            if (m_connections.end() == connectionIt)
+            {
+                continue;
+            }
+            // keep connection alive if it is closed and removed from map
+            ConnectionPtr connection = connectionIt->second;
+            if ((events[i].events & (EPOLLHUP | EPOLLERR)) && !connection->m_reading)
+            {
+                // peer is gone while reading is paused. responses cannot be sent
+                close(connection);
+                continue;
+            }
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+            {
+                read(connection);
+            }
+            if (!connection->m_closed && (events[i].events & EPOLLOUT))
+            {
+                flush(connection);
+            }
+        }
+    }
+
+    std::vector<ConnectionPtr> connections;
+    for (const auto& connection : m_connections)
+    {
+        connections.push_back(connection.second);
+    }
+    for (const auto& connection : connections)
+    {
+        close(connection);
+    }
+}
+
+void ConversionDaemon::accept()
+{
+    for (;;)
+    {
+        const int fd = accept4(m_listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            return;
+        }
+        epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &event) != 0)
+        {
+            ::close(fd);
+            continue;
+        }
+        ConnectionPtr connection = std::make_shared<Connection>();
+        connection->m_fd = fd;
+        m_connections[fd] = connection;
+    }
+}
+
+void ConversionDaemon::read(const ConnectionPtr& connection)
+{
+    // event may be taken before reading was paused
+    if (!connection->m_reading)
+    {
+        return;
+    }
+
+    // one read per event. level triggered epoll returns to connection if there is more data
+    std::vector<uint8_t>& input = connection->m_input;
+    const size_t size = input.size();
+    input.resize(size + READ_BUFFER_SIZE);
+    ssize_t res;
+    do
+    {
+        res = ::read(connection->m_fd, input.data() + size, READ_BUFFER_SIZE);
+    }
+    while (res < 0 && EINTR == errno);
+    if (res <= 0)
+    {
+        input.resize(size);
+        if (res < 0 && (EAGAIN == errno || EWOULDBLOCK == errno))
+        {
+            return;
+        }
+        close(connection);
+        return;
+    }
+    input.resize(size + res);
+
+    std::vector<Task> tasks;
+    size_t pos = 0;
+    for (;;)
+    {
+        size_t frameSize;
+        if (!getFrameSize(input.data() + pos, input.size() - pos, frameSize))
+        {
+            close(connection);
+            return;
+        }
+        if (!frameSize)
+        {
+            break;
+        }
+        const uint8_t* payload = input.data() + pos + FRAME_HEADER_SIZE;
+        tasks.push_back(Task{connection, std::vector<uint8_t>(payload, payload + frameSize - FRAME_HEADER_SIZE)});
+        pos += frameSize;
+    }
+    input.erase(input.begin(), input.begin() + pos);
+
+    if (tasks.empty())
+    {
+        return;
+    }
+    {
+        std::unique_lock<std::mutex> l(connection->m_outputGuard);
+        connection->m_tasksCount += tasks.size();
+        updateEventsUnsafe(*connection);
+    }
+    {
+        std::unique_lock<std::mutex> l(m_guard);
+        for (auto& task : tasks)
+        {
+            m_tasks.push_back(std::move(task));
+        }
+    }
+    if (tasks.size() > 1)
+    {
+        m_tasksCv.notify_all();
+    }
+    else
+    {
+        m_tasksCv.notify_one();
+    }
+}
+
+void ConversionDaemon::flush(const ConnectionPtr& connection)
+{
+    std::unique_lock<std::mutex> l(connection->m_outputGuard);
+    connection->m_flushQueued = false;
+    if (connection->m_closed)
+    {
+        return;
+    }
+    std::vector<uint8_t>& output = connection->m_output;
+    while (connection->m_outputPos < output.size())
+    {
+        const ssize_t res = send(connection->m_fd, output.data() + connection->m_outputPos,
+            output.size() - connection->m_outputPos, MSG_NOSIGNAL);
+        if (res > 0)
+        {
+            connection->m_outputPos += res;
+            continue;
+        }
+        if (res < 0 && EINTR == errno)
+        {
+            continue;
+        }
+        if (res < 0 && (EAGAIN == errno || EWOULDBLOCK == errno))
+        {
+            break;
+        }
+        l.unlock();
+        close(connection);
+        return;
+    }
+    if (connection->m_outputPos == output.size())
+    {
+        output.clear();
+        connection->m_outputPos = 0;
+    }
+    // reading is resumed when output is sent and requests are done
+    updateEventsUnsafe(*connection);
+}
+
+void ConversionDaemon::updateEventsUnsafe(Connection& connection)
+{
+    const size_t outputSize = connection.m_output.size() - connection.m_outputPos;
+    const bool reading = outputSize < MAX_CONNECTION_OUTPUT && connection.m_tasksCount < MAX_CONNECTION_TASKS;
+    const bool writing = outputSize != 0;
+    if (reading == connection.m_reading && writing == connection.m_writing)
+    {
+        return;
+    }
+    epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = (reading ? EPOLLIN : 0) | (writing ? EPOLLOUT : 0);
+    event.data.fd = connection.m_fd;
+    epoll_ctl(m_epollFd, EPOLL_CTL_MOD, connection.m_fd, &event);
+    if (connection.m_reading && !reading)
+    {
+        ++ m_readPausesCount;
+    }
+    connection.m_reading = reading;
+    connection.m_writing = writing;
+}
+
+void ConversionDaemon::close(const ConnectionPtr& connection)
+{
+    {
+        std::unique_lock<std::mutex> l(connection->m_outputGuard);
+        if (connection->m_closed)
+        {
+            return;
+        }
+        connection->m_closed = true;
+        connection->m_output.clear();
+    }
+    epoll_ctl(m_epollFd, EPOLL_CTL_DEL, connection->m_fd, nullptr);
+    ::close(connection->m_fd);
+    m_connections.erase(connection->m_fd);
+}
+
+void ConversionDaemon::runWorker()
+{
+    std::vector<uint8_t> response;
+    for (;;)
+    {
+        Task task;
+        {
+            std::unique_lock<std::mutex> l(m_guard);
+            m_tasksCv.wait(l, [this]() { return m_stopped || !m_tasks.empty(); });
+            if (m_stopped)
+            {
+                return;
+            }
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+
+        response.clear();
+        process(task.m_frame, response);
+        ++ m_requestsCount;
+
+        Connection& connection = *task.m_connection;
+        bool queue = false;
+        {
+            std::unique_lock<std::mutex> l(connection.m_outputGuard);
+            -- connection.m_tasksCount;
+            if (connection.m_closed)
+            {
+                continue;
+            }
+            connection.m_output.insert(connection.m_output.end(), response.begin(), response.end());
+            queue = !connection.m_flushQueued;
+            connection.m_flushQueued = true;
+        }
+        if (queue)
+        {
+            {
+                std::unique_lock<std::mutex> l(m_guard);
+                m_flushQueue.push_back(std::move(task.m_connection));
+            }
+            wakeUp();
+        }
+    }
+}
+
+void ConversionDaemon::process(const std::vector<uint8_t>& frame, std::vector<uint8_t>& response)
+{
+    const uint8_t* p = frame.data();
+    const uint8_t* end = p + frame.size();
+    uint32_t requestId;
+    MessageType type;
+    // frame size is checked by event loop
+    readMessageHeader(p, end, requestId, type);
+    const size_t offset = beginFrame(response, requestId, type);
+
+    switch (type)
+    {
+        case MessageType::CONVERT:
+        {
+            POSTransactionBatch fromBatch;
+            std::string toCurrency;
+            if (Result::SUCCESS != readConvertRequest(p, end, fromBatch, toCurrency))
+            {
+                writeErrorResponse(response, Result::INVALID_FORMAT);
+                break;
+            }
+            POSTransactionBatch toBatch;
+            std::vector<Result> results;
+            const Result res = m_manager.convertPOSTransactionBatch(toBatch, results, fromBatch, toCurrency);
+            writeConvertResponse(response, res, toBatch.getTotals(), results);
+            break;
+        }
+        case MessageType::ADD_RATES:
+        {
+            std::vector<ExchangeRate> rates;
+            if (Result::SUCCESS != readAddRatesRequest(p, end, rates))
+            {
+                writeErrorResponse(response, Result::INVALID_FORMAT);
+                break;
+            }
+            // valid rates are applied under one lock
+            std::vector<Result> results(rates.size());
+            std::vector<RateUpdate> updates;
+            updates.reserve(rates.size());
+            Result res = Result::SUCCESS;
+            for (size_t i = 0; i < rates.size(); ++i)
+            {
+                const ExchangeRate& rate = rates[i];
+                RateUpdate update;
+                results[i] = rate.m_toDateSet ?
+                    m_manager.makeRateUpdate(
+                        update, rate.m_fromCurrency, rate.m_toCurrency, rate.m_fromDate, rate.m_toDate, rate.m_rate) :
+                    m_manager.makeRateUpdate(
+                        update, rate.m_fromCurrency, rate.m_toCurrency, rate.m_fromDate, rate.m_rate);
+                if (Result::SUCCESS == results[i])
+                {
+                    updates.push_back(std::move(update));
+                }
+                else if (Result::SUCCESS == res)
+                {
+                    res = results[i];
+                }
+            }
+            if (!updates.empty())
+            {
+                m_manager.addExchangeRates(std::move(updates));
+            }
+            writeAddRatesResponse(response, res, results);
+            break;
+        }
+        case MessageType::EXPORT:
+        {
+            std::string currency;
+            if (Result::SUCCESS != readExportRequest(p, end, currency))
+            {
+                writeErrorResponse(response, Result::INVALID_FORMAT);
+                break;
+            }
+            RateTrend rateTrend;
+            const Result res = m_manager.getExchangeRates(currency, rateTrend);
+            writeExportResponse(response, res, rateTrend);
+            break;
+        }
+        default:
+            writeErrorResponse(response, Result::INVALID_FORMAT);
+            break;
+    }
+    endFrame(response, offset);
+}
+
+} // namespace pos
@@ -0,0 +1,194 @@
+#include <ConversionLedger.h>
+
+namespace pos
+{
+
+ConversionLedger::ConversionLedger(POSTransactionManager& manager):
+    m_manager(manager)
+{
+    m_manager.addRateChangeListener(this);
+}
+
+ConversionLedger::~ConversionLedger()
+{
+    m_manager.removeRateChangeListener(this);
+}
+
+void ConversionLedger::addDependencyUnsafe(const std::string& currency, const time_t date, const uint64_t id)
+{
+    if (currency != m_manager.getBaseCurrency())
+    {
+        m_dependencies[currency].emplace(date, id);
+    }
+}
+
+void ConversionLedger::removeDependencyUnsafe(const std::string& currency, const time_t date, const uint64_t id)
+{
+    auto currencyIt = m_dependencies.find(currency);
+    if (m_dependencies.end() == currencyIt)
+    {
+        return;
+    }
+    auto range = currencyIt->second.equal_range(date);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        if (it->second == id)
+        {
+            currencyIt->second.erase(it);
+            break;
+        }
+    }
+    if (currencyIt->second.empty())
+    {
+        m_dependencies.erase(currencyIt);
+    }
+}
+
+Result ConversionLedger::convertPOSTransaction(
+    uint64_t& id,
+    POSTransaction& toPosTransaction,
+    const POSTransaction& fromPosTransaction,
+    const std::string& toCurrency)
+{
+    uint64_t generation;
+    {
+        // dependencies are added before conversion, so rate change is not missed
+        std::unique_lock<std::mutex> l(m_guard);
+        id = m_nextId++;
+        Entry& entry = m_entries[id];
+        entry.m_entry.m_fromTransaction = fromPosTransaction;
+        entry.m_entry.m_toCurrency = toCurrency;
+        entry.m_entry.m_result = Result::PENDING;
+        generation = entry.m_generation;
+        if (fromPosTransaction.m_currency != toCurrency)
+        {
+            addDependencyUnsafe(fromPosTransaction.m_currency, fromPosTransaction.m_date, id);
+            addDependencyUnsafe(toCurrency, fromPosTransaction.m_date, id);
+        }
+    }
+
+    const Result r = m_manager.convertPOSTransaction(toPosTransaction, fromPosTransaction, toCurrency);
+
+    std::unique_lock<std::mutex> l(m_guard);
+    auto entryIt = m_entries.find(id);
+    if (m_entries.end() != entryIt && entryIt->second.m_generation == generation)
+    {
+        entryIt->second.m_entry.m_result = r;
+        entryIt->second.m_entry.m_toTransaction = Result::SUCCESS == r ? toPosTransaction : POSTransaction();
+    }
+    return r;
+}
+
+bool ConversionLedger::get(const uint64_t id, LedgerEntry& entry) const
+{
+    std::unique_lock<std::mutex> l(m_guard);
+    auto entryIt = m_entries.find(id);
+    if (m_entries.end() == entryIt)
+    {
+        return false;
+    }
+    entry = entryIt->second.m_entry;
+    return true;
+}
+
+bool ConversionLedger::remove(const uint64_t id)
+{
+    std::unique_lock<std::mutex> l(m_guard);
+    auto entryIt = m_entries.find(id);
+    if (m_entries.end() == entryIt)
+    {
+        return false;
+    }
+    const LedgerEntry& entry = entryIt->second.m_entry;
+    removeDependencyUnsafe(entry.m_fromTransaction.m_currency, entry.m_fromTransaction.m_date, id);
+    removeDependencyUnsafe(entry.m_toCurrency, entry.m_fromTransaction.m_date, id);
+    m_affected.erase(id);
+    m_entries.erase(entryIt);
+    return true;
+}
+
+size_t ConversionLedger::size() const
+{
+    std::unique_lock<std::mutex> l(m_guard);
+    return m_entries.size();
+}
+
+std::vector<uint64_t> ConversionLedger::takeAffected()
+{
+    std::set<uint64_t> affected;
+    {
+        std::unique_lock<std::mutex> l(m_guard);
+        affected.swap(m_affected);
+    }
+    return std::vector<uint64_t>(affected.begin(), affected.end());
+}
+
+bool ConversionLedger::compute(const uint64_t id)
+{
+    POSTransaction fromTransaction;
+    std::string toCurrency;
+    uint64_t generation;
+    {
+        std::unique_lock<std::mutex> l(m_guard);
+        auto entryIt = m_entries.find(id);
+        if (m_entries.end() == entryIt)
+        {
+            return false;
+        }
+        fromTransaction = entryIt->second.m_entry.m_fromTransaction;
+        toCurrency = entryIt->second.m_entry.m_toCurrency;
+        generation = entryIt->second.m_generation;
+    }
+
+    POSTransaction toTransaction;
+    const Result r = m_manager.convertPOSTransaction(toTransaction, fromTransaction, toCurrency);
+
+    std::unique_lock<std::mutex> l(m_guard);
+    auto entryIt = m_entries.find(id);
+    if (m_entries.end() == entryIt || entryIt->second.m_generation != generation)
+    {
+        // marked again. it is recomputed next time
+        return false;
+    }
+    LedgerEntry& entry = entryIt->second.m_entry;
+    const bool changed = entry.m_result != r ||
+        (Result::SUCCESS == r && entry.m_toTransaction.m_total != toTransaction.m_total);
+    entry.m_result = r;
+    entry.m_toTransaction = Result::SUCCESS == r ? toTransaction : POSTransaction();
+    return changed;
+}
+
+std::vector<uint64_t> ConversionLedger::reprice()
+{
+    std::vector<uint64_t> changedIds;
+    for (const uint64_t id : takeAffected())
+    {
+        if (compute(id))
+        {
+            changedIds.push_back(id);
+        }
+    }
+    return changedIds;
+}
+
+void ConversionLedger::onRatesChanged(const std::string& currency, const time_t fromDate, const time_t toDate)
+{
+    std::unique_lock<std::mutex> l(m_guard);
+    auto currencyIt = m_dependencies.find(currency);
+    if (m_dependencies.end() == currencyIt)
+    {
+        return;
+    }
+    const Dependencies& dependencies = currencyIt->second;
+    for (auto it = dependencies.lower_bound(fromDate); it != dependencies.end() && it->first < toDate; ++it)
+    {
+        auto entryIt = m_entries.find(it->second);
+        if (m_entries.end() != entryIt)
+        {
+            ++ entryIt->second.m_generation;
+            m_affected.insert(it->second);
+        }
+    }
+}
+
+} // namespace pos
@@ -0,0 +1,363 @@
+#include <ConversionProtocol.h>
+#include <Encoding.h>
+
+namespace pos
+{
+
+static void writeString(std::vector<uint8_t>& buf, const std::string& str)
+{
+    writeVarint(buf, str.size());
+    buf.insert(buf.end(), str.begin(), str.end());
+}
+
+static bool readString(const uint8_t*& p, const uint8_t* end, std::string& str)
+{
+    uint64_t size;
+    if (!readVarint(p, end, size) || size > static_cast<uint64_t>(end - p))
+    {
+        return false;
+    }
+    str.assign(reinterpret_cast<const char*>(p), size);
+    p += size;
+    return true;
+}
+
+static bool readDouble(const uint8_t*& p, const uint8_t* end, double& value)
+{
+    uint64_t bits;
+    if (!readFixed64(p, end, bits))
+    {
+        return false;
+    }
+    value = bitsToDouble(bits);
+    return true;
+}
+
+static bool readDate(const uint8_t*& p, const uint8_t* end, time_t& date)
+{
+    uint64_t value;
+    if (!readVarint(p, end, value))
+    {
+        return false;
+    }
+    date = static_cast<time_t>(zigzagDecode(value));
+    return true;
+}
+
+static bool readResult(const uint8_t*& p, const uint8_t* end, Result& result)
+{
+    uint64_t value;
+    if (!readVarint(p, end, value) || value > static_cast<uint64_t>(Result::AMOUNT_OVERFLOW))
+    {
+        return false;
+    }
+    result = static_cast<Result>(value);
+    return true;
+}
+
+// count of items that take at least minSize bytes each. big count of broken message
+// is rejected before memory is reserved for it
+static bool readCount(const uint8_t*& p, const uint8_t* end, const size_t minSize, size_t& count)
+{
+    uint64_t value;
+    if (!readVarint(p, end, value) || value > static_cast<uint64_t>(end - p) / minSize)
+    {
+        return false;
+    }
+    count = static_cast<size_t>(value);
+    return true;
+}
+
+size_t beginFrame(std::vector<uint8_t>& buf, const uint32_t requestId, const MessageType type)
+{
+    const size_t offset = buf.size();
+    buf.resize(offset + FRAME_HEADER_SIZE + MESSAGE_HEADER_SIZE);
+    uint8_t* p = buf.data() + offset + FRAME_HEADER_SIZE;
+    for (size_t i = 0; i < sizeof(requestId); ++i)
+    {
+        p[i] = static_cast<uint8_t>(requestId >> (i * 8));
+    }
+    p[sizeof(requestId)] = static_cast<uint8_t>(type);
+    return offset;
+}
+
+void endFrame(std::vector<uint8_t>& buf, const size_t offset)
+{
+    const uint32_t size = static_cast<uint32_t>(buf.size() - offset - FRAME_HEADER_SIZE);
+    for (size_t i = 0; i < FRAME_HEADER_SIZE; ++i)
+    {
+        buf[offset + i] = static_cast<uint8_t>(size >> (i * 8));
+    }
+}
+
+bool getFrameSize(const uint8_t* p, const size_t size, size_t& frameSize)
+{
+    frameSize = 0;
+    if (size < FRAME_HEADER_SIZE)
+    {
+        return true;
+    }
+    uint32_t payloadSize = 0;
+    for (size_t i = 0; i < FRAME_HEADER_SIZE; ++i)
+    {
+        payloadSize |= static_cast<uint32_t>(p[i]) << (i * 8);
+    }
+    if (payloadSize < MESSAGE_HEADER_SIZE || payloadSize > MAX_FRAME_SIZE)
+    {
+        return false;
+    }
+    if (size >= FRAME_HEADER_SIZE + payloadSize)
+    {
+        frameSize = FRAME_HEADER_SIZE + payloadSize;
+    }
+    return true;
+}
+
+Result readMessageHeader(const uint8_t*& p, const uint8_t* end, uint32_t& requestId, MessageType& type)
+{
+    if (end - p < static_cast<ptrdiff_t>(MESSAGE_HEADER_SIZE))
+    {
+        return Result::INVALID_FORMAT;
+    }
+    requestId = 0;
+    for (size_t i = 0; i < sizeof(requestId); ++i)
+    {
+        requestId |= static_cast<uint32_t>(p[i]) << (i * 8);
+    }
+    type = static_cast<MessageType>(p[sizeof(requestId)]);
+    p += MESSAGE_HEADER_SIZE;
+    return Result::SUCCESS;
+}
+
+void writeConvertRequest(std::vector<uint8_t>& buf, const POSTransactionBatch& batch, const std::string& toCurrency)
+{
+    writeString(buf, toCurrency);
+    const std::vector<std::string>& currencies = batch.getCurrencies();
+    writeVarint(buf, currencies.size());
+    for (const auto& currency : currencies)
+    {
+        writeString(buf, currency);
+    }
+    const size_t size = batch.size();
+    writeVarint(buf, size);
+    time_t prevDate = 0;
+    for (size_t i = 0; i < size; ++i)
+    {
+        const time_t date = batch.getDates()[i];
+        writeFixed64(buf, doubleToBits(batch.getTotals()[i]));
+        writeVarint(buf, batch.getCurrencyIds()[i]);
+        writeVarint(buf, zigzagEncode(static_cast<int64_t>(date) - static_cast<int64_t>(prevDate)));
+        prevDate = date;
+    }
+}
+
+Result readConvertRequest(const uint8_t* p, const uint8_t* end, POSTransactionBatch& batch, std::string& toCurrency)
+{
+    batch.clear();
+    size_t count;
+    if (!readString(p, end, toCurrency) || !readCount(p, end, 1, count))
+    {
+        return Result::INVALID_FORMAT;
+    }
+    std::string currency;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (!readString(p, end, currency) || batch.addCurrency(currency) != i)
+        {
+            return Result::INVALID_FORMAT;
+        }
+    }
+    // total, currency id and date take at least 10 bytes
+    size_t size;
+    if (!readCount(p, end, 10, size))
+    {
+        return Result::INVALID_FORMAT;
+    }
+    batch.reserve(size);
+    time_t date = 0;
+    for (size_t i = 0; i < size; ++i)
+    {
+        double total;
+        uint64_t currencyId;
+        time_t delta;
+        if (!readDouble(p, end, total) ||
+            !readVarint(p, end, currencyId) || currencyId >= count ||
+            !readDate(p, end, delta))
+        {
+            return Result::INVALID_FORMAT;
+        }
+        date += delta;
+        batch.add(total, static_cast<uint32_t>(currencyId), date);
+    }
+    return p == end ? Result::SUCCESS : Result::INVALID_FORMAT;
+}
+
+void writeConvertResponse(
+    std::vector<uint8_t>& buf,
+    const Result result,
+    const std::vector<double>& totals,
+    const std::vector<Result>& results)
+{
+    writeVarint(buf, static_cast<uint64_t>(result));
+    writeVarint(buf, totals.size());
+    for (size_t i = 0; i < totals.size(); ++i)
+    {
+        writeVarint(buf, static_cast<uint64_t>(results[i]));
+        writeFixed64(buf, doubleToBits(totals[i]));
+    }
+}
+
+Result readConvertResponse(
+    const uint8_t* p,
+    const uint8_t* end,
+    Result& result,
+    std::vector<double>& totals,
+    std::vector<Result>& results)
+{
+    size_t size;
+    if (!readResult(p, end, result) || !readCount(p, end, 9, size))
+    {
+        return Result::INVALID_FORMAT;
+    }
+    totals.resize(size);
+    results.resize(size);
+    for (size_t i = 0; i < size; ++i)
+    {
+        if (!readResult(p, end, results[i]) || !readDouble(p, end, totals[i]))
+        {
+            return Result::INVALID_FORMAT;
+        }
+    }
+    return p == end ? Result::SUCCESS : Result::INVALID_FORMAT;
+}
+
+void writeAddRatesRequest(std::vector<uint8_t>& buf, const std::vector<ExchangeRate>& rates)
+{
+    writeVarint(buf, rates.size());
+    for (const auto& rate : rates)
+    {
+        writeString(buf, rate.m_fromCurrency);
+        writeString(buf, rate.m_toCurrency);
+        writeVarint(buf, zigzagEncode(rate.m_fromDate));
+        buf.push_back(rate.m_toDateSet ? 1 : 0);
+        if (rate.m_toDateSet)
+        {
+            writeVarint(buf, zigzagEncode(rate.m_toDate));
+        }
+        writeFixed64(buf, doubleToBits(rate.m_rate));
+    }
+}
+
+Result readAddRatesRequest(const uint8_t* p, const uint8_t* end, std::vector<ExchangeRate>& rates)
+{
+    // currencies, from date, flag and rate take at least 12 bytes
+    size_t size;
+    if (!readCount(p, end, 12, size))
+    {
+        return Result::INVALID_FORMAT;
+    }
+    rates.resize(size);
+    for (auto& rate : rates)
+    {
+        if (!readString(p, end, rate.m_fromCurrency) ||
+            !readString(p, end, rate.m_toCurrency) ||
+            !readDate(p, end, rate.m_fromDate) ||
+            p == end || *p > 1)
+        {
+            return Result::INVALID_FORMAT;
+        }
+        rate.m_toDateSet = *p++ != 0;
+        rate.m_toDate = 0;
+        if ((rate.m_toDateSet && !readDate(p, end, rate.m_toDate)) || !readDouble(p, end, rate.m_rate))
+        {
+            return Result::INVALID_FORMAT;
+        }
+    }
+    return p == end ? Result::SUCCESS : Result::INVALID_FORMAT;
+}
+
+void writeAddRatesResponse(std::vector<uint8_t>& buf, const Result result, const std::vector<Result>& results)
+{
+    writeVarint(buf, static_cast<uint64_t>(result));
+    writeVarint(buf, results.size());
+    for (const Result r : results)
+    {
+        writeVarint(buf, static_cast<uint64_t>(r));
+    }
+}
+
+Result readAddRatesResponse(const uint8_t* p, const uint8_t* end, Result& result, std::vector<Result>& results)
+{
+    size_t size;
+    if (!readResult(p, end, result) || !readCount(p, end, 1, size))
+    {
+        return Result::INVALID_FORMAT;
+    }
+    results.resize(size);
+    for (auto& r : results)
+    {
+        if (!readResult(p, end, r))
+        {
+            return Result::INVALID_FORMAT;
+        }
+    }
+    return p == end ? Result::SUCCESS : Result::INVALID_FORMAT;
+}
+
+void writeExportRequest(std::vector<uint8_t>& buf, const std::string& currency)
+{
+    writeString(buf, currency);
+}
+
+Result readExportRequest(const uint8_t* p, const uint8_t* end, std::string& currency)
+{
+    if (!readString(p, end, currency))
+    {
+        return Result::INVALID_FORMAT;
+    }
+    return p == end ? Result::SUCCESS : Result::INVALID_FORMAT;
+}
+
+void writeExportResponse(std::vector<uint8_t>& buf, const Result result, const RateTrend& rateTrend)
+{
+    writeVarint(buf, static_cast<uint64_t>(result));
+    writeVarint(buf, rateTrend.size());
+    time_t prevDate = 0;
+    for (const auto& rate : rateTrend)
+    {
+        writeVarint(buf, zigzagEncode(static_cast<int64_t>(rate.first) - static_cast<int64_t>(prevDate)));
+        writeFixed64(buf, doubleToBits(rate.second));
+        prevDate = rate.first;
+    }
+}
+
+Result readExportResponse(const uint8_t* p, const uint8_t* end, Result& result, RateTrend& rateTrend)
+{
+    rateTrend.clear();
+    size_t size;
+    if (!readResult(p, end, result) || !readCount(p, end, 9, size))
+    {
+        return Result::INVALID_FORMAT;
+    }
+    time_t date = 0;
+    for (size_t i = 0; i < size; ++i)
+    {
+        time_t delta;
+        double rate;
+        if (!readDate(p, end, delta) || !readDouble(p, end, rate))
+        {
+            return Result::INVALID_FORMAT;
+        }
+        date += delta;
+        rateTrend.emplace_hint(rateTrend.end(), date, rate);
+    }
+    return p == end ? Result::SUCCESS : Result::INVALID_FORMAT;
+}
+
+void writeErrorResponse(std::vector<uint8_t>& buf, const Result result)
+{
+    writeVarint(buf, static_cast<uint64_t>(result));
+    writeVarint(buf, 0);
+}
+
+} // namespace pos
@@ -0,0 +1,243 @@
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <limits>
+
+#include <DailyTotals.h>
+
+namespace pos
+{
+
+constexpr time_t DailyTotals::SECONDS_PER_DAY;
+
+DailyTotals::DailyTotals(POSTransactionManager& manager):
+    m_manager(manager)
+{
+    m_manager.addRateChangeListener(this);
+}
+
+DailyTotals::~DailyTotals()
+{
+    m_manager.removeRateChangeListener(this);
+}
+
+int64_t DailyTotals::getDay(const time_t date)
+{
+    // round down for dates before epoch
+    const int64_t day = date / SECONDS_PER_DAY;
+    return date % SECONDS_PER_DAY < 0 ? day - 1 : day;
+}
+
+void DailyTotals::addUnsafe(const double total, const std::string& currency, const time_t date)
+{
+    const int64_t day = getDay(date);
+    Bucket& bucket = m_days[day][currency];
+    if (!bucket.m_total.m_count)
+    {
+        bucket.m_total.m_currency = currency;
+        if (currency != m_manager.getBaseCurrency())
+        {
+            m_currencyDays[currency].insert(day);
+        }
+    }
+    DateTotal& dateTotal = bucket.m_dateTotals[date];
+    dateTotal.m_total += total;
+    ++ dateTotal.m_count;
+    bucket.m_total.m_total += total;
+    ++ bucket.m_total.m_count;
+    if (isStale(bucket, date))
+    {
+        // base total of date is taken again, count keeps sums of unconverted dates
+        if (std::isnan(dateTotal.m_baseTotal))
+        {
+            ++ bucket.m_total.m_unconvertedCount;
+        }
+        return;
+    }
+
+    // rate change after lookup marks date as soon as lock is released
+    double rate;
+    const bool converted = Result::SUCCESS == m_manager.getExchangeRate(currency, date, rate);
+    if (dateTotal.m_count > 1 && converted == std::isnan(dateTotal.m_baseTotal))
+    {
+        // rate of date appeared or disappeared and notification is not delivered yet.
+        // date is recomputed as a whole, row is counted as stale one
+        markStale(bucket, date, date + 1);
+        if (std::isnan(dateTotal.m_baseTotal))
+        {
+            ++ bucket.m_total.m_unconvertedCount;
+        }
+        return;
+    }
+    if (converted)
+    {
+        dateTotal.m_baseTotal += total / rate;
+        bucket.m_total.m_baseTotal += total / rate;
+    }
+    else
+    {
+        dateTotal.m_baseTotal = std::numeric_limits<double>::quiet_NaN();
+        ++ bucket.m_total.m_unconvertedCount;
+    }
+}
+
+void DailyTotals::markStale(Bucket& bucket, const time_t fromDate, const time_t toDate)
+{
+    if (bucket.m_staleFromDate >= bucket.m_staleToDate)
+    {
+        bucket.m_staleFromDate = fromDate;
+        bucket.m_staleToDate = toDate;
+    }
+    else
+    {
+        bucket.m_staleFromDate = std::min(bucket.m_staleFromDate, fromDate);
+        bucket.m_staleToDate = std::max(bucket.m_staleToDate, toDate);
+    }
+}
+
+void DailyTotals::add(const POSTransaction& transaction)
+{
+    std::unique_lock<std::mutex> l(m_guard);
+    addUnsafe(transaction.m_total, transaction.m_currency, transaction.m_date);
+}
+
+void DailyTotals::add(const POSTransactionBatch& batch)
+{
+    const std::vector<double>& totals = batch.getTotals();
+    const std::vector<uint32_t>& currencyIds = batch.getCurrencyIds();
+    const std::vector<time_t>& dates = batch.getDates();
+    const std::vector<std::string>& currencies = batch.getCurrencies();
+    std::unique_lock<std::mutex> l(m_guard);
+    for (size_t i = 0; i < batch.size(); ++i)
+    {
+        addUnsafe(totals[i], currencies[currencyIds[i]], dates[i]);
+    }
+}
+
+void DailyTotals::recomputeUnsafe(DayBuckets& dayBuckets)
+{
+    // stale dates of all buckets are converted by one batch call
+    m_fromBatch.clear();
+    for (auto& currencyBucket : dayBuckets)
+    {
+        const Bucket& bucket = currencyBucket.second;
+        const auto endIt = bucket.m_dateTotals.lower_bound(bucket.m_staleToDate);
+        auto dateIt = bucket.m_dateTotals.lower_bound(bucket.m_staleFromDate);
+        if (dateIt == endIt)
+        {
+            continue;
+        }
+        const uint32_t currencyId = m_fromBatch.addCurrency(currencyBucket.first);
+        for (; dateIt != endIt; ++dateIt)
+        {
+            m_fromBatch.add(dateIt->second.m_total, currencyId, dateIt->first);
+        }
+    }
+    if (!m_fromBatch.empty())
+    {
+        m_manager.convertPOSTransactionBatch(m_toBatch, m_results, m_fromBatch, m_manager.getBaseCurrency());
+    }
+
+    size_t index = 0;
+    for (auto& currencyBucket : dayBuckets)
+    {
+        Bucket& bucket = currencyBucket.second;
+        if (bucket.m_staleFromDate >= bucket.m_staleToDate)
+        {
+            continue;
+        }
+        // bucket sums take differences of recomputed dates only
+        const auto endIt = bucket.m_dateTotals.lower_bound(bucket.m_staleToDate);
+        for (auto dateIt = bucket.m_dateTotals.lower_bound(bucket.m_staleFromDate); dateIt != endIt; ++dateIt)
+        {
+            DateTotal& dateTotal = dateIt->second;
+            if (std::isnan(dateTotal.m_baseTotal))
+            {
+                bucket.m_total.m_unconvertedCount -= dateTotal.m_count;
+            }
+            else
+            {
+                bucket.m_total.m_baseTotal -= dateTotal.m_baseTotal;
+            }
+            if (Result::SUCCESS == m_results[index])
+            {
+                dateTotal.m_baseTotal = m_toBatch.getTotals()[index];
+                bucket.m_total.m_baseTotal += dateTotal.m_baseTotal;
+            }
+            else
+            {
+                dateTotal.m_baseTotal = std::numeric_limits<double>::quiet_NaN();
+                bucket.m_total.m_unconvertedCount += dateTotal.m_count;
+            }
+            ++ index;
+        }
+        bucket.m_staleFromDate = bucket.m_staleToDate = 0;
+    }
+}
+
+std::vector<DailyTotal> DailyTotals::getDailyTotals(const time_t date)
+{
+    std::vector<DailyTotal> totals;
+    std::unique_lock<std::mutex> l(m_guard);
+    auto dayIt = m_days.find(getDay(date));
+    if (m_days.end() == dayIt)
+    {
+        return totals;
+    }
+    recomputeUnsafe(dayIt->second);
+    totals.reserve(dayIt->second.size());
+    for (const auto& currencyBucket : dayIt->second)
+    {
+        totals.push_back(currencyBucket.second.m_total);
+    }
+    return totals;
+}
+
+size_t DailyTotals::expire(const time_t cutoff)
+{
+    const int64_t cutoffDay = getDay(cutoff);
+    size_t count = 0;
+    std::unique_lock<std::mutex> l(m_guard);
+    const auto endIt = m_days.lower_bound(cutoffDay);
+    for (auto dayIt = m_days.begin(); dayIt != endIt; ++dayIt)
+    {
+        count += dayIt->second.size();
+    }
+    m_days.erase(m_days.begin(), endIt);
+    for (auto currencyIt = m_currencyDays.begin(); currencyIt != m_currencyDays.end(); )
+    {
+        std::set<int64_t>& days = currencyIt->second;
+        days.erase(days.begin(), days.lower_bound(cutoffDay));
+        currencyIt = days.empty() ? m_currencyDays.erase(currencyIt) : std::next(currencyIt);
+    }
+    return count;
+}
+
+size_t DailyTotals::getBucketsCount() const
+{
+    size_t count = 0;
+    std::unique_lock<std::mutex> l(m_guard);
+    for (const auto& day : m_days)
+    {
+        count += day.second.size();
+    }
+    return count;
+}
+
+void DailyTotals::onRatesChanged(const std::string& currency, const time_t fromDate, const time_t toDate)
+{
+    std::unique_lock<std::mutex> l(m_guard);
+    auto currencyIt = m_currencyDays.find(currency);
+    if (m_currencyDays.end() == currencyIt || toDate <= fromDate)
+    {
+        return;
+    }
+    const int64_t lastDay = getDay(toDate - 1);
+    const std::set<int64_t>& days = currencyIt->second;
+    for (auto dayIt = days.lower_bound(getDay(fromDate)); dayIt != days.end() && *dayIt <= lastDay; ++dayIt)
+    {
+        markStale(m_days[*dayIt][currency], fromDate, toDate);
+    }
+}
+
+} // namespace pos
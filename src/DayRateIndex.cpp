@@ -0,0 +1,167 @@
+#include <algorithm>
+#include <limits>
+
+#include <DayRateIndex.h>
+
+namespace pos
+{
+constexpr time_t DayRateIndex::SECONDS_PER_DAY;
+constexpr size_t DayRateIndex::MIN_POINTS;
+constexpr size_t DayRateIndex::MAX_DAYS_PER_POINT;
+constexpr size_t DayRateIndex::MAX_SPLIT_DAYS_RATIO;
+
+double DayRateIndex::getDayRate(const RateTrend& rateTrend, const int64_t day)
+{
+    const time_t dayStart = day * SECONDS_PER_DAY;
+    auto rateIt = rateTrend.upper_bound(dayStart);
+    if (rateTrend.end() != rateIt && rateIt->first < dayStart + SECONDS_PER_DAY)
+    {
+        // rate changes during day
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    if (rateTrend.begin() == rateIt)
+    {
+        return -1;
+    }
+    return std::prev(rateIt)->second;
+}
+
+void DayRateIndex::setDayRate(const size_t index, const double rate)
+{
+    if (std::isnan(m_rates[index]))
+    {
+        -- m_splitDaysCount;
+    }
+    if (std::isnan(rate))
+    {
+        ++ m_splitDaysCount;
+    }
+    m_rates[index] = rate;
+}
+
+bool DayRateIndex::isSpanWorthwhile(const size_t pointsCount, const int64_t firstDay, const int64_t lastDay)
+{
+    // days of time_t range fit int64, so span is computed without overflow
+    return static_cast<uint64_t>(lastDay - firstDay) < pointsCount * MAX_DAYS_PER_POINT;
+}
+
+void DayRateIndex::build(const RateTrend& rateTrend)
+{
+    clear();
+    if (rateTrend.empty())
+    {
+        return;
+    }
+    const int64_t firstDay = getDay(rateTrend.begin()->first);
+    const int64_t lastDay = getDay(rateTrend.rbegin()->first);
+    if (!isSpanWorthwhile(rateTrend.size(), firstDay, lastDay))
+    {
+        return;
+    }
+    m_firstDay = firstDay;
+    m_rates.reserve(lastDay - m_firstDay + 1);
+
+    // single pass over days and points
+    auto rateIt = rateTrend.begin();
+    double rate = -1;
+    for (int64_t day = m_firstDay; day <= lastDay; ++day)
+    {
+        const time_t dayStart = day * SECONDS_PER_DAY;
+        while (rateTrend.end() != rateIt && rateIt->first <= dayStart)
+        {
+            rate = rateIt->second;
+            ++ rateIt;
+        }
+        if (rateTrend.end() != rateIt && rateIt->first < dayStart + SECONDS_PER_DAY)
+        {
+            m_rates.push_back(std::numeric_limits<double>::quiet_NaN());
+            ++ m_splitDaysCount;
+        }
+        else
+        {
+            m_rates.push_back(rate);
+        }
+    }
+    m_lastDate = rateTrend.rbegin()->first;
+    m_lastRate = rateTrend.rbegin()->second;
+}
+
+void DayRateIndex::update(const RateTrend& rateTrend, const time_t fromDate, const time_t toDate)
+{
+    if (rateTrend.empty())
+    {
+        clear();
+        return;
+    }
+    if (m_rates.empty())
+    {
+        build(rateTrend);
+        return;
+    }
+
+    // days before the old range are inside changed interval or have no rate.
+    // days after it are inside changed interval or have the old last rate
+    const int64_t firstDay = getDay(rateTrend.begin()->first);
+    const int64_t lastDay = getDay(rateTrend.rbegin()->first);
+    if (!isSpanWorthwhile(rateTrend.size(), firstDay, lastDay))
+    {
+        // table of the new span is not allocated
+        clear();
+        return;
+    }
+    if (firstDay < m_firstDay)
+    {
+        m_rates.insert(m_rates.begin(), m_firstDay - firstDay, -1.);
+        m_firstDay = firstDay;
+    }
+    else if (firstDay > m_firstDay)
+    {
+        // leading points were removed
+        auto firstIt = m_rates.begin() + std::min<size_t>(firstDay - m_firstDay, m_rates.size());
+        m_splitDaysCount -= std::count_if(m_rates.begin(), firstIt, [] (double rate) { return std::isnan(rate); });
+        m_rates.erase(m_rates.begin(), firstIt);
+        m_firstDay = firstDay;
+    }
+    const size_t daysCount = lastDay - m_firstDay + 1;
+    for (size_t i = daysCount; i < m_rates.size(); ++i)
+    {
+        if (std::isnan(m_rates[i]))
+        {
+            -- m_splitDaysCount;
+        }
+    }
+    m_rates.resize(daysCount, m_lastRate);
+
+    const int64_t fromDay = std::max(getDay(fromDate), m_firstDay);
+    const int64_t toDay = std::min(getDay(toDate), lastDay);
+    for (int64_t day = fromDay; day <= toDay; ++day)
+    {
+        setDayRate(day - m_firstDay, getDayRate(rateTrend, day));
+    }
+    m_lastDate = rateTrend.rbegin()->first;
+    m_lastRate = rateTrend.rbegin()->second;
+}
+
+void DayRateIndex::clear()
+{
+    m_firstDay = 0;
+    m_rates.clear();
+    m_rates.shrink_to_fit();
+    m_splitDaysCount = 0;
+    m_lastDate = 0;
+    m_lastRate = -1;
+}
+
+bool DayRateIndex::isWorthwhile(const size_t pointsCount, const size_t daysCount, const size_t splitDaysCount)
+{
+    return pointsCount >= MIN_POINTS &&
+        daysCount <= pointsCount * MAX_DAYS_PER_POINT &&
+        splitDaysCount * MAX_SPLIT_DAYS_RATIO <= daysCount;
+}
+
+bool DayRateIndex::isWorthwhile(const size_t pointsCount) const
+{
+    return isWorthwhile(pointsCount, m_rates.size(), m_splitDaysCount);
+}
+
+} // namespace pos
@@ -0,0 +1,172 @@
+#include <DeferredConversion.h>
+
+namespace pos
+{
+
+static bool isMissingRate(const Result r)
+{
+    return Result::NO_RATE == r || Result::NO_CURRENCY == r;
+}
+
+DeferredConverter::DeferredConverter(POSTransactionManager& manager):
+    m_manager(manager)
+{
+    m_manager.addRateChangeListener(this);
+}
+
+DeferredConverter::~DeferredConverter()
+{
+    m_manager.removeRateChangeListener(this);
+
+    std::unordered_map<std::string, PendingConversions> pendingConversions;
+    {
+        std::unique_lock<std::mutex> l(m_guard);
+        pendingConversions.swap(m_pendingConversions);
+        m_pendingCount = 0;
+    }
+    for (const auto& currencyConversions : pendingConversions)
+    {
+        for (const auto& conversion : currencyConversions.second)
+        {
+            conversion.second->m_callback(conversion.second->m_result, POSTransaction());
+        }
+    }
+}
+
+Result DeferredConverter::tryConvert(
+    PendingConversion& conversion,
+    POSTransaction& toTransaction,
+    std::string& currency) const
+{
+    Result r = m_manager.convertPOSTransaction(toTransaction, conversion.m_fromTransaction, conversion.m_toCurrency);
+    if (!isMissingRate(r))
+    {
+        return r;
+    }
+    double rate;
+    const POSTransaction& fromTransaction = conversion.m_fromTransaction;
+    if (isMissingRate(m_manager.getExchangeRate(fromTransaction.m_currency, fromTransaction.m_date, rate)))
+    {
+        currency = fromTransaction.m_currency;
+    }
+    else
+    {
+        currency = conversion.m_toCurrency;
+    }
+    return r;
+}
+
+bool DeferredConverter::unpark(const std::string& currency, const PendingConversionPtr& conversion)
+{
+    std::unique_lock<std::mutex> l(m_guard);
+    auto currencyIt = m_pendingConversions.find(currency);
+    if (m_pendingConversions.end() == currencyIt)
+    {
+        return false;
+    }
+    auto range = currencyIt->second.equal_range(conversion->m_fromTransaction.m_date);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        if (it->second == conversion)
+        {
+            currencyIt->second.erase(it);
+            -- m_pendingCount;
+            return true;
+        }
+    }
+    return false;
+}
+
+Result DeferredConverter::process(const PendingConversionPtr& conversion)
+{
+    POSTransaction toTransaction;
+    std::string currency;
+    while (true)
+    {
+        Result r = tryConvert(*conversion, toTransaction, currency);
+        if (!isMissingRate(r))
+        {
+            conversion->m_callback(r, toTransaction);
+            return r;
+        }
+        conversion->m_result = r;
+        {
+            std::unique_lock<std::mutex> l(m_guard);
+            m_pendingConversions[currency].emplace(conversion->m_fromTransaction.m_date, conversion);
+            ++ m_pendingCount;
+        }
+
+        // rate could be added before conversion was parked
+        std::string missingCurrency;
+        r = tryConvert(*conversion, toTransaction, missingCurrency);
+        if (isMissingRate(r) && missingCurrency == currency)
+        {
+            return Result::PENDING;
+        }
+        if (!unpark(currency, conversion))
+        {
+            // conversion is taken by notification
+            return Result::PENDING;
+        }
+    }
+}
+
+Result DeferredConverter::convertPOSTransaction(
+    const POSTransaction& fromPosTransaction,
+    const std::string& toCurrency,
+    ConversionCallback callback)
+{
+    PendingConversionPtr conversion(
+        new PendingConversion{ fromPosTransaction, toCurrency, std::move(callback), Result::SUCCESS });
+    return process(conversion);
+}
+
+std::future<ConversionResult> DeferredConverter::convertPOSTransaction(
+    const POSTransaction& fromPosTransaction,
+    const std::string& toCurrency)
+{
+    std::shared_ptr<std::promise<ConversionResult>> promise(new std::promise<ConversionResult>());
+    std::future<ConversionResult> future = promise->get_future();
+    convertPOSTransaction(fromPosTransaction, toCurrency,
+        [promise] (Result r, const POSTransaction& toTransaction)
+        {
+            promise->set_value(ConversionResult{ r, toTransaction });
+        });
+    return future;
+}
+
+size_t DeferredConverter::getPendingCount() const
+{
+    std::unique_lock<std::mutex> l(m_guard);
+    return m_pendingCount;
+}
+
+void DeferredConverter::onRatesChanged(const std::string& currency, const time_t fromDate, const time_t toDate)
+{
+    // take all conversions covered by changed interval in one batch
+    std::vector<PendingConversionPtr> conversions;
+    {
+        std::unique_lock<std::mutex> l(m_guard);
+        auto currencyIt = m_pendingConversions.find(currency);
+        if (m_pendingConversions.end() == currencyIt)
+        {
+            return;
+        }
+        PendingConversions& pendingConversions = currencyIt->second;
+        auto fromIt = pendingConversions.lower_bound(fromDate);
+        auto toIt = pendingConversions.lower_bound(toDate);
+        for (auto it = fromIt; it != toIt; ++it)
+        {
+            conversions.push_back(std::move(it->second));
+        }
+        pendingConversions.erase(fromIt, toIt);
+        m_pendingCount -= conversions.size();
+    }
+
+    for (const auto& conversion : conversions)
+    {
+        process(conversion);
+    }
+}
+
+} // namespace pos
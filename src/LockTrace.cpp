@@ -0,0 +1,150 @@
+#include <cstdio>
+#include <cinttypes>
+
+#include <LockTrace.h>
+
+namespace pos
+{
+const char* lockSiteToStr(const LockSite site)
+{
+    switch (site)
+    {
+        case LockSite::CONVERT_FROM:
+            return "convert-from";
+        case LockSite::CONVERT_TO:
+            return "convert-to";
+        case LockSite::ADD:
+            return "add";
+        case LockSite::EXPORT:
+            return "export";
+        case LockSite::EXPIRE:
+            return "expire";
+        case LockSite::LOOKUP:
+            return "lookup";
+    }
+    return "unknown";
+}
+
+LockTracer::LockTracer(const size_t capacity):
+    m_start(Clock::now()),
+    m_events(capacity ? capacity : 1)
+{}
+
+int64_t LockTracer::now() const
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - m_start).count();
+}
+
+void LockTracer::record(
+    const LockSite site,
+    const int64_t requestTime,
+    const int64_t acquireTime,
+    const int64_t releaseTime)
+{
+    const int64_t wait = acquireTime - requestTime;
+    const int64_t hold = releaseTime - acquireTime;
+    const uint32_t threadIndex = getThreadIndex();
+
+    std::unique_lock<std::mutex> l(m_guard);
+    LockTraceEvent& event = m_events[m_eventsCount % m_events.size()];
+    event.m_site = site;
+    event.m_threadIndex = threadIndex;
+    event.m_requestTime = requestTime;
+    event.m_acquireTime = acquireTime;
+    event.m_releaseTime = releaseTime;
+    ++ m_eventsCount;
+
+    LockSiteStats& stats = m_stats[static_cast<size_t>(site)];
+    ++ stats.m_count;
+    stats.m_totalWait += wait;
+    stats.m_totalHold += hold;
+    if (stats.m_maxWait < wait)
+    {
+        stats.m_maxWait = wait;
+    }
+    if (stats.m_maxHold < hold)
+    {
+        stats.m_maxHold = hold;
+    }
+}
+
+LockSiteStats LockTracer::getStats(const LockSite site) const
+{
+    std::unique_lock<std::mutex> l(m_guard);
+    return m_stats[static_cast<size_t>(site)];
+}
+
+std::vector<LockTraceEvent> LockTracer::getEvents() const
+{
+    std::unique_lock<std::mutex> l(m_guard);
+    std::vector<LockTraceEvent> events;
+    if (m_eventsCount <= m_events.size())
+    {
+        events.assign(m_events.begin(), m_events.begin() + m_eventsCount);
+        return events;
+    }
+    // ring buffer is full. the oldest event is the next one to be overwritten
+    const size_t first = m_eventsCount % m_events.size();
+    events.reserve(m_events.size());
+    events.insert(events.end(), m_events.begin() + first, m_events.end());
+    events.insert(events.end(), m_events.begin(), m_events.begin() + first);
+    return events;
+}
+
+uint64_t LockTracer::getDroppedCount() const
+{
+    std::unique_lock<std::mutex> l(m_guard);
+    return m_eventsCount > m_events.size() ? m_eventsCount - m_events.size() : 0;
+}
+
+void LockTracer::reset()
+{
+    std::unique_lock<std::mutex> l(m_guard);
+    m_eventsCount = 0;
+    for (auto& stats : m_stats)
+    {
+        stats = LockSiteStats();
+    }
+}
+
+Result LockTracer::dumpChromeTrace(const std::string& fileName) const
+{
+    // copy events not to block tracing while writing file
+    std::vector<LockTraceEvent> events = getEvents();
+
+    FILE* file = fopen(fileName.c_str(), "w");
+    if (!file)
+    {
+        return Result::IO_ERROR;
+    }
+
+    // complete ('X') events. timestamps and durations are in microseconds
+    fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    bool first = true;
+    for (const auto& event : events)
+    {
+        const char* site = lockSiteToStr(event.m_site);
+        fprintf(file,
+            "%s\n{\"name\":\"%s\",\"cat\":\"wait\",\"ph\":\"X\",\"pid\":0,\"tid\":%" PRIu32 ","
+            "\"ts\":%.3f,\"dur\":%.3f}",
+            first ? "" : ",",
+            site, event.m_threadIndex,
+            event.m_requestTime / 1000., (event.m_acquireTime - event.m_requestTime) / 1000.);
+        fprintf(file,
+            ",\n{\"name\":\"%s\",\"cat\":\"hold\",\"ph\":\"X\",\"pid\":0,\"tid\":%" PRIu32 ","
+            "\"ts\":%.3f,\"dur\":%.3f}",
+            site, event.m_threadIndex,
+            event.m_acquireTime / 1000., (event.m_releaseTime - event.m_acquireTime) / 1000.);
+        first = false;
+    }
+    fprintf(file, "\n]}\n");
+
+    bool failed = ferror(file);
+    if (fclose(file) != 0 || failed)
+    {
+        return Result::IO_ERROR;
+    }
+    return Result::SUCCESS;
+}
+
+} // namespace pos
@@ -0,0 +1,57 @@
+#include <cmath>
+
+#include <Money.h>
+
+namespace pos
+{
+
+Result toFixedRate(const double rate, int64_t& fixedRate)
+{
+    if (!(rate > 0))
+    {
+        return Result::NO_RATE;
+    }
+    const double scaledRate = rate * RATE_SCALE;
+    // 2^63 is the first double that does not fit
+    if (scaledRate >= 9223372036854775808.)
+    {
+        return Result::AMOUNT_OVERFLOW;
+    }
+    fixedRate = std::llround(scaledRate);
+    return fixedRate ? Result::SUCCESS : Result::AMOUNT_OVERFLOW;
+}
+
+size_t convertAmounts(
+    int64_t* toAmounts,
+    const int64_t* fromAmounts,
+    const int64_t* fromRates,
+    const int64_t* toRates,
+    const size_t count)
+{
+    // integer division has no SIMD form, independent rows keep divider busy instead
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        const int64_t amount0 = convertAmount(fromAmounts[i], fromRates[i], toRates[i]);
+        const int64_t amount1 = convertAmount(fromAmounts[i + 1], fromRates[i + 1], toRates[i + 1]);
+        const int64_t amount2 = convertAmount(fromAmounts[i + 2], fromRates[i + 2], toRates[i + 2]);
+        const int64_t amount3 = convertAmount(fromAmounts[i + 3], fromRates[i + 3], toRates[i + 3]);
+        toAmounts[i] = amount0;
+        toAmounts[i + 1] = amount1;
+        toAmounts[i + 2] = amount2;
+        toAmounts[i + 3] = amount3;
+    }
+    for (; i < count; ++i)
+    {
+        toAmounts[i] = convertAmount(fromAmounts[i], fromRates[i], toRates[i]);
+    }
+
+    size_t invalidCount = 0;
+    for (i = 0; i < count; ++i)
+    {
+        invalidCount += INVALID_AMOUNT == toAmounts[i];
+    }
+    return invalidCount;
+}
+
+} // namespace pos
@@ -0,0 +1,74 @@
+#include <algorithm>
+#include <cstddef>
+
+#include <RateTrendAllocator.h>
+
+namespace pos
+{
+constexpr size_t NodePool::MIN_CHUNK_NODES;
+constexpr size_t NodePool::MAX_CHUNK_NODES;
+
+NodePool::~NodePool()
+{
+    release();
+}
+
+void NodePool::release()
+{
+    for (void* chunk : m_chunks)
+    {
+        ::operator delete(chunk);
+    }
+    m_chunks.clear();
+    m_chunkNodes = MIN_CHUNK_NODES;
+    m_chunkPos = nullptr;
+    m_chunkEnd = nullptr;
+    m_freeList = nullptr;
+    m_memoryUsage = 0;
+}
+
+void* NodePool::allocate(const size_t size)
+{
+    if (!m_nodeSize)
+    {
+        // slot keeps node alignment and fits free list link
+        const size_t alignment = alignof(std::max_align_t);
+        m_nodeSize = size;
+        m_slotSize = (std::max(size, sizeof(void*)) + alignment - 1) / alignment * alignment;
+    }
+    ++ m_nodesCount;
+    if (m_freeList)
+    {
+        void* node = m_freeList;
+        m_freeList = *static_cast<void**>(node);
+        return node;
+    }
+    if (m_chunkPos == m_chunkEnd)
+    {
+        const size_t chunkSize = m_chunkNodes * m_slotSize;
+        m_chunks.push_back(nullptr);
+        m_chunks.back() = ::operator new(chunkSize);
+        m_chunkPos = static_cast<char*>(m_chunks.back());
+        m_chunkEnd = m_chunkPos + chunkSize;
+        m_memoryUsage += chunkSize;
+        m_chunkNodes = std::min(m_chunkNodes * 2, MAX_CHUNK_NODES);
+    }
+    void* node = m_chunkPos;
+    m_chunkPos += m_slotSize;
+    return node;
+}
+
+void NodePool::deallocate(void* node)
+{
+    -- m_nodesCount;
+    if (!m_nodesCount)
+    {
+        // trend is cleared. memory is reclaimed in bulk
+        release();
+        return;
+    }
+    *static_cast<void**>(node) = m_freeList;
+    m_freeList = node;
+}
+
+} // namespace pos
@@ -0,0 +1,93 @@
+#include <vector>
+
+#ifdef POS_HAVE_NUMA
+#include <numa.h>
+#include <sched.h>
+#endif
+
+#include <Numa.h>
+
+namespace pos
+{
+
+#ifdef POS_HAVE_NUMA
+
+namespace
+{
+struct NumaTopology
+{
+    size_t m_nodesCount = 1;
+    // node of each cpu
+    std::vector<size_t> m_cpuNodes;
+
+    NumaTopology()
+    {
+        if (numa_available() < 0)
+        {
+            return;
+        }
+        m_nodesCount = numa_max_node() + 1;
+        const int cpusCount = numa_num_configured_cpus();
+        for (int cpu = 0; cpu < cpusCount; ++cpu)
+        {
+            const int node = numa_node_of_cpu(cpu);
+            m_cpuNodes.push_back(node < 0 ? 0 : node);
+        }
+    }
+};
+
+const NumaTopology& getNumaTopology()
+{
+    static const NumaTopology topology;
+    return topology;
+}
+} // namespace
+
+size_t getNumaNodesCount()
+{
+    return getNumaTopology().m_nodesCount;
+}
+
+size_t getCurrentNumaNode()
+{
+    const NumaTopology& topology = getNumaTopology();
+    if (topology.m_nodesCount < 2)
+    {
+        return 0;
+    }
+    const int cpu = sched_getcpu();
+    if (cpu < 0 || static_cast<size_t>(cpu) >= topology.m_cpuNodes.size())
+    {
+        return 0;
+    }
+    return topology.m_cpuNodes[cpu];
+}
+
+void bindThreadToNumaNode(const size_t node)
+{
+    if (getNumaNodesCount() < 2)
+    {
+        return;
+    }
+    numa_run_on_node(static_cast<int>(node));
+    numa_set_preferred(static_cast<int>(node));
+}
+
+#else // POS_HAVE_NUMA
+
+size_t getNumaNodesCount()
+{
+    return 1;
+}
+
+size_t getCurrentNumaNode()
+{
+    return 0;
+}
+
+void bindThreadToNumaNode(const size_t)
+{}
+
+#endif // POS_HAVE_NUMA
+
+} // namespace pos
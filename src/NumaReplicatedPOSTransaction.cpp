@@ -0,0 +1,133 @@
+#include <NumaReplicatedPOSTransaction.h>
+#include <Numa.h>
+
+namespace pos
+{
+
+NumaReplicatedPOSTransactionManager::Replica::Replica(const std::string& baseCurrency, const size_t node):
+    m_node(node),
+    m_manager(baseCurrency)
+{}
+
+NumaReplicatedPOSTransactionManager::NumaReplicatedPOSTransactionManager(
+    const std::string& baseCurrency,
+    const size_t replicasCount)
+{
+    const size_t nodesCount = getNumaNodesCount();
+    const size_t count = replicasCount ? replicasCount : nodesCount;
+    for (size_t i = 0; i < count; ++i)
+    {
+        // throws on empty currency
+        m_replicas.emplace_back(new Replica(baseCurrency, i % nodesCount));
+    }
+    if (m_replicas.size() < 2)
+    {
+        return;
+    }
+    for (auto& replica : m_replicas)
+    {
+        replica->m_thread = std::thread(&NumaReplicatedPOSTransactionManager::run, this, std::ref(*replica));
+    }
+}
+
+NumaReplicatedPOSTransactionManager::~NumaReplicatedPOSTransactionManager()
+{
+    for (auto& replica : m_replicas)
+    {
+        if (!replica->m_thread.joinable())
+        {
+            continue;
+        }
+        {
+            std::unique_lock<std::mutex> l(replica->m_guard);
+            replica->m_stopped = true;
+        }
+        replica->m_cv.notify_all();
+        replica->m_thread.join();
+    }
+}
+
+void NumaReplicatedPOSTransactionManager::run(Replica& replica)
+{
+    bindThreadToNumaNode(replica.m_node);
+    std::vector<RateUpdate> updates;
+    while (true)
+    {
+        uint64_t pushedCount;
+        {
+            std::unique_lock<std::mutex> l(replica.m_guard);
+            replica.m_cv.wait(l, [&replica] () { return replica.m_stopped || !replica.m_updates.empty(); });
+            if (replica.m_updates.empty())
+            {
+                break;
+            }
+            updates.swap(replica.m_updates);
+            pushedCount = replica.m_pushedCount;
+        }
+
+        replica.m_manager.addExchangeRates(std::move(updates));
+        updates.clear();
+
+        {
+            std::unique_lock<std::mutex> l(replica.m_guard);
+            replica.m_appliedCount = pushedCount;
+        }
+        replica.m_cv.notify_all();
+    }
+}
+
+void NumaReplicatedPOSTransactionManager::addExchangeRates(std::vector<RateUpdate>&& updates)
+{
+    if (m_replicas.size() < 2)
+    {
+        m_replicas.front()->m_manager.addExchangeRates(std::move(updates));
+        return;
+    }
+
+    std::unique_lock<std::mutex> writeLock(m_writeGuard);
+    for (size_t i = 0; i < m_replicas.size(); ++i)
+    {
+        Replica& replica = *m_replicas[i];
+        {
+            std::unique_lock<std::mutex> l(replica.m_guard);
+            if (i + 1 == m_replicas.size())
+            {
+                replica.m_updates = std::move(updates);
+            }
+            else
+            {
+                replica.m_updates = updates;
+            }
+            ++ replica.m_pushedCount;
+        }
+        replica.m_cv.notify_all();
+    }
+    // replicas apply update in parallel
+    for (auto& replica : m_replicas)
+    {
+        std::unique_lock<std::mutex> l(replica->m_guard);
+        replica->m_cv.wait(l, [&replica] () { return replica->m_appliedCount == replica->m_pushedCount; });
+    }
+}
+
+const POSTransactionManager& NumaReplicatedPOSTransactionManager::getLocalManager() const
+{
+    const size_t node = getCurrentNumaNode();
+    // replica i is on node i % nodes count. with fewer replicas nodes share them round robin
+    return m_replicas[node % m_replicas.size()]->m_manager;
+}
+
+POSTransactionManager::CurrencyTrendMap NumaReplicatedPOSTransactionManager::getExchangeRates() const
+{
+    return getLocalManager().getExchangeRates();
+}
+
+Result NumaReplicatedPOSTransactionManager::getExchangeRate(
+    const std::string& currency,
+    const time_t date,
+    double& rate) const
+{
+    return getLocalManager().getExchangeRate(currency, date, rate);
+}
+
+} // namespace pos
@@ -0,0 +1,358 @@
+#include <algorithm>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <POSTransactionBatch.h>
+#include <RadixSort.h>
+
+namespace pos
+{
+
+POSTransactionBatch::POSTransactionBatch(const std::vector<POSTransaction>& transactions)
+{
+    reserve(transactions.size());
+    for (const auto& transaction : transactions)
+    {
+        add(transaction);
+    }
+}
+
+uint32_t POSTransactionBatch::addCurrency(const std::string& currency)
+{
+    auto res = m_currencyIdMap.emplace(currency, static_cast<uint32_t>(m_currencies.size()));
+    if (res.second)
+    {
+        m_currencies.push_back(currency);
+    }
+    return res.first->second;
+}
+
+void POSTransactionBatch::add(const double total, const uint32_t currencyId, const time_t date)
+{
+    m_totals.push_back(total);
+    m_currencyIds.push_back(currencyId);
+    m_dates.push_back(date);
+}
+
+void POSTransactionBatch::add(const double total, const std::string& currency, const time_t date)
+{
+    add(total, addCurrency(currency), date);
+}
+
+void POSTransactionBatch::add(const POSTransaction& transaction)
+{
+    add(transaction.m_total, transaction.m_currency, transaction.m_date);
+}
+
+void POSTransactionBatch::reserve(const size_t size)
+{
+    m_totals.reserve(size);
+    m_currencyIds.reserve(size);
+    m_dates.reserve(size);
+}
+
+void POSTransactionBatch::clear()
+{
+    m_totals.clear();
+    m_currencyIds.clear();
+    m_dates.clear();
+    m_currencies.clear();
+    m_currencyIdMap.clear();
+}
+
+POSTransaction POSTransactionBatch::get(const size_t index) const
+{
+    return POSTransaction{ m_totals[index], m_currencies[m_currencyIds[index]], m_dates[index] };
+}
+
+std::vector<POSTransaction> POSTransactionBatch::toTransactions() const
+{
+    std::vector<POSTransaction> transactions;
+    transactions.reserve(size());
+    for (size_t i = 0; i < size(); ++i)
+    {
+        transactions.push_back(get(i));
+    }
+    return transactions;
+}
+
+void sortPOSTransactionBatch(const POSTransactionBatch& batch, std::vector<uint32_t>& order)
+{
+    const size_t count = batch.size();
+    const std::vector<uint32_t>& currencyIds = batch.getCurrencyIds();
+    const std::vector<time_t>& dates = batch.getDates();
+    if (!count)
+    {
+        order.clear();
+        return;
+    }
+
+    // key is currency id in high bits and date offset in low bits.
+    // dates are coarsened if their range does not fit
+    const size_t currenciesCount = batch.getCurrencies().size();
+    const size_t idBits = currenciesCount > 1 ? 64 - __builtin_clzll(currenciesCount - 1) : 0;
+    const size_t dateBits = 64 - idBits;
+    auto minMax = std::minmax_element(dates.begin(), dates.end());
+    const time_t minDate = *minMax.first;
+    const uint64_t dateRange = static_cast<uint64_t>(*minMax.second) - static_cast<uint64_t>(minDate);
+    const size_t rangeBits = dateRange ? 64 - __builtin_clzll(dateRange) : 0;
+    const size_t dateShift = rangeBits > dateBits ? rangeBits - dateBits : 0;
+
+    std::vector<uint64_t> keys(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        const uint64_t dateKey = (static_cast<uint64_t>(dates[i]) - static_cast<uint64_t>(minDate)) >> dateShift;
+        keys[i] = idBits ? (static_cast<uint64_t>(currencyIds[i]) << dateBits) | dateKey : dateKey;
+    }
+    radixSortPermutation(keys, order);
+    if (!dateShift)
+    {
+        return;
+    }
+
+    // rows of one coarse date are ordered by exact date
+    for (size_t runBegin = 0; runBegin < count; )
+    {
+        size_t runEnd = runBegin + 1;
+        while (runEnd < count && keys[order[runEnd]] == keys[order[runBegin]])
+        {
+            ++ runEnd;
+        }
+        if (runEnd - runBegin > 1)
+        {
+            std::stable_sort(order.begin() + runBegin, order.begin() + runEnd,
+                [&dates] (uint32_t l, uint32_t r) { return dates[l] < dates[r]; });
+        }
+        runBegin = runEnd;
+    }
+}
+
+void convertTotals(
+    double* toTotals,
+    const double* fromTotals,
+    const double* fromRates,
+    const double* toRates,
+    const size_t count)
+{
+    size_t i = 0;
+#ifdef __SSE2__
+    // the same IEEE operations in the same order as scalar loop
+    for (; i + 2 <= count; i += 2)
+    {
+        __m128d total = _mm_loadu_pd(fromTotals + i);
+        total = _mm_div_pd(total, _mm_loadu_pd(fromRates + i));
+        total = _mm_mul_pd(total, _mm_loadu_pd(toRates + i));
+        _mm_storeu_pd(toTotals + i, total);
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        toTotals[i] = fromTotals[i] / fromRates[i] * toRates[i];
+    }
+}
+
+// rates of rows that are sorted by date. trend is walked instead of searched for each row
+static void findSortedRates(
+    const POSTransactionManager::RateTrend* rateTrend,
+    const uint32_t* rows,
+    const size_t count,
+    const std::vector<time_t>& dates,
+    std::vector<double>& rates,
+    std::vector<Result>& results)
+{
+    if (!rateTrend)
+    {
+        for (size_t j = 0; j < count; ++j)
+        {
+            if (Result::SUCCESS == results[rows[j]])
+            {
+                results[rows[j]] = Result::NO_CURRENCY;
+            }
+        }
+        return;
+    }
+
+    auto rateIt = rateTrend->upper_bound(dates[rows[0]]);
+    for (size_t j = 0; j < count; ++j)
+    {
+        const size_t row = rows[j];
+        while (rateTrend->end() != rateIt && rateIt->first <= dates[row])
+        {
+            ++ rateIt;
+        }
+        if (Result::SUCCESS != results[row])
+        {
+            continue;
+        }
+        if (rateTrend->begin() == rateIt || std::prev(rateIt)->second <= 0)
+        {
+            results[row] = Result::NO_RATE;
+            continue;
+        }
+        rates[row] = std::prev(rateIt)->second;
+    }
+}
+
+Result POSTransactionManager::findBatchRates(
+    std::vector<double>& fromRates,
+    std::vector<double>& toRates,
+    std::vector<Result>& results,
+    const POSTransactionBatch& fromBatch,
+    const std::string& toCurrency) const
+{
+    const size_t count = fromBatch.size();
+    const std::vector<uint32_t>& currencyIds = fromBatch.getCurrencyIds();
+    const std::vector<time_t>& dates = fromBatch.getDates();
+    const std::vector<std::string>& currencies = fromBatch.getCurrencies();
+
+    results.assign(count, Result::SUCCESS);
+    fromRates.assign(count, 1.);
+    toRates.assign(count, 1.);
+
+    // order rows by currency and date. rows of one currency go together
+    // and trend is walked in date order
+    std::vector<uint32_t> rows;
+    sortPOSTransactionBatch(fromBatch, rows);
+
+    // one lock per currency. trends are walked in date order
+    LockTracer* lockTracer = m_lockTracer.load(std::memory_order_acquire);
+    for (size_t groupBegin = 0; groupBegin < count; )
+    {
+        const uint32_t id = currencyIds[rows[groupBegin]];
+        size_t groupEnd = groupBegin + 1;
+        while (groupEnd < count && currencyIds[rows[groupEnd]] == id)
+        {
+            ++ groupEnd;
+        }
+        const std::string& currency = currencies[id];
+        if (currency == toCurrency)
+        {
+            // the same currency. rates stay 1
+            groupBegin = groupEnd;
+            continue;
+        }
+
+        TracedLock<std::mutex> l(m_currencyTrendMapGuard, lockTracer, LockSite::CONVERT_FROM);
+        // trends are walked, so rate logs are merged first
+        if (currency != m_baseCurrency)
+        {
+            auto currencyIt = m_currencyTrendMap.find(currency);
+            if (m_currencyTrendMap.end() != currencyIt)
+            {
+                mergeRateLogUnsafe(currencyIt->second);
+            }
+            findSortedRates(m_currencyTrendMap.end() == currencyIt ? nullptr : &currencyIt->second,
+                rows.data() + groupBegin, groupEnd - groupBegin, dates, fromRates, results);
+        }
+        if (toCurrency != m_baseCurrency)
+        {
+            auto currencyIt = m_currencyTrendMap.find(toCurrency);
+            if (m_currencyTrendMap.end() != currencyIt)
+            {
+                mergeRateLogUnsafe(currencyIt->second);
+            }
+            findSortedRates(m_currencyTrendMap.end() == currencyIt ? nullptr : &currencyIt->second,
+                rows.data() + groupBegin, groupEnd - groupBegin, dates, toRates, results);
+        }
+        groupBegin = groupEnd;
+    }
+
+    // failed rows get NaN rate
+    Result res = Result::SUCCESS;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (Result::SUCCESS != results[i])
+        {
+            fromRates[i] = std::numeric_limits<double>::quiet_NaN();
+            if (Result::SUCCESS == res)
+            {
+                res = results[i];
+            }
+        }
+    }
+    return res;
+}
+
+Result POSTransactionManager::convertPOSTransactionBatch(
+    POSTransactionBatch& toBatch,
+    std::vector<Result>& results,
+    const POSTransactionBatch& fromBatch,
+    const std::string& toCurrency) const
+{
+    if (WorkloadRecorder* workloadRecorder = m_workloadRecorder.load(std::memory_order_acquire))
+    {
+        workloadRecorder->recordConvertBatch(fromBatch, toCurrency);
+    }
+
+    const size_t count = fromBatch.size();
+    std::vector<double> fromRates;
+    std::vector<double> toRates;
+    const Result res = findBatchRates(fromRates, toRates, results, fromBatch, toCurrency);
+
+    std::vector<double> toTotals(count);
+    convertTotals(toTotals.data(), fromBatch.getTotals().data(), fromRates.data(), toRates.data(), count);
+
+    // batches may be the same object
+    std::vector<time_t> toDates(fromBatch.getDates());
+    toBatch.clear();
+    toBatch.reserve(count);
+    const uint32_t toCurrencyId = toBatch.addCurrency(toCurrency);
+    for (size_t i = 0; i < count; ++i)
+    {
+        toBatch.add(toTotals[i], toCurrencyId, toDates[i]);
+    }
+    return res;
+}
+
+Result POSTransactionManager::convertPOSTransactionBatch(
+    std::vector<int64_t>& toAmounts,
+    std::vector<Result>& results,
+    const std::vector<int64_t>& fromAmounts,
+    const POSTransactionBatch& fromBatch,
+    const std::string& toCurrency) const
+{
+    const size_t count = fromBatch.size();
+    if (fromAmounts.size() != count)
+    {
+        return Result::INVALID_FORMAT;
+    }
+    if (WorkloadRecorder* workloadRecorder = m_workloadRecorder.load(std::memory_order_acquire))
+    {
+        workloadRecorder->recordConvertMoneyBatch(fromAmounts, fromBatch, toCurrency);
+    }
+    std::vector<double> fromRates;
+    std::vector<double> toRates;
+    findBatchRates(fromRates, toRates, results, fromBatch, toCurrency);
+
+    // failed rows get rate 0 and invalid amount
+    std::vector<int64_t> fixedFromRates(count, 0);
+    std::vector<int64_t> fixedToRates(count, 0);
+    for (size_t i = 0; i < count; ++i)
+    {
+        Result& r = results[i];
+        r = Result::SUCCESS == r ? toFixedRate(fromRates[i], fixedFromRates[i]) : r;
+        r = Result::SUCCESS == r ? toFixedRate(toRates[i], fixedToRates[i]) : r;
+    }
+
+    toAmounts.resize(count);
+    if (convertAmounts(toAmounts.data(), fromAmounts.data(), fixedFromRates.data(), fixedToRates.data(), count))
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (INVALID_AMOUNT == toAmounts[i] && Result::SUCCESS == results[i])
+            {
+                results[i] = Result::AMOUNT_OVERFLOW;
+            }
+        }
+    }
+    Result res = Result::SUCCESS;
+    for (size_t i = 0; i < count && Result::SUCCESS == res; ++i)
+    {
+        res = results[i];
+    }
+    return res;
+}
+
+} // namespace pos
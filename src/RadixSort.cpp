@@ -0,0 +1,115 @@
+#include <algorithm>
+#include <array>
+#include <numeric>
+#include <thread>
+
+#include <RadixSort.h>
+
+namespace pos
+{
+
+static constexpr size_t RADIX_BITS = 8;
+static constexpr size_t RADIX_SIZE = 1 << RADIX_BITS;
+
+typedef std::array<size_t, RADIX_SIZE> Histogram;
+
+// run func(thread index) for each thread. the last part runs in the calling thread
+template<class Func>
+static void runParallel(const size_t threadsCount, Func func)
+{
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i + 1 < threadsCount; ++i)
+    {
+        threads.emplace_back(func, i);
+    }
+    func(threadsCount - 1);
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+}
+
+void radixSortPermutation(
+    const std::vector<uint64_t>& keys,
+    std::vector<uint32_t>& order,
+    const size_t threadsCount)
+{
+    const size_t count = keys.size();
+    order.resize(count);
+    std::iota(order.begin(), order.end(), 0);
+
+    uint64_t allBits = 0;
+    for (const uint64_t key : keys)
+    {
+        allBits |= key;
+    }
+    if (count < 2 || !allBits)
+    {
+        return;
+    }
+    const size_t passesCount = (64 - __builtin_clzll(allBits) + RADIX_BITS - 1) / RADIX_BITS;
+
+    size_t partsCount = 1;
+    if (count >= RADIX_SORT_PARALLEL_MIN_SIZE)
+    {
+        partsCount = threadsCount ? threadsCount : std::thread::hardware_concurrency();
+        partsCount = std::max<size_t>(1, std::min(partsCount, count / RADIX_SORT_PARALLEL_MIN_SIZE * 4));
+    }
+    const size_t partSize = (count + partsCount - 1) / partsCount;
+
+    // keys are moved with indexes to read them sequentially
+    std::vector<uint64_t> srcKeys(keys);
+    std::vector<uint64_t> dstKeys(count);
+    std::vector<uint32_t> dstOrder(count);
+    std::vector<Histogram> histograms(partsCount);
+
+    for (size_t pass = 0; pass < passesCount; ++pass)
+    {
+        const size_t shift = pass * RADIX_BITS;
+        runParallel(partsCount, [&] (size_t part)
+            {
+                Histogram& histogram = histograms[part];
+                histogram.fill(0);
+                const size_t end = std::min(count, (part + 1) * partSize);
+                for (size_t i = part * partSize; i < end; ++i)
+                {
+                    ++ histogram[(srcKeys[i] >> shift) & (RADIX_SIZE - 1)];
+                }
+            });
+
+        // offsets of each part inside each digit bucket keep sort stable
+        size_t offset = 0;
+        bool sameDigit = false;
+        for (size_t digit = 0; digit < RADIX_SIZE; ++digit)
+        {
+            const size_t digitOffset = offset;
+            for (auto& histogram : histograms)
+            {
+                const size_t digitCount = histogram[digit];
+                histogram[digit] = offset;
+                offset += digitCount;
+            }
+            sameDigit = sameDigit || offset - digitOffset == count;
+        }
+        if (sameDigit)
+        {
+            continue;
+        }
+
+        runParallel(partsCount, [&] (size_t part)
+            {
+                Histogram& positions = histograms[part];
+                const size_t end = std::min(count, (part + 1) * partSize);
+                for (size_t i = part * partSize; i < end; ++i)
+                {
+                    const size_t position = positions[(srcKeys[i] >> shift) & (RADIX_SIZE - 1)]++;
+                    dstKeys[position] = srcKeys[i];
+                    dstOrder[position] = order[i];
+                }
+            });
+        srcKeys.swap(dstKeys);
+        order.swap(dstOrder);
+    }
+}
+
+} // namespace pos
@@ -0,0 +1,267 @@
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+#include <RateExporter.h>
+
+namespace pos
+{
+constexpr size_t RateExporter::BUFFER_SIZE;
+
+size_t formatDouble(char* buf, const double value)
+{
+    // the shortest of precisions that round trip
+    for (int precision = 15; precision < 17; ++precision)
+    {
+        const int size = snprintf(buf, FORMAT_BUFFER_SIZE, "%.*g", precision, value);
+        if (strtod(buf, nullptr) == value)
+        {
+            return size;
+        }
+    }
+    return snprintf(buf, FORMAT_BUFFER_SIZE, "%.17g", value);
+}
+
+static char* formatNumber(char* p, int64_t value, const size_t width)
+{
+    char digits[24];
+    size_t count = 0;
+    const bool negative = value < 0;
+    uint64_t absValue = negative ? -static_cast<uint64_t>(value) : value;
+    do
+    {
+        digits[count++] = '0' + absValue % 10;
+        absValue /= 10;
+    }
+    while (absValue);
+    while (count < width)
+    {
+        digits[count++] = '0';
+    }
+    if (negative)
+    {
+        *p++ = '-';
+    }
+    while (count)
+    {
+        *p++ = digits[--count];
+    }
+    return p;
+}
+
+size_t formatTime(char* buf, const time_t date)
+{
+    // days since epoch to civil date (proleptic Gregorian calendar)
+    int64_t days = date / 86400;
+    int64_t seconds = date % 86400;
+    if (seconds < 0)
+    {
+        seconds += 86400;
+        -- days;
+    }
+    days += 719468;
+    const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    const int64_t dayOfEra = days - era * 146097;
+    const int64_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    const int64_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    const int64_t monthIndex = (5 * dayOfYear + 2) / 153;
+    const int64_t day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+    const int64_t month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+    const int64_t year = yearOfEra + era * 400 + (month <= 2);
+
+    char* p = formatNumber(buf, year, 4);
+    *p++ = '-';
+    p = formatNumber(p, month, 2);
+    *p++ = '-';
+    p = formatNumber(p, day, 2);
+    *p++ = ' ';
+    p = formatNumber(p, seconds / 3600, 2);
+    *p++ = ':';
+    p = formatNumber(p, seconds / 60 % 60, 2);
+    *p++ = ':';
+    p = formatNumber(p, seconds % 60, 2);
+    *p = '\0';
+    return p - buf;
+}
+
+RateExporter::RateExporter(const ExportFormat format, const int fd):
+    m_format(format),
+    m_fd(fd)
+{
+    m_buffer.reserve(BUFFER_SIZE);
+}
+
+RateExporter::RateExporter(const ExportFormat format):
+    m_format(format),
+    m_fd(-1)
+{}
+
+void RateExporter::flush()
+{
+    if (m_fd < 0)
+    {
+        return;
+    }
+    const char* data = m_buffer.data();
+    size_t size = m_buffer.size();
+    while (size && !m_failed)
+    {
+        const ssize_t written = write(m_fd, data, size);
+        if (written < 0)
+        {
+            m_failed = EINTR != errno;
+            continue;
+        }
+        data += written;
+        size -= written;
+    }
+    m_buffer.clear();
+}
+
+void RateExporter::append(const char* data, const size_t size)
+{
+    m_buffer.append(data, size);
+    if (m_buffer.size() >= BUFFER_SIZE)
+    {
+        flush();
+    }
+}
+
+void RateExporter::appendString(const std::string& str)
+{
+    if (ExportFormat::CSV == m_format)
+    {
+        if (str.find_first_of(",\"\r\n") == std::string::npos)
+        {
+            append(str.data(), str.size());
+            return;
+        }
+        append("\"", 1);
+        for (const char c : str)
+        {
+            append(&c, 1);
+            if ('"' == c)
+            {
+                append(&c, 1);
+            }
+        }
+        append("\"", 1);
+        return;
+    }
+
+    append("\"", 1);
+    for (const char c : str)
+    {
+        if ('"' == c || '\\' == c)
+        {
+            const char escaped[2] = { '\\', c };
+            append(escaped, sizeof(escaped));
+        }
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+            char escaped[8];
+            append(escaped, snprintf(escaped, sizeof(escaped), "\\u%04x", c));
+        }
+        else
+        {
+            append(&c, 1);
+        }
+    }
+    append("\"", 1);
+}
+
+void RateExporter::appendRate(const time_t date, const double rate)
+{
+    char buf[FORMAT_BUFFER_SIZE];
+    if (ExportFormat::JSON == m_format)
+    {
+        append("[\"", 2);
+        append(buf, formatTime(buf, date));
+        append("\",", 2);
+        if (rate > 0)
+        {
+            append(buf, formatDouble(buf, rate));
+        }
+        else
+        {
+            append("null", 4);
+        }
+        append("]", 1);
+        return;
+    }
+    append(buf, formatTime(buf, date));
+    append(",", 1);
+    if (rate > 0)
+    {
+        append(buf, formatDouble(buf, rate));
+    }
+    append("\n", 1);
+}
+
+Result RateExporter::exportRates(const POSTransactionManager& manager)
+{
+    m_failed = false;
+    // buffer keeps output of the last export only
+    if (m_fd < 0)
+    {
+        m_buffer.clear();
+    }
+    if (ExportFormat::CSV == m_format)
+    {
+        append("currency,date,rate\n", 19);
+    }
+    else
+    {
+        append("{\"base\":", 8);
+        appendString(manager.getBaseCurrency());
+        append(",\"rates\":{", 10);
+    }
+
+    POSTransactionManager::RateTrend rateTrend;
+    bool firstCurrency = true;
+    for (const auto& currency : manager.getCurrencies())
+    {
+        // currency cannot be removed
+        manager.getExchangeRates(currency, rateTrend);
+        if (ExportFormat::CSV == m_format)
+        {
+            for (const auto& rate : rateTrend)
+            {
+                appendString(currency);
+                append(",", 1);
+                appendRate(rate.first, rate.second);
+            }
+            continue;
+        }
+
+        if (!firstCurrency)
+        {
+            append(",", 1);
+        }
+        firstCurrency = false;
+        appendString(currency);
+        append(":[", 2);
+        bool firstRate = true;
+        for (const auto& rate : rateTrend)
+        {
+            if (!firstRate)
+            {
+                append(",", 1);
+            }
+            firstRate = false;
+            appendRate(rate.first, rate.second);
+        }
+        append("]", 1);
+    }
+
+    if (ExportFormat::JSON == m_format)
+    {
+        append("}}\n", 3);
+    }
+    flush();
+    return m_failed ? Result::IO_ERROR : Result::SUCCESS;
+}
+
+} // namespace pos
@@ -0,0 +1,360 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include <RateImporter.h>
+
+namespace pos
+{
+
+static const char* parseNumber(const char* p, const char* end, const size_t width, int64_t& value)
+{
+    if (static_cast<size_t>(end - p) < width)
+    {
+        return nullptr;
+    }
+    value = 0;
+    for (size_t i = 0; i < width; ++i, ++p)
+    {
+        if (*p < '0' || *p > '9')
+        {
+            return nullptr;
+        }
+        value = value * 10 + (*p - '0');
+    }
+    return p;
+}
+
+static const char* parseSeparator(const char* p, const char* end, const char separator)
+{
+    return p && p < end && *p == separator ? p + 1 : nullptr;
+}
+
+const char* parseTime(const char* p, const char* end, time_t& date)
+{
+    const bool negative = p < end && '-' == *p;
+    if (negative)
+    {
+        ++ p;
+    }
+    // year has at least 4 digits
+    int64_t year;
+    p = parseNumber(p, end, 4, year);
+    while (p && p < end && *p >= '0' && *p <= '9' && year < 100000000)
+    {
+        year = year * 10 + (*p++ - '0');
+    }
+    int64_t month;
+    int64_t day;
+    int64_t hours;
+    int64_t minutes;
+    int64_t seconds;
+    p = parseSeparator(p, end, '-');
+    p = p ? parseNumber(p, end, 2, month) : nullptr;
+    p = parseSeparator(p, end, '-');
+    p = p ? parseNumber(p, end, 2, day) : nullptr;
+    p = parseSeparator(p, end, ' ');
+    p = p ? parseNumber(p, end, 2, hours) : nullptr;
+    p = parseSeparator(p, end, ':');
+    p = p ? parseNumber(p, end, 2, minutes) : nullptr;
+    p = parseSeparator(p, end, ':');
+    p = p ? parseNumber(p, end, 2, seconds) : nullptr;
+    if (!p)
+    {
+        return nullptr;
+    }
+    if (negative)
+    {
+        year = -year;
+    }
+
+    static const int64_t DAYS_IN_MONTH[] = { 31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    const bool leap = (0 == year % 4 && 0 != year % 100) || 0 == year % 400;
+    if (month < 1 || month > 12 || day < 1 || day > DAYS_IN_MONTH[month - 1] ||
+        (2 == month && 29 == day && !leap) || hours > 23 || minutes > 59 || seconds > 59)
+    {
+        return nullptr;
+    }
+
+    // civil date to days since epoch (inverse of formatTime)
+    const int64_t y = month <= 2 ? year - 1 : year;
+    const int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const int64_t yearOfEra = y - era * 400;
+    const int64_t dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    const int64_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    const int64_t days = era * 146097 + dayOfEra - 719468;
+    date = days * 86400 + hours * 3600 + minutes * 60 + seconds;
+    return p;
+}
+
+static bool readFile(const std::string& fileName, std::string& data)
+{
+    FILE* file = fopen(fileName.c_str(), "rb");
+    if (!file)
+    {
+        return false;
+    }
+    data.clear();
+    char buf[64 * 1024];
+    size_t size;
+    while ((size = fread(buf, 1, sizeof(buf), file)) > 0)
+    {
+        data.append(buf, size);
+    }
+    const bool failed = ferror(file) != 0;
+    fclose(file);
+    return !failed;
+}
+
+// currency field (quoted if it has separators). returns pointer after field or nullptr
+static const char* parseCurrency(const char* p, const char* end, std::string& currency)
+{
+    currency.clear();
+    if (p < end && '"' == *p)
+    {
+        for (++p; p < end; ++p)
+        {
+            if ('"' == *p)
+            {
+                if (p + 1 < end && '"' == p[1])
+                {
+                    ++ p;
+                }
+                else
+                {
+                    return p + 1;
+                }
+            }
+            currency.push_back(*p);
+        }
+        return nullptr;
+    }
+    const char* fieldEnd = static_cast<const char*>(memchr(p, ',', end - p));
+    if (!fieldEnd)
+    {
+        return nullptr;
+    }
+    currency.assign(p, fieldEnd);
+    return fieldEnd;
+}
+
+Result RateImporter::parseFile(
+    const std::string& fileName,
+    const std::string& baseCurrency,
+    CurrencyPoints& currencyPoints,
+    std::string& errorLocation)
+{
+    std::string data;
+    if (!readFile(fileName, data))
+    {
+        errorLocation = fileName + ":0";
+        return Result::IO_ERROR;
+    }
+
+    static const char HEADER[] = "currency,date,rate";
+    std::string currency;
+    std::string lastCurrency;
+    std::vector<Point>* points = nullptr;
+    size_t lineNumber = 0;
+    // data is null terminated, so strtod stops at the end
+    const char* p = data.c_str();
+    const char* dataEnd = p + data.size();
+    while (p < dataEnd)
+    {
+        ++ lineNumber;
+        const size_t recordLineNumber = lineNumber;
+        // quoted currency may hold line breaks, so record ends at the first one after it
+        const char* currencyEnd = nullptr;
+        if ('"' == *p)
+        {
+            currencyEnd = parseCurrency(p, dataEnd, currency);
+            lineNumber += currencyEnd ? std::count(p, currencyEnd, '\n') : 0;
+        }
+        const char* recordEnd = currencyEnd ? currencyEnd : p;
+        const char* lineEnd = static_cast<const char*>(memchr(recordEnd, '\n', dataEnd - recordEnd));
+        const char* nextLine = lineEnd ? lineEnd + 1 : dataEnd;
+        lineEnd = lineEnd ? lineEnd : dataEnd;
+        if (lineEnd > recordEnd && '\r' == lineEnd[-1])
+        {
+            -- lineEnd;
+        }
+        const char* q = p;
+        p = nextLine;
+        if (q == lineEnd ||
+            (1 == recordLineNumber && static_cast<size_t>(lineEnd - q) == sizeof(HEADER) - 1 &&
+            !memcmp(q, HEADER, sizeof(HEADER) - 1)))
+        {
+            continue;
+        }
+
+        Point point;
+        q = currencyEnd ? currencyEnd : parseCurrency(q, lineEnd, currency);
+        q = parseSeparator(q, lineEnd, ',');
+        q = q ? parseTime(q, lineEnd, point.m_date) : nullptr;
+        q = parseSeparator(q, lineEnd, ',');
+        Result r = q && !currency.empty() ? Result::SUCCESS : Result::INVALID_FORMAT;
+        if (Result::SUCCESS == r)
+        {
+            point.m_rate = -1;
+            if (q != lineEnd)
+            {
+                char* rateEnd;
+                point.m_rate = strtod(q, &rateEnd);
+                if (rateEnd != lineEnd || !std::isfinite(point.m_rate) || point.m_rate <= 0)
+                {
+                    r = Result::INVALID_FORMAT;
+                }
+            }
+        }
+        if (Result::SUCCESS == r && currency == baseCurrency)
+        {
+            r = Result::CURRENCY_NOT_MATCH;
+        }
+        if (Result::SUCCESS != r)
+        {
+            errorLocation = fileName + ":" + std::to_string(recordLineNumber);
+            return r;
+        }
+
+        // files usually hold one currency
+        if (!points || currency != lastCurrency)
+        {
+            points = &currencyPoints[currency];
+            lastCurrency = currency;
+        }
+        points->push_back(point);
+    }
+    return Result::SUCCESS;
+}
+
+RateImporter::RateImporter(const size_t threadsCount):
+    m_threadsCount(threadsCount ? threadsCount : std::max(1u, std::thread::hardware_concurrency()))
+{}
+
+// call f from threads until it returns false
+template<class F>
+static void runParallel(const size_t threadsCount, F&& f)
+{
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < threadsCount; ++i)
+    {
+        threads.emplace_back([&f]()
+        {
+            while (f())
+            {
+            }
+        });
+    }
+    while (f())
+    {
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+}
+
+Result RateImporter::importRates(POSTransactionManager& manager, const std::vector<std::string>& fileNames)
+{
+    m_errorLocation.clear();
+    m_pointsCount = 0;
+    m_currenciesCount = 0;
+
+    // parse files
+    const size_t filesCount = fileNames.size();
+    std::vector<CurrencyPoints> filePoints(filesCount);
+    std::vector<Result> results(filesCount, Result::SUCCESS);
+    std::vector<std::string> errorLocations(filesCount);
+    std::atomic<size_t> nextFile(0);
+    runParallel(std::min(m_threadsCount, filesCount), [&]()
+    {
+        const size_t i = nextFile++;
+        if (i >= filesCount)
+        {
+            return false;
+        }
+        results[i] = parseFile(fileNames[i], manager.getBaseCurrency(), filePoints[i], errorLocations[i]);
+        return true;
+    });
+    for (size_t i = 0; i < filesCount; ++i)
+    {
+        if (Result::SUCCESS != results[i])
+        {
+            m_errorLocation = errorLocations[i];
+            return results[i];
+        }
+    }
+
+    // points of currency in file order
+    struct CurrencyImport
+    {
+        std::string m_currency;
+        std::vector<std::vector<Point>*> m_points;
+        POSTransactionManager::RateTrend m_rateTrend;
+    };
+    std::vector<CurrencyImport> imports;
+    std::unordered_map<std::string, size_t> importIndexes;
+    for (auto& currencyPoints : filePoints)
+    {
+        for (auto& points : currencyPoints)
+        {
+            auto res = importIndexes.emplace(points.first, imports.size());
+            if (res.second)
+            {
+                imports.emplace_back();
+                imports.back().m_currency = points.first;
+            }
+            imports[res.first->second].m_points.push_back(&points.second);
+        }
+    }
+
+    // build trends
+    std::atomic<size_t> nextImport(0);
+    runParallel(std::min(m_threadsCount, imports.size()), [&]()
+    {
+        const size_t i = nextImport++;
+        if (i >= imports.size())
+        {
+            return false;
+        }
+        CurrencyImport& currencyImport = imports[i];
+        std::vector<Point> points;
+        points.swap(*currencyImport.m_points[0]);
+        for (size_t j = 1; j < currencyImport.m_points.size(); ++j)
+        {
+            points.insert(points.end(), currencyImport.m_points[j]->begin(), currencyImport.m_points[j]->end());
+            std::vector<Point>().swap(*currencyImport.m_points[j]);
+        }
+        auto dateLess = [](const Point& point1, const Point& point2) { return point1.m_date < point2.m_date; };
+        if (!std::is_sorted(points.begin(), points.end(), dateLess))
+        {
+            // stable, so the later point of date is the last one
+            std::stable_sort(points.begin(), points.end(), dateLess);
+        }
+        POSTransactionManager::RateTrend& rateTrend = currencyImport.m_rateTrend;
+        for (size_t j = 0; j < points.size(); ++j)
+        {
+            if (j + 1 < points.size() && points[j + 1].m_date == points[j].m_date)
+            {
+                continue;
+            }
+            rateTrend.emplace_hint(rateTrend.end(), points[j].m_date, points[j].m_rate);
+        }
+        return true;
+    });
+
+    // one swap per currency. replaced trends are released with imports
+    for (auto& currencyImport : imports)
+    {
+        m_pointsCount += currencyImport.m_rateTrend.size();
+        manager.replaceExchangeRates(currencyImport.m_currency, currencyImport.m_rateTrend);
+    }
+    m_currenciesCount = imports.size();
+    return Result::SUCCESS;
+}
+
+} // namespace pos
@@ -0,0 +1,128 @@
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <RateSegment.h>
+
+namespace pos
+{
+static const char SEGMENT_MAGIC[8] = { 'P', 'O', 'S', 'S', 'E', 'G', '1', '\0' };
+
+RateSegment::~RateSegment()
+{
+    close();
+}
+
+Result RateSegment::write(
+    const std::string& fileName,
+    const POSTransactionManager::RateTrend& rateTrend,
+    const time_t fromDate,
+    const time_t toDate)
+{
+    // existing file is not overwritten
+    int fd = ::open(fileName.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+    if (fd < 0)
+    {
+        return Result::IO_ERROR;
+    }
+    FILE* file = fdopen(fd, "wb");
+    if (!file)
+    {
+        ::close(fd);
+        unlink(fileName.c_str());
+        return Result::IO_ERROR;
+    }
+
+    Header header;
+    memcpy(header.m_magic, SEGMENT_MAGIC, sizeof(header.m_magic));
+    header.m_fromDate = fromDate;
+    header.m_toDate = toDate;
+    header.m_count = rateTrend.size();
+    bool failed = fwrite(&header, sizeof(header), 1, file) != 1;
+    for (auto rateIt = rateTrend.begin(); !failed && rateTrend.end() != rateIt; ++rateIt)
+    {
+        Point point = { rateIt->first, rateIt->second };
+        failed = fwrite(&point, sizeof(point), 1, file) != 1;
+    }
+
+    if (fclose(file) != 0 || failed)
+    {
+        // partially written segment is removed
+        unlink(fileName.c_str());
+        return Result::IO_ERROR;
+    }
+    return Result::SUCCESS;
+}
+
+Result RateSegment::open(const std::string& fileName)
+{
+    close();
+
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return Result::IO_ERROR;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header))
+    {
+        ::close(fd);
+        return Result::IO_ERROR;
+    }
+    void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (MAP_FAILED == data)
+    {
+        return Result::IO_ERROR;
+    }
+
+    const Header* header = static_cast<const Header*>(data);
+    if (memcmp(header->m_magic, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC)) != 0 ||
+        static_cast<size_t>(st.st_size) != sizeof(Header) + header->m_count * sizeof(Point))
+    {
+        munmap(data, st.st_size);
+        return Result::IO_ERROR;
+    }
+
+    m_data = data;
+    m_size = st.st_size;
+    m_header = header;
+    m_points = reinterpret_cast<const Point*>(header + 1);
+    return Result::SUCCESS;
+}
+
+void RateSegment::close()
+{
+    if (m_data)
+    {
+        munmap(m_data, m_size);
+    }
+    m_data = nullptr;
+    m_size = 0;
+    m_header = nullptr;
+    m_points = nullptr;
+}
+
+Result RateSegment::findRate(const time_t date, double& rate) const
+{
+    const Point* end = m_points + size();
+    const Point* pointIt = std::upper_bound(m_points, end, date,
+        [] (const time_t date, const Point& point) { return date < point.m_date; });
+    if (m_points == pointIt)
+    {
+        return Result::NO_RATE;
+    }
+    rate = std::prev(pointIt)->m_rate;
+    if (rate <= 0)
+    {
+        return Result::NO_RATE;
+    }
+    return Result::SUCCESS;
+}
+
+} // namespace pos
@@ -0,0 +1,257 @@
+#include <algorithm>
+#include <iterator>
+#include <limits>
+
+#include <RateSubscriptions.h>
+
+namespace pos
+{
+
+RateSubscriptions::RateSubscriptions(POSTransactionManager& manager):
+    m_manager(manager)
+{
+    m_notifier = std::thread(&RateSubscriptions::run, this);
+    m_manager.addRateChangeListener(this);
+}
+
+RateSubscriptions::~RateSubscriptions()
+{
+    // waits for notifications in progress
+    m_manager.removeRateChangeListener(this);
+    {
+        std::unique_lock<std::mutex> l(m_guard);
+        m_stopped = true;
+    }
+    m_notifierCv.notify_one();
+    m_notifier.join();
+}
+
+void RateSubscriptions::addInterval(Intervals& intervals, time_t fromDate, time_t toDate)
+{
+    // merge overlapping and adjacent intervals
+    auto it = intervals.upper_bound(fromDate);
+    if (it != intervals.begin() && std::prev(it)->second >= fromDate)
+    {
+        -- it;
+        fromDate = it->first;
+    }
+    while (it != intervals.end() && it->first <= toDate)
+    {
+        toDate = std::max(toDate, it->second);
+        it = intervals.erase(it);
+    }
+    intervals.emplace_hint(it, fromDate, toDate);
+}
+
+void RateSubscriptions::enqueueUnsafe(
+    Subscription& subscription,
+    const std::string& currency,
+    time_t fromDate,
+    time_t toDate)
+{
+    Intervals& intervals = subscription.m_queues[currency];
+    auto next = intervals.upper_bound(toDate);
+    const bool overlaps = next != intervals.begin() && std::prev(next)->second >= fromDate;
+    if (!overlaps && intervals.size() >= subscription.m_queueLimit)
+    {
+        switch (subscription.m_policy)
+        {
+        case OverflowPolicy::WIDEN:
+        {
+            // interval takes the nearest neighbour
+            auto prev = next != intervals.begin() ? std::prev(next) : intervals.end();
+            if (intervals.end() == next ||
+                (intervals.end() != prev && static_cast<uint64_t>(fromDate) - prev->second <=
+                static_cast<uint64_t>(next->first) - toDate))
+            {
+                fromDate = prev->first;
+            }
+            else
+            {
+                toDate = next->second;
+            }
+            break;
+        }
+        case OverflowPolicy::RESYNC:
+            intervals.clear();
+            fromDate = std::numeric_limits<time_t>::min();
+            toDate = std::numeric_limits<time_t>::max();
+            break;
+        case OverflowPolicy::DROP_NEWEST:
+            ++ subscription.m_droppedCount;
+            return;
+        }
+    }
+    addInterval(intervals, fromDate, toDate);
+    if (!subscription.m_ready)
+    {
+        subscription.m_ready = true;
+        m_ready.push_back(&subscription);
+    }
+}
+
+void RateSubscriptions::run()
+{
+    std::vector<RateChange> changes;
+    std::unique_lock<std::mutex> l(m_guard);
+    while (true)
+    {
+        m_notifierCv.wait(l, [this] () { return m_stopped || !m_ready.empty(); });
+        if (m_ready.empty())
+        {
+            break;
+        }
+
+        // subscribers are served in turn, one batch at a time
+        Subscription& subscription = *m_ready.front();
+        m_ready.pop_front();
+        subscription.m_ready = false;
+        changes.clear();
+        for (auto& queue : subscription.m_queues)
+        {
+            for (auto& interval : queue.second)
+            {
+                changes.push_back(RateChange{ queue.first, interval.first, interval.second });
+            }
+        }
+        subscription.m_queues.clear();
+        RateSubscriber* subscriber = subscription.m_subscriber;
+        m_deliveringId = subscription.m_id;
+
+        l.unlock();
+        subscriber->onRateChanges(changes);
+        l.lock();
+
+        m_deliveringId = 0;
+        ++ m_batchesCount;
+        m_deliveredCv.notify_all();
+    }
+}
+
+Result RateSubscriptions::subscribe(
+    SubscriptionId& id,
+    RateSubscriber& subscriber,
+    const std::vector<std::string>& currencies,
+    const size_t queueLimit,
+    const OverflowPolicy policy)
+{
+    if (currencies.empty())
+    {
+        return Result::NO_CURRENCY;
+    }
+    for (const std::string& currency : currencies)
+    {
+        if (currency.empty())
+        {
+            return Result::NO_CURRENCY;
+        }
+        if (currency == m_manager.getBaseCurrency())
+        {
+            return Result::CURRENCY_NOT_MATCH;
+        }
+    }
+
+    std::unique_ptr<Subscription> subscription(new Subscription());
+    subscription->m_subscriber = &subscriber;
+    subscription->m_currencies = currencies;
+    std::sort(subscription->m_currencies.begin(), subscription->m_currencies.end());
+    subscription->m_currencies.erase(
+        std::unique(subscription->m_currencies.begin(), subscription->m_currencies.end()),
+        subscription->m_currencies.end());
+    subscription->m_queueLimit = std::max<size_t>(queueLimit, 1);
+    subscription->m_policy = policy;
+
+    std::unique_lock<std::mutex> l(m_guard);
+    subscription->m_id = m_nextId++;
+    id = subscription->m_id;
+    for (const std::string& currency : subscription->m_currencies)
+    {
+        m_currencySubscriptions[currency].push_back(subscription.get());
+    }
+    m_subscriptions.emplace(id, std::move(subscription));
+    return Result::SUCCESS;
+}
+
+void RateSubscriptions::unsubscribe(const SubscriptionId id)
+{
+    std::unique_lock<std::mutex> l(m_guard);
+    auto it = m_subscriptions.find(id);
+    if (m_subscriptions.end() == it)
+    {
+        return;
+    }
+    Subscription* subscription = it->second.get();
+    for (const std::string& currency : subscription->m_currencies)
+    {
+        auto currencyIt = m_currencySubscriptions.find(currency);
+        std::vector<Subscription*>& subscriptions = currencyIt->second;
+        subscriptions.erase(std::remove(subscriptions.begin(), subscriptions.end(), subscription), subscriptions.end());
+        if (subscriptions.empty())
+        {
+            m_currencySubscriptions.erase(currencyIt);
+        }
+    }
+    if (subscription->m_ready)
+    {
+        m_ready.erase(std::find(m_ready.begin(), m_ready.end(), subscription));
+        // flush may wait for dropped queue
+        m_deliveredCv.notify_all();
+    }
+    m_subscriptions.erase(it);
+
+    // subscriber may unsubscribe from notification
+    if (std::this_thread::get_id() != m_notifier.get_id())
+    {
+        m_deliveredCv.wait(l, [this, id] () { return m_deliveringId != id; });
+    }
+}
+
+void RateSubscriptions::flush()
+{
+    // subscriber cannot wait for own delivery
+    if (std::this_thread::get_id() == m_notifier.get_id())
+    {
+        return;
+    }
+    std::unique_lock<std::mutex> l(m_guard);
+    m_deliveredCv.wait(l, [this] () { return m_ready.empty() && !m_deliveringId; });
+}
+
+uint64_t RateSubscriptions::getBatchesCount() const
+{
+    std::unique_lock<std::mutex> l(m_guard);
+    return m_batchesCount;
+}
+
+uint64_t RateSubscriptions::getDroppedCount(const SubscriptionId id) const
+{
+    std::unique_lock<std::mutex> l(m_guard);
+    auto it = m_subscriptions.find(id);
+    return m_subscriptions.end() != it ? it->second->m_droppedCount : 0;
+}
+
+void RateSubscriptions::onRatesChanged(const std::string& currency, const time_t fromDate, const time_t toDate)
+{
+    bool ready;
+    {
+        std::unique_lock<std::mutex> l(m_guard);
+        auto it = m_currencySubscriptions.find(currency);
+        if (m_currencySubscriptions.end() == it)
+        {
+            return;
+        }
+        ready = !m_ready.empty();
+        for (Subscription* subscription : it->second)
+        {
+            enqueueUnsafe(*subscription, currency, fromDate, toDate);
+        }
+        // notifier is busy if there were ready subscriptions
+        ready = !ready && !m_ready.empty();
+    }
+    if (ready)
+    {
+        m_notifierCv.notify_one();
+    }
+}
+
+} // namespace pos
@@ -0,0 +1,69 @@
+#include <RetentionScheduler.h>
+
+namespace pos
+{
+
+RetentionScheduler::RetentionScheduler(
+    POSTransactionManager& manager,
+    const time_t horizon,
+    const std::chrono::milliseconds period,
+    Clock clock):
+    m_manager(manager),
+    m_horizon(horizon),
+    m_period(period),
+    m_clock(clock ? std::move(clock) : Clock([] () { return time(nullptr); }))
+{
+    m_thread = std::thread(&RetentionScheduler::run, this);
+}
+
+RetentionScheduler::~RetentionScheduler()
+{
+    stop();
+}
+
+void RetentionScheduler::stop()
+{
+    // thread is claimed under lock, so concurrent calls do not join it twice
+    std::thread thread;
+    {
+        std::unique_lock<std::mutex> l(m_guard);
+        m_stopped = true;
+        thread.swap(m_thread);
+    }
+    m_cv.notify_all();
+    if (thread.joinable())
+    {
+        thread.join();
+    }
+}
+
+void RetentionScheduler::run()
+{
+    std::unique_lock<std::mutex> l(m_guard);
+    while (!m_stopped)
+    {
+        if (m_cv.wait_for(l, m_period, [this] () { return m_stopped; }))
+        {
+            break;
+        }
+        l.unlock();
+        size_t expiredCount = m_manager.expireExchangeRates(m_clock() - m_horizon);
+        l.lock();
+        ++ m_runsCount;
+        m_expiredCount += expiredCount;
+    }
+}
+
+uint64_t RetentionScheduler::getRunsCount() const
+{
+    std::unique_lock<std::mutex> l(m_guard);
+    return m_runsCount;
+}
+
+uint64_t RetentionScheduler::getExpiredCount() const
+{
+    std::unique_lock<std::mutex> l(m_guard);
+    return m_expiredCount;
+}
+
+} // namespace pos
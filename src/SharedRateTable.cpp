@@ -0,0 +1,459 @@
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <SharedRateTable.h>
+
+namespace pos
+{
+
+static const char SHARED_RATE_TABLE_MAGIC[8] = { 'P', 'O', 'S', 'S', 'H', 'M', '1', '\0' };
+
+struct SharedRateTableHeader
+{
+    char m_magic[8];
+    uint64_t m_capacity;
+    std::atomic<uint64_t> m_version;
+    std::atomic<uint32_t> m_activeBuffer;
+    // seqlock sequence of each buffer
+    std::atomic<uint64_t> m_sequences[2];
+};
+
+static constexpr size_t SHARED_HEADER_SIZE = 64;
+static_assert(sizeof(SharedRateTableHeader) <= SHARED_HEADER_SIZE, "shared header is too big");
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2, "shared atomics shall be lock free");
+
+// buffer layout. offsets are from buffer start, values are 8 byte aligned.
+// currency entries are sorted by name, points are dates array and rates array
+struct SharedBufferHeader
+{
+    uint64_t m_currenciesCount;
+    uint64_t m_baseCurrencyOffset;
+    uint64_t m_baseCurrencySize;
+};
+
+struct SharedCurrencyEntry
+{
+    uint64_t m_nameOffset;
+    uint64_t m_nameSize;
+    uint64_t m_pointsOffset;
+    uint64_t m_pointsCount;
+};
+
+static size_t align8(const size_t size)
+{
+    return (size + 7) & ~static_cast<size_t>(7);
+}
+
+// buffer may be changed during read, so every offset is checked before it is used
+// (result of such read is dropped)
+static bool getBufferString(
+    const uint8_t* buffer,
+    const size_t capacity,
+    const uint64_t offset,
+    const uint64_t size,
+    const char*& str)
+{
+    if (offset > capacity || size > capacity - offset)
+    {
+        return false;
+    }
+    str = reinterpret_cast<const char*>(buffer + offset);
+    return true;
+}
+
+static bool isBaseCurrency(const uint8_t* buffer, const size_t capacity, const std::string& currency)
+{
+    const SharedBufferHeader* header = reinterpret_cast<const SharedBufferHeader*>(buffer);
+    const char* base;
+    return getBufferString(buffer, capacity, header->m_baseCurrencyOffset, header->m_baseCurrencySize, base) &&
+        header->m_baseCurrencySize == currency.size() &&
+        !memcmp(base, currency.data(), currency.size());
+}
+
+static Result findBufferRate(
+    const uint8_t* buffer,
+    const size_t capacity,
+    const std::string& currency,
+    const time_t date,
+    double& rate)
+{
+    const SharedBufferHeader* header = reinterpret_cast<const SharedBufferHeader*>(buffer);
+    const uint64_t count = header->m_currenciesCount;
+    if (count > (capacity - sizeof(SharedBufferHeader)) / sizeof(SharedCurrencyEntry))
+    {
+        return Result::NO_CURRENCY;
+    }
+    const SharedCurrencyEntry* entries =
+        reinterpret_cast<const SharedCurrencyEntry*>(buffer + sizeof(SharedBufferHeader));
+
+    size_t first = 0;
+    size_t last = count;
+    while (first < last)
+    {
+        const size_t middle = first + (last - first) / 2;
+        const SharedCurrencyEntry& entry = entries[middle];
+        const char* name;
+        if (!getBufferString(buffer, capacity, entry.m_nameOffset, entry.m_nameSize, name))
+        {
+            return Result::NO_CURRENCY;
+        }
+        // the same order as of std::string
+        const size_t size = std::min<size_t>(entry.m_nameSize, currency.size());
+        int cmp = memcmp(name, currency.data(), size);
+        if (!cmp)
+        {
+            cmp = entry.m_nameSize < currency.size() ? -1 : (entry.m_nameSize > currency.size() ? 1 : 0);
+        }
+        if (cmp < 0)
+        {
+            first = middle + 1;
+            continue;
+        }
+        if (cmp > 0)
+        {
+            last = middle;
+            continue;
+        }
+
+        const uint64_t pointsCount = entry.m_pointsCount;
+        if (entry.m_pointsOffset > capacity ||
+            pointsCount > (capacity - entry.m_pointsOffset) / (sizeof(time_t) + sizeof(double)))
+        {
+            return Result::NO_CURRENCY;
+        }
+        const time_t* dates = reinterpret_cast<const time_t*>(buffer + entry.m_pointsOffset);
+        const double* rates = reinterpret_cast<const double*>(dates + pointsCount);
+        const size_t index = std::upper_bound(dates, dates + pointsCount, date) - dates;
+        if (!index || rates[index - 1] <= 0)
+        {
+            return Result::NO_RATE;
+        }
+        rate = rates[index - 1];
+        return Result::SUCCESS;
+    }
+    return Result::NO_CURRENCY;
+}
+
+SharedRateTableWriter::~SharedRateTableWriter()
+{
+    close();
+}
+
+Result SharedRateTableWriter::open(const std::string& name, const size_t capacity)
+{
+    close();
+
+    // segment is created again, so readers of old segment are not broken by new layout
+    shm_unlink(name.c_str());
+    const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0)
+    {
+        return Result::IO_ERROR;
+    }
+    const size_t bufferCapacity = align8(std::max(capacity, sizeof(SharedBufferHeader)));
+    const size_t size = SHARED_HEADER_SIZE + 2 * bufferCapacity;
+    void* data = MAP_FAILED;
+    if (ftruncate(fd, size) == 0)
+    {
+        data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (MAP_FAILED == data)
+    {
+        shm_unlink(name.c_str());
+        return Result::IO_ERROR;
+    }
+
+    // new segment is zero filled: buffer 0 is empty table
+    m_data = static_cast<uint8_t*>(data);
+    m_size = size;
+    m_header = new (m_data) SharedRateTableHeader;
+    m_header->m_capacity = bufferCapacity;
+    m_header->m_version.store(0, std::memory_order_relaxed);
+    m_header->m_activeBuffer.store(0, std::memory_order_relaxed);
+    m_header->m_sequences[0].store(0, std::memory_order_relaxed);
+    m_header->m_sequences[1].store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(m_header->m_magic, SHARED_RATE_TABLE_MAGIC, sizeof(SHARED_RATE_TABLE_MAGIC));
+    return Result::SUCCESS;
+}
+
+void SharedRateTableWriter::close()
+{
+    if (m_data)
+    {
+        munmap(m_data, m_size);
+        m_data = nullptr;
+        m_size = 0;
+        m_header = nullptr;
+    }
+}
+
+Result SharedRateTableWriter::remove(const std::string& name)
+{
+    return shm_unlink(name.c_str()) == 0 ? Result::SUCCESS : Result::IO_ERROR;
+}
+
+Result SharedRateTableWriter::publish(const POSTransactionManager& manager)
+{
+    return publish(manager.getBaseCurrency(), manager.getExchangeRates());
+}
+
+size_t SharedRateTableWriter::getPublishSize(
+    const std::string& baseCurrency,
+    const POSTransactionManager::CurrencyTrendMap& currencyTrendMap)
+{
+    size_t size = sizeof(SharedBufferHeader) +
+        currencyTrendMap.size() * sizeof(SharedCurrencyEntry) +
+        align8(baseCurrency.size());
+    for (const auto& currencyTrend : currencyTrendMap)
+    {
+        size += align8(currencyTrend.first.size()) +
+            currencyTrend.second.size() * (sizeof(time_t) + sizeof(double));
+    }
+    return size;
+}
+
+Result SharedRateTableWriter::publish(
+    const std::string& baseCurrency,
+    const POSTransactionManager::CurrencyTrendMap& currencyTrendMap)
+{
+    if (!m_header || getPublishSize(baseCurrency, currencyTrendMap) > m_header->m_capacity)
+    {
+        return Result::IO_ERROR;
+    }
+
+    typedef POSTransactionManager::CurrencyTrendMap::value_type CurrencyTrend;
+    std::vector<const CurrencyTrend*> currencyTrends;
+    currencyTrends.reserve(currencyTrendMap.size());
+    for (const auto& currencyTrend : currencyTrendMap)
+    {
+        currencyTrends.push_back(&currencyTrend);
+    }
+    std::sort(currencyTrends.begin(), currencyTrends.end(),
+        [](const CurrencyTrend* l, const CurrencyTrend* r) { return l->first < r->first; });
+
+    // readers use active buffer. the other one is rewritten
+    const uint32_t bufferIndex = 1 - m_header->m_activeBuffer.load(std::memory_order_relaxed);
+    std::atomic<uint64_t>& sequence = m_header->m_sequences[bufferIndex];
+    const uint64_t startSequence = sequence.load(std::memory_order_relaxed) + 1;
+    sequence.store(startSequence, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    uint8_t* buffer = m_data + SHARED_HEADER_SIZE + bufferIndex * m_header->m_capacity;
+    SharedBufferHeader* header = reinterpret_cast<SharedBufferHeader*>(buffer);
+    SharedCurrencyEntry* entries = reinterpret_cast<SharedCurrencyEntry*>(buffer + sizeof(SharedBufferHeader));
+    size_t offset = sizeof(SharedBufferHeader) + currencyTrends.size() * sizeof(SharedCurrencyEntry);
+    header->m_currenciesCount = currencyTrends.size();
+    header->m_baseCurrencyOffset = offset;
+    header->m_baseCurrencySize = baseCurrency.size();
+    memcpy(buffer + offset, baseCurrency.data(), baseCurrency.size());
+    offset += align8(baseCurrency.size());
+
+    for (size_t i = 0; i < currencyTrends.size(); ++i)
+    {
+        const std::string& currency = currencyTrends[i]->first;
+        entries[i].m_nameOffset = offset;
+        entries[i].m_nameSize = currency.size();
+        memcpy(buffer + offset, currency.data(), currency.size());
+        offset += align8(currency.size());
+    }
+    for (size_t i = 0; i < currencyTrends.size(); ++i)
+    {
+        const POSTransactionManager::RateTrend& rateTrend = currencyTrends[i]->second;
+        entries[i].m_pointsOffset = offset;
+        entries[i].m_pointsCount = rateTrend.size();
+        time_t* dates = reinterpret_cast<time_t*>(buffer + offset);
+        double* rates = reinterpret_cast<double*>(dates + rateTrend.size());
+        for (const auto& rate : rateTrend)
+        {
+            *dates++ = rate.first;
+            *rates++ = rate.second;
+        }
+        offset += rateTrend.size() * (sizeof(time_t) + sizeof(double));
+    }
+
+    sequence.store(startSequence + 1, std::memory_order_release);
+    m_header->m_activeBuffer.store(bufferIndex, std::memory_order_release);
+    m_header->m_version.fetch_add(1, std::memory_order_release);
+    return Result::SUCCESS;
+}
+
+uint64_t SharedRateTableWriter::getVersion() const
+{
+    return m_header ? m_header->m_version.load(std::memory_order_acquire) : 0;
+}
+
+SharedRateTableReader::~SharedRateTableReader()
+{
+    close();
+}
+
+Result SharedRateTableReader::open(const std::string& name)
+{
+    close();
+
+    const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+    {
+        return Result::IO_ERROR;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        return Result::IO_ERROR;
+    }
+    const size_t size = static_cast<size_t>(st.st_size);
+    if (size < SHARED_HEADER_SIZE + 2 * sizeof(SharedBufferHeader))
+    {
+        ::close(fd);
+        return Result::INVALID_FORMAT;
+    }
+    void* data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (MAP_FAILED == data)
+    {
+        return Result::IO_ERROR;
+    }
+
+    const SharedRateTableHeader* header = static_cast<const SharedRateTableHeader*>(data);
+    if (memcmp(header->m_magic, SHARED_RATE_TABLE_MAGIC, sizeof(SHARED_RATE_TABLE_MAGIC)) != 0 ||
+        SHARED_HEADER_SIZE + 2 * header->m_capacity != size)
+    {
+        munmap(data, size);
+        return Result::INVALID_FORMAT;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    m_data = static_cast<const uint8_t*>(data);
+    m_size = size;
+    m_header = header;
+    return Result::SUCCESS;
+}
+
+void SharedRateTableReader::close()
+{
+    if (m_data)
+    {
+        munmap(const_cast<uint8_t*>(m_data), m_size);
+        m_data = nullptr;
+        m_size = 0;
+        m_header = nullptr;
+    }
+}
+
+template<class F>
+void SharedRateTableReader::read(F&& f) const
+{
+    // capacity is checked on open
+    const size_t capacity = (m_size - SHARED_HEADER_SIZE) / 2;
+    for (;;)
+    {
+        const uint32_t bufferIndex = m_header->m_activeBuffer.load(std::memory_order_acquire) & 1;
+        const std::atomic<uint64_t>& sequence = m_header->m_sequences[bufferIndex];
+        const uint64_t startSequence = sequence.load(std::memory_order_acquire);
+        if (startSequence & 1)
+        {
+            // buffer is rewritten after two publications. active buffer is already switched
+            continue;
+        }
+        f(m_data + SHARED_HEADER_SIZE + bufferIndex * capacity, capacity);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) == startSequence)
+        {
+            return;
+        }
+    }
+}
+
+std::string SharedRateTableReader::getBaseCurrency() const
+{
+    std::string baseCurrency;
+    if (!m_header)
+    {
+        return baseCurrency;
+    }
+    read([&baseCurrency](const uint8_t* buffer, const size_t capacity)
+    {
+        const SharedBufferHeader* header = reinterpret_cast<const SharedBufferHeader*>(buffer);
+        const char* base;
+        if (getBufferString(buffer, capacity, header->m_baseCurrencyOffset, header->m_baseCurrencySize, base))
+        {
+            baseCurrency.assign(base, header->m_baseCurrencySize);
+        }
+    });
+    return baseCurrency;
+}
+
+uint64_t SharedRateTableReader::getVersion() const
+{
+    return m_header ? m_header->m_version.load(std::memory_order_acquire) : 0;
+}
+
+Result SharedRateTableReader::getExchangeRate(const std::string& currency, const time_t date, double& rate) const
+{
+    if (!m_header)
+    {
+        return Result::NO_CURRENCY;
+    }
+    Result r = Result::SUCCESS;
+    read([&](const uint8_t* buffer, const size_t capacity)
+    {
+        r = findBufferRate(buffer, capacity, currency, date, rate);
+    });
+    return r;
+}
+
+Result SharedRateTableReader::convertPOSTransaction(
+    POSTransaction& toPosTransaction,
+    const POSTransaction& fromPosTransaction,
+    const std::string& toCurrency) const
+{
+    if (fromPosTransaction.m_currency == toCurrency)
+    {
+        toPosTransaction = fromPosTransaction;
+        return Result::SUCCESS;
+    }
+    if (!m_header)
+    {
+        return Result::NO_CURRENCY;
+    }
+
+    // both rates are taken from the same publication
+    Result r = Result::SUCCESS;
+    double fromRate = 1;
+    double toRate = 1;
+    read([&](const uint8_t* buffer, const size_t capacity)
+    {
+        fromRate = 1;
+        toRate = 1;
+        r = Result::SUCCESS;
+        if (!isBaseCurrency(buffer, capacity, fromPosTransaction.m_currency))
+        {
+            r = findBufferRate(buffer, capacity, fromPosTransaction.m_currency, fromPosTransaction.m_date, fromRate);
+        }
+        if (Result::SUCCESS == r && !isBaseCurrency(buffer, capacity, toCurrency))
+        {
+            r = findBufferRate(buffer, capacity, toCurrency, fromPosTransaction.m_date, toRate);
+        }
+    });
+    if (Result::SUCCESS != r)
+    {
+        return r;
+    }
+
+    toPosTransaction.m_currency = toCurrency;
+    toPosTransaction.m_date = fromPosTransaction.m_date;
+    toPosTransaction.m_total = fromPosTransaction.m_total / fromRate * toRate;
+    return Result::SUCCESS;
+}
+
+} // namespace pos
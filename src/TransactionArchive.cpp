@@ -0,0 +1,389 @@
+#include <cstring>
+#include <algorithm>
+
+#include <TransactionArchive.h>
+#include <Encoding.h>
+
+namespace pos
+{
+constexpr size_t TransactionArchiveWriter::BLOCK_ROWS;
+
+const char ARCHIVE_MAGIC[8] = { 'P', 'O', 'S', 'A', 'R', 'C', '1', '\0' };
+
+static void writeDoubles(std::vector<uint8_t>& buf, const double* values, const size_t count)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(values);
+    buf.insert(buf.end(), data, data + count * sizeof(double));
+#else
+    for (size_t i = 0; i < count; ++i)
+    {
+        const uint64_t bits = doubleToBits(values[i]);
+        for (size_t j = 0; j < sizeof(bits); ++j)
+        {
+            buf.push_back(static_cast<uint8_t>(bits >> (j * 8)));
+        }
+    }
+#endif
+}
+
+static void readDoubles(const uint8_t* p, double* values, const size_t count)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    memcpy(values, p, count * sizeof(double));
+#else
+    for (size_t i = 0; i < count; ++i, p += sizeof(uint64_t))
+    {
+        uint64_t bits = 0;
+        for (size_t j = 0; j < sizeof(bits); ++j)
+        {
+            bits |= static_cast<uint64_t>(p[j]) << (j * 8);
+        }
+        values[i] = bitsToDouble(bits);
+    }
+#endif
+}
+
+TransactionArchiveWriter::~TransactionArchiveWriter()
+{
+    close();
+}
+
+Result TransactionArchiveWriter::open(const std::string& fileName)
+{
+    close();
+    m_file = fopen(fileName.c_str(), "wb");
+    if (!m_file)
+    {
+        return Result::IO_ERROR;
+    }
+    m_block.clear();
+    m_rowsCount = 0;
+    m_blocksCount = 0;
+    m_failed = fwrite(ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC), 1, m_file) != 1;
+    return Result::SUCCESS;
+}
+
+Result TransactionArchiveWriter::close()
+{
+    if (!m_file)
+    {
+        return Result::SUCCESS;
+    }
+    flushBlock();
+    bool failed = fclose(m_file) != 0 || m_failed;
+    m_file = nullptr;
+    return failed ? Result::IO_ERROR : Result::SUCCESS;
+}
+
+void TransactionArchiveWriter::write(const POSTransaction& transaction)
+{
+    m_block.add(transaction);
+    ++ m_rowsCount;
+    if (m_block.size() >= BLOCK_ROWS)
+    {
+        flushBlock();
+    }
+}
+
+void TransactionArchiveWriter::write(const POSTransactionBatch& batch)
+{
+    // batch currency id -> block currency id. block dictionary is reset on flush
+    const std::vector<std::string>& currencies = batch.getCurrencies();
+    std::vector<uint32_t> blockIds(currencies.size(), UINT32_MAX);
+    for (size_t i = 0; i < batch.size(); ++i)
+    {
+        const uint32_t id = batch.getCurrencyIds()[i];
+        if (UINT32_MAX == blockIds[id])
+        {
+            blockIds[id] = m_block.addCurrency(currencies[id]);
+        }
+        m_block.add(batch.getTotals()[i], blockIds[id], batch.getDates()[i]);
+        ++ m_rowsCount;
+        if (m_block.size() >= BLOCK_ROWS)
+        {
+            flushBlock();
+            std::fill(blockIds.begin(), blockIds.end(), UINT32_MAX);
+        }
+    }
+}
+
+void TransactionArchiveWriter::flushBlock()
+{
+    if (m_block.empty())
+    {
+        return;
+    }
+    const size_t count = m_block.size();
+    const std::vector<time_t>& dates = m_block.getDates();
+    auto minMax = std::minmax_element(dates.begin(), dates.end());
+
+    m_buffer.clear();
+    writeDoubles(m_buffer, m_block.getTotals().data(), count);
+    const std::vector<std::string>& currencies = m_block.getCurrencies();
+    writeVarint(m_buffer, currencies.size());
+    for (const auto& currency : currencies)
+    {
+        writeVarint(m_buffer, currency.size());
+        m_buffer.insert(m_buffer.end(), currency.begin(), currency.end());
+    }
+    for (const uint32_t id : m_block.getCurrencyIds())
+    {
+        writeVarint(m_buffer, id);
+    }
+    time_t prevDate = 0;
+    for (const time_t date : dates)
+    {
+        // delta wraps around in unsigned arithmetic for far apart dates
+        const uint64_t delta = static_cast<uint64_t>(date) - static_cast<uint64_t>(prevDate);
+        writeVarint(m_buffer, zigzagEncode(static_cast<int64_t>(delta)));
+        prevDate = date;
+    }
+
+    std::vector<uint8_t> header;
+    writeVarint(header, count);
+    writeVarint(header, zigzagEncode(*minMax.first));
+    writeVarint(header, zigzagEncode(*minMax.second));
+    writeVarint(header, m_buffer.size());
+    if (fwrite(header.data(), header.size(), 1, m_file) != 1 ||
+        fwrite(m_buffer.data(), m_buffer.size(), 1, m_file) != 1)
+    {
+        m_failed = true;
+    }
+    m_block.clear();
+    ++ m_blocksCount;
+}
+
+TransactionArchiveReader::~TransactionArchiveReader()
+{
+    close();
+}
+
+Result TransactionArchiveReader::open(const std::string& fileName)
+{
+    close();
+    m_file = fopen(fileName.c_str(), "rb");
+    if (!m_file)
+    {
+        return Result::IO_ERROR;
+    }
+    m_blocksCount = 0;
+    m_skippedBlocksCount = 0;
+    if (fseek(m_file, 0, SEEK_END) != 0)
+    {
+        close();
+        return Result::IO_ERROR;
+    }
+    m_fileSize = ftell(m_file);
+    if (fseek(m_file, 0, SEEK_SET) != 0)
+    {
+        close();
+        return Result::IO_ERROR;
+    }
+    char magic[sizeof(ARCHIVE_MAGIC)];
+    if (fread(magic, sizeof(magic), 1, m_file) != 1 || memcmp(magic, ARCHIVE_MAGIC, sizeof(magic)) != 0)
+    {
+        close();
+        return Result::INVALID_FORMAT;
+    }
+    return Result::SUCCESS;
+}
+
+void TransactionArchiveReader::close()
+{
+    if (m_file)
+    {
+        fclose(m_file);
+        m_file = nullptr;
+    }
+}
+
+void TransactionArchiveReader::setDateRange(const time_t fromDate, const time_t toDate)
+{
+    m_fromDate = fromDate;
+    m_toDate = toDate;
+}
+
+// read varint from file. returns false at the end of file
+static bool readFileVarint(FILE* file, uint64_t& value, bool& failed)
+{
+    uint8_t buf[10];
+    for (size_t i = 0; i < sizeof(buf); ++i)
+    {
+        const int c = fgetc(file);
+        if (EOF == c)
+        {
+            // end of file is valid only before block
+            failed = i != 0;
+            return false;
+        }
+        buf[i] = static_cast<uint8_t>(c);
+        if (!(buf[i] & 0x80))
+        {
+            const uint8_t* p = buf;
+            return readVarint(p, buf + i + 1, value);
+        }
+    }
+    failed = true;
+    return false;
+}
+
+Result TransactionArchiveReader::read(POSTransactionBatch& batch)
+{
+    batch.clear();
+    if (!m_file)
+    {
+        return Result::IO_ERROR;
+    }
+
+    while (true)
+    {
+        uint64_t count, minDate, maxDate, size;
+        bool failed = false;
+        if (!readFileVarint(m_file, count, failed))
+        {
+            if (ferror(m_file))
+            {
+                return Result::IO_ERROR;
+            }
+            return failed ? Result::INVALID_FORMAT : Result::SUCCESS;
+        }
+        if (!readFileVarint(m_file, minDate, failed) ||
+            !readFileVarint(m_file, maxDate, failed) ||
+            !readFileVarint(m_file, size, failed) ||
+            !count || count > TransactionArchiveWriter::BLOCK_ROWS || size / sizeof(double) < count ||
+            size > m_fileSize - ftell(m_file))
+        {
+            return ferror(m_file) ? Result::IO_ERROR : Result::INVALID_FORMAT;
+        }
+        ++ m_blocksCount;
+
+        if (zigzagDecode(maxDate) < m_fromDate || zigzagDecode(minDate) >= m_toDate)
+        {
+            ++ m_skippedBlocksCount;
+            if (fseek(m_file, size, SEEK_CUR) != 0)
+            {
+                return Result::IO_ERROR;
+            }
+            continue;
+        }
+
+        m_buffer.resize(size);
+        if (fread(m_buffer.data(), size, 1, m_file) != 1)
+        {
+            return ferror(m_file) ? Result::IO_ERROR : Result::INVALID_FORMAT;
+        }
+        const uint8_t* p = m_buffer.data();
+        const uint8_t* end = p + size;
+
+        std::vector<double> totals(count);
+        readDoubles(p, totals.data(), count);
+        p += count * sizeof(double);
+
+        uint64_t currenciesCount;
+        if (!readVarint(p, end, currenciesCount) || currenciesCount > static_cast<uint64_t>(end - p))
+        {
+            return Result::INVALID_FORMAT;
+        }
+        for (uint64_t i = 0; i < currenciesCount; ++i)
+        {
+            uint64_t length;
+            if (!readVarint(p, end, length) || static_cast<uint64_t>(end - p) < length)
+            {
+                return Result::INVALID_FORMAT;
+            }
+            batch.addCurrency(std::string(reinterpret_cast<const char*>(p), length));
+            p += length;
+        }
+        if (batch.getCurrencies().size() != currenciesCount)
+        {
+            return Result::INVALID_FORMAT;
+        }
+
+        std::vector<uint32_t> ids(count);
+        for (uint64_t i = 0; i < count; ++i)
+        {
+            uint64_t id;
+            if (!readVarint(p, end, id) || id >= currenciesCount)
+            {
+                return Result::INVALID_FORMAT;
+            }
+            ids[i] = static_cast<uint32_t>(id);
+        }
+
+        batch.reserve(count);
+        time_t date = 0;
+        for (uint64_t i = 0; i < count; ++i)
+        {
+            uint64_t delta;
+            if (!readVarint(p, end, delta))
+            {
+                return Result::INVALID_FORMAT;
+            }
+            date = static_cast<time_t>(static_cast<uint64_t>(date) + static_cast<uint64_t>(zigzagDecode(delta)));
+            if (date >= m_fromDate && date < m_toDate)
+            {
+                batch.add(totals[i], ids[i], date);
+            }
+        }
+        if (p != end)
+        {
+            return Result::INVALID_FORMAT;
+        }
+        if (!batch.empty())
+        {
+            return Result::SUCCESS;
+        }
+        // no rows in range
+        batch.clear();
+    }
+}
+
+Result convertTransactionArchive(
+    const POSTransactionManager& manager,
+    const std::string& fromFileName,
+    const std::string& toFileName,
+    const std::string& toCurrency,
+    const time_t fromDate,
+    const time_t toDate,
+    ArchiveConversionStats& stats)
+{
+    stats = ArchiveConversionStats();
+    TransactionArchiveReader reader;
+    Result r = reader.open(fromFileName);
+    if (Result::SUCCESS != r)
+    {
+        return r;
+    }
+    reader.setDateRange(fromDate, toDate);
+    TransactionArchiveWriter writer;
+    r = writer.open(toFileName);
+    if (Result::SUCCESS != r)
+    {
+        return r;
+    }
+
+    POSTransactionBatch fromBatch;
+    POSTransactionBatch toBatch;
+    std::vector<Result> results;
+    while (true)
+    {
+        r = reader.read(fromBatch);
+        if (Result::SUCCESS != r || fromBatch.empty())
+        {
+            break;
+        }
+        manager.convertPOSTransactionBatch(toBatch, results, fromBatch, toCurrency);
+        stats.m_rowsCount += results.size();
+        stats.m_failedCount += std::count_if(results.begin(), results.end(),
+            [] (Result res) { return Result::SUCCESS != res; });
+        writer.write(toBatch);
+    }
+    stats.m_blocksCount = reader.getBlocksCount();
+    stats.m_skippedBlocksCount = reader.getSkippedBlocksCount();
+
+    Result closeRes = writer.close();
+    return Result::SUCCESS != r ? r : closeRes;
+}
+
+} // namespace pos
@@ -1,3 +1,5 @@
+#include <atomic>
+
 #include <Utils.h>
 
 namespace pos
@@ -18,6 +20,14 @@ const char* resultToStr(const Result r)
             return "No currency found for conversion in manager";
         case Result::NO_RATE:
             return  "No rate found for conversion in manager";
+        case Result::IO_ERROR:
+            return "Input/output error";
+        case Result::INVALID_FORMAT:
+            return "Invalid data format";
+        case Result::PENDING:
+            return "Operation is pending";
+        case Result::AMOUNT_OVERFLOW:
+            return "Amount or rate does not fit fixed-point range";
     }
     return "Unknown";
 }
@@ -36,4 +46,11 @@ std::string timeToString(const time_t t)
     return std::string(buf);
 }
 
+uint32_t getThreadIndex()
+{
+    static std::atomic<uint32_t> threadsCount(0);
+    thread_local uint32_t threadIndex = threadsCount++;
+    return threadIndex;
+}
+
 } // namespace pos
\ No newline at end of file
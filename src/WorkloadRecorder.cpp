@@ -0,0 +1,370 @@
+#include <cstring>
+
+#include <WorkloadRecorder.h>
+#include <POSTransaction.h>
+#include <POSTransactionBatch.h>
+#include <Encoding.h>
+
+namespace pos
+{
+constexpr size_t WorkloadRecorder::BUFFER_SIZE;
+
+const char WORKLOAD_MAGIC[8] = { 'P', 'O', 'S', 'W', 'R', 'K', '1', '\0' };
+
+const char* workloadOperationToStr(const WorkloadOperation operation)
+{
+    switch (operation)
+    {
+        case WorkloadOperation::ADD_RATE:
+            return "add-rate";
+        case WorkloadOperation::ADD_OPEN_RATE:
+            return "add-open-rate";
+        case WorkloadOperation::CONVERT:
+            return "convert";
+        case WorkloadOperation::EXPORT:
+            return "export";
+        case WorkloadOperation::ADD_RATES:
+            return "add-rates";
+        case WorkloadOperation::EXPIRE:
+            return "expire";
+        case WorkloadOperation::REPLACE_RATES:
+            return "replace-rates";
+        case WorkloadOperation::CONVERT_BATCH:
+            return "convert-batch";
+        case WorkloadOperation::CONVERT_MONEY:
+            return "convert-money";
+        case WorkloadOperation::CONVERT_MONEY_BATCH:
+            return "convert-money-batch";
+        case WorkloadOperation::GET_RATE:
+            return "get-rate";
+    }
+    return "unknown";
+}
+
+WorkloadRecorder::~WorkloadRecorder()
+{
+    close();
+}
+
+Result WorkloadRecorder::open(const std::string& fileName, const std::string& baseCurrency)
+{
+    close();
+
+    std::unique_lock<std::mutex> l(m_guard);
+    m_file = fopen(fileName.c_str(), "wb");
+    if (!m_file)
+    {
+        return Result::IO_ERROR;
+    }
+    m_start = Clock::now();
+    m_lastTime = 0;
+    m_currencyIds.clear();
+    m_recordsCount = 0;
+    m_failed = false;
+
+    m_buffer.clear();
+    m_buffer.reserve(BUFFER_SIZE);
+    m_buffer.insert(m_buffer.end(), WORKLOAD_MAGIC, WORKLOAD_MAGIC + sizeof(WORKLOAD_MAGIC));
+    writeVarint(m_buffer, baseCurrency.size());
+    m_buffer.insert(m_buffer.end(), baseCurrency.begin(), baseCurrency.end());
+    return Result::SUCCESS;
+}
+
+Result WorkloadRecorder::close()
+{
+    std::unique_lock<std::mutex> l(m_guard);
+    if (!m_file)
+    {
+        return Result::SUCCESS;
+    }
+    flushUnsafe();
+    bool failed = fclose(m_file) != 0 || m_failed;
+    m_file = nullptr;
+    return failed ? Result::IO_ERROR : Result::SUCCESS;
+}
+
+void WorkloadRecorder::flushUnsafe()
+{
+    if (!m_buffer.empty() && fwrite(m_buffer.data(), m_buffer.size(), 1, m_file) != 1)
+    {
+        m_failed = true;
+    }
+    m_buffer.clear();
+}
+
+void WorkloadRecorder::writeHeaderUnsafe(const WorkloadOperation operation)
+{
+    // time is taken under lock, so records are ordered by time
+    const int64_t time =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - m_start).count();
+    m_buffer.push_back(static_cast<uint8_t>(operation));
+    writeVarint(m_buffer, getThreadIndex());
+    writeVarint(m_buffer, time - m_lastTime);
+    m_lastTime = time;
+    ++ m_recordsCount;
+}
+
+void WorkloadRecorder::writeCurrencyUnsafe(const std::string& currency)
+{
+    auto res = m_currencyIds.emplace(currency, m_currencyIds.size());
+    writeVarint(m_buffer, res.first->second);
+    if (res.second)
+    {
+        writeVarint(m_buffer, currency.size());
+        m_buffer.insert(m_buffer.end(), currency.begin(), currency.end());
+    }
+}
+
+void WorkloadRecorder::writeDoubleUnsafe(const double value)
+{
+    uint64_t bits = doubleToBits(value);
+    for (size_t i = 0; i < sizeof(bits); ++i)
+    {
+        m_buffer.push_back(static_cast<uint8_t>(bits >> (i * 8)));
+    }
+}
+
+void WorkloadRecorder::writeBatchUnsafe(const POSTransactionBatch& batch, const std::vector<int64_t>* amounts)
+{
+    // row is currency, date and total (or amount)
+    const std::vector<std::string>& currencies = batch.getCurrencies();
+    writeVarint(m_buffer, batch.size());
+    for (size_t i = 0; i < batch.size(); ++i)
+    {
+        writeCurrencyUnsafe(currencies[batch.getCurrencyIds()[i]]);
+        writeVarint(m_buffer, zigzagEncode(batch.getDates()[i]));
+        if (amounts)
+        {
+            writeVarint(m_buffer, zigzagEncode((*amounts)[i]));
+        }
+        else
+        {
+            writeDoubleUnsafe(batch.getTotals()[i]);
+        }
+    }
+}
+
+void WorkloadRecorder::recordAddExchangeRate(
+    const std::string& fromCurrency,
+    const std::string& toCurrency,
+    const time_t fromDate,
+    const time_t toDate,
+    const double rate)
+{
+    std::unique_lock<std::mutex> l(m_guard);
+    if (!m_file)
+    {
+        return;
+    }
+    writeHeaderUnsafe(WorkloadOperation::ADD_RATE);
+    writeCurrencyUnsafe(fromCurrency);
+    writeCurrencyUnsafe(toCurrency);
+    writeVarint(m_buffer, zigzagEncode(fromDate));
+    writeVarint(m_buffer, zigzagEncode(toDate - fromDate));
+    writeDoubleUnsafe(rate);
+    if (m_buffer.size() >= BUFFER_SIZE)
+    {
+        flushUnsafe();
+    }
+}
+
+void WorkloadRecorder::recordAddExchangeRate(
+    const std::string& fromCurrency,
+    const std::string& toCurrency,
+    const time_t fromDate,
+    const double rate)
+{
+    std::unique_lock<std::mutex> l(m_guard);
+    if (!m_file)
+    {
+        return;
+    }
+    writeHeaderUnsafe(WorkloadOperation::ADD_OPEN_RATE);
+    writeCurrencyUnsafe(fromCurrency);
+    writeCurrencyUnsafe(toCurrency);
+    writeVarint(m_buffer, zigzagEncode(fromDate));
+    writeDoubleUnsafe(rate);
+    if (m_buffer.size() >= BUFFER_SIZE)
+    {
+        flushUnsafe();
+    }
+}
+
+void WorkloadRecorder::recordConvert(
+    const double total,
+    const std::string& fromCurrency,
+    const time_t date,
+    const std::string& toCurrency)
+{
+    std::unique_lock<std::mutex> l(m_guard);
+    if (!m_file)
+    {
+        return;
+    }
+    writeHeaderUnsafe(WorkloadOperation::CONVERT);
+    writeCurrencyUnsafe(fromCurrency);
+    writeCurrencyUnsafe(toCurrency);
+    writeVarint(m_buffer, zigzagEncode(date));
+    writeDoubleUnsafe(total);
+    if (m_buffer.size() >= BUFFER_SIZE)
+    {
+        flushUnsafe();
+    }
+}
+
+void WorkloadRecorder::recordExport()
+{
+    std::unique_lock<std::mutex> l(m_guard);
+    if (!m_file)
+    {
+        return;
+    }
+    writeHeaderUnsafe(WorkloadOperation::EXPORT);
+    if (m_buffer.size() >= BUFFER_SIZE)
+    {
+        flushUnsafe();
+    }
+}
+
+void WorkloadRecorder::recordAddExchangeRates(const std::vector<RateUpdate>& updates)
+{
+    std::unique_lock<std::mutex> l(m_guard);
+    if (!m_file)
+    {
+        return;
+    }
+    writeHeaderUnsafe(WorkloadOperation::ADD_RATES);
+    writeVarint(m_buffer, updates.size());
+    for (const RateUpdate& update : updates)
+    {
+        // open interval is written as zero length
+        writeCurrencyUnsafe(update.m_currency);
+        writeVarint(m_buffer, zigzagEncode(update.m_fromDate));
+        writeVarint(m_buffer, update.m_toDateSet ? zigzagEncode(update.m_toDate - update.m_fromDate) : 0);
+        writeDoubleUnsafe(update.m_rate);
+    }
+    if (m_buffer.size() >= BUFFER_SIZE)
+    {
+        flushUnsafe();
+    }
+}
+
+void WorkloadRecorder::recordExpire(const time_t cutoff)
+{
+    std::unique_lock<std::mutex> l(m_guard);
+    if (!m_file)
+    {
+        return;
+    }
+    writeHeaderUnsafe(WorkloadOperation::EXPIRE);
+    writeVarint(m_buffer, zigzagEncode(cutoff));
+    if (m_buffer.size() >= BUFFER_SIZE)
+    {
+        flushUnsafe();
+    }
+}
+
+void WorkloadRecorder::recordReplaceExchangeRates(const std::string& currency, const RateTrend& rateTrend)
+{
+    std::unique_lock<std::mutex> l(m_guard);
+    if (!m_file)
+    {
+        return;
+    }
+    writeHeaderUnsafe(WorkloadOperation::REPLACE_RATES);
+    writeCurrencyUnsafe(currency);
+    writeVarint(m_buffer, rateTrend.size());
+    // dates are delta encoded
+    time_t prevDate = 0;
+    for (const auto& point : rateTrend)
+    {
+        writeVarint(m_buffer, zigzagEncode(point.first - prevDate));
+        writeDoubleUnsafe(point.second);
+        prevDate = point.first;
+    }
+    if (m_buffer.size() >= BUFFER_SIZE)
+    {
+        flushUnsafe();
+    }
+}
+
+void WorkloadRecorder::recordConvertBatch(const POSTransactionBatch& batch, const std::string& toCurrency)
+{
+    std::unique_lock<std::mutex> l(m_guard);
+    if (!m_file)
+    {
+        return;
+    }
+    writeHeaderUnsafe(WorkloadOperation::CONVERT_BATCH);
+    writeCurrencyUnsafe(toCurrency);
+    writeBatchUnsafe(batch, nullptr);
+    if (m_buffer.size() >= BUFFER_SIZE)
+    {
+        flushUnsafe();
+    }
+}
+
+void WorkloadRecorder::recordConvertMoney(
+    const int64_t amount,
+    const std::string& fromCurrency,
+    const time_t date,
+    const std::string& toCurrency)
+{
+    std::unique_lock<std::mutex> l(m_guard);
+    if (!m_file)
+    {
+        return;
+    }
+    writeHeaderUnsafe(WorkloadOperation::CONVERT_MONEY);
+    writeCurrencyUnsafe(fromCurrency);
+    writeCurrencyUnsafe(toCurrency);
+    writeVarint(m_buffer, zigzagEncode(date));
+    writeVarint(m_buffer, zigzagEncode(amount));
+    if (m_buffer.size() >= BUFFER_SIZE)
+    {
+        flushUnsafe();
+    }
+}
+
+void WorkloadRecorder::recordConvertMoneyBatch(
+    const std::vector<int64_t>& amounts,
+    const POSTransactionBatch& batch,
+    const std::string& toCurrency)
+{
+    std::unique_lock<std::mutex> l(m_guard);
+    if (!m_file)
+    {
+        return;
+    }
+    writeHeaderUnsafe(WorkloadOperation::CONVERT_MONEY_BATCH);
+    writeCurrencyUnsafe(toCurrency);
+    writeBatchUnsafe(batch, &amounts);
+    if (m_buffer.size() >= BUFFER_SIZE)
+    {
+        flushUnsafe();
+    }
+}
+
+void WorkloadRecorder::recordGetExchangeRate(const std::string& currency, const time_t date)
+{
+    std::unique_lock<std::mutex> l(m_guard);
+    if (!m_file)
+    {
+        return;
+    }
+    writeHeaderUnsafe(WorkloadOperation::GET_RATE);
+    writeCurrencyUnsafe(currency);
+    writeVarint(m_buffer, zigzagEncode(date));
+    if (m_buffer.size() >= BUFFER_SIZE)
+    {
+        flushUnsafe();
+    }
+}
+
+uint64_t WorkloadRecorder::getRecordsCount()
+{
+    std::unique_lock<std::mutex> l(m_guard);
+    return m_recordsCount;
+}
+
+} // namespace pos
@@ -0,0 +1,446 @@
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <thread>
+
+#include <WorkloadReplayer.h>
+#include <Encoding.h>
+
+namespace pos
+{
+
+static bool readString(const uint8_t*& p, const uint8_t* end, std::string& str)
+{
+    uint64_t size;
+    if (!readVarint(p, end, size) || static_cast<uint64_t>(end - p) < size)
+    {
+        return false;
+    }
+    str.assign(reinterpret_cast<const char*>(p), size);
+    p += size;
+    return true;
+}
+
+static bool readDouble(const uint8_t*& p, const uint8_t* end, double& value)
+{
+    if (end - p < 8)
+    {
+        return false;
+    }
+    uint64_t bits = 0;
+    for (size_t i = 0; i < sizeof(bits); ++i)
+    {
+        bits |= static_cast<uint64_t>(p[i]) << (i * 8);
+    }
+    value = bitsToDouble(bits);
+    p += 8;
+    return true;
+}
+
+static bool readDate(const uint8_t*& p, const uint8_t* end, time_t& date)
+{
+    uint64_t value;
+    if (!readVarint(p, end, value))
+    {
+        return false;
+    }
+    date = zigzagDecode(value);
+    return true;
+}
+
+static bool readCurrency(
+    const uint8_t*& p,
+    const uint8_t* end,
+    std::vector<std::string>& currencies,
+    uint32_t& id)
+{
+    uint64_t value;
+    if (!readVarint(p, end, value) || value > currencies.size())
+    {
+        return false;
+    }
+    if (value == currencies.size())
+    {
+        // the first occurrence of currency
+        currencies.emplace_back();
+        if (!readString(p, end, currencies.back()))
+        {
+            return false;
+        }
+    }
+    id = static_cast<uint32_t>(value);
+    return true;
+}
+
+static bool readCount(const uint8_t*& p, const uint8_t* end, size_t& count)
+{
+    // every item takes at least one byte
+    uint64_t value;
+    if (!readVarint(p, end, value) || value > static_cast<uint64_t>(end - p))
+    {
+        return false;
+    }
+    count = static_cast<size_t>(value);
+    return true;
+}
+
+bool WorkloadReplayer::readBatch(const uint8_t*& p, const uint8_t* end, WorkloadPayload& payload, const bool money)
+{
+    size_t count;
+    if (!readCount(p, end, count))
+    {
+        return false;
+    }
+    payload.m_batch.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        uint32_t currency;
+        time_t date;
+        double total = 0;
+        uint64_t amount;
+        if (!readCurrency(p, end, m_currencies, currency) ||
+            !readDate(p, end, date) ||
+            !(money ? readVarint(p, end, amount) : readDouble(p, end, total)))
+        {
+            return false;
+        }
+        if (money)
+        {
+            payload.m_amounts.push_back(zigzagDecode(amount));
+        }
+        payload.m_batch.add(total, m_currencies[currency], date);
+    }
+    return true;
+}
+
+Result WorkloadReplayer::load(const std::string& fileName)
+{
+    std::ifstream file(fileName, std::ios::binary);
+    if (!file)
+    {
+        return Result::IO_ERROR;
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (file.bad())
+    {
+        return Result::IO_ERROR;
+    }
+
+    m_baseCurrency.clear();
+    m_currencies.clear();
+    m_records.clear();
+    m_payloads.clear();
+
+    const uint8_t* p = data.data();
+    const uint8_t* end = p + data.size();
+    if (data.size() < sizeof(WORKLOAD_MAGIC) || memcmp(p, WORKLOAD_MAGIC, sizeof(WORKLOAD_MAGIC)) != 0)
+    {
+        return Result::INVALID_FORMAT;
+    }
+    p += sizeof(WORKLOAD_MAGIC);
+    if (!readString(p, end, m_baseCurrency))
+    {
+        return Result::INVALID_FORMAT;
+    }
+
+    int64_t time = 0;
+    while (p != end)
+    {
+        WorkloadRecord record = {};
+        uint64_t threadIndex, delta;
+        const uint8_t operation = *p++;
+        if (operation >= WORKLOAD_OPERATIONS_COUNT ||
+            !readVarint(p, end, threadIndex) ||
+            !readVarint(p, end, delta))
+        {
+            return Result::INVALID_FORMAT;
+        }
+        time += delta;
+        record.m_operation = static_cast<WorkloadOperation>(operation);
+        record.m_threadIndex = static_cast<uint32_t>(threadIndex);
+        record.m_time = time;
+
+        bool valid = true;
+        switch (record.m_operation)
+        {
+            case WorkloadOperation::ADD_RATE:
+                valid = readCurrency(p, end, m_currencies, record.m_fromCurrency) &&
+                    readCurrency(p, end, m_currencies, record.m_toCurrency) &&
+                    readDate(p, end, record.m_fromDate) &&
+                    readDate(p, end, record.m_toDate) &&
+                    readDouble(p, end, record.m_value);
+                record.m_toDate += record.m_fromDate;
+                break;
+            case WorkloadOperation::ADD_OPEN_RATE:
+            case WorkloadOperation::CONVERT:
+                valid = readCurrency(p, end, m_currencies, record.m_fromCurrency) &&
+                    readCurrency(p, end, m_currencies, record.m_toCurrency) &&
+                    readDate(p, end, record.m_fromDate) &&
+                    readDouble(p, end, record.m_value);
+                break;
+            case WorkloadOperation::EXPORT:
+                break;
+            case WorkloadOperation::ADD_RATES:
+            {
+                record.m_payload = static_cast<uint32_t>(m_payloads.size());
+                m_payloads.emplace_back();
+                std::vector<RateUpdate>& updates = m_payloads.back().m_updates;
+                size_t count;
+                valid = readCount(p, end, count);
+                for (size_t i = 0; valid && i < count; ++i)
+                {
+                    uint32_t currency;
+                    RateUpdate update;
+                    valid = readCurrency(p, end, m_currencies, currency) &&
+                        readDate(p, end, update.m_fromDate) &&
+                        readDate(p, end, update.m_toDate) &&
+                        readDouble(p, end, update.m_rate);
+                    if (valid)
+                    {
+                        // zero length is open interval
+                        update.m_currency = m_currencies[currency];
+                        update.m_toDateSet = update.m_toDate != 0;
+                        update.m_toDate += update.m_fromDate;
+                        updates.push_back(std::move(update));
+                    }
+                }
+                break;
+            }
+            case WorkloadOperation::EXPIRE:
+                valid = readDate(p, end, record.m_fromDate);
+                break;
+            case WorkloadOperation::REPLACE_RATES:
+            {
+                record.m_payload = static_cast<uint32_t>(m_payloads.size());
+                m_payloads.emplace_back();
+                std::vector<std::pair<time_t, double>>& points = m_payloads.back().m_points;
+                size_t count;
+                valid = readCurrency(p, end, m_currencies, record.m_fromCurrency) && readCount(p, end, count);
+                time_t date = 0;
+                for (size_t i = 0; valid && i < count; ++i)
+                {
+                    time_t delta;
+                    double rate;
+                    valid = readDate(p, end, delta) && readDouble(p, end, rate);
+                    date += delta;
+                    points.emplace_back(date, rate);
+                }
+                break;
+            }
+            case WorkloadOperation::CONVERT_BATCH:
+            case WorkloadOperation::CONVERT_MONEY_BATCH:
+                record.m_payload = static_cast<uint32_t>(m_payloads.size());
+                m_payloads.emplace_back();
+                valid = readCurrency(p, end, m_currencies, record.m_toCurrency) &&
+                    readBatch(p, end, m_payloads.back(), WorkloadOperation::CONVERT_MONEY_BATCH == record.m_operation);
+                break;
+            case WorkloadOperation::CONVERT_MONEY:
+            {
+                uint64_t amount;
+                valid = readCurrency(p, end, m_currencies, record.m_fromCurrency) &&
+                    readCurrency(p, end, m_currencies, record.m_toCurrency) &&
+                    readDate(p, end, record.m_fromDate) &&
+                    readVarint(p, end, amount);
+                record.m_amount = zigzagDecode(amount);
+                break;
+            }
+            case WorkloadOperation::GET_RATE:
+                valid = readCurrency(p, end, m_currencies, record.m_fromCurrency) &&
+                    readDate(p, end, record.m_fromDate);
+                break;
+        }
+        if (!valid)
+        {
+            return Result::INVALID_FORMAT;
+        }
+        m_records.push_back(record);
+    }
+    return Result::SUCCESS;
+}
+
+void WorkloadReplayer::replayRecord(
+    POSTransactionManager& manager,
+    const WorkloadRecord& record,
+    Result& res) const
+{
+    switch (record.m_operation)
+    {
+        case WorkloadOperation::ADD_RATE:
+            res = manager.addExchangeRate(
+                m_currencies[record.m_fromCurrency], m_currencies[record.m_toCurrency],
+                record.m_fromDate, record.m_toDate, record.m_value);
+            break;
+        case WorkloadOperation::ADD_OPEN_RATE:
+            res = manager.addExchangeRate(
+                m_currencies[record.m_fromCurrency], m_currencies[record.m_toCurrency],
+                record.m_fromDate, record.m_value);
+            break;
+        case WorkloadOperation::CONVERT:
+            {
+                POSTransaction fromTransaction =
+                    { record.m_value, m_currencies[record.m_fromCurrency], record.m_fromDate };
+                POSTransaction toTransaction;
+                res = manager.convertPOSTransaction(
+                    toTransaction, fromTransaction, m_currencies[record.m_toCurrency]);
+            }
+            break;
+        case WorkloadOperation::EXPORT:
+            manager.getExchangeRates();
+            res = Result::SUCCESS;
+            break;
+        case WorkloadOperation::ADD_RATES:
+            {
+                std::vector<RateUpdate> updates(m_payloads[record.m_payload].m_updates);
+                manager.addExchangeRates(std::move(updates));
+                res = Result::SUCCESS;
+            }
+            break;
+        case WorkloadOperation::EXPIRE:
+            manager.expireExchangeRates(record.m_fromDate);
+            res = Result::SUCCESS;
+            break;
+        case WorkloadOperation::REPLACE_RATES:
+            {
+                const std::vector<std::pair<time_t, double>>& points = m_payloads[record.m_payload].m_points;
+                RateTrend rateTrend(points.begin(), points.end());
+                res = manager.replaceExchangeRates(m_currencies[record.m_fromCurrency], rateTrend);
+            }
+            break;
+        case WorkloadOperation::CONVERT_BATCH:
+            {
+                POSTransactionBatch toBatch;
+                std::vector<Result> results;
+                res = manager.convertPOSTransactionBatch(
+                    toBatch, results, m_payloads[record.m_payload].m_batch, m_currencies[record.m_toCurrency]);
+            }
+            break;
+        case WorkloadOperation::CONVERT_MONEY:
+            {
+                MoneyTransaction fromTransaction =
+                    { record.m_amount, m_currencies[record.m_fromCurrency], record.m_fromDate };
+                MoneyTransaction toTransaction;
+                res = manager.convertPOSTransaction(
+                    toTransaction, fromTransaction, m_currencies[record.m_toCurrency]);
+            }
+            break;
+        case WorkloadOperation::CONVERT_MONEY_BATCH:
+            {
+                const WorkloadPayload& payload = m_payloads[record.m_payload];
+                std::vector<int64_t> toAmounts;
+                std::vector<Result> results;
+                res = manager.convertPOSTransactionBatch(
+                    toAmounts, results, payload.m_amounts, payload.m_batch, m_currencies[record.m_toCurrency]);
+            }
+            break;
+        case WorkloadOperation::GET_RATE:
+            {
+                double rate;
+                res = manager.getExchangeRate(m_currencies[record.m_fromCurrency], record.m_fromDate, rate);
+            }
+            break;
+    }
+}
+
+void WorkloadReplayer::replay(
+    POSTransactionManager& manager,
+    const ReplaySpeed speed,
+    ReplayReport& report) const
+{
+    typedef std::chrono::steady_clock Clock;
+
+    // records of each recorded thread
+    std::vector<uint32_t> threadIndexes;
+    for (const auto& record : m_records)
+    {
+        threadIndexes.push_back(record.m_threadIndex);
+    }
+    std::sort(threadIndexes.begin(), threadIndexes.end());
+    threadIndexes.erase(std::unique(threadIndexes.begin(), threadIndexes.end()), threadIndexes.end());
+    std::vector<std::vector<const WorkloadRecord*>> threadRecords(threadIndexes.size());
+    for (const auto& record : m_records)
+    {
+        auto threadIt = std::lower_bound(threadIndexes.begin(), threadIndexes.end(), record.m_threadIndex);
+        threadRecords[std::distance(threadIndexes.begin(), threadIt)].push_back(&record);
+    }
+
+    // latencies of each operation
+    std::vector<std::vector<int64_t>> latencies(WORKLOAD_OPERATIONS_COUNT);
+    std::atomic<uint64_t> failedCount(0);
+    std::mutex latenciesGuard;
+    std::atomic<size_t> readyCount(0);
+    Clock::time_point start;
+    std::atomic<bool> started(false);
+
+    std::vector<std::thread> threads;
+    for (const auto& records : threadRecords)
+    {
+        threads.emplace_back([&, this] ()
+            {
+                std::vector<std::vector<int64_t>> threadLatencies(WORKLOAD_OPERATIONS_COUNT);
+                ++ readyCount;
+                while (!started.load())
+                {
+                    std::this_thread::yield();
+                }
+                for (const WorkloadRecord* record : records)
+                {
+                    if (ReplaySpeed::ORIGINAL == speed)
+                    {
+                        std::this_thread::sleep_until(start + std::chrono::nanoseconds(record->m_time));
+                    }
+                    Result res;
+                    Clock::time_point operationStart = Clock::now();
+                    replayRecord(manager, *record, res);
+                    Clock::time_point operationEnd = Clock::now();
+                    threadLatencies[static_cast<size_t>(record->m_operation)].push_back(
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(operationEnd - operationStart).count());
+                    if (Result::SUCCESS != res)
+                    {
+                        ++ failedCount;
+                    }
+                }
+                std::unique_lock<std::mutex> l(latenciesGuard);
+                for (size_t i = 0; i < WORKLOAD_OPERATIONS_COUNT; ++i)
+                {
+                    latencies[i].insert(latencies[i].end(), threadLatencies[i].begin(), threadLatencies[i].end());
+                }
+            });
+    }
+    while (readyCount.load() != threads.size())
+    {
+        std::this_thread::yield();
+    }
+    start = Clock::now();
+    started.store(true);
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    Clock::time_point end = Clock::now();
+
+    report = ReplayReport();
+    report.m_operationsCount = m_records.size();
+    report.m_failedCount = failedCount.load();
+    report.m_threadsCount = threads.size();
+    report.m_duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    report.m_throughput = report.m_duration ? report.m_operationsCount * 1e9 / report.m_duration : 0;
+    for (size_t i = 0; i < WORKLOAD_OPERATIONS_COUNT; ++i)
+    {
+        std::vector<int64_t>& operationLatencies = latencies[i];
+        if (operationLatencies.empty())
+        {
+            continue;
+        }
+        std::sort(operationLatencies.begin(), operationLatencies.end());
+        ReplayLatency& latency = report.m_latencies[i];
+        latency.m_count = operationLatencies.size();
+        latency.m_p50 = operationLatencies[operationLatencies.size() / 2];
+        latency.m_p99 = operationLatencies[operationLatencies.size() * 99 / 100];
+        latency.m_max = operationLatencies.back();
+    }
+}
+
+} // namespace pos
@@ -1,7 +1,20 @@
 #include <cstdio>
 #include <cstdint>
+#include <cstring>
+#include <cinttypes>
+#include <cstdlib>
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <pthread.h>
+#include <unistd.h>
 
 #include <POSTransaction.h>
+#include <WorkloadReplayer.h>
+#include <RateExporter.h>
+#include <RateImporter.h>
+#include <ConversionDaemon.h>
+#include <ConversionClient.h>
 
 static void printTransaction(FILE* file, const pos::POSTransaction& transaction)
 {
@@ -9,7 +22,222 @@ static void printTransaction(FILE* file, const pos::POSTransaction& transaction)
         transaction.m_total, transaction.m_currency.c_str(), pos::timeToString(transaction.m_date).c_str());
 }
 
-int main(int argc, char* argv[])
+static void printUsage(FILE* file, const char* name)
+{
+    fprintf(file,
+        "Usage:\n"
+        "\t%s - run examples\n"
+        "\t%s replay <trace> [--fast] - replay recorded workload\n"
+        "\t%s daemon <socket> [base currency] [workers] - serve conversions on Unix socket\n"
+        "\t%s daemon-bench [batch rows] [pipeline depth] [requests] - benchmark local daemon\n"
+        "\t%s import <base currency> <file>... - import rate history files (CSV export format)\n"
+        "\t%s memory <base currency> <file>... - report memory of imported rates before and after compaction\n",
+        name, name, name, name, name, name);
+}
+
+static int runReplay(const char* fileName, const pos::ReplaySpeed speed)
+{
+    using namespace pos;
+
+    WorkloadReplayer replayer;
+    Result res = replayer.load(fileName);
+    if (Result::SUCCESS != res)
+    {
+        fprintf(stderr, "Cannot load trace '%s': %s\n", fileName, resultToStr(res));
+        return 1;
+    }
+
+    POSTransactionManager mng(replayer.getBaseCurrency());
+    ReplayReport report;
+    replayer.replay(mng, speed, report);
+
+    fprintf(stdout, "Operations: %" PRIu64 " (failed: %" PRIu64 ")\n",
+        report.m_operationsCount, report.m_failedCount);
+    fprintf(stdout, "Threads: %zu\n", report.m_threadsCount);
+    fprintf(stdout, "Duration: %.3f ms\n", report.m_duration / 1e6);
+    fprintf(stdout, "Throughput: %.0f ops/s\n", report.m_throughput);
+    for (size_t i = 0; i < WORKLOAD_OPERATIONS_COUNT; ++i)
+    {
+        const ReplayLatency& latency = report.m_latencies[i];
+        if (!latency.m_count)
+        {
+            continue;
+        }
+        fprintf(stdout, "%s: count %" PRIu64 ", p50 %" PRId64 " ns, p99 %" PRId64 " ns, max %" PRId64 " ns\n",
+            workloadOperationToStr(static_cast<WorkloadOperation>(i)),
+            latency.m_count, latency.m_p50, latency.m_p99, latency.m_max);
+    }
+    return 0;
+}
+
+static int runDaemon(const char* socketPath, const char* baseCurrency, const size_t workersCount)
+{
+    using namespace pos;
+
+    // signals are blocked in all threads and taken by sigwait
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    POSTransactionManager mng(baseCurrency);
+    ConversionDaemon daemon(mng, workersCount);
+    Result res = daemon.start(socketPath);
+    if (Result::SUCCESS != res)
+    {
+        fprintf(stderr, "Cannot listen on '%s': %s\n", socketPath, resultToStr(res));
+        return 1;
+    }
+    fprintf(stdout, "Listening on %s\n", socketPath);
+    fflush(stdout);
+
+    int signal;
+    sigwait(&signals, &signal);
+    daemon.stop();
+    fprintf(stdout, "Requests: %" PRIu64 "\n", daemon.getRequestsCount());
+    return 0;
+}
+
+static int runDaemonBench(const size_t batchSize, const size_t depth, const size_t requestsCount)
+{
+    using namespace pos;
+    typedef std::chrono::steady_clock Clock;
+
+    const std::string socketPath = "/tmp/exchange.rate.bench." + std::to_string(getpid()) + ".sock";
+    POSTransactionManager mng("USD");
+    ConversionDaemon daemon(mng);
+    ConversionClient client;
+    if (Result::SUCCESS != daemon.start(socketPath) || Result::SUCCESS != client.connect(socketPath))
+    {
+        fprintf(stderr, "Cannot start daemon on '%s'\n", socketPath.c_str());
+        return 1;
+    }
+
+    // daily rates of several currencies for a year
+    const char* currencies[] = { "EUR", "GBP", "JPY", "CHF", "CAD", "AUD", "CNY", "SEK" };
+    const time_t start = timeFromString("2020-1-1 00:00:00");
+    const time_t day = 86400;
+    std::vector<ExchangeRate> rates;
+    for (const char* currency : currencies)
+    {
+        for (time_t i = 0; i < 365; ++i)
+        {
+            rates.push_back(ExchangeRate{"USD", currency, start + i * day, 0, false, 1 + rand() % 1000 / 1000.});
+        }
+    }
+    std::vector<Result> addResults;
+    client.addExchangeRates(rates, addResults);
+
+    POSTransactionBatch batch;
+    for (size_t i = 0; i < batchSize; ++i)
+    {
+        batch.add(rand() % 100000 / 100., currencies[rand() % 8], start + rand() % (365 * day));
+    }
+
+    std::vector<double> totals;
+    std::vector<Result> results;
+    // latency of single request in flight
+    std::vector<int64_t> latencies;
+    for (size_t i = 0; i < std::max<size_t>(requestsCount / 10, 1); ++i)
+    {
+        const Clock::time_point begin = Clock::now();
+        if (Result::SUCCESS != client.receiveConvert(client.sendConvert(batch, "CHF"), totals, results))
+        {
+            fprintf(stderr, "Conversion failed\n");
+            return 1;
+        }
+        latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin).count());
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    // throughput with depth requests in flight
+    std::vector<uint32_t> requestIds;
+    const Clock::time_point begin = Clock::now();
+    for (size_t i = 0; i < std::min(depth, requestsCount); ++i)
+    {
+        requestIds.push_back(client.sendConvert(batch, "CHF"));
+    }
+    for (size_t i = 0; i < requestsCount; ++i)
+    {
+        uint32_t& requestId = requestIds[i % requestIds.size()];
+        if (Result::SUCCESS != client.receiveConvert(requestId, totals, results))
+        {
+            fprintf(stderr, "Conversion failed\n");
+            return 1;
+        }
+        if (i + requestIds.size() < requestsCount)
+        {
+            requestId = client.sendConvert(batch, "CHF");
+        }
+    }
+    const double duration = std::chrono::duration<double>(Clock::now() - begin).count();
+
+    fprintf(stdout, "Batch: %zu rows, depth: %zu, requests: %zu\n", batchSize, depth, requestsCount);
+    fprintf(stdout, "Latency: p50 %" PRId64 " ns, p99 %" PRId64 " ns, max %" PRId64 " ns\n",
+        latencies[latencies.size() / 2], latencies[latencies.size() * 99 / 100], latencies.back());
+    fprintf(stdout, "Throughput: %.0f requests/s, %.0f rows/s\n",
+        requestsCount / duration, requestsCount * batchSize / duration);
+    return 0;
+}
+
+static int runImport(const char* baseCurrency, const std::vector<std::string>& fileNames)
+{
+    using namespace pos;
+    typedef std::chrono::steady_clock Clock;
+
+    POSTransactionManager mng(baseCurrency);
+    RateImporter importer;
+    const Clock::time_point begin = Clock::now();
+    Result res = importer.importRates(mng, fileNames);
+    const double duration = std::chrono::duration<double>(Clock::now() - begin).count();
+    if (Result::SUCCESS != res)
+    {
+        fprintf(stderr, "Cannot import '%s': %s\n", importer.getErrorLocation().c_str(), resultToStr(res));
+        return 1;
+    }
+    fprintf(stdout, "Files: %zu\n", fileNames.size());
+    fprintf(stdout, "Currencies: %zu\n", importer.getCurrenciesCount());
+    fprintf(stdout, "Points: %zu\n", importer.getPointsCount());
+    fprintf(stdout, "Duration: %.3f ms\n", duration * 1e3);
+    fprintf(stdout, "Throughput: %.0f points/s\n", importer.getPointsCount() / duration);
+    return 0;
+}
+
+static void printMemoryUsage(FILE* file, const pos::MemoryUsage& memoryUsage)
+{
+    fprintf(file, "%-12s %12s %14s %12s %14s %14s\n",
+        "Currency", "Points", "Trend bytes", "Key bytes", "Overhead bytes", "Total bytes");
+    for (const pos::CurrencyMemoryUsage& usage : memoryUsage.m_currencies)
+    {
+        fprintf(file, "%-12s %12zu %14zu %12zu %14zu %14zu\n", usage.m_currency.c_str(), usage.m_pointsCount,
+            usage.m_trendBytes, usage.m_keyBytes, usage.m_overheadBytes, usage.getBytes());
+    }
+    const pos::CurrencyMemoryUsage& total = memoryUsage.m_total;
+    fprintf(file, "%-12s %12zu %14zu %12zu %14zu %14zu\n", "Total", total.m_pointsCount,
+        total.m_trendBytes, total.m_keyBytes, total.m_overheadBytes, total.getBytes());
+}
+
+static int runMemory(const char* baseCurrency, const std::vector<std::string>& fileNames)
+{
+    using namespace pos;
+
+    POSTransactionManager mng(baseCurrency, true);
+    RateImporter importer;
+    Result res = importer.importRates(mng, fileNames);
+    if (Result::SUCCESS != res)
+    {
+        fprintf(stderr, "Cannot import '%s': %s\n", importer.getErrorLocation().c_str(), resultToStr(res));
+        return 1;
+    }
+    printMemoryUsage(stdout, mng.getMemoryUsage());
+    const size_t removedCount = mng.compact();
+    fprintf(stdout, "\nAfter compaction (%zu points removed):\n", removedCount);
+    printMemoryUsage(stdout, mng.getMemoryUsage());
+    return 0;
+}
+
+static int runExamples()
 {
     using namespace pos;
 
@@ -46,15 +274,11 @@ int main(int argc, char* argv[])
             0.11);
         fprintf(stdout, "Result: %u(%s)\n", static_cast<uint32_t>(res), resultToStr(res));
 
-        POSTransactionManager::CurrencyTrendMap currenciesTrendMap = mng.getExchangeRates();
-        for (const auto& currencyTrend : currenciesTrendMap)
-        {
-            fprintf(stdout, "Currency: '%s'. Trend:\n", currencyTrend.first.c_str());
-            for (const auto& rate : currencyTrend.second)
-            {
-                fprintf(stdout, "\t%s -> %f\n", timeToString(rate.first).c_str(), rate.second);
-            }
-        }
+        // exporter writes to descriptor directly
+        fflush(stdout);
+        RateExporter exporter(ExportFormat::CSV, STDOUT_FILENO);
+        res = exporter.exportRates(mng);
+        fprintf(stdout, "Result: %u(%s)\n", static_cast<uint32_t>(res), resultToStr(res));
     }
 
     {
@@ -120,4 +344,46 @@ int main(int argc, char* argv[])
         }
     }
     return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        return runExamples();
+    }
+
+    if (!strcmp(argv[1], "replay") && (3 == argc || (4 == argc && !strcmp(argv[3], "--fast"))))
+    {
+        return runReplay(argv[2], 4 == argc ? pos::ReplaySpeed::FAST : pos::ReplaySpeed::ORIGINAL);
+    }
+
+    if (!strcmp(argv[1], "daemon") && argc >= 3 && argc <= 5)
+    {
+        return runDaemon(argv[2], argc > 3 ? argv[3] : "USD", argc > 4 ? strtoul(argv[4], nullptr, 10) : 2);
+    }
+
+    if (!strcmp(argv[1], "daemon-bench") && argc <= 5)
+    {
+        const size_t batchSize = argc > 2 ? strtoul(argv[2], nullptr, 10) : 64;
+        const size_t depth = argc > 3 ? strtoul(argv[3], nullptr, 10) : 16;
+        const size_t requestsCount = argc > 4 ? strtoul(argv[4], nullptr, 10) : 20000;
+        if (batchSize && depth && requestsCount)
+        {
+            return runDaemonBench(batchSize, depth, requestsCount);
+        }
+    }
+
+    if (!strcmp(argv[1], "import") && argc >= 4)
+    {
+        return runImport(argv[2], std::vector<std::string>(argv + 3, argv + argc));
+    }
+
+    if (!strcmp(argv[1], "memory") && argc >= 4)
+    {
+        return runMemory(argv[2], std::vector<std::string>(argv + 3, argv + argc));
+    }
+
+    printUsage(stderr, argv[0]);
+    return 1;
 }
\ No newline at end of file
@@ -1,10 +1,41 @@
 #include <vector>
 #include <list>
 #include <cstdlib>
+#include <cmath>
 #include <iostream>
 #include <tuple>
+#include <thread>
+#include <chrono>
+#include <future>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 
 #include <POSTransaction.h>
+#include <CompressedRateTrend.h>
+#include <RetentionScheduler.h>
+#include <AsyncRateIngestor.h>
+#include <MultiBasePOSTransaction.h>
+#include <TieredPOSTransaction.h>
+#include <WorkloadReplayer.h>
+#include <DeferredConversion.h>
+#include <NumaReplicatedPOSTransaction.h>
+#include <Numa.h>
+#include <POSTransactionBatch.h>
+#include <TransactionArchive.h>
+#include <RadixSort.h>
+#include <RateExporter.h>
+#include <RateTrendAllocator.h>
+#include <ConversionDaemon.h>
+#include <ConversionClient.h>
+#include <SharedRateTable.h>
+#include <ConversionLedger.h>
+#include <DailyTotals.h>
+#include <GraphPOSTransaction.h>
+#include <RateImporter.h>
+#include <RateSubscriptions.h>
 #include "TestUtils.h"
 
 namespace pos
@@ -379,7 +410,7 @@ void tc_convertPOSTransactionBaseOther()
         Result::NO_RATE,
     };
 
-    for (int month = 0; month < monthsCount; ++month)
+    for (size_t month = 0; month < monthsCount; ++month)
     {
         for (int i = 1; i < 29; ++i)
         {
@@ -533,7 +564,7 @@ void tc_convertPOSTransactionOtherOther()
         Result::NO_RATE,
     };
 
-    for (int month = 0; month < monthsCount; ++month)
+    for (size_t month = 0; month < monthsCount; ++month)
     {
         for (int i = 1; i < 29; ++i)
         {
@@ -623,6 +654,2456 @@ void tc_convertPOSTransactionOtherOther()
     }
 }
 
+void tc_lockTrace()
+{
+    std::string baseCurrency("USD");
+    std::string currency1("RUR");
+    std::string currency2("EUR");
+    POSTransactionManager mng(baseCurrency);
+    LockTracer tracer(4);
+    mng.setLockTracer(&tracer);
+
+    time_t fromDate = timeFromString("2000-1-1 00:00:00");
+    time_t toDate = timeFromString("2000-2-1 00:00:00");
+    TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(baseCurrency, currency1, fromDate, toDate, 100.));
+    TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(baseCurrency, currency2, fromDate, toDate, 1.1));
+
+    POSTransaction fromTransaction = {100, currency1, timeFromString("2000-1-15 00:00:00")};
+    POSTransaction toTransaction;
+    TC_REQUIRE(Result::SUCCESS == mng.convertPOSTransaction(toTransaction, fromTransaction, currency2));
+    mng.getExchangeRates();
+
+    TC_REQUIRE(2 == tracer.getStats(LockSite::ADD).m_count);
+    TC_REQUIRE(1 == tracer.getStats(LockSite::CONVERT_FROM).m_count);
+    TC_REQUIRE(1 == tracer.getStats(LockSite::CONVERT_TO).m_count);
+    TC_REQUIRE(1 == tracer.getStats(LockSite::EXPORT).m_count);
+
+    // ring buffer keeps the last 4 events
+    auto events = tracer.getEvents();
+    TC_REQUIRE(4 == events.size());
+    TC_REQUIRE(1 == tracer.getDroppedCount());
+    TC_REQUIRE(LockSite::ADD == events[0].m_site);
+    TC_REQUIRE(LockSite::CONVERT_FROM == events[1].m_site);
+    TC_REQUIRE(LockSite::CONVERT_TO == events[2].m_site);
+    TC_REQUIRE(LockSite::EXPORT == events[3].m_site);
+    for (const auto& event : events)
+    {
+        TC_REQUIRE(event.m_requestTime <= event.m_acquireTime);
+        TC_REQUIRE(event.m_acquireTime <= event.m_releaseTime);
+    }
+
+    std::string fileName = "lock_trace_test.json";
+    TC_REQUIRE(Result::SUCCESS == tracer.dumpChromeTrace(fileName));
+    std::ifstream file(fileName);
+    std::stringstream content;
+    content << file.rdbuf();
+    remove(fileName.c_str());
+    TC_REQUIRE(0 == content.str().find("{\"displayTimeUnit\":\"ns\",\"traceEvents\":["));
+    TC_REQUIRE(std::string::npos != content.str().find("\"name\":\"convert-to\",\"cat\":\"hold\""));
+    TC_REQUIRE(Result::IO_ERROR == tracer.dumpChromeTrace("/nonexistent/dir/trace.json"));
+
+    // disabled tracing
+    mng.setLockTracer(nullptr);
+    tracer.reset();
+    mng.getExchangeRates();
+    TC_REQUIRE(0 == tracer.getStats(LockSite::EXPORT).m_count);
+    TC_REQUIRE(tracer.getEvents().empty());
+}
+
+void tc_compressedRateTrend()
+{
+    POSTransactionManager::RateTrend rateTrend;
+    time_t date = timeFromString("2000-1-1 00:00:00");
+    double rate = 60.;
+    for (int i = 0; i < 10000; ++i)
+    {
+        // rates are repeated for several days and sometimes there is no rate
+        if (0 == rand() % 4)
+        {
+            rate = 60. + rand() % 10000 / 1000.;
+        }
+        rateTrend.emplace(date, 0 == rand() % 100 ? -1 : rate);
+        date += 86400 + (0 == rand() % 10 ? rand() % 3600 : 0);
+    }
+
+    CompressedRateTrend compressedTrend(rateTrend);
+    TC_REQUIRE(compressedTrend.size() == rateTrend.size());
+    TC_REQUIRE(compressedTrend.toRateTrend() == rateTrend);
+    // map node takes at least 48 bytes per point
+    TC_REQUIRE(compressedTrend.getMemoryUsage() * 5 <= rateTrend.size() * 48);
+
+    const time_t firstDate = rateTrend.begin()->first;
+    for (int i = 0; i < 10000; ++i)
+    {
+        time_t date = firstDate - 86400 + rand() % (10002 * 86400);
+        double expectedRate = -1;
+        auto rateIt = rateTrend.upper_bound(date);
+        if (rateTrend.begin() != rateIt)
+        {
+            expectedRate = std::prev(rateIt)->second;
+        }
+        double rate = -1;
+        Result res = compressedTrend.findRate(date, rate);
+        TC_REQUIRE((expectedRate > 0 ? Result::SUCCESS : Result::NO_RATE) == res);
+        if (Result::SUCCESS == res)
+        {
+            TC_REQUIRE(expectedRate == rate);
+        }
+    }
+    for (const auto& rate : rateTrend)
+    {
+        double foundRate;
+        Result res = compressedTrend.findRate(rate.first, foundRate);
+        TC_REQUIRE((rate.second > 0 ? Result::SUCCESS : Result::NO_RATE) == res);
+    }
+
+    CompressedRateTrend emptyTrend;
+    double foundRate;
+    TC_REQUIRE(Result::NO_RATE == emptyTrend.findRate(firstDate, foundRate));
+    TC_REQUIRE(Result::SUCCESS == emptyTrend.append(firstDate, 1.5));
+    TC_REQUIRE(Result::INVALID_DATE == emptyTrend.append(firstDate, 1.5));
+    TC_REQUIRE(Result::INVALID_DATE == emptyTrend.append(firstDate - 1, 1.5));
+    TC_REQUIRE(Result::SUCCESS == emptyTrend.findRate(firstDate + 1, foundRate));
+    TC_REQUIRE(1.5 == foundRate);
+
+    // dates that are far apart
+    CompressedRateTrend extremeTrend;
+    const time_t minDate = std::numeric_limits<time_t>::min();
+    const time_t maxDate = std::numeric_limits<time_t>::max();
+    TC_REQUIRE(Result::SUCCESS == extremeTrend.append(minDate, 1.5));
+    TC_REQUIRE(Result::SUCCESS == extremeTrend.append(0, 2.5));
+    TC_REQUIRE(Result::SUCCESS == extremeTrend.append(maxDate, 3.5));
+    TC_REQUIRE(Result::SUCCESS == extremeTrend.findRate(-1, foundRate));
+    TC_REQUIRE(1.5 == foundRate);
+    TC_REQUIRE(Result::SUCCESS == extremeTrend.findRate(maxDate - 1, foundRate));
+    TC_REQUIRE(2.5 == foundRate);
+    TC_REQUIRE(Result::SUCCESS == extremeTrend.findRate(maxDate, foundRate));
+    TC_REQUIRE(3.5 == foundRate);
+    POSTransactionManager::RateTrend extremeRates = extremeTrend.toRateTrend();
+    TC_REQUIRE(3 == extremeRates.size());
+    TC_REQUIRE(minDate == extremeRates.begin()->first);
+    TC_REQUIRE(maxDate == extremeRates.rbegin()->first);
+}
+
+void tc_expireExchangeRates()
+{
+    std::string baseCurrency("USD");
+    std::string currency1("RUR");
+    std::string currency2("EUR");
+    POSTransactionManager mng(baseCurrency);
+
+    RateList rateList;
+    for (int i = 1; i < 29; ++i)
+    {
+        time_t fromDate = timeFromString("2000-1-" + std::to_string(i) + " 00:00:00");
+        rateList.emplace_back(fromDate, i + rand() % 1000 / 1000.);
+    }
+    fillPOSTransactionManager(mng, baseCurrency, currency1, rateList);
+    // EUR has no rate at cutoff
+    mng.addExchangeRate(
+        baseCurrency, currency2,
+        timeFromString("2000-1-1 00:00:00"), timeFromString("2000-1-5 00:00:00"),
+        1.1);
+    mng.addExchangeRate(
+        baseCurrency, currency2,
+        timeFromString("2000-1-20 00:00:00"),
+        1.2);
+
+    // listeners get intervals that lost rates
+    class ExpireListener : public RateChangeListener
+    {
+    public:
+        std::map<std::string, std::pair<time_t, time_t>> m_changes;
+
+        void onRatesChanged(const std::string& currency, const time_t fromDate, const time_t toDate) override
+        {
+            TC_REQUIRE(m_changes.emplace(currency, std::make_pair(fromDate, toDate)).second);
+        }
+    };
+    ExpireListener listener;
+    mng.addRateChangeListener(&listener);
+
+    time_t cutoff = timeFromString("2000-1-10 12:00:00");
+    TC_REQUIRE(0 == mng.expireExchangeRates(timeFromString("1999-12-31 00:00:00")));
+    TC_REQUIRE(listener.m_changes.empty());
+    // 9 RUR points before Jan 10 and EUR points at Jan 1 and Jan 5
+    TC_REQUIRE(11 == mng.expireExchangeRates(cutoff));
+    TC_REQUIRE(2 == listener.m_changes.size());
+    TC_REQUIRE(std::make_pair(timeFromString("2000-1-1 00:00:00"), timeFromString("2000-1-10 00:00:00")) ==
+        listener.m_changes[currency1]);
+    TC_REQUIRE(std::make_pair(timeFromString("2000-1-1 00:00:00"), timeFromString("2000-1-20 00:00:00")) ==
+        listener.m_changes[currency2]);
+    listener.m_changes.clear();
+    TC_REQUIRE(0 == mng.expireExchangeRates(cutoff));
+    TC_REQUIRE(listener.m_changes.empty());
+    mng.removeRateChangeListener(&listener);
+
+    auto currencyTrendMap = mng.getExchangeRates();
+    TC_REQUIRE(19 == currencyTrendMap[currency1].size());
+    TC_REQUIRE(timeFromString("2000-1-10 00:00:00") == currencyTrendMap[currency1].begin()->first);
+    TC_REQUIRE(1 == currencyTrendMap[currency2].size());
+
+    POSTransaction toTransaction;
+    POSTransaction fromTransaction = {100, baseCurrency, cutoff};
+    TC_REQUIRE(Result::SUCCESS == mng.convertPOSTransaction(toTransaction, fromTransaction, currency1));
+    TC_REQUIRE(Result::NO_RATE == mng.convertPOSTransaction(toTransaction, fromTransaction, currency2));
+    fromTransaction.m_date = timeFromString("2000-1-9 00:00:00");
+    TC_REQUIRE(Result::NO_RATE == mng.convertPOSTransaction(toTransaction, fromTransaction, currency1));
+
+    // open interval covers any later cutoff
+    TC_REQUIRE(18 == mng.expireExchangeRates(timeFromString("2001-1-1 00:00:00")));
+    fromTransaction.m_date = timeFromString("2001-1-1 00:00:00");
+    TC_REQUIRE(Result::SUCCESS == mng.convertPOSTransaction(toTransaction, fromTransaction, currency1));
+    TC_REQUIRE(Result::SUCCESS == mng.convertPOSTransaction(toTransaction, fromTransaction, currency2));
+}
+
+void tc_retentionScheduler()
+{
+    std::string baseCurrency("USD");
+    std::string currency1("RUR");
+    POSTransactionManager mng(baseCurrency);
+
+    RateList rateList;
+    for (int i = 1; i < 29; ++i)
+    {
+        time_t fromDate = timeFromString("2000-1-" + std::to_string(i) + " 00:00:00");
+        rateList.emplace_back(fromDate, i + rand() % 1000 / 1000.);
+    }
+    fillPOSTransactionManager(mng, baseCurrency, currency1, rateList);
+
+    time_t now = timeFromString("2000-1-20 00:00:00");
+    {
+        // keep the last 5 days
+        RetentionScheduler scheduler(mng, 5 * 86400, std::chrono::milliseconds(1),
+            [now] () { return now; });
+        for (int i = 0; i < 1000 && scheduler.getRunsCount() < 2; ++i)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        TC_REQUIRE(scheduler.getRunsCount() >= 2);
+        TC_REQUIRE(14 == scheduler.getExpiredCount());
+    }
+
+    auto currencyTrendMap = mng.getExchangeRates();
+    TC_REQUIRE(timeFromString("2000-1-15 00:00:00") == currencyTrendMap[currency1].begin()->first);
+
+    // concurrent stops join thread once
+    for (int i = 0; i < 100; ++i)
+    {
+        RetentionScheduler scheduler(mng, 5 * 86400, std::chrono::milliseconds(1), [now] () { return now; });
+        std::thread stopThread([&scheduler] () { scheduler.stop(); });
+        scheduler.stop();
+        stopThread.join();
+    }
+}
+
+void tc_asyncRateIngestor()
+{
+    std::string baseCurrency("USD");
+    std::vector<std::string> currencies = { "RUR", "EUR", "GBP", "JPY" };
+    POSTransactionManager mng(baseCurrency);
+    POSTransactionManager expectedMng(baseCurrency);
+
+    // the same updates for each currency in each manager
+    std::vector<RateList> rateLists(currencies.size());
+    for (auto& rateList : rateLists)
+    {
+        for (int i = 0; i < 500; ++i)
+        {
+            time_t fromDate = timeFromString("2000-1-1 00:00:00") + rand() % (365 * 86400);
+            if (0 == rand() % 5)
+            {
+                rateList.emplace_back(fromDate, 1 + rand() % 1000 / 1000.);
+            }
+            else
+            {
+                time_t toDate = fromDate + 1 + rand() % (30 * 86400);
+                rateList.emplace_back(fromDate, toDate, 1 + rand() % 1000 / 1000.);
+            }
+        }
+    }
+    for (size_t i = 0; i < currencies.size(); ++i)
+    {
+        fillPOSTransactionManager(expectedMng, baseCurrency, currencies[i], rateLists[i]);
+    }
+
+    {
+        AsyncRateIngestor ingestor(mng, 64);
+        TC_REQUIRE(Result::CURRENCY_NOT_MATCH == ingestor.addExchangeRate(
+            currencies[0], currencies[1], timeFromString("2000-1-1 00:00:00"), 1.));
+        TC_REQUIRE(Result::INVALID_DATE == ingestor.addExchangeRate(
+            baseCurrency, currencies[1],
+            timeFromString("2000-1-2 00:00:00"), timeFromString("2000-1-1 00:00:00"), 1.));
+
+        std::vector<std::thread> producers;
+        for (size_t i = 0; i < currencies.size(); ++i)
+        {
+            producers.emplace_back([&, i] ()
+                {
+                    for (const auto& rate : rateLists[i])
+                    {
+                        // half of rates is added in reverse direction
+                        Result res = rate.m_toSet ?
+                            ingestor.addExchangeRate(currencies[i], baseCurrency, rate.m_from, rate.m_to, 1 / rate.m_rate) :
+                            ingestor.addExchangeRate(baseCurrency, currencies[i], rate.m_from, rate.m_rate);
+                        if (Result::SUCCESS != res)
+                        {
+                            return;
+                        }
+                    }
+                });
+        }
+        for (auto& producer : producers)
+        {
+            producer.join();
+        }
+        ingestor.flush();
+        TC_REQUIRE(rateLists.size() * 500 == ingestor.getAppliedCount());
+        TC_REQUIRE(ingestor.getBatchesCount() > 0);
+
+        auto currencyTrendMap = mng.getExchangeRates();
+        auto expectedCurrencyTrendMap = expectedMng.getExchangeRates();
+        TC_REQUIRE(currencyTrendMap.size() == expectedCurrencyTrendMap.size());
+        for (const auto& currency : currencies)
+        {
+            const auto& rateTrend = currencyTrendMap[currency];
+            const auto& expectedRateTrend = expectedCurrencyTrendMap[currency];
+            TC_REQUIRE(rateTrend.size() == expectedRateTrend.size());
+            auto expectedIt = expectedRateTrend.begin();
+            for (const auto& rate : rateTrend)
+            {
+                TC_REQUIRE(rate.first == expectedIt->first);
+                TC_REQUIRE(std::abs(rate.second - expectedIt->second) < 1e-9);
+                ++ expectedIt;
+            }
+        }
+
+        // rates pushed after flush are applied on destruction
+        ingestor.addExchangeRate(baseCurrency, "CHF", timeFromString("2000-1-1 00:00:00"), 1.);
+    }
+    TC_REQUIRE(1 == mng.getExchangeRates().count("CHF"));
+}
+
+void tc_multiBasePOSTransactionManager()
+{
+    TC_REQUIRE_THROW(MultiBasePOSTransactionManager mng({}), std::runtime_error);
+    TC_REQUIRE_THROW(MultiBasePOSTransactionManager mng({"USD", "EUR", "USD"}), std::runtime_error);
+    TC_REQUIRE_THROW(MultiBasePOSTransactionManager mng({"USD", ""}), std::runtime_error);
+
+    MultiBasePOSTransactionManager mng({"USD", "EUR", "GBP"});
+    time_t fromDate = timeFromString("2000-1-1 00:00:00");
+    time_t toDate = timeFromString("2000-2-1 00:00:00");
+    TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate("USD", "EUR", fromDate, 0.9));
+    TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate("GBP", "USD", fromDate, 1 / 0.8));
+    TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate("USD", "RUR", fromDate, toDate, 60.));
+    TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate("EUR", "CHF", fromDate, toDate, 1.05));
+    TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate("GBP", "INR", fromDate, 100.));
+
+    // currency is quoted against one base only
+    TC_REQUIRE(Result::CURRENCY_NOT_MATCH == mng.addExchangeRate("USD", "CHF", fromDate, 1.1));
+    // rates between bases are quoted against primary one
+    TC_REQUIRE(Result::CURRENCY_NOT_MATCH == mng.addExchangeRate("EUR", "GBP", fromDate, 1.1));
+    TC_REQUIRE(Result::CURRENCY_NOT_MATCH == mng.addExchangeRate("CHF", "INR", fromDate, 1.1));
+    TC_REQUIRE(Result::SAME_CURRECY == mng.addExchangeRate("EUR", "EUR", fromDate, 1.1));
+    TC_REQUIRE(Result::INVALID_DATE == mng.addExchangeRate("EUR", "SEK", toDate, fromDate, 1.1));
+
+    // each rate is stored once
+    auto usdRates = mng.getExchangeRates("USD");
+    auto eurRates = mng.getExchangeRates("EUR");
+    auto gbpRates = mng.getExchangeRates("GBP");
+    TC_REQUIRE(3 == usdRates.size());
+    TC_REQUIRE(usdRates.count("EUR") && usdRates.count("GBP") && usdRates.count("RUR"));
+    TC_REQUIRE(1 == eurRates.size() && eurRates.count("CHF"));
+    TC_REQUIRE(1 == gbpRates.size() && gbpRates.count("INR"));
+    TC_REQUIRE(mng.getExchangeRates("RUR").empty());
+
+    time_t date = timeFromString("2000-1-15 00:00:00");
+    struct Conversion
+    {
+        std::string m_from;
+        std::string m_to;
+        double m_rate;
+    };
+    std::vector<Conversion> conversions =
+    {
+        { "CHF", "INR", 1 / 1.05 / 0.9 * 0.8 * 100 },
+        { "INR", "CHF", 1 / 100. / 0.8 * 0.9 * 1.05 },
+        { "CHF", "EUR", 1 / 1.05 },
+        { "EUR", "CHF", 1.05 },
+        { "CHF", "USD", 1 / 1.05 / 0.9 },
+        { "RUR", "GBP", 1 / 60. * 0.8 },
+        { "EUR", "GBP", 1 / 0.9 * 0.8 },
+        { "RUR", "CHF", 1 / 60. * 0.9 * 1.05 },
+        { "USD", "RUR", 60. },
+        { "RUR", "RUR", 1. },
+    };
+    for (const auto& conversion : conversions)
+    {
+        POSTransaction fromTransaction = {100, conversion.m_from, date};
+        POSTransaction toTransaction;
+        TC_REQUIRE(Result::SUCCESS == mng.convertPOSTransaction(toTransaction, fromTransaction, conversion.m_to));
+        TC_REQUIRE(std::abs(toTransaction.m_total - 100 * conversion.m_rate) < 1e-9);
+        TC_REQUIRE(toTransaction.m_currency == conversion.m_to);
+        TC_REQUIRE(toTransaction.m_date == date);
+    }
+
+    POSTransaction toTransaction;
+    POSTransaction fromTransaction = {100, "CHF", date};
+    TC_REQUIRE(Result::NO_CURRENCY == mng.convertPOSTransaction(toTransaction, fromTransaction, "SEK"));
+    fromTransaction.m_date = timeFromString("2000-3-1 00:00:00");
+    TC_REQUIRE(Result::NO_RATE == mng.convertPOSTransaction(toTransaction, fromTransaction, "INR"));
+}
+
+void tc_tieredPOSTransactionManager()
+{
+    std::string baseCurrency("USD");
+    std::vector<std::string> currencies = { "RUR", "EUR" };
+    char directory[] = "/tmp/pos_tiered_test.XXXXXX";
+    TC_REQUIRE(mkdtemp(directory));
+
+    POSTransactionManager expectedMng(baseCurrency);
+    {
+        TieredPOSTransactionManager mng(baseCurrency, directory);
+        for (const auto& currency : currencies)
+        {
+            RateList rateList;
+            for (int month = 1; month <= 3; ++month)
+            {
+                for (int day = 1; day < 29; day += 1 + rand() % 3)
+                {
+                    time_t fromDate = timeFromString(
+                        "2000-" + std::to_string(month) + "-" + std::to_string(day) + " 00:00:00");
+                    if (0 == rand() % 10)
+                    {
+                        // gap in rates
+                        rateList.emplace_back(fromDate, fromDate + 3600, 1 + rand() % 1000 / 1000.);
+                    }
+                    else
+                    {
+                        rateList.emplace_back(fromDate, 1 + rand() % 1000 / 1000.);
+                    }
+                }
+            }
+            fillPOSTransactionManager(expectedMng, baseCurrency, currency, rateList);
+            for (const auto& rate : rateList)
+            {
+                TC_REQUIRE(Result::SUCCESS == (rate.m_toSet ?
+                    mng.addExchangeRate(baseCurrency, currency, rate.m_from, rate.m_to, rate.m_rate) :
+                    mng.addExchangeRate(baseCurrency, currency, rate.m_from, rate.m_rate)));
+            }
+        }
+
+        // manager in the same directory does not overwrite segments
+        TieredPOSTransactionManager otherMng(baseCurrency, directory);
+        TC_REQUIRE(Result::SUCCESS == otherMng.addExchangeRate(
+            baseCurrency, currencies[0], timeFromString("2000-1-1 00:00:00"), 1.));
+        TC_REQUIRE(Result::SUCCESS == otherMng.seal(timeFromString("2000-2-1 00:00:00")));
+
+        TC_REQUIRE(Result::SUCCESS == mng.seal(timeFromString("2000-2-1 00:00:00")));
+        TC_REQUIRE(Result::SUCCESS == mng.seal(timeFromString("2000-3-1 12:00:00")));
+        TC_REQUIRE(Result::INVALID_DATE == mng.seal(timeFromString("2000-3-1 00:00:00")));
+        TC_REQUIRE(4 == mng.getSegmentsCount());
+        TC_REQUIRE(Result::INVALID_DATE == mng.addExchangeRate(
+            baseCurrency, currencies[0], timeFromString("2000-2-15 00:00:00"), 1.));
+
+        // hot tier keeps only the point that covers boundary
+        auto currencyTrendMap = mng.getExchangeRates();
+        for (const auto& currency : currencies)
+        {
+            auto& rateTrend = currencyTrendMap[currency];
+            TC_REQUIRE(!rateTrend.empty());
+            TC_REQUIRE(std::next(rateTrend.begin())->first > mng.getSealedUntil());
+        }
+
+        // new currency after sealing
+        TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(
+            baseCurrency, "GBP", timeFromString("2000-3-2 00:00:00"), 0.8));
+        TC_REQUIRE(Result::SUCCESS == expectedMng.addExchangeRate(
+            baseCurrency, "GBP", timeFromString("2000-3-2 00:00:00"), 0.8));
+        currencies.push_back("GBP");
+        currencies.push_back("JPY");
+        currencies.push_back(baseCurrency);
+
+        for (int i = 0; i < 1000; ++i)
+        {
+            time_t date = timeFromString("1999-12-25 00:00:00") + rand() % (100 * 86400);
+            const std::string& fromCurrency = currencies[rand() % currencies.size()];
+            const std::string& toCurrency = currencies[rand() % currencies.size()];
+            POSTransaction fromTransaction = {100, fromCurrency, date};
+            POSTransaction toTransaction;
+            POSTransaction expectedTransaction;
+            Result res = mng.convertPOSTransaction(toTransaction, fromTransaction, toCurrency);
+            TC_REQUIRE(expectedMng.convertPOSTransaction(expectedTransaction, fromTransaction, toCurrency) == res);
+            if (Result::SUCCESS == res)
+            {
+                TC_REQUIRE(expectedTransaction.m_total == toTransaction.m_total);
+                TC_REQUIRE(toCurrency == toTransaction.m_currency);
+            }
+        }
+    }
+
+    // existing file is not overwritten
+    const std::string fileName = std::string(directory) + "/rates.seg";
+    TC_REQUIRE(Result::SUCCESS == RateSegment::write(fileName, expectedMng.getExchangeRates()[currencies[0]], 0, 1));
+    TC_REQUIRE(Result::IO_ERROR == RateSegment::write(fileName, expectedMng.getExchangeRates()[currencies[0]], 0, 1));
+    RateSegment segment;
+    TC_REQUIRE(Result::SUCCESS == segment.open(fileName));
+    TC_REQUIRE(expectedMng.getExchangeRates()[currencies[0]].size() == segment.size());
+    segment.close();
+    TC_REQUIRE(0 == unlink(fileName.c_str()));
+    // segments are removed with managers
+    TC_REQUIRE(0 == rmdir(directory));
+
+    TieredPOSTransactionManager mng(baseCurrency, "/nonexistent/dir");
+    mng.addExchangeRate(baseCurrency, currencies[0], timeFromString("2000-1-1 00:00:00"), 1.);
+    TC_REQUIRE(Result::IO_ERROR == mng.seal(timeFromString("2000-2-1 00:00:00")));
+}
+
+void tc_workloadRecordReplay()
+{
+    std::string baseCurrency("USD");
+    std::string currency1("RUR");
+    std::string currency2("EUR");
+    std::string fileName = "workload_test.bin";
+
+    POSTransactionManager mng(baseCurrency);
+    WorkloadRecorder recorder;
+    TC_REQUIRE(Result::SUCCESS == recorder.open(fileName, baseCurrency));
+    mng.setWorkloadRecorder(&recorder);
+
+    time_t fromDate = timeFromString("2000-1-1 00:00:00");
+    time_t toDate = timeFromString("2000-2-1 00:00:00");
+    mng.addExchangeRate(baseCurrency, currency1, fromDate, toDate, 100.);
+    mng.addExchangeRate(currency2, baseCurrency, fromDate, 0.9);
+    // failed call is recorded too
+    mng.addExchangeRate(currency1, currency2, fromDate, 0.9);
+    // conversions follow rates in the same thread, so replay order does not depend on timing
+    for (int i = 0; i < 100; ++i)
+    {
+        POSTransaction fromTransaction = {100. + i, currency1, fromDate + i * 3600};
+        POSTransaction toTransaction;
+        mng.convertPOSTransaction(toTransaction, fromTransaction, currency2);
+    }
+    std::thread thread([&] ()
+        {
+            mng.getExchangeRates();
+        });
+    thread.join();
+    mng.setWorkloadRecorder(nullptr);
+    mng.getExchangeRates();
+    TC_REQUIRE(104 == recorder.getRecordsCount());
+    TC_REQUIRE(Result::SUCCESS == recorder.close());
+
+    WorkloadReplayer replayer;
+    TC_REQUIRE(Result::SUCCESS == replayer.load(fileName));
+    TC_REQUIRE(baseCurrency == replayer.getBaseCurrency());
+    TC_REQUIRE(3 == replayer.getCurrencies().size());
+    const auto& records = replayer.getRecords();
+    TC_REQUIRE(104 == records.size());
+    TC_REQUIRE(WorkloadOperation::ADD_RATE == records[0].m_operation);
+    TC_REQUIRE(fromDate == records[0].m_fromDate && toDate == records[0].m_toDate);
+    TC_REQUIRE(100. == records[0].m_value);
+    TC_REQUIRE(WorkloadOperation::ADD_OPEN_RATE == records[1].m_operation);
+    TC_REQUIRE(currency2 == replayer.getCurrencies()[records[1].m_fromCurrency]);
+    TC_REQUIRE(WorkloadOperation::CONVERT == records[3].m_operation);
+    TC_REQUIRE(101. == records[4].m_value && fromDate + 3600 == records[4].m_fromDate);
+    TC_REQUIRE(records[3].m_threadIndex == records[0].m_threadIndex);
+    TC_REQUIRE(records.back().m_threadIndex != records[0].m_threadIndex);
+    TC_REQUIRE(WorkloadOperation::EXPORT == records.back().m_operation);
+    for (size_t i = 1; i < records.size(); ++i)
+    {
+        TC_REQUIRE(records[i - 1].m_time <= records[i].m_time);
+    }
+
+    for (auto speed : { ReplaySpeed::FAST, ReplaySpeed::ORIGINAL })
+    {
+        POSTransactionManager replayMng(replayer.getBaseCurrency());
+        ReplayReport report;
+        replayer.replay(replayMng, speed, report);
+        TC_REQUIRE(104 == report.m_operationsCount);
+        // only the failed rate add fails
+        TC_REQUIRE(1 == report.m_failedCount);
+        TC_REQUIRE(2 == report.m_threadsCount);
+        TC_REQUIRE(100 == report.m_latencies[static_cast<size_t>(WorkloadOperation::CONVERT)].m_count);
+        TC_REQUIRE(report.m_throughput > 0);
+        TC_REQUIRE(replayMng.getExchangeRates() == mng.getExchangeRates());
+    }
+
+    {
+        std::ofstream file(fileName, std::ios::binary | std::ios::app);
+        file.put(static_cast<char>(WorkloadOperation::CONVERT));
+    }
+    TC_REQUIRE(Result::INVALID_FORMAT == replayer.load(fileName));
+    remove(fileName.c_str());
+    TC_REQUIRE(Result::IO_ERROR == replayer.load(fileName));
+
+    // list operations, money conversions and lookups
+    POSTransactionManager listMng(baseCurrency);
+    TC_REQUIRE(Result::SUCCESS == recorder.open(fileName, baseCurrency));
+    listMng.setWorkloadRecorder(&recorder);
+    std::vector<RateUpdate> updates(2);
+    TC_REQUIRE(Result::SUCCESS == listMng.makeRateUpdate(updates[0], baseCurrency, currency1, fromDate, toDate, 100.));
+    TC_REQUIRE(Result::SUCCESS == listMng.makeRateUpdate(updates[1], currency2, baseCurrency, fromDate, 0.9));
+    listMng.addExchangeRates(std::move(updates));
+    RateTrend rateTrend;
+    rateTrend.emplace(fromDate - 86400, 1.5);
+    rateTrend.emplace(fromDate, 1.6);
+    TC_REQUIRE(Result::SUCCESS == listMng.replaceExchangeRates("GBP", rateTrend));
+    TC_REQUIRE(1 == listMng.expireExchangeRates(fromDate + 3600));
+    POSTransactionBatch batch;
+    batch.add(100., currency1, fromDate + 3600);
+    batch.add(200., "GBP", fromDate + 7200);
+    POSTransactionBatch toBatch;
+    std::vector<Result> results;
+    TC_REQUIRE(Result::SUCCESS == listMng.convertPOSTransactionBatch(toBatch, results, batch, currency2));
+    std::vector<int64_t> toAmounts;
+    TC_REQUIRE(Result::SUCCESS == listMng.convertPOSTransactionBatch(
+        toAmounts, results, std::vector<int64_t>{ 10000, -20000 }, batch, currency2));
+    MoneyTransaction toMoney;
+    TC_REQUIRE(Result::SUCCESS == listMng.convertPOSTransaction(
+        toMoney, MoneyTransaction{ 12345, currency1, fromDate }, currency2));
+    double rate;
+    TC_REQUIRE(Result::NO_RATE == listMng.getExchangeRate(currency1, toDate, rate));
+    listMng.setWorkloadRecorder(nullptr);
+    TC_REQUIRE(7 == recorder.getRecordsCount());
+    TC_REQUIRE(Result::SUCCESS == recorder.close());
+
+    TC_REQUIRE(Result::SUCCESS == replayer.load(fileName));
+    const auto& listRecords = replayer.getRecords();
+    const auto& payloads = replayer.getPayloads();
+    TC_REQUIRE(7 == listRecords.size() && 4 == payloads.size());
+    TC_REQUIRE(WorkloadOperation::ADD_RATES == listRecords[0].m_operation);
+    const std::vector<RateUpdate>& loadedUpdates = payloads[listRecords[0].m_payload].m_updates;
+    TC_REQUIRE(2 == loadedUpdates.size() && currency1 == loadedUpdates[0].m_currency);
+    TC_REQUIRE(loadedUpdates[0].m_toDateSet && toDate == loadedUpdates[0].m_toDate);
+    TC_REQUIRE(!loadedUpdates[1].m_toDateSet && fromDate == loadedUpdates[1].m_fromDate);
+    TC_REQUIRE(WorkloadOperation::REPLACE_RATES == listRecords[1].m_operation);
+    TC_REQUIRE(2 == payloads[listRecords[1].m_payload].m_points.size());
+    TC_REQUIRE(WorkloadOperation::EXPIRE == listRecords[2].m_operation && fromDate + 3600 == listRecords[2].m_fromDate);
+    TC_REQUIRE(WorkloadOperation::CONVERT_BATCH == listRecords[3].m_operation);
+    TC_REQUIRE(2 == payloads[listRecords[3].m_payload].m_batch.size());
+    TC_REQUIRE(WorkloadOperation::CONVERT_MONEY_BATCH == listRecords[4].m_operation);
+    TC_REQUIRE((std::vector<int64_t>{ 10000, -20000 }) == payloads[listRecords[4].m_payload].m_amounts);
+    TC_REQUIRE(WorkloadOperation::CONVERT_MONEY == listRecords[5].m_operation && 12345 == listRecords[5].m_amount);
+    TC_REQUIRE(WorkloadOperation::GET_RATE == listRecords[6].m_operation && toDate == listRecords[6].m_fromDate);
+
+    POSTransactionManager listReplayMng(replayer.getBaseCurrency());
+    ReplayReport report;
+    replayer.replay(listReplayMng, ReplaySpeed::FAST, report);
+    TC_REQUIRE(7 == report.m_operationsCount && 1 == report.m_failedCount);
+    TC_REQUIRE(listReplayMng.getExchangeRates() == listMng.getExchangeRates());
+    remove(fileName.c_str());
+}
+
+void tc_deferredConversions()
+{
+    std::string baseCurrency("USD");
+    POSTransactionManager mng(baseCurrency);
+    TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(
+        baseCurrency, "EUR", timeFromString("2000-1-1 00:00:00"), 0.5));
+
+    DeferredConverter converter(mng);
+    POSTransaction toTransaction;
+    Result callbackResult = Result::PENDING;
+    ConversionCallback callback = [&] (Result r, const POSTransaction& transaction)
+    {
+        callbackResult = r;
+        toTransaction = transaction;
+    };
+
+    // completed immediately
+    POSTransaction fromTransaction{ 100., "EUR", timeFromString("2000-1-10 00:00:00") };
+    TC_REQUIRE(Result::SUCCESS == converter.convertPOSTransaction(fromTransaction, baseCurrency, callback));
+    TC_REQUIRE(Result::SUCCESS == callbackResult);
+    TC_REQUIRE(200. == toTransaction.m_total);
+    TC_REQUIRE(Result::SUCCESS == converter.convertPOSTransaction(fromTransaction, "EUR", callback));
+
+    // both currencies are missing. conversion is parked twice
+    callbackResult = Result::PENDING;
+    fromTransaction = POSTransaction{ 100., "RUR", timeFromString("2000-1-10 00:00:00") };
+    TC_REQUIRE(Result::PENDING == converter.convertPOSTransaction(fromTransaction, "GBP", callback));
+    std::future<ConversionResult> future = converter.convertPOSTransaction(fromTransaction, baseCurrency);
+    TC_REQUIRE(2 == converter.getPendingCount());
+
+    // rate does not cover transaction date
+    TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(
+        baseCurrency, "RUR", timeFromString("2000-1-11 00:00:00"), 25.));
+    TC_REQUIRE(2 == converter.getPendingCount());
+    TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(
+        baseCurrency, "RUR", timeFromString("2000-1-1 00:00:00"), timeFromString("2000-1-11 00:00:00"), 20.));
+    TC_REQUIRE(std::future_status::ready == future.wait_for(std::chrono::seconds(0)));
+    ConversionResult result = future.get();
+    TC_REQUIRE(Result::SUCCESS == result.m_result);
+    TC_REQUIRE(5. == result.m_transaction.m_total);
+    TC_REQUIRE(baseCurrency == result.m_transaction.m_currency);
+
+    // conversion to GBP waits for GBP now
+    TC_REQUIRE(Result::PENDING == callbackResult);
+    TC_REQUIRE(1 == converter.getPendingCount());
+    TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(
+        "GBP", baseCurrency, timeFromString("2000-1-5 00:00:00"), 2.));
+    TC_REQUIRE(Result::SUCCESS == callbackResult);
+    TC_REQUIRE(2.5 == toTransaction.m_total);
+    TC_REQUIRE("GBP" == toTransaction.m_currency);
+    TC_REQUIRE(0 == converter.getPendingCount());
+
+    // parked conversions are completed on destruction
+    {
+        DeferredConverter tmpConverter(mng);
+        callbackResult = Result::PENDING;
+        fromTransaction = POSTransaction{ 100., "JPY", timeFromString("2000-1-10 00:00:00") };
+        TC_REQUIRE(Result::PENDING == tmpConverter.convertPOSTransaction(fromTransaction, baseCurrency, callback));
+        TC_REQUIRE(1 == tmpConverter.getPendingCount());
+    }
+    TC_REQUIRE(Result::NO_CURRENCY == callbackResult);
+
+    // callback of one writer does not block notifications of another writer
+    std::mutex guard;
+    std::condition_variable cv;
+    bool otherAdded = false;
+    bool concurrent = false;
+    ConversionCallback waitingCallback = [&] (Result, const POSTransaction&)
+    {
+        std::unique_lock<std::mutex> l(guard);
+        concurrent = cv.wait_for(l, std::chrono::seconds(10), [&] () { return otherAdded; });
+    };
+    fromTransaction = POSTransaction{ 100., "CHF", timeFromString("2000-1-10 00:00:00") };
+    TC_REQUIRE(Result::PENDING == converter.convertPOSTransaction(fromTransaction, baseCurrency, waitingCallback));
+    fromTransaction = POSTransaction{ 100., "SEK", timeFromString("2000-1-10 00:00:00") };
+    future = converter.convertPOSTransaction(fromTransaction, baseCurrency);
+    std::thread writer([&] ()
+    {
+        mng.addExchangeRate(baseCurrency, "CHF", timeFromString("2000-1-1 00:00:00"), 1.);
+    });
+    while (converter.getPendingCount() > 1)
+    {
+        std::this_thread::yield();
+    }
+    TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(baseCurrency, "SEK", timeFromString("2000-1-1 00:00:00"), 10.));
+    {
+        std::unique_lock<std::mutex> l(guard);
+        otherAdded = true;
+    }
+    cv.notify_all();
+    writer.join();
+    TC_REQUIRE(concurrent);
+    TC_REQUIRE(10. == future.get().m_transaction.m_total);
+
+    // listener removes itself from notification
+    class RemovingListener : public RateChangeListener
+    {
+    public:
+        POSTransactionManager& m_manager;
+        size_t m_callsCount = 0;
+
+        RemovingListener(POSTransactionManager& manager): m_manager(manager) {}
+        void onRatesChanged(const std::string&, const time_t, const time_t) override
+        {
+            ++ m_callsCount;
+            m_manager.removeRateChangeListener(this);
+        }
+    };
+    RemovingListener listener(mng);
+    mng.addRateChangeListener(&listener);
+    TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(baseCurrency, "SEK", timeFromString("2000-1-2 00:00:00"), 11.));
+    TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(baseCurrency, "SEK", timeFromString("2000-1-3 00:00:00"), 12.));
+    TC_REQUIRE(1 == listener.m_callsCount);
+}
+
+static void checkExchangeRates(const POSTransactionManager& mng, const std::string& currency)
+{
+    // compare lookups with search in trend copy
+    auto currencyTrendMap = mng.getExchangeRates();
+    const auto& rateTrend = currencyTrendMap[currency];
+    const time_t fromDate = rateTrend.begin()->first - 86400;
+    const time_t toDate = rateTrend.rbegin()->first + 86400;
+    for (time_t date = fromDate; date < toDate; date += 1800 + rand() % 3600)
+    {
+        double expectedRate = -1;
+        auto rateIt = rateTrend.upper_bound(date);
+        if (rateTrend.begin() != rateIt)
+        {
+            expectedRate = std::prev(rateIt)->second;
+        }
+        double rate = 0;
+        Result r = mng.getExchangeRate(currency, date, rate);
+        TC_REQUIRE((expectedRate > 0 ? Result::SUCCESS : Result::NO_RATE) == r);
+        TC_REQUIRE(Result::SUCCESS != r || expectedRate == rate);
+    }
+}
+
+void tc_dayRateIndex()
+{
+    std::string baseCurrency("USD");
+    std::string currency1("RUR");
+    std::string currency2("EUR");
+    POSTransactionManager mng(baseCurrency);
+
+    // daily rates with a few intra-day changes and gaps
+    const time_t startDate = timeFromString("2000-1-1 00:00:00");
+    for (int day = 0; day < 200; ++day)
+    {
+        const time_t date = startDate + day * 86400;
+        if (0 == day % 20)
+        {
+            TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(
+                baseCurrency, currency1, date + 3600, date + 7200, 1 + rand() % 1000 / 1000.));
+        }
+        else if (0 == day % 30)
+        {
+            TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(
+                baseCurrency, currency1, date, date + 86400, 1 + rand() % 1000 / 1000.));
+        }
+        else if (0 != day % 7)
+        {
+            TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(
+                baseCurrency, currency1, date, 1 + rand() % 1000 / 1000.));
+        }
+    }
+    TC_REQUIRE(mng.hasDayRateIndex(currency1));
+    checkExchangeRates(mng, currency1);
+
+    // index is updated on add
+    TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(
+        baseCurrency, currency1, startDate + 50 * 86400 + 600, startDate + 60 * 86400, 3.));
+    TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(
+        baseCurrency, currency1, startDate - 10 * 86400, startDate - 5 * 86400, 4.));
+    TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(
+        baseCurrency, currency1, startDate + 250 * 86400, startDate + 251 * 86400, 5.));
+    TC_REQUIRE(mng.hasDayRateIndex(currency1));
+    checkExchangeRates(mng, currency1);
+    TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(
+        baseCurrency, currency1, startDate + 150 * 86400, 6.));
+    std::vector<RateUpdate> updates(1);
+    TC_REQUIRE(Result::SUCCESS == mng.makeRateUpdate(
+        updates[0], currency1, baseCurrency, startDate + 100 * 86400 + 60, startDate + 120 * 86400, 7.));
+    mng.addExchangeRates(std::move(updates));
+    TC_REQUIRE(mng.hasDayRateIndex(currency1));
+    checkExchangeRates(mng, currency1);
+
+    // index is updated on expiration
+    TC_REQUIRE(mng.expireExchangeRates(startDate + 40 * 86400 + 100) > 0);
+    TC_REQUIRE(mng.hasDayRateIndex(currency1));
+    checkExchangeRates(mng, currency1);
+
+    // index is dropped when trend becomes short
+    TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(
+        baseCurrency, currency1, startDate + 45 * 86400, 8.));
+    TC_REQUIRE(!mng.hasDayRateIndex(currency1));
+    checkExchangeRates(mng, currency1);
+
+    // hourly rates are not indexed
+    for (int hour = 0; hour < 200; ++hour)
+    {
+        TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(
+            baseCurrency, currency2, startDate + hour * 3600, 1 + hour / 1000.));
+    }
+    TC_REQUIRE(!mng.hasDayRateIndex(currency2));
+    checkExchangeRates(mng, currency2);
+
+    // far dates make span too long, index is dropped without allocation of the span
+    const std::string currency3("GBP");
+    for (int day = 0; day < 64; ++day)
+    {
+        TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(
+            baseCurrency, currency3, startDate + day * 86400, 1 + day / 1000.));
+    }
+    TC_REQUIRE(mng.hasDayRateIndex(currency3));
+    TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(
+        baseCurrency, currency3, startDate + 100 * 86400, std::numeric_limits<time_t>::max() - 1, 1.5));
+    TC_REQUIRE(!mng.hasDayRateIndex(currency3));
+    TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(
+        baseCurrency, currency3, std::numeric_limits<time_t>::min() + 1, startDate - 86400, 0.5));
+    TC_REQUIRE(!mng.hasDayRateIndex(currency3));
+    const std::vector<std::pair<time_t, double>> expectedRates = {
+        { std::numeric_limits<time_t>::min() + 1, 0.5 }, { startDate - 2 * 86400, 0.5 },
+        { startDate + 10 * 86400, 1.01 }, { startDate + 150 * 86400, 1.5 },
+        { std::numeric_limits<time_t>::max() - 2, 1.5 }, { std::numeric_limits<time_t>::max(), 1.063 } };
+    for (const auto& expectedRate : expectedRates)
+    {
+        double rate = 0;
+        TC_REQUIRE(Result::SUCCESS == mng.getExchangeRate(currency3, expectedRate.first, rate));
+        TC_REQUIRE(expectedRate.second == rate);
+    }
+}
+
+void tc_numaReplicatedPOSTransactionManager()
+{
+    std::string baseCurrency("USD");
+    std::vector<std::string> currencies = { "RUR", "EUR", "GBP" };
+    TC_REQUIRE_THROW(NumaReplicatedPOSTransactionManager mng(""), std::runtime_error);
+    {
+        NumaReplicatedPOSTransactionManager mng(baseCurrency);
+        TC_REQUIRE(getNumaNodesCount() == mng.getReplicasCount());
+    }
+
+    // several replicas on one node behave as several nodes
+    NumaReplicatedPOSTransactionManager mng(baseCurrency, 3);
+    POSTransactionManager expectedMng(baseCurrency);
+    TC_REQUIRE(3 == mng.getReplicasCount());
+    TC_REQUIRE(Result::CURRENCY_NOT_MATCH == mng.addExchangeRate(
+        currencies[0], currencies[1], timeFromString("2000-1-1 00:00:00"), 1.));
+
+    for (const auto& currency : currencies)
+    {
+        RateList rateList;
+        for (int day = 1; day < 29; day += 1 + rand() % 3)
+        {
+            time_t fromDate = timeFromString("2000-1-" + std::to_string(day) + " 00:00:00");
+            if (0 == rand() % 5)
+            {
+                rateList.emplace_back(fromDate, fromDate + 3600, 1 + rand() % 1000 / 1000.);
+            }
+            else
+            {
+                rateList.emplace_back(fromDate, 1 + rand() % 1000 / 1000.);
+            }
+        }
+        fillPOSTransactionManager(expectedMng, baseCurrency, currency, rateList);
+        for (const auto& rate : rateList)
+        {
+            TC_REQUIRE(Result::SUCCESS == (rate.m_toSet ?
+                mng.addExchangeRate(baseCurrency, currency, rate.m_from, rate.m_to, rate.m_rate) :
+                mng.addExchangeRate(baseCurrency, currency, rate.m_from, rate.m_rate)));
+        }
+    }
+    std::vector<RateUpdate> updates(1);
+    TC_REQUIRE(Result::SUCCESS == expectedMng.makeRateUpdate(
+        updates[0], currencies[0], baseCurrency, timeFromString("2000-2-1 00:00:00"), 2.));
+    expectedMng.addExchangeRates(std::vector<RateUpdate>(updates));
+    mng.addExchangeRates(std::move(updates));
+
+    // writer returns after all replicas are updated
+    auto expectedCurrencyTrendMap = expectedMng.getExchangeRates();
+    for (size_t i = 0; i < mng.getReplicasCount(); ++i)
+    {
+        TC_REQUIRE(i == mng.getReplicaNode(i) || 1 == getNumaNodesCount());
+        TC_REQUIRE(expectedCurrencyTrendMap == mng.getReplica(i).getExchangeRates());
+    }
+    TC_REQUIRE(expectedCurrencyTrendMap == mng.getExchangeRates());
+
+    for (int day = 1; day < 40; ++day)
+    {
+        time_t date = timeFromString("2000-1-1 12:00:00") + (day - 1) * 86400;
+        POSTransaction fromTransaction = { 100., currencies[0], date };
+        POSTransaction toTransaction, expectedTransaction;
+        Result expectedRes = expectedMng.convertPOSTransaction(expectedTransaction, fromTransaction, currencies[1]);
+        TC_REQUIRE(expectedRes == mng.convertPOSTransaction(toTransaction, fromTransaction, currencies[1]));
+        TC_REQUIRE(Result::SUCCESS != expectedRes || expectedTransaction.m_total == toTransaction.m_total);
+    }
+}
+
+void tc_posTransactionBatch()
+{
+    std::string baseCurrency("USD");
+    std::vector<std::string> currencies = { "RUR", "EUR", "GBP" };
+    POSTransactionManager mng(baseCurrency);
+    for (const auto& currency : currencies)
+    {
+        RateList rateList;
+        for (int day = 1; day < 29; day += 1 + rand() % 3)
+        {
+            time_t fromDate = timeFromString("2000-1-" + std::to_string(day) + " 00:00:00");
+            if (0 == rand() % 5)
+            {
+                rateList.emplace_back(fromDate, fromDate + 3600, 1 + rand() % 1000 / 1000.);
+            }
+            else
+            {
+                rateList.emplace_back(fromDate, 1 + rand() % 1000 / 1000.);
+            }
+        }
+        fillPOSTransactionManager(mng, baseCurrency, currency, rateList);
+    }
+
+    // random rows including base, unknown currency and dates without rates
+    std::vector<std::string> batchCurrencies = { "RUR", "EUR", "GBP", "USD", "JPY" };
+    std::vector<POSTransaction> transactions;
+    for (int i = 0; i < 1001; ++i)
+    {
+        transactions.push_back(POSTransaction{ 1 + rand() % 100000 / 100.,
+            batchCurrencies[rand() % batchCurrencies.size()],
+            timeFromString("1999-12-31 00:00:00") + rand() % (35 * 86400) });
+    }
+    POSTransactionBatch batch(transactions);
+    TC_REQUIRE(transactions.size() == batch.size());
+    TC_REQUIRE(batchCurrencies.size() == batch.getCurrencies().size());
+    for (size_t i = 0; i < transactions.size(); ++i)
+    {
+        POSTransaction transaction = batch.get(i);
+        TC_REQUIRE(transactions[i].m_total == transaction.m_total);
+        TC_REQUIRE(transactions[i].m_currency == transaction.m_currency);
+        TC_REQUIRE(transactions[i].m_date == transaction.m_date);
+    }
+
+    for (const auto& toCurrency : batchCurrencies)
+    {
+        POSTransactionBatch toBatch;
+        std::vector<Result> results;
+        Result res = mng.convertPOSTransactionBatch(toBatch, results, batch, toCurrency);
+        TC_REQUIRE(transactions.size() == toBatch.size());
+        TC_REQUIRE(transactions.size() == results.size());
+        std::vector<POSTransaction> toTransactions = toBatch.toTransactions();
+        bool failed = false;
+        for (size_t i = 0; i < transactions.size(); ++i)
+        {
+            // the same result as of scalar conversion
+            POSTransaction expectedTransaction;
+            Result expectedRes = mng.convertPOSTransaction(expectedTransaction, transactions[i], toCurrency);
+            TC_REQUIRE(expectedRes == results[i]);
+            TC_REQUIRE(toCurrency == toTransactions[i].m_currency);
+            TC_REQUIRE(transactions[i].m_date == toTransactions[i].m_date);
+            if (Result::SUCCESS == expectedRes)
+            {
+                TC_REQUIRE(expectedTransaction.m_total == toTransactions[i].m_total);
+            }
+            else
+            {
+                TC_REQUIRE(std::isnan(toTransactions[i].m_total));
+                if (!failed)
+                {
+                    TC_REQUIRE(expectedRes == res);
+                }
+                failed = true;
+            }
+        }
+        TC_REQUIRE(failed || Result::SUCCESS == res);
+    }
+
+    // conversion in place
+    std::vector<Result> results;
+    POSTransactionBatch toBatch(transactions);
+    mng.convertPOSTransactionBatch(toBatch, results, toBatch, "EUR");
+    for (size_t i = 0; i < transactions.size(); ++i)
+    {
+        POSTransaction expectedTransaction;
+        if (Result::SUCCESS == mng.convertPOSTransaction(expectedTransaction, transactions[i], "EUR"))
+        {
+            TC_REQUIRE(expectedTransaction.m_total == toBatch.getTotals()[i]);
+        }
+    }
+}
+
+void tc_transactionArchive()
+{
+    std::string baseCurrency("USD");
+    std::vector<std::string> currencies = { "RUR", "EUR" };
+    std::string fileName = "archive_test.bin";
+    std::string toFileName = "archive_test_converted.bin";
+    POSTransactionManager mng(baseCurrency);
+    for (const auto& currency : currencies)
+    {
+        TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(
+            baseCurrency, currency, timeFromString("2000-1-1 00:00:00"), 1 + rand() % 1000 / 1000.));
+        TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(
+            baseCurrency, currency, timeFromString("2000-1-15 00:00:00"), 1 + rand() % 1000 / 1000.));
+    }
+
+    // rows go by days. some rows have no rates
+    const time_t startDate = timeFromString("1999-12-30 00:00:00");
+    const size_t rowsCount = TransactionArchiveWriter::BLOCK_ROWS * 2 + 100;
+    std::vector<std::string> rowCurrencies = { "RUR", "EUR", "USD", "JPY" };
+    std::vector<POSTransaction> transactions;
+    for (size_t i = 0; i < rowsCount; ++i)
+    {
+        transactions.push_back(POSTransaction{ 1 + rand() % 100000 / 100.,
+            rowCurrencies[rand() % rowCurrencies.size()],
+            startDate + static_cast<time_t>(i * 30) - rand() % 60 });
+    }
+    {
+        TransactionArchiveWriter writer;
+        TC_REQUIRE(Result::SUCCESS == writer.open(fileName));
+        writer.write(transactions.front());
+        writer.write(POSTransactionBatch(std::vector<POSTransaction>(transactions.begin() + 1, transactions.end())));
+        TC_REQUIRE(Result::SUCCESS == writer.close());
+        TC_REQUIRE(rowsCount == writer.getRowsCount());
+        TC_REQUIRE(3 == writer.getBlocksCount());
+    }
+
+    {
+        TransactionArchiveReader reader;
+        TC_REQUIRE(Result::SUCCESS == reader.open(fileName));
+        POSTransactionBatch batch;
+        std::vector<POSTransaction> readTransactions;
+        while (Result::SUCCESS == reader.read(batch) && !batch.empty())
+        {
+            auto blockTransactions = batch.toTransactions();
+            readTransactions.insert(readTransactions.end(), blockTransactions.begin(), blockTransactions.end());
+        }
+        TC_REQUIRE(rowsCount == readTransactions.size());
+        for (size_t i = 0; i < rowsCount; ++i)
+        {
+            TC_REQUIRE(transactions[i].m_total == readTransactions[i].m_total);
+            TC_REQUIRE(transactions[i].m_currency == readTransactions[i].m_currency);
+            TC_REQUIRE(transactions[i].m_date == readTransactions[i].m_date);
+        }
+    }
+
+    // the last block is in range only
+    const time_t fromDate = transactions[TransactionArchiveWriter::BLOCK_ROWS * 2 + 10].m_date;
+    ArchiveConversionStats stats;
+    TC_REQUIRE(Result::SUCCESS == convertTransactionArchive(
+        mng, fileName, toFileName, "EUR", fromDate, std::numeric_limits<time_t>::max(), stats));
+    TC_REQUIRE(3 == stats.m_blocksCount);
+    TC_REQUIRE(2 == stats.m_skippedBlocksCount);
+    {
+        TransactionArchiveReader reader;
+        TC_REQUIRE(Result::SUCCESS == reader.open(toFileName));
+        POSTransactionBatch batch;
+        TC_REQUIRE(Result::SUCCESS == reader.read(batch));
+        TC_REQUIRE(stats.m_rowsCount == batch.size());
+        size_t row = 0;
+        uint64_t failedCount = 0;
+        for (const auto& transaction : transactions)
+        {
+            if (transaction.m_date < fromDate)
+            {
+                continue;
+            }
+            POSTransaction expectedTransaction;
+            POSTransaction toTransaction = batch.get(row++);
+            TC_REQUIRE("EUR" == toTransaction.m_currency);
+            TC_REQUIRE(transaction.m_date == toTransaction.m_date);
+            if (Result::SUCCESS == mng.convertPOSTransaction(expectedTransaction, transaction, "EUR"))
+            {
+                TC_REQUIRE(expectedTransaction.m_total == toTransaction.m_total);
+            }
+            else
+            {
+                TC_REQUIRE(std::isnan(toTransaction.m_total));
+                ++ failedCount;
+            }
+        }
+        TC_REQUIRE(row == batch.size());
+        TC_REQUIRE(failedCount == stats.m_failedCount && failedCount > 0);
+        TC_REQUIRE(Result::SUCCESS == reader.read(batch));
+        TC_REQUIRE(batch.empty());
+    }
+
+    // truncated archive
+    {
+        std::ifstream file(fileName, std::ios::binary);
+        std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        std::ofstream truncatedFile(fileName, std::ios::binary | std::ios::trunc);
+        truncatedFile.write(data.data(), data.size() - 10);
+    }
+    {
+        TransactionArchiveReader reader;
+        TC_REQUIRE(Result::SUCCESS == reader.open(fileName));
+        reader.setDateRange(fromDate, std::numeric_limits<time_t>::max());
+        POSTransactionBatch batch;
+        TC_REQUIRE(Result::INVALID_FORMAT == reader.read(batch));
+    }
+
+    // dates that are far apart. range end is exclusive, so max - 1 is the last date read
+    std::vector<POSTransaction> extremeTransactions = {
+        POSTransaction{ 1.5, "RUR", std::numeric_limits<time_t>::max() - 1 },
+        POSTransaction{ 2.5, "RUR", std::numeric_limits<time_t>::min() },
+        POSTransaction{ 3.5, "EUR", 0 } };
+    {
+        TransactionArchiveWriter writer;
+        TC_REQUIRE(Result::SUCCESS == writer.open(fileName));
+        writer.write(POSTransactionBatch(extremeTransactions));
+        TC_REQUIRE(Result::SUCCESS == writer.close());
+    }
+    {
+        TransactionArchiveReader reader;
+        TC_REQUIRE(Result::SUCCESS == reader.open(fileName));
+        POSTransactionBatch batch;
+        TC_REQUIRE(Result::SUCCESS == reader.read(batch));
+        TC_REQUIRE(extremeTransactions.size() == batch.size());
+        for (size_t i = 0; i < extremeTransactions.size(); ++i)
+        {
+            TC_REQUIRE(extremeTransactions[i].m_date == batch.get(i).m_date);
+            TC_REQUIRE(extremeTransactions[i].m_total == batch.get(i).m_total);
+        }
+    }
+
+    remove(fileName.c_str());
+    remove(toFileName.c_str());
+    TransactionArchiveReader reader;
+    TC_REQUIRE(Result::IO_ERROR == reader.open(fileName));
+}
+
+void tc_radixSort()
+{
+    for (size_t count : { static_cast<size_t>(0), static_cast<size_t>(1), static_cast<size_t>(1000),
+        RADIX_SORT_PARALLEL_MIN_SIZE * 3 + 7 })
+    {
+        // few distinct keys check stability. high bits check all passes
+        std::vector<uint64_t> keys(count);
+        for (auto& key : keys)
+        {
+            key = 0 == rand() % 2 ?
+                static_cast<uint64_t>(rand() % 50) :
+                (static_cast<uint64_t>(rand()) << 40) ^ static_cast<uint64_t>(rand());
+        }
+        std::vector<uint32_t> expectedOrder(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            expectedOrder[i] = i;
+        }
+        std::stable_sort(expectedOrder.begin(), expectedOrder.end(),
+            [&keys] (uint32_t l, uint32_t r) { return keys[l] < keys[r]; });
+
+        std::vector<uint32_t> order;
+        radixSortPermutation(keys, order, 4);
+        TC_REQUIRE(expectedOrder == order);
+        radixSortPermutation(keys, order, 1);
+        TC_REQUIRE(expectedOrder == order);
+    }
+
+    // batch rows are ordered by currency and date
+    std::vector<std::string> currencies = { "RUR", "EUR", "USD" };
+    POSTransactionBatch batch;
+    for (int i = 0; i < 10000; ++i)
+    {
+        batch.add(1., currencies[rand() % currencies.size()], timeFromString("2000-1-1 00:00:00") + rand() % 1000000);
+    }
+    std::vector<uint32_t> order;
+    sortPOSTransactionBatch(batch, order);
+    TC_REQUIRE(batch.size() == order.size());
+    for (size_t i = 1; i < order.size(); ++i)
+    {
+        const uint32_t prevId = batch.getCurrencyIds()[order[i - 1]];
+        const uint32_t id = batch.getCurrencyIds()[order[i]];
+        TC_REQUIRE(prevId < id || (prevId == id && batch.getDates()[order[i - 1]] <= batch.getDates()[order[i]]));
+    }
+
+    // dates range does not fit into sort key, close dates are ordered anyway
+    POSTransactionManager spanMng("USD");
+    TC_REQUIRE(Result::SUCCESS == spanMng.addExchangeRate("USD", "EUR", -6000000000000000000, 1.));
+    TC_REQUIRE(Result::SUCCESS == spanMng.addExchangeRate("USD", "EUR", 51, 2.));
+    TC_REQUIRE(Result::SUCCESS == spanMng.addExchangeRate("USD", "GBP", -6000000000000000000, 1.));
+    POSTransactionBatch spanBatch;
+    spanBatch.add(1., "EUR", -5000000000000000000);
+    spanBatch.add(1., "GBP", 5000000000000000000);
+    spanBatch.add(1., "EUR", 51);
+    spanBatch.add(1., "EUR", 50);
+    sortPOSTransactionBatch(spanBatch, order);
+    TC_REQUIRE((std::vector<uint32_t>{ 0, 3, 2, 1 }) == order);
+    POSTransactionBatch spanToBatch;
+    std::vector<Result> results;
+    TC_REQUIRE(Result::SUCCESS == spanMng.convertPOSTransactionBatch(spanToBatch, results, spanBatch, "USD"));
+    for (size_t i = 0; i < spanBatch.size(); ++i)
+    {
+        POSTransaction transaction;
+        TC_REQUIRE(Result::SUCCESS == spanMng.convertPOSTransaction(transaction, spanBatch.get(i), "USD"));
+        TC_REQUIRE(transaction.m_total == spanToBatch.getTotals()[i]);
+    }
+    TC_REQUIRE(1. == spanToBatch.getTotals()[3] && 0.5 == spanToBatch.getTotals()[2]);
+}
+
+void tc_rateExporter()
+{
+    char buf[FORMAT_BUFFER_SIZE];
+    for (int i = 0; i < 10000; ++i)
+    {
+        const time_t date = static_cast<time_t>(rand()) * 2 - RAND_MAX;
+        TC_REQUIRE(timeToString(date) == std::string(buf, formatTime(buf, date)));
+        const double value = (rand() + 1.) / (rand() + 1.);
+        formatDouble(buf, value);
+        TC_REQUIRE(value == strtod(buf, nullptr));
+    }
+    TC_REQUIRE(std::string("0.1") == std::string(buf, formatDouble(buf, 0.1)));
+    TC_REQUIRE(std::string("100") == std::string(buf, formatDouble(buf, 100.)));
+    TC_REQUIRE(std::string("1970-01-01 00:00:00") == std::string(buf, formatTime(buf, 0)));
+
+    std::string baseCurrency("USD");
+    POSTransactionManager mng(baseCurrency);
+    TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(baseCurrency, "EUR", 86400, 2 * 86400, 0.9));
+    {
+        RateExporter exporter(ExportFormat::CSV);
+        TC_REQUIRE(Result::SUCCESS == exporter.exportRates(mng));
+        TC_REQUIRE(exporter.getBuffer() ==
+            "currency,date,rate\n"
+            "EUR,1970-01-02 00:00:00,0.9\n"
+            "EUR,1970-01-03 00:00:00,\n");
+    }
+    TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate("R\"U,R", baseCurrency, 0, 4.));
+    {
+        RateExporter exporter(ExportFormat::JSON);
+        TC_REQUIRE(Result::SUCCESS == exporter.exportRates(mng));
+        const std::string& json = exporter.getBuffer();
+        TC_REQUIRE(0 == json.find("{\"base\":\"USD\",\"rates\":{"));
+        TC_REQUIRE(json.find("\"EUR\":[[\"1970-01-02 00:00:00\",0.9],[\"1970-01-03 00:00:00\",null]]") != std::string::npos);
+        TC_REQUIRE(json.find("\"R\\\"U,R\":[[\"1970-01-01 00:00:00\",0.25]]") != std::string::npos);
+        TC_REQUIRE(json.size() - 3 == json.rfind("}}\n"));
+    }
+
+    // file descriptor output is the same as buffer output
+    for (int i = 0; i < 5000; ++i)
+    {
+        mng.addExchangeRate(baseCurrency, "GBP", i * 3600, 1 + rand() % 1000 / 1000.);
+    }
+    RateExporter bufferExporter(ExportFormat::CSV);
+    TC_REQUIRE(Result::SUCCESS == bufferExporter.exportRates(mng));
+    TC_REQUIRE(bufferExporter.getBuffer().size() > RateExporter::BUFFER_SIZE);
+    // the next export replaces buffer
+    const std::string firstBuffer = bufferExporter.getBuffer();
+    TC_REQUIRE(Result::SUCCESS == bufferExporter.exportRates(mng));
+    TC_REQUIRE(firstBuffer == bufferExporter.getBuffer());
+    char fileName[] = "/tmp/pos_export_test.XXXXXX";
+    int fd = mkstemp(fileName);
+    TC_REQUIRE(fd >= 0);
+    RateExporter fileExporter(ExportFormat::CSV, fd);
+    TC_REQUIRE(Result::SUCCESS == fileExporter.exportRates(mng));
+    close(fd);
+    std::ifstream file(fileName, std::ios::binary);
+    std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    TC_REQUIRE(bufferExporter.getBuffer() == data);
+    remove(fileName);
+    RateExporter failedExporter(ExportFormat::CSV, fd);
+    TC_REQUIRE(Result::IO_ERROR == failedExporter.exportRates(mng));
+}
+
+void tc_rateTrendAllocator()
+{
+    NodePool pool;
+    std::vector<void*> nodes;
+    for (size_t i = 0; i < NodePool::MIN_CHUNK_NODES * 3; ++i)
+    {
+        nodes.push_back(pool.allocate(48));
+    }
+    TC_REQUIRE(pool.accepts(48) && !pool.accepts(64));
+    TC_REQUIRE(nodes.size() == pool.getNodesCount());
+    TC_REQUIRE(2 == pool.getChunksCount());
+    TC_REQUIRE(NodePool::MIN_CHUNK_NODES * 3 * 48 == pool.getMemoryUsage());
+    // freed node is reused
+    pool.deallocate(nodes[5]);
+    TC_REQUIRE(nodes[5] == pool.allocate(48));
+    for (void* node : nodes)
+    {
+        pool.deallocate(node);
+    }
+    TC_REQUIRE(0 == pool.getNodesCount() && 0 == pool.getChunksCount() && 0 == pool.getMemoryUsage());
+
+    // trend nodes come from pool. copy does not use pool
+    std::shared_ptr<NodePool> trendPool = std::make_shared<NodePool>();
+    RateTrend rateTrend{RateTrend::allocator_type(trendPool)};
+    for (time_t date = 0; date < 1000; ++date)
+    {
+        rateTrend.emplace(date, date + 1.);
+    }
+    TC_REQUIRE(1000 == trendPool->getNodesCount());
+    RateTrend copy(rateTrend);
+    TC_REQUIRE(copy == rateTrend && !copy.get_allocator().m_pool);
+    rateTrend.erase(rateTrend.begin(), rateTrend.find(500));
+    TC_REQUIRE(500 == trendPool->getNodesCount() && trendPool->getChunksCount());
+    rateTrend.clear();
+    TC_REQUIRE(0 == trendPool->getChunksCount() && 0 == trendPool->getMemoryUsage());
+    TC_REQUIRE(1000 == copy.size());
+
+    // manager with node pools keeps the same rates
+    std::string baseCurrency("USD");
+    POSTransactionManager mng(baseCurrency);
+    POSTransactionManager pooledMng(baseCurrency, true);
+    for (int i = 0; i < 2000; ++i)
+    {
+        const char* currency = i % 3 ? "EUR" : "GBP";
+        const time_t fromDate = rand() % 100000;
+        const time_t toDate = fromDate + rand() % 10000;
+        const double rate = 1 + rand() % 1000 / 1000.;
+        if (i % 2)
+        {
+            TC_REQUIRE(mng.addExchangeRate(baseCurrency, currency, fromDate, toDate, rate) ==
+                pooledMng.addExchangeRate(baseCurrency, currency, fromDate, toDate, rate));
+        }
+        else
+        {
+            TC_REQUIRE(mng.addExchangeRate(baseCurrency, currency, fromDate, rate) ==
+                pooledMng.addExchangeRate(baseCurrency, currency, fromDate, rate));
+        }
+    }
+    mng.expireExchangeRates(50000);
+    pooledMng.expireExchangeRates(50000);
+    for (const char* currency : {"EUR", "GBP"})
+    {
+        RateTrend trend;
+        RateTrend pooledTrend;
+        TC_REQUIRE(Result::SUCCESS == mng.getExchangeRates(currency, trend));
+        TC_REQUIRE(Result::SUCCESS == pooledMng.getExchangeRates(currency, pooledTrend));
+        TC_REQUIRE(trend == pooledTrend && !pooledTrend.get_allocator().m_pool);
+    }
+}
+
+void tc_conversionDaemon()
+{
+    const std::string socketPath = "/tmp/pos_daemon_test." + std::to_string(getpid()) + ".sock";
+    std::string baseCurrency("USD");
+    POSTransactionManager mng(baseCurrency);
+    ConversionDaemon daemon(mng, 2);
+    TC_REQUIRE(Result::SUCCESS == daemon.start(socketPath));
+    ConversionClient client;
+    TC_REQUIRE(Result::SUCCESS == client.connect(socketPath));
+
+    std::vector<ExchangeRate> rates = {
+        {baseCurrency, "EUR", 0, 0, false, 0.9},
+        {"GBP", baseCurrency, 100, 200, true, 1.25},
+        {baseCurrency, baseCurrency, 0, 0, false, 1.},
+        {"EUR", "GBP", 0, 0, false, 1.},
+    };
+    std::vector<Result> results;
+    TC_REQUIRE(Result::SAME_CURRECY == client.addExchangeRates(rates, results));
+    TC_REQUIRE(4 == results.size() && Result::SUCCESS == results[0] && Result::SUCCESS == results[1]);
+    TC_REQUIRE(Result::SAME_CURRECY == results[2] && Result::CURRENCY_NOT_MATCH == results[3]);
+
+    // the same result as of manager
+    POSTransactionBatch fromBatch;
+    for (int i = 0; i < 1000; ++i)
+    {
+        fromBatch.add(rand() % 10000 / 100., i % 3 ? "EUR" : "GBP", rand() % 300 - 50);
+    }
+    POSTransactionBatch toBatch;
+    POSTransactionBatch expectedBatch;
+    std::vector<Result> expectedResults;
+    const Result expected = mng.convertPOSTransactionBatch(expectedBatch, expectedResults, fromBatch, "USD");
+    TC_REQUIRE(expected == client.convert(toBatch, results, fromBatch, "USD"));
+    TC_REQUIRE(results == expectedResults && toBatch.size() == fromBatch.size());
+    for (size_t i = 0; i < toBatch.size(); ++i)
+    {
+        TC_REQUIRE(toBatch.get(i).m_currency == "USD" && toBatch.getDates()[i] == fromBatch.getDates()[i]);
+        TC_REQUIRE(std::isnan(expectedBatch.getTotals()[i]) ?
+            std::isnan(toBatch.getTotals()[i]) : expectedBatch.getTotals()[i] == toBatch.getTotals()[i]);
+    }
+
+    // pipelined requests are received in any order
+    std::vector<uint32_t> requestIds;
+    for (int i = 0; i < 50; ++i)
+    {
+        requestIds.push_back(i % 2 ? client.sendExport("EUR") : client.sendConvert(fromBatch, "USD"));
+    }
+    TC_REQUIRE(Result::SUCCESS == client.flush());
+    for (int i = 49; i >= 0; --i)
+    {
+        if (i % 2)
+        {
+            RateTrend rateTrend;
+            TC_REQUIRE(Result::SUCCESS == client.receiveExport(requestIds[i], rateTrend));
+            TC_REQUIRE(1 == rateTrend.size() && 0.9 == rateTrend.begin()->second);
+        }
+        else
+        {
+            std::vector<double> totals;
+            TC_REQUIRE(expected == client.receiveConvert(requestIds[i], totals, results));
+            TC_REQUIRE(results == expectedResults);
+        }
+    }
+    RateTrend rateTrend;
+    TC_REQUIRE(Result::NO_CURRENCY == client.getExchangeRates("JPY", rateTrend) && rateTrend.empty());
+
+    // unknown message gets INVALID_FORMAT, too big frame closes connection
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socketPath.c_str());
+    TC_REQUIRE(0 == connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)));
+    std::vector<uint8_t> frame;
+    endFrame(frame, beginFrame(frame, 7, static_cast<MessageType>(99)));
+    TC_REQUIRE(static_cast<ssize_t>(frame.size()) == write(fd, frame.data(), frame.size()));
+    uint8_t response[64];
+    const ssize_t size = read(fd, response, sizeof(response));
+    size_t frameSize;
+    TC_REQUIRE(size > 0 && getFrameSize(response, size, frameSize) && frameSize == static_cast<size_t>(size));
+    const uint8_t* p = response + FRAME_HEADER_SIZE;
+    uint32_t requestId;
+    MessageType type;
+    Result result;
+    TC_REQUIRE(Result::SUCCESS == readMessageHeader(p, response + size, requestId, type));
+    TC_REQUIRE(7 == requestId && Result::SUCCESS == readAddRatesResponse(p, response + size, result, results));
+    TC_REQUIRE(Result::INVALID_FORMAT == result && results.empty());
+    const uint8_t bigFrame[] = { 0xff, 0xff, 0xff, 0xff, 0, 0, 0, 0, 1 };
+    TC_REQUIRE(sizeof(bigFrame) == write(fd, bigFrame, sizeof(bigFrame)));
+    TC_REQUIRE(0 == read(fd, response, sizeof(response)));
+    close(fd);
+
+    TC_REQUIRE(daemon.getRequestsCount() == 54);
+
+    // request that was not sent or was already received does not wait
+    TC_REQUIRE(Result::INVALID_FORMAT == client.receiveExport(requestIds[1], rateTrend));
+    TC_REQUIRE(Result::INVALID_FORMAT == client.receiveExport(12345, rateTrend));
+    TC_REQUIRE(client.isConnected());
+
+    // client that does not receive responses stops reading of its requests
+    for (int i = 0; i < 2000; ++i)
+    {
+        mng.addExchangeRate(baseCurrency, "JPY", i * 86400, 100. + i % 7);
+    }
+    requestIds.clear();
+    TC_REQUIRE(0 == daemon.getReadPausesCount());
+    for (int i = 0; i < 2000; ++i)
+    {
+        requestIds.push_back(client.sendExport("JPY"));
+    }
+    TC_REQUIRE(Result::SUCCESS == client.flush());
+    // output limit and tasks limit are about 200 and 256 requests
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!daemon.getReadPausesCount() && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    TC_REQUIRE(daemon.getReadPausesCount() > 0);
+    for (uint32_t id : requestIds)
+    {
+        TC_REQUIRE(Result::SUCCESS == client.receiveExport(id, rateTrend) && 2000 == rateTrend.size());
+    }
+    TC_REQUIRE(daemon.getRequestsCount() == 54 + 2000);
+    daemon.stop();
+    TC_REQUIRE(Result::IO_ERROR == client.getExchangeRates("EUR", rateTrend));
+    TC_REQUIRE(!client.isConnected());
+    TC_REQUIRE(Result::IO_ERROR == client.connect(socketPath));
+}
+
+void tc_sharedRateTable()
+{
+    const std::string name = "/pos_shm_test." + std::to_string(getpid());
+    std::string baseCurrency("USD");
+    POSTransactionManager mng(baseCurrency);
+    for (int i = 0; i < 300; ++i)
+    {
+        const char* currency = i % 3 ? "EUR" : (i % 2 ? "GBP" : "R\"U,R");
+        const time_t fromDate = rand() % 10000;
+        if (i % 4)
+        {
+            mng.addExchangeRate(baseCurrency, currency, fromDate, fromDate + rand() % 1000, 1 + rand() % 1000 / 1000.);
+        }
+        else
+        {
+            mng.addExchangeRate(currency, baseCurrency, fromDate, 1 + rand() % 1000 / 1000.);
+        }
+    }
+
+    SharedRateTableReader reader;
+    TC_REQUIRE(Result::IO_ERROR == reader.open(name));
+    SharedRateTableWriter writer;
+    TC_REQUIRE(Result::SUCCESS == writer.open(name, 64));
+    TC_REQUIRE(Result::SUCCESS == reader.open(name));
+    // empty table before the first publication
+    double rate;
+    TC_REQUIRE(0 == reader.getVersion() && reader.getBaseCurrency().empty());
+    TC_REQUIRE(Result::NO_CURRENCY == reader.getExchangeRate("EUR", 0, rate));
+    TC_REQUIRE(Result::IO_ERROR == writer.publish(mng));
+
+    const size_t capacity = SharedRateTableWriter::getPublishSize(baseCurrency, mng.getExchangeRates()) * 2;
+    TC_REQUIRE(Result::SUCCESS == writer.open(name, capacity));
+    TC_REQUIRE(Result::SUCCESS == writer.publish(mng));
+    TC_REQUIRE(Result::SUCCESS == reader.open(name));
+    TC_REQUIRE(1 == reader.getVersion() && baseCurrency == reader.getBaseCurrency());
+
+    // the same conversions as of manager
+    const std::vector<std::string> currencies = { "USD", "EUR", "GBP", "R\"U,R", "JPY" };
+    auto checkConversions = [&]()
+    {
+        for (int i = 0; i < 2000; ++i)
+        {
+            const POSTransaction fromTransaction = {
+                rand() % 10000 / 100., currencies[rand() % currencies.size()], rand() % 12000 - 1000 };
+            const std::string& toCurrency = currencies[rand() % currencies.size()];
+            POSTransaction expected;
+            POSTransaction converted;
+            const Result r = mng.convertPOSTransaction(expected, fromTransaction, toCurrency);
+            TC_REQUIRE(r == reader.convertPOSTransaction(converted, fromTransaction, toCurrency));
+            TC_REQUIRE(Result::SUCCESS != r || (expected.m_total == converted.m_total &&
+                expected.m_currency == converted.m_currency && expected.m_date == converted.m_date));
+        }
+    };
+    checkConversions();
+
+    // new rates are visible after publication
+    mng.addExchangeRate(baseCurrency, "JPY", 0, 150.);
+    TC_REQUIRE(Result::NO_CURRENCY == reader.getExchangeRate("JPY", 0, rate));
+    TC_REQUIRE(Result::SUCCESS == writer.publish(mng));
+    TC_REQUIRE(Result::SUCCESS == reader.getExchangeRate("JPY", 0, rate) && 150. == rate);
+    TC_REQUIRE(2 == reader.getVersion());
+    checkConversions();
+
+    // reader sees one of published tables while writer publishes
+    POSTransactionManager::CurrencyTrendMap tables[2];
+    tables[0]["EUR"].emplace(0, 2.);
+    tables[1]["EUR"].emplace(0, 3.);
+    tables[1]["GBP"].emplace(0, 3.);
+    TC_REQUIRE(Result::SUCCESS == writer.publish(baseCurrency, tables[0]));
+    std::atomic<bool> stopped(false);
+    std::thread publisher([&]()
+    {
+        for (size_t i = 1; !stopped.load(); ++i)
+        {
+            writer.publish(baseCurrency, tables[i % 2]);
+        }
+    });
+    bool consistent = true;
+    for (int i = 0; i < 100000; ++i)
+    {
+        POSTransaction converted;
+        const Result r = reader.convertPOSTransaction(converted, {1., "EUR", 0}, "GBP");
+        consistent = consistent && ((Result::NO_CURRENCY == r) || (Result::SUCCESS == r && 1. == converted.m_total));
+    }
+    stopped.store(true);
+    publisher.join();
+    TC_REQUIRE(consistent);
+
+    writer.close();
+    TC_REQUIRE(Result::SUCCESS == reader.getExchangeRate("EUR", 0, rate));
+    TC_REQUIRE(Result::SUCCESS == SharedRateTableWriter::remove(name));
+    TC_REQUIRE(Result::IO_ERROR == SharedRateTableWriter::remove(name));
+    reader.close();
+    TC_REQUIRE(Result::NO_CURRENCY == reader.getExchangeRate("EUR", 0, rate));
+}
+
+void tc_conversionLedger()
+{
+    std::string baseCurrency("USD");
+    POSTransactionManager mng(baseCurrency);
+    TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(baseCurrency, "EUR", 0, 0.9));
+    TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(baseCurrency, "GBP", 0, 5000, 0.8));
+    ConversionLedger ledger(mng);
+
+    const std::vector<std::string> currencies = { "USD", "EUR", "GBP" };
+    std::vector<uint64_t> ids;
+    for (int i = 0; i < 1000; ++i)
+    {
+        const POSTransaction fromTransaction = {
+            rand() % 10000 / 100., currencies[rand() % currencies.size()], rand() % 10000 };
+        uint64_t id;
+        POSTransaction toTransaction;
+        const Result r = ledger.convertPOSTransaction(
+            id, toTransaction, fromTransaction, currencies[rand() % currencies.size()]);
+        LedgerEntry entry;
+        TC_REQUIRE(ledger.get(id, entry) && r == entry.m_result);
+        TC_REQUIRE(Result::SUCCESS != r || toTransaction.m_total == entry.m_toTransaction.m_total);
+        ids.push_back(id);
+    }
+    TC_REQUIRE(1000 == ledger.size() && ledger.takeAffected().empty());
+
+    // correction marks conversions with the currency at dates of changed interval
+    TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(baseCurrency, "EUR", 2000, 3000, 0.95));
+    std::vector<uint64_t> expected;
+    for (const uint64_t id : ids)
+    {
+        LedgerEntry entry;
+        ledger.get(id, entry);
+        const POSTransaction& fromTransaction = entry.m_fromTransaction;
+        if (fromTransaction.m_currency != entry.m_toCurrency &&
+            (fromTransaction.m_currency == "EUR" || entry.m_toCurrency == "EUR") &&
+            fromTransaction.m_date >= 2000 && fromTransaction.m_date < 3000)
+        {
+            expected.push_back(id);
+        }
+    }
+    TC_REQUIRE(!expected.empty() && expected == ledger.takeAffected());
+
+    // gap is filled: failed conversions are recomputed
+    TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(baseCurrency, "GBP", 5000, 0.85));
+    const std::vector<uint64_t> changed = ledger.reprice();
+    TC_REQUIRE(!changed.empty());
+    for (const uint64_t id : ids)
+    {
+        LedgerEntry entry;
+        ledger.get(id, entry);
+        POSTransaction toTransaction;
+        const Result r = mng.convertPOSTransaction(toTransaction, entry.m_fromTransaction, entry.m_toCurrency);
+        const bool isChanged = std::find(changed.begin(), changed.end(), id) != changed.end();
+        // EUR correction was taken by caller, so its conversions keep old totals
+        TC_REQUIRE(std::find(expected.begin(), expected.end(), id) != expected.end() ||
+            (r == entry.m_result && (Result::SUCCESS != r || toTransaction.m_total == entry.m_toTransaction.m_total)));
+        TC_REQUIRE(!isChanged || (entry.m_fromTransaction.m_date >= 5000 &&
+            (entry.m_fromTransaction.m_currency == "GBP" || entry.m_toCurrency == "GBP")));
+    }
+
+    TC_REQUIRE(ledger.remove(ids[0]) && !ledger.remove(ids[0]));
+    TC_REQUIRE(999 == ledger.size());
+    TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(baseCurrency, "EUR", 0, 0.5));
+    const std::vector<uint64_t> affected = ledger.takeAffected();
+    TC_REQUIRE(!affected.empty() && std::find(affected.begin(), affected.end(), ids[0]) == affected.end());
+
+    // expiration marks conversions at dates that lost rates
+    TC_REQUIRE(1 == mng.expireExchangeRates(6000));
+    expected.clear();
+    for (size_t i = 1; i < ids.size(); ++i)
+    {
+        LedgerEntry entry;
+        ledger.get(ids[i], entry);
+        const POSTransaction& fromTransaction = entry.m_fromTransaction;
+        if (fromTransaction.m_currency != entry.m_toCurrency &&
+            (fromTransaction.m_currency == "GBP" || entry.m_toCurrency == "GBP") &&
+            fromTransaction.m_date < 5000)
+        {
+            expected.push_back(ids[i]);
+        }
+    }
+    TC_REQUIRE(!expected.empty() && expected == ledger.takeAffected());
+}
+
+void tc_dailyTotals()
+{
+    std::string baseCurrency("USD");
+    POSTransactionManager mng(baseCurrency);
+    const time_t day = DailyTotals::SECONDS_PER_DAY;
+    TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(baseCurrency, "EUR", 0, 0.9));
+    TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(baseCurrency, "GBP", day, 0.8));
+    DailyTotals dailyTotals(mng);
+
+    const std::vector<std::string> currencies = { "EUR", "GBP", "USD" };
+    std::vector<POSTransaction> transactions;
+    POSTransactionBatch batch;
+    for (int i = 0; i < 3000; ++i)
+    {
+        const POSTransaction transaction = {
+            rand() % 10000 / 100., currencies[rand() % currencies.size()], rand() % (3 * day) };
+        transactions.push_back(transaction);
+        if (i % 2)
+        {
+            dailyTotals.add(transaction);
+        }
+        else
+        {
+            batch.add(transaction);
+        }
+    }
+    dailyTotals.add(batch);
+    TC_REQUIRE(9 == dailyTotals.getBucketsCount());
+
+    auto check = [&]()
+    {
+        for (time_t date = 0; date < 3 * day; date += day)
+        {
+            const std::vector<DailyTotal> totals = dailyTotals.getDailyTotals(date + day / 2);
+            TC_REQUIRE(currencies.size() == totals.size());
+            for (size_t i = 0; i < currencies.size(); ++i)
+            {
+                DailyTotal expected;
+                for (const POSTransaction& transaction : transactions)
+                {
+                    if (transaction.m_currency != currencies[i] ||
+                        transaction.m_date < date || transaction.m_date >= date + day)
+                    {
+                        continue;
+                    }
+                    expected.m_total += transaction.m_total;
+                    ++ expected.m_count;
+                    POSTransaction toTransaction;
+                    if (Result::SUCCESS == mng.convertPOSTransaction(toTransaction, transaction, baseCurrency))
+                    {
+                        expected.m_baseTotal += toTransaction.m_total;
+                    }
+                    else
+                    {
+                        ++ expected.m_unconvertedCount;
+                    }
+                }
+                const DailyTotal& total = totals[i];
+                TC_REQUIRE(currencies[i] == total.m_currency && expected.m_count == total.m_count);
+                TC_REQUIRE(expected.m_unconvertedCount == total.m_unconvertedCount);
+                TC_REQUIRE(std::fabs(expected.m_total - total.m_total) < 1e-6);
+                TC_REQUIRE(std::fabs(expected.m_baseTotal - total.m_baseTotal) < 1e-6);
+            }
+        }
+    };
+    check();
+
+    // correction inside a day and gap filling rescale their buckets only
+    TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(baseCurrency, "EUR", day + 1000, day + 5000, 0.95));
+    TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(baseCurrency, "GBP", 0, day / 2, 0.7));
+    // transactions at marked dates wait for recomputation
+    for (int i = 0; i < 300; ++i)
+    {
+        transactions.push_back({ rand() % 10000 / 100., currencies[rand() % currencies.size()], rand() % (2 * day) });
+        dailyTotals.add(transactions.back());
+    }
+    check();
+    TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(baseCurrency, "EUR", 0, 0.5));
+    check();
+
+    TC_REQUIRE(dailyTotals.getDailyTotals(3 * day).empty());
+    TC_REQUIRE(6 == dailyTotals.expire(2 * day + 1) && 3 == dailyTotals.getBucketsCount());
+    TC_REQUIRE(dailyTotals.getDailyTotals(0).empty() && 3 == dailyTotals.getDailyTotals(2 * day).size());
+
+    // rate of date disappears and appears again between rows of the date
+    for (const bool expire : { true, false })
+    {
+        POSTransactionManager dateMng(baseCurrency);
+        DailyTotals dateTotals(dateMng);
+        TC_REQUIRE(Result::SUCCESS == dateMng.addExchangeRate(baseCurrency, "EUR", day, 0.5));
+        TC_REQUIRE(Result::SUCCESS == dateMng.addExchangeRate(baseCurrency, "EUR", day + 7200, 0.25));
+        dateTotals.add(POSTransaction{ 10, "EUR", day + 3600 });
+        if (expire)
+        {
+            dateMng.expireExchangeRates(day + 7200);
+        }
+        else
+        {
+            TC_REQUIRE(Result::SUCCESS == dateMng.addExchangeRate(baseCurrency, "EUR", day, day + 7200, -1));
+        }
+        dateTotals.add(POSTransaction{ 10, "EUR", day + 3600 });
+        TC_REQUIRE(Result::SUCCESS == dateMng.addExchangeRate(baseCurrency, "EUR", day, day + 7200, 2.));
+        dateTotals.add(POSTransaction{ 20, "EUR", day + 3600 });
+        const std::vector<DailyTotal> totals = dateTotals.getDailyTotals(day);
+        TC_REQUIRE(1 == totals.size() && 3 == totals[0].m_count && 0 == totals[0].m_unconvertedCount);
+        TC_REQUIRE(std::fabs(20 - totals[0].m_baseTotal) < 1e-9);
+    }
+}
+
+void tc_graphPOSTransactionManager()
+{
+    GraphPOSTransactionManager mng;
+    time_t fromDate = timeFromString("2000-1-1 00:00:00");
+    time_t toDate = timeFromString("2000-2-1 00:00:00");
+    TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate("USD", "EUR", fromDate, 0.9));
+    TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate("EUR", "CHF", fromDate, toDate, 1.05));
+    // exotic currency quoted against EUR only
+    TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate("SEK", "EUR", fromDate, 0.09));
+    TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate("GBP", "INR", fromDate, 100.));
+    TC_REQUIRE(Result::SAME_CURRECY == mng.addExchangeRate("EUR", "EUR", fromDate, 1.1));
+    TC_REQUIRE(Result::INVALID_DATE == mng.addExchangeRate("EUR", "SEK", toDate, fromDate, 1.1));
+
+    std::vector<std::string> path;
+    TC_REQUIRE(Result::SUCCESS == mng.getPath(path, "SEK", "USD"));
+    TC_REQUIRE((std::vector<std::string>{ "SEK", "EUR", "USD" }) == path);
+    TC_REQUIRE(Result::CURRENCY_NOT_MATCH == mng.getPath(path, "SEK", "INR"));
+    TC_REQUIRE(Result::NO_CURRENCY == mng.getPath(path, "SEK", "RUR"));
+    TC_REQUIRE(6 == mng.getCurrencies().size());
+
+    POSTransaction fromTransaction = { 100., "SEK", fromDate };
+    POSTransaction toTransaction;
+    TC_REQUIRE(Result::SUCCESS == mng.convertPOSTransaction(toTransaction, fromTransaction, "CHF"));
+    TC_REQUIRE(std::fabs(toTransaction.m_total - 100. * 0.09 * 1.05) < 1e-9 && "CHF" == toTransaction.m_currency);
+    TC_REQUIRE(Result::SUCCESS == mng.convertPOSTransaction(toTransaction, fromTransaction, "USD"));
+    TC_REQUIRE(std::fabs(toTransaction.m_total - 100. * 0.09 / 0.9) < 1e-9);
+    TC_REQUIRE(Result::CURRENCY_NOT_MATCH == mng.convertPOSTransaction(toTransaction, fromTransaction, "INR"));
+    // rate of any hop shall be available at transaction date
+    fromTransaction.m_date = toDate;
+    TC_REQUIRE(Result::NO_RATE == mng.convertPOSTransaction(toTransaction, fromTransaction, "CHF"));
+
+    // new pair connects components and shortens paths
+    TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate("INR", "USD", fromDate, 0.012));
+    TC_REQUIRE(Result::SUCCESS == mng.convertPOSTransaction(toTransaction, fromTransaction, "GBP"));
+    TC_REQUIRE(std::fabs(toTransaction.m_total - 100. * 0.09 / 0.9 / 0.012 / 100.) < 1e-9);
+    TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate("GBP", "SEK", fromDate, 12.));
+    TC_REQUIRE(Result::SUCCESS == mng.getPath(path, "SEK", "INR"));
+    TC_REQUIRE((std::vector<std::string>{ "SEK", "GBP", "INR" }) == path);
+    TC_REQUIRE(Result::SUCCESS == mng.convertPOSTransaction(toTransaction, fromTransaction, "INR"));
+    TC_REQUIRE(std::fabs(toTransaction.m_total - 100. / 12. * 100.) < 1e-9);
+
+    // path table is the same as breadth first search over random graph
+    GraphPOSTransactionManager randomMng;
+    const size_t count = 30;
+    std::vector<std::vector<size_t>> neighbours(count);
+    auto currency = [](const size_t i) { return "C" + std::to_string(i); };
+    for (int i = 0; i < 40; ++i)
+    {
+        const size_t from = rand() % count;
+        const size_t to = rand() % count;
+        if (Result::SUCCESS == randomMng.addExchangeRate(currency(from), currency(to), 0, 1.5))
+        {
+            neighbours[from].push_back(to);
+            neighbours[to].push_back(from);
+        }
+    }
+    auto currencyIndex = [](const std::string& currency) { return std::stoul(currency.substr(1)); };
+    for (size_t from = 0; from < count; ++from)
+    {
+        std::vector<size_t> hopsCounts(count, SIZE_MAX);
+        std::vector<size_t> queue = { from };
+        hopsCounts[from] = 0;
+        for (size_t i = 0; i < queue.size(); ++i)
+        {
+            for (const size_t next : neighbours[queue[i]])
+            {
+                if (SIZE_MAX == hopsCounts[next])
+                {
+                    hopsCounts[next] = hopsCounts[queue[i]] + 1;
+                    queue.push_back(next);
+                }
+            }
+        }
+        for (size_t to = 0; to < count; ++to)
+        {
+            const Result r = randomMng.getPath(path, currency(from), currency(to));
+            if (neighbours[from].empty() || neighbours[to].empty())
+            {
+                TC_REQUIRE(Result::NO_CURRENCY == r);
+                continue;
+            }
+            TC_REQUIRE(SIZE_MAX == hopsCounts[to] ? Result::CURRENCY_NOT_MATCH == r :
+                Result::SUCCESS == r && hopsCounts[to] + 1 == path.size());
+            for (size_t i = 1; i < path.size(); ++i)
+            {
+                const std::vector<size_t>& hopNeighbours = neighbours[currencyIndex(path[i - 1])];
+                TC_REQUIRE(std::find(hopNeighbours.begin(), hopNeighbours.end(), currencyIndex(path[i])) !=
+                    hopNeighbours.end());
+            }
+        }
+    }
+}
+
+void tc_rateLog()
+{
+    std::string baseCurrency("USD");
+    POSTransactionManager mng(baseCurrency);
+    POSTransactionManager logMng(baseCurrency);
+    logMng.setRateLogLimit(16);
+
+    // out of order overlapping updates, open intervals and gaps
+    auto check = [&]()
+    {
+        for (time_t date = -10; date < 1100; date += 3)
+        {
+            double rate = 0;
+            double logRate = 0;
+            const Result r = mng.getExchangeRate("EUR", date, rate);
+            TC_REQUIRE(r == logMng.getExchangeRate("EUR", date, logRate) && (Result::SUCCESS != r || rate == logRate));
+        }
+    };
+    for (int i = 0; i < 500; ++i)
+    {
+        const time_t fromDate = rand() % 1000;
+        const double rate = rand() % 10 ? 1 + rand() % 100 / 100. : -1;
+        if (rand() % 8)
+        {
+            const time_t toDate = fromDate + 1 + rand() % 100;
+            TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(baseCurrency, "EUR", fromDate, toDate, rate));
+            TC_REQUIRE(Result::SUCCESS == logMng.addExchangeRate(baseCurrency, "EUR", fromDate, toDate, rate));
+        }
+        else
+        {
+            TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(baseCurrency, "EUR", fromDate, rate));
+            TC_REQUIRE(Result::SUCCESS == logMng.addExchangeRate(baseCurrency, "EUR", fromDate, rate));
+        }
+        // lookups read unmerged log
+        if (!(i % 37))
+        {
+            check();
+        }
+    }
+    check();
+
+    // export merges log
+    POSTransactionManager::RateTrend rateTrend;
+    POSTransactionManager::RateTrend logRateTrend;
+    TC_REQUIRE(Result::SUCCESS == mng.getExchangeRates("EUR", rateTrend));
+    TC_REQUIRE(Result::SUCCESS == logMng.getExchangeRates("EUR", logRateTrend));
+    check();
+
+    // batch conversion of unmerged log
+    POSTransactionBatch batch;
+    for (time_t date = 0; date < 1100; date += 7)
+    {
+        batch.add(10, "EUR", date);
+    }
+    TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(baseCurrency, "EUR", 500, 600, 2.5));
+    TC_REQUIRE(Result::SUCCESS == logMng.addExchangeRate(baseCurrency, "EUR", 500, 600, 2.5));
+    POSTransactionBatch toBatch;
+    POSTransactionBatch logToBatch;
+    std::vector<Result> results;
+    std::vector<Result> logResults;
+    mng.convertPOSTransactionBatch(toBatch, results, batch, baseCurrency);
+    logMng.convertPOSTransactionBatch(logToBatch, logResults, batch, baseCurrency);
+    TC_REQUIRE(results == logResults);
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        TC_REQUIRE(Result::SUCCESS != results[i] || toBatch.getTotals()[i] == logToBatch.getTotals()[i]);
+    }
+
+    // disabled mode applies updates at once
+    TC_REQUIRE(Result::SUCCESS == logMng.addExchangeRate(baseCurrency, "EUR", 50, 2.));
+    logMng.setRateLogLimit(0);
+    TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(baseCurrency, "EUR", 50, 2.));
+    TC_REQUIRE(Result::SUCCESS == logMng.addExchangeRate(baseCurrency, "EUR", 20, 30, 3.));
+    TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(baseCurrency, "EUR", 20, 30, 3.));
+    check();
+}
+
+void tc_rateImporter()
+{
+    char buf[FORMAT_BUFFER_SIZE];
+    for (int i = 0; i < 10000; ++i)
+    {
+        const time_t date = static_cast<time_t>(rand()) * 2 - RAND_MAX;
+        const size_t size = formatTime(buf, date);
+        time_t parsedDate;
+        TC_REQUIRE(parseTime(buf, buf + size, parsedDate) == buf + size && date == parsedDate);
+    }
+    time_t date;
+    const std::string invalidTimes[] = { "2000-02-30 00:00:00", "2001-02-29 00:00:00", "2000-1-01 00:00:00",
+        "2000-01-01 24:00:00", "2000-01-01T00:00:00", "2000-01-01 00:00" };
+    for (const std::string& invalidTime : invalidTimes)
+    {
+        TC_REQUIRE(!parseTime(invalidTime.data(), invalidTime.data() + invalidTime.size(), date));
+    }
+
+    std::string baseCurrency("USD");
+    POSTransactionManager mng(baseCurrency);
+    const std::vector<std::string> currencies = { "EUR", "GBP", "R\"U,R" };
+    for (const std::string& currency : currencies)
+    {
+        for (int i = 0; i < 1000; ++i)
+        {
+            const time_t fromDate = rand() % 100000;
+            TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(
+                baseCurrency, currency, fromDate, fromDate + 1 + rand() % 1000, 1 + rand() % 100 / 100.));
+        }
+    }
+
+    // every currency in own file with unsorted lines, one more file overrides points
+    RateExporter exporter(ExportFormat::CSV);
+    TC_REQUIRE(Result::SUCCESS == exporter.exportRates(mng));
+    std::istringstream lines(exporter.getBuffer());
+    std::string line;
+    std::getline(lines, line);
+    std::map<std::string, std::vector<std::string>> currencyLines;
+    while (std::getline(lines, line))
+    {
+        currencyLines[line.substr(0, line.rfind(',', line.rfind(',') - 1))].push_back(line);
+    }
+    TC_REQUIRE(currencies.size() == currencyLines.size());
+    const std::string prefix = "/tmp/pos_import_test." + std::to_string(getpid());
+    std::vector<std::string> fileNames;
+    for (auto& currencyLine : currencyLines)
+    {
+        std::reverse(currencyLine.second.begin(), currencyLine.second.end());
+        fileNames.push_back(prefix + "." + std::to_string(fileNames.size()) + ".csv");
+        std::ofstream file(fileNames.back(), std::ios::binary);
+        file << "currency,date,rate\r\n";
+        for (const std::string& currencyLineText : currencyLine.second)
+        {
+            file << currencyLineText << "\r\n";
+        }
+    }
+    fileNames.push_back(prefix + ".override.csv");
+    {
+        std::ofstream file(fileNames.back(), std::ios::binary);
+        file << "EUR,1970-01-01 00:00:10,2.5\nEUR,1970-01-01 00:00:20,\n";
+    }
+    TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(baseCurrency, "EUR", 10, 20, 2.5));
+
+    POSTransactionManager importMng(baseCurrency);
+    TC_REQUIRE(Result::SUCCESS == importMng.addExchangeRate(baseCurrency, "EUR", 0, 3.));
+    TC_REQUIRE(Result::SUCCESS == importMng.addExchangeRate(baseCurrency, "JPY", 0, 100.));
+    RateImporter importer(2);
+    TC_REQUIRE(Result::SUCCESS == importer.importRates(importMng, fileNames));
+    TC_REQUIRE(currencies.size() == importer.getCurrenciesCount() && importer.getErrorLocation().empty());
+    // imported trends are replaced, other trends are kept
+    POSTransactionManager::CurrencyTrendMap importedRates = importMng.getExchangeRates();
+    TC_REQUIRE(1 == importedRates.erase("JPY"));
+    for (int i = 0; i < 10000; ++i)
+    {
+        const std::string& currency = currencies[rand() % currencies.size()];
+        const time_t date = rand() % 102000 - 1000;
+        double rate = 0;
+        double importedRate = 0;
+        const Result r = mng.getExchangeRate(currency, date, rate);
+        TC_REQUIRE(r == importMng.getExchangeRate(currency, date, importedRate) &&
+            (Result::SUCCESS != r || rate == importedRate));
+    }
+
+    // failed import changes nothing
+    {
+        std::ofstream file(fileNames.back(), std::ios::binary);
+        file << "EUR,1970-01-01 00:00:10,2.5\nEUR,1970-01-01 00:00:20,x\n";
+    }
+    TC_REQUIRE(Result::INVALID_FORMAT == importer.importRates(importMng, fileNames));
+    TC_REQUIRE(fileNames.back() + ":2" == importer.getErrorLocation());
+    {
+        std::ofstream file(fileNames.back(), std::ios::binary);
+        file << "USD,1970-01-01 00:00:10,2.5\n";
+    }
+    TC_REQUIRE(Result::CURRENCY_NOT_MATCH == importer.importRates(importMng, fileNames));
+    for (const std::string& fileName : fileNames)
+    {
+        remove(fileName.c_str());
+    }
+    TC_REQUIRE(Result::IO_ERROR == importer.importRates(importMng, fileNames));
+    TC_REQUIRE(fileNames[0] + ":0" == importer.getErrorLocation());
+    importedRates.emplace("JPY", POSTransactionManager::RateTrend());
+    TC_REQUIRE(importMng.getExchangeRates().size() == importedRates.size());
+    double rate;
+    TC_REQUIRE(Result::SUCCESS == importMng.getExchangeRate("EUR", 15, rate) && 2.5 == rate);
+
+    // exported currency with line breaks is imported back
+    POSTransactionManager lineBreakMng(baseCurrency);
+    TC_REQUIRE(Result::SUCCESS == lineBreakMng.addExchangeRate(baseCurrency, "R\r\nU\nR", 10, 20, 2.5));
+    TC_REQUIRE(Result::SUCCESS == lineBreakMng.addExchangeRate(baseCurrency, "EUR", 30, 0.9));
+    TC_REQUIRE(Result::SUCCESS == exporter.exportRates(lineBreakMng));
+    {
+        std::ofstream file(fileNames[0], std::ios::binary);
+        file << exporter.getBuffer() << "EUR,1970-01-01 00:00:40,x\n";
+    }
+    // error line counts line breaks of quoted currency
+    TC_REQUIRE(Result::INVALID_FORMAT == importer.importRates(importMng, { fileNames[0] }));
+    TC_REQUIRE(fileNames[0] + ":9" == importer.getErrorLocation());
+    {
+        std::ofstream file(fileNames[0], std::ios::binary);
+        file << exporter.getBuffer();
+    }
+    POSTransactionManager lineBreakImportMng(baseCurrency);
+    TC_REQUIRE(Result::SUCCESS == importer.importRates(lineBreakImportMng, { fileNames[0] }));
+    TC_REQUIRE(lineBreakMng.getExchangeRates() == lineBreakImportMng.getExchangeRates());
+    remove(fileNames[0].c_str());
+}
+
+void tc_rateSubscriptions()
+{
+    // subscriber waits on gate in notification
+    class Subscriber : public RateSubscriber
+    {
+    public:
+        std::mutex m_guard;
+        std::condition_variable m_cv;
+        bool m_open = true;
+        bool m_entered = false;
+        std::vector<RateChange> m_changes;
+        size_t m_batchesCount = 0;
+
+        void onRateChanges(const std::vector<RateChange>& changes) override
+        {
+            std::unique_lock<std::mutex> l(m_guard);
+            m_entered = true;
+            m_cv.notify_all();
+            m_cv.wait(l, [this] () { return m_open; });
+            m_changes.insert(m_changes.end(), changes.begin(), changes.end());
+            ++ m_batchesCount;
+        }
+        // every change is covered by delivered interval of its currency
+        bool covers(const std::vector<RateChange>& changes)
+        {
+            for (const RateChange& change : changes)
+            {
+                if (m_changes.end() == std::find_if(m_changes.begin(), m_changes.end(), [&change] (const RateChange& c)
+                    {
+                        return c.m_currency == change.m_currency &&
+                            c.m_fromDate <= change.m_fromDate && c.m_toDate >= change.m_toDate;
+                    }))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+    };
+
+    std::string baseCurrency("USD");
+    POSTransactionManager mng(baseCurrency);
+    RateSubscriptions subscriptions(mng);
+    Subscriber all;
+    Subscriber eur;
+    Subscriber slow;
+    Subscriber dropping;
+    Subscriber resync;
+    RateSubscriptions::SubscriptionId id;
+    TC_REQUIRE(Result::NO_CURRENCY == subscriptions.subscribe(id, all, {}));
+    TC_REQUIRE(Result::CURRENCY_NOT_MATCH == subscriptions.subscribe(id, all, { "EUR", baseCurrency }));
+    TC_REQUIRE(Result::SUCCESS == subscriptions.subscribe(id, all, { "EUR", "GBP", "EUR" }));
+    TC_REQUIRE(Result::SUCCESS == subscriptions.subscribe(id, eur, { "EUR" }));
+    TC_REQUIRE(Result::SUCCESS == subscriptions.subscribe(id, slow, { "EUR", "GBP" }, 4));
+    RateSubscriptions::SubscriptionId droppingId;
+    TC_REQUIRE(Result::SUCCESS == subscriptions.subscribe(
+        droppingId, dropping, { "GBP" }, 4, OverflowPolicy::DROP_NEWEST));
+    TC_REQUIRE(Result::SUCCESS == subscriptions.subscribe(id, resync, { "GBP" }, 4, OverflowPolicy::RESYNC));
+
+    // slow subscriber is blocked, writers are not
+    slow.m_open = dropping.m_open = resync.m_open = false;
+    TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(baseCurrency, "GBP", 0, 10, 0.8));
+    {
+        std::unique_lock<std::mutex> l(slow.m_guard);
+        slow.m_cv.wait(l, [&slow] () { return slow.m_entered; });
+    }
+    const std::vector<std::string> currencies = { "EUR", "GBP", "JPY" };
+    std::vector<RateChange> changes = { RateChange{ "GBP", 0, 10 } };
+    for (int i = 0; i < 1000; ++i)
+    {
+        const std::string& currency = currencies[rand() % currencies.size()];
+        const time_t fromDate = rand() % 100000;
+        const time_t toDate = fromDate + 1 + rand() % 1000;
+        TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(baseCurrency, currency, fromDate, toDate, 1.5));
+        changes.push_back(RateChange{ currency, fromDate, toDate });
+    }
+    TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(baseCurrency, "EUR", 200000, 2.));
+    changes.push_back(RateChange{ "EUR", 200000, std::numeric_limits<time_t>::max() });
+    for (Subscriber* subscriber : { &slow, &dropping, &resync })
+    {
+        std::unique_lock<std::mutex> l(subscriber->m_guard);
+        subscriber->m_open = true;
+        subscriber->m_cv.notify_all();
+    }
+    subscriptions.flush();
+
+    auto currencyChanges = [&changes] (const std::vector<std::string>& currencies)
+    {
+        std::vector<RateChange> result;
+        std::copy_if(changes.begin(), changes.end(), std::back_inserter(result), [&currencies] (const RateChange& c)
+        {
+            return currencies.end() != std::find(currencies.begin(), currencies.end(), c.m_currency);
+        });
+        return result;
+    };
+    auto currencyCount = [] (const std::vector<RateChange>& changes, const std::string& currency)
+    {
+        return static_cast<size_t>(std::count_if(changes.begin(), changes.end(), [&currency] (const RateChange& c)
+        {
+            return c.m_currency == currency;
+        }));
+    };
+    TC_REQUIRE(all.covers(currencyChanges({ "EUR", "GBP" })) && 0 == currencyCount(all.m_changes, "JPY"));
+    TC_REQUIRE(eur.covers(currencyChanges({ "EUR" })) && eur.m_changes.size() == currencyCount(eur.m_changes, "EUR"));
+    // changes were coalesced while subscriber was busy
+    TC_REQUIRE(2 == slow.m_batchesCount && slow.covers(currencyChanges({ "EUR", "GBP" })));
+    TC_REQUIRE(slow.m_changes.size() <= 1 + 2 * 4);
+    // first change was queued behind slow subscriber too
+    TC_REQUIRE(1 == resync.m_batchesCount && resync.covers(currencyChanges({ "GBP" })));
+    TC_REQUIRE(std::numeric_limits<time_t>::min() == resync.m_changes.back().m_fromDate);
+    TC_REQUIRE(0 < subscriptions.getDroppedCount(droppingId) && 4 == dropping.m_changes.size());
+    TC_REQUIRE(0 == subscriptions.getDroppedCount(id));
+
+    // unsubscribed subscriber gets nothing
+    subscriptions.unsubscribe(droppingId);
+    TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(baseCurrency, "GBP", 300000, 2.));
+    subscriptions.flush();
+    TC_REQUIRE(4 == dropping.m_changes.size() && 300000 == resync.m_changes.back().m_fromDate);
+
+    // unsubscribe drops the only queued change while flush waits for it
+    for (int i = 0; i < 200; ++i)
+    {
+        Subscriber queued;
+        TC_REQUIRE(Result::SUCCESS == subscriptions.subscribe(id, queued, { "CHF" }));
+        TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(baseCurrency, "CHF", i, 1.1));
+        std::promise<void> flushed;
+        std::thread flusher([&] ()
+        {
+            subscriptions.flush();
+            flushed.set_value();
+        });
+        subscriptions.unsubscribe(id);
+        const bool stuck = std::future_status::timeout == flushed.get_future().wait_for(std::chrono::seconds(5));
+        // unrelated delivery releases flush that is stuck
+        mng.addExchangeRate(baseCurrency, "EUR", 300000 + i, 2.);
+        flusher.join();
+        TC_REQUIRE(!stuck);
+    }
+
+    // flush from subscriber does not wait for itself
+    class FlushingSubscriber : public RateSubscriber
+    {
+    public:
+        RateSubscriptions* m_subscriptions = nullptr;
+        size_t m_batchesCount = 0;
+
+        void onRateChanges(const std::vector<RateChange>&) override
+        {
+            m_subscriptions->flush();
+            ++ m_batchesCount;
+        }
+    };
+    FlushingSubscriber flushing;
+    flushing.m_subscriptions = &subscriptions;
+    TC_REQUIRE(Result::SUCCESS == subscriptions.subscribe(id, flushing, { "CHF" }));
+    TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(baseCurrency, "CHF", 1000, 1.2));
+    subscriptions.flush();
+    TC_REQUIRE(1 == flushing.m_batchesCount);
+    subscriptions.unsubscribe(id);
+}
+
+void tc_memoryUsage()
+{
+    // node size matches nodes allocated by trend
+    {
+        RateTrend rateTrend(RateTrend::allocator_type(std::make_shared<NodePool>()));
+        rateTrend.emplace(0, 1.);
+        TC_REQUIRE((RATE_TREND_NODE_SIZE + 15) / 16 * 16 == rateTrend.get_allocator().m_pool->getSlotSize());
+    }
+
+    for (const bool useNodePools : { false, true })
+    {
+        std::string baseCurrency("USD");
+        POSTransactionManager mng(baseCurrency, useNodePools);
+        const std::string longCurrency("CURRENCY WITH LONG NAME");
+        const std::vector<std::string> currencies = { "GBP", longCurrency, "EUR" };
+        for (const std::string& currency : currencies)
+        {
+            for (int i = 0; i < 10000; ++i)
+            {
+                // every rate repeats once
+                TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(baseCurrency, currency, i * 3600, 1 + i / 2 / 100.));
+            }
+        }
+        // churn: most points are overwritten by gaps and long intervals
+        for (int i = 0; i < 1000; ++i)
+        {
+            const time_t fromDate = i * 36000;
+            TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(baseCurrency, "EUR", fromDate, fromDate + 30000, 2.));
+            TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(baseCurrency, "GBP", fromDate, fromDate + 30000, -1));
+        }
+
+        MemoryUsage memoryUsage = mng.getMemoryUsage();
+        const POSTransactionManager::CurrencyTrendMap rates = mng.getExchangeRates();
+        TC_REQUIRE(currencies.size() == memoryUsage.m_currencies.size());
+        CurrencyMemoryUsage sum;
+        for (size_t i = 0; i < memoryUsage.m_currencies.size(); ++i)
+        {
+            const CurrencyMemoryUsage& usage = memoryUsage.m_currencies[i];
+            TC_REQUIRE(0 == i || memoryUsage.m_currencies[i - 1].m_currency < usage.m_currency);
+            TC_REQUIRE(rates.find(usage.m_currency)->second.size() == usage.m_pointsCount);
+            TC_REQUIRE(usage.m_trendBytes >= usage.m_pointsCount * RATE_TREND_NODE_SIZE);
+            sum.m_pointsCount += usage.m_pointsCount;
+            sum.m_trendBytes += usage.m_trendBytes;
+            sum.m_keyBytes += usage.m_keyBytes;
+            sum.m_overheadBytes += usage.m_overheadBytes;
+        }
+        TC_REQUIRE(memoryUsage.m_currencies[0].m_keyBytes > memoryUsage.m_currencies[1].m_keyBytes);
+        TC_REQUIRE(memoryUsage.m_total.m_pointsCount == sum.m_pointsCount &&
+            memoryUsage.m_total.m_trendBytes == sum.m_trendBytes &&
+            memoryUsage.m_total.m_keyBytes == sum.m_keyBytes &&
+            memoryUsage.m_total.m_overheadBytes > sum.m_overheadBytes);
+
+        std::vector<std::tuple<std::string, time_t, Result, double>> lookups;
+        for (int i = 0; i < 10000; ++i)
+        {
+            const std::string& currency = currencies[rand() % currencies.size()];
+            const time_t date = rand() % (10001 * 3600) - 3600;
+            double rate = 0;
+            const Result r = mng.getExchangeRate(currency, date, rate);
+            lookups.emplace_back(currency, date, r, Result::SUCCESS == r ? rate : 0);
+        }
+
+        const size_t removedCount = mng.compact();
+        const MemoryUsage compactedUsage = mng.getMemoryUsage();
+        TC_REQUIRE(0 < removedCount && removedCount == sum.m_pointsCount - compactedUsage.m_total.m_pointsCount);
+        TC_REQUIRE(compactedUsage.m_total.getBytes() < memoryUsage.m_total.getBytes());
+        if (useNodePools)
+        {
+            // free slots of churned pools are released
+            TC_REQUIRE(compactedUsage.m_currencies[1].m_overheadBytes * 2 < memoryUsage.m_currencies[1].m_overheadBytes);
+        }
+        for (const auto& lookup : lookups)
+        {
+            double rate = 0;
+            const Result r = mng.getExchangeRate(std::get<0>(lookup), std::get<1>(lookup), rate);
+            TC_REQUIRE(std::get<2>(lookup) == r && (Result::SUCCESS != r || std::get<3>(lookup) == rate));
+        }
+        TC_REQUIRE(0 == mng.compact());
+    }
+}
+
+void tc_money()
+{
+    // half to even
+    TC_REQUIRE(2 == convertAmount(25, 10, 1) && 4 == convertAmount(35, 10, 1) && 3 == convertAmount(26, 10, 1));
+    TC_REQUIRE(-2 == convertAmount(-25, 10, 1) && -4 == convertAmount(-35, 10, 1) && -3 == convertAmount(-26, 10, 1));
+    TC_REQUIRE(0 == convertAmount(1, 2, 1) && 2 == convertAmount(3, 2, 1) && 0 == convertAmount(0, 3, 7));
+    const int64_t maxAmount = std::numeric_limits<int64_t>::max();
+    TC_REQUIRE(maxAmount == convertAmount(maxAmount, RATE_SCALE, RATE_SCALE));
+    TC_REQUIRE(-maxAmount == convertAmount(-maxAmount, 3, 3));
+    TC_REQUIRE(INVALID_AMOUNT == convertAmount(maxAmount, RATE_SCALE, RATE_SCALE + 1));
+    TC_REQUIRE(INVALID_AMOUNT == convertAmount(INVALID_AMOUNT, 1, 1) && INVALID_AMOUNT == convertAmount(1, 0, 1));
+
+    int64_t fixedRate;
+    TC_REQUIRE(Result::SUCCESS == toFixedRate(1., fixedRate) && RATE_SCALE == fixedRate);
+    TC_REQUIRE(Result::SUCCESS == toFixedRate(0.9, fixedRate) && 900000000 == fixedRate);
+    TC_REQUIRE(Result::NO_RATE == toFixedRate(0, fixedRate) && Result::NO_RATE == toFixedRate(-1, fixedRate));
+    TC_REQUIRE(Result::NO_RATE == toFixedRate(std::numeric_limits<double>::quiet_NaN(), fixedRate));
+    TC_REQUIRE(Result::AMOUNT_OVERFLOW == toFixedRate(1e-12, fixedRate));
+    TC_REQUIRE(Result::AMOUNT_OVERFLOW == toFixedRate(1e10, fixedRate));
+
+    // result is checked by exact remainder: |amount * toRate - result * fromRate| <= fromRate / 2
+    auto random64 = []()
+    {
+        return static_cast<int64_t>(static_cast<uint64_t>(rand()) << 33 ^ static_cast<uint64_t>(rand()) << 11 ^ rand());
+    };
+    const size_t count = 10003;
+    std::vector<int64_t> amounts(count);
+    std::vector<int64_t> fromRates(count);
+    std::vector<int64_t> toRates(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        const int kind = rand() % 4;
+        amounts[i] = 0 == kind ? random64() : (1 == kind ? rand() % 2000001 - 1000000 : random64() >> (rand() % 63));
+        fromRates[i] = 3 == kind ? rand() % 20 + 1 : (random64() >> (rand() % 63)) & maxAmount;
+        toRates[i] = (random64() >> (rand() % 63)) & maxAmount;
+        if (!(rand() % 100))
+        {
+            toRates[i] = 0;
+        }
+        const int64_t amount = convertAmount(amounts[i], fromRates[i], toRates[i]);
+        if (fromRates[i] <= 0 || toRates[i] <= 0 || INVALID_AMOUNT == amounts[i])
+        {
+            TC_REQUIRE(INVALID_AMOUNT == amount);
+            continue;
+        }
+        const __int128 product = static_cast<__int128>(amounts[i]) * toRates[i];
+        if (INVALID_AMOUNT == amount)
+        {
+            TC_REQUIRE((product < 0 ? -product : product) / fromRates[i] >= maxAmount);
+            continue;
+        }
+        const __int128 diff = product - static_cast<__int128>(amount) * fromRates[i];
+        const __int128 doubleDiff = 2 * (diff < 0 ? -diff : diff);
+        TC_REQUIRE(doubleDiff < fromRates[i] || (doubleDiff == fromRates[i] && 0 == amount % 2));
+    }
+
+    // batch kernel is the same as scalar conversion, including tails
+    std::vector<int64_t> batchAmounts(count + 1, 1);
+    for (const size_t batchCount : { size_t(0), size_t(1), size_t(3), size_t(4), size_t(5), count })
+    {
+        const size_t invalidCount = convertAmounts(
+            batchAmounts.data(), amounts.data(), fromRates.data(), toRates.data(), batchCount);
+        size_t expectedInvalidCount = 0;
+        for (size_t i = 0; i < batchCount; ++i)
+        {
+            const int64_t amount = convertAmount(amounts[i], fromRates[i], toRates[i]);
+            TC_REQUIRE(amount == batchAmounts[i]);
+            expectedInvalidCount += INVALID_AMOUNT == amount;
+        }
+        TC_REQUIRE(1 == batchAmounts[batchCount] && expectedInvalidCount == invalidCount);
+    }
+
+    std::string baseCurrency("USD");
+    POSTransactionManager mng(baseCurrency);
+    TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(baseCurrency, "EUR", 0, 0.9));
+    TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(baseCurrency, "GBP", 0, 100, 0.8));
+    TC_REQUIRE(Result::SUCCESS == mng.addExchangeRate(baseCurrency, "JPY", 0, 1e-11));
+    MoneyTransaction toTransaction;
+    TC_REQUIRE(Result::SUCCESS == mng.convertPOSTransaction(toTransaction, MoneyTransaction{ 1000, "EUR", 10 }, "USD"));
+    TC_REQUIRE(1111 == toTransaction.m_amount && "USD" == toTransaction.m_currency && 10 == toTransaction.m_date);
+    TC_REQUIRE(Result::SUCCESS == mng.convertPOSTransaction(toTransaction, MoneyTransaction{ 1000, "EUR", 10 }, "GBP"));
+    TC_REQUIRE(889 == toTransaction.m_amount);
+    TC_REQUIRE(Result::NO_RATE == mng.convertPOSTransaction(
+        toTransaction, MoneyTransaction{ 1000, "EUR", 100 }, "GBP"));
+    TC_REQUIRE(Result::AMOUNT_OVERFLOW == mng.convertPOSTransaction(
+        toTransaction, MoneyTransaction{ 1, "JPY", 10 }, "USD"));
+    TC_REQUIRE(Result::AMOUNT_OVERFLOW == mng.convertPOSTransaction(
+        toTransaction, MoneyTransaction{ maxAmount, "GBP", 10 }, "USD"));
+
+    // batch conversion is the same as conversion of every row
+    const std::vector<std::string> currencies = { "EUR", "GBP", "USD", "SEK" };
+    for (const std::string& toCurrency : currencies)
+    {
+        POSTransactionBatch batch;
+        std::vector<int64_t> fromAmounts;
+        for (int i = 0; i < 1000; ++i)
+        {
+            fromAmounts.push_back(rand() % 20000001 - 10000000);
+            batch.add(0, currencies[rand() % currencies.size()], rand() % 200);
+        }
+        fromAmounts.back() = maxAmount;
+        std::vector<int64_t> toAmounts;
+        std::vector<Result> results;
+        const Result r = mng.convertPOSTransactionBatch(toAmounts, results, fromAmounts, batch, toCurrency);
+        Result expectedResult = Result::SUCCESS;
+        for (size_t i = 0; i < batch.size(); ++i)
+        {
+            const MoneyTransaction fromTransaction = { fromAmounts[i], batch.get(i).m_currency, batch.get(i).m_date };
+            const Result rowResult = mng.convertPOSTransaction(toTransaction, fromTransaction, toCurrency);
+            TC_REQUIRE(rowResult == results[i] &&
+                (Result::SUCCESS == rowResult ? toTransaction.m_amount : INVALID_AMOUNT) == toAmounts[i]);
+            expectedResult = Result::SUCCESS == expectedResult ? rowResult : expectedResult;
+        }
+        TC_REQUIRE(expectedResult == r);
+    }
+    std::vector<Result> results;
+    TC_REQUIRE(Result::INVALID_FORMAT == mng.convertPOSTransactionBatch(
+        batchAmounts, results, std::vector<int64_t>(1), POSTransactionBatch(), "EUR"));
+}
+
 static std::vector<TestCase> tests =
 {
     TEST_CASE(tc_init),
@@ -631,6 +3112,32 @@ static std::vector<TestCase> tests =
     TEST_CASE(tc_convertPOSTransactionOtherToSame),
     TEST_CASE(tc_convertPOSTransactionBaseOther),
     TEST_CASE(tc_convertPOSTransactionOtherOther),
+    TEST_CASE(tc_lockTrace),
+    TEST_CASE(tc_compressedRateTrend),
+    TEST_CASE(tc_expireExchangeRates),
+    TEST_CASE(tc_retentionScheduler),
+    TEST_CASE(tc_asyncRateIngestor),
+    TEST_CASE(tc_multiBasePOSTransactionManager),
+    TEST_CASE(tc_tieredPOSTransactionManager),
+    TEST_CASE(tc_workloadRecordReplay),
+    TEST_CASE(tc_deferredConversions),
+    TEST_CASE(tc_dayRateIndex),
+    TEST_CASE(tc_numaReplicatedPOSTransactionManager),
+    TEST_CASE(tc_posTransactionBatch),
+    TEST_CASE(tc_transactionArchive),
+    TEST_CASE(tc_radixSort),
+    TEST_CASE(tc_rateExporter),
+    TEST_CASE(tc_rateTrendAllocator),
+    TEST_CASE(tc_conversionDaemon),
+    TEST_CASE(tc_sharedRateTable),
+    TEST_CASE(tc_conversionLedger),
+    TEST_CASE(tc_dailyTotals),
+    TEST_CASE(tc_graphPOSTransactionManager),
+    TEST_CASE(tc_rateLog),
+    TEST_CASE(tc_rateImporter),
+    TEST_CASE(tc_rateSubscriptions),
+    TEST_CASE(tc_memoryUsage),
+    TEST_CASE(tc_money),
 };
 
 } // namespace test
@@ -640,6 +3147,7 @@ using namespace pos::test;
 
 int main(int agrc, char* argv[])
 {
+    int failedCount = 0;
     for (auto& test : tests)
     {
         try
@@ -651,7 +3159,8 @@ int main(int agrc, char* argv[])
         {
             fprintf(stderr, "'%s' testcase failed (%s:%d)\n", test.m_name.c_str(),
                 e.m_file, e.m_line);
+            ++ failedCount;
         }
     }
-    return 0;
+    return failedCount ? 1 : 0;
 }
\ No newline at end of file